@@ -0,0 +1,44 @@
+// Test that a batch insert into a capped collection which has to delete documents of the same
+// batch leaves no index entries for the deleted documents, and that a batch with a bad document
+// in it inserts everything else.
+
+var t = db.capped_batch_insert;
+t.drop();
+
+assert.commandWorked(db.createCollection(t.getName(), {capped: true, size: 64 * 1024, max: 5}));
+assert.commandWorked(t.ensureIndex({a: 1}));
+
+var docs = [];
+for (var i = 0; i < 10; i++) {
+    docs.push({_id: i, a: i});
+}
+assert.writeOK(t.insert(docs));
+
+assert.eq(5, t.count());
+assert.eq(5, t.find().hint({_id: 1}).itcount());
+assert.eq(5, t.find().hint({a: 1}).itcount());
+assert.eq([5, 6, 7, 8, 9], t.find().sort({$natural: 1}).toArray().map(function(doc) {
+    return doc._id;
+}));
+
+var validate = t.validate(true);
+assert(validate.valid, tojson(validate));
+
+// A duplicate key in the middle of an unordered batch fails only that document.
+var u = db.capped_batch_insert_dups;
+u.drop();
+assert.commandWorked(u.ensureIndex({a: 1}, {unique: true}));
+
+docs = [];
+for (var i = 0; i < 100; i++) {
+    docs.push({_id: i, a: i == 50 ? 10 : i});
+}
+var res = u.insert(docs, {ordered: false});
+assert.eq(99, res.nInserted, tojson(res));
+assert.eq(1, res.getWriteErrors().length, tojson(res));
+assert.eq(50, res.getWriteErrors()[0].index, tojson(res));
+assert.eq(99, u.count());
+assert(u.validate(true).valid);
+
+t.drop();
+u.drop();
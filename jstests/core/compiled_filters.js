@@ -0,0 +1,63 @@
+// Collection scans and fetches match documents with a compiled form of the filter unless
+// internalQueryExecCompileFilters is off. Both must return the same documents.
+
+var t = db.compiled_filters;
+t.drop();
+
+t.insert({_id: 0});
+t.insert({_id: 1, a: 1, b: "x"});
+t.insert({_id: 2, a: 5, b: "y", c: true});
+t.insert({_id: 3, a: NumberLong(5), b: null});
+t.insert({_id: 4, a: 5.5, b: ["x", "z"]});
+t.insert({_id: 5, a: [1, 5, 9], b: {c: 2}});
+t.insert({_id: 6, a: [], c: 10});
+t.insert({_id: 7, a: null, b: "abc"});
+t.insert({_id: 8, a: "5", b: [{c: 1}, {c: 3}]});
+t.insert({_id: 9, a: {b: 5}, c: NaN});
+
+var queries = [
+    {a: 5},
+    {a: {$gt: 1, $lte: 9}},
+    {a: null},
+    {a: {$in: [1, "5", null]}},
+    {a: {$nin: [5]}},
+    {a: {$exists: false}},
+    {a: {$type: 4}},
+    {b: /^a/},
+    {c: {$mod: [2, 0]}},
+    {c: {$ne: 10}},
+    {$or: [{a: 1}, {b: "z"}, {c: true}]},
+    {$nor: [{a: 5}, {b: null}]},
+    {a: {$not: {$lt: 5}}},
+    {"a.b": 5},
+    {"b.c": {$gte: 2}},
+    {b: {$elemMatch: {c: 3}}},
+    {a: {$size: 3}, b: {$exists: true}},
+    {$where: "this.c == 10"}
+];
+
+function run(query, hint) {
+    return t.find(query).hint(hint).sort({_id: 1}).toArray();
+}
+
+function setCompileFilters(enabled) {
+    assert.commandWorked(db.adminCommand({setParameter: 1,
+                                          internalQueryExecCompileFilters: enabled}));
+}
+
+try {
+    t.ensureIndex({_id: 1, x: 1});
+    var results = [];
+    setCompileFilters(false);
+    queries.forEach(function(query) {
+        results.push([run(query, {$natural: 1}), run(query, {_id: 1, x: 1})]);
+    });
+
+    setCompileFilters(true);
+    queries.forEach(function(query, i) {
+        assert.eq(results[i][0], run(query, {$natural: 1}), "collection scan: " + tojson(query));
+        assert.eq(results[i][1], run(query, {_id: 1, x: 1}), "fetch: " + tojson(query));
+    });
+} finally {
+    setCompileFilters(true);
+}
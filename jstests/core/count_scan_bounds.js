@@ -0,0 +1,40 @@
+// Test that counts over several index intervals, or with a filter the index keys can answer, are
+// done by a COUNT_SCAN without looking at any documents.
+
+var t = db.count_scan_bounds;
+t.drop();
+
+assert.commandWorked(t.ensureIndex({a: 1, b: 1}));
+for (var i = 0; i < 200; i++) {
+    assert.writeOK(t.insert({a: i % 10, b: i % 20, c: "str" + i}));
+}
+
+function checkCount(query, expectCountScan) {
+    assert.eq(t.find(query).hint({$natural: 1}).itcount(), t.count(query), tojson(query));
+
+    var explain = t.explain("executionStats").count(query);
+    var stage = explain.queryPlanner.winningPlan.inputStage;
+    if (expectCountScan) {
+        assert.eq("COUNT_SCAN", stage.stage, tojson(explain));
+        assert.eq(0, explain.executionStats.totalDocsExamined, tojson(explain));
+    }
+    else {
+        assert.neq("COUNT_SCAN", stage.stage, tojson(explain));
+    }
+}
+
+checkCount({a: {$in: [1, 3, 7]}}, true);
+checkCount({a: {$in: [1, 3]}, b: {$gt: 5}}, true);
+checkCount({a: {$gte: 2, $lt: 6}, b: {$in: [4, 12, 14]}}, true);
+checkCount({a: {$in: [2, 4]}, b: {$mod: [4, 0]}}, true);
+checkCount({a: 5, b: {$ne: 5}}, true);
+
+// A predicate on a field outside the index needs the documents.
+checkCount({a: {$in: [1, 3]}, c: "str1"}, false);
+
+// Multikey indexes are deduplicated.
+assert.writeOK(t.insert({a: [1, 3], b: 11}));
+checkCount({a: {$in: [1, 3]}, b: 11}, true);
+assert.eq(11, t.count({a: {$in: [1, 3]}, b: 11}));
+
+t.drop();
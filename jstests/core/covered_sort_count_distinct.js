@@ -0,0 +1,60 @@
+// Test that blocking sorts under a covered projection, counts with a filter on indexed fields,
+// and distincts with a filter on indexed fields are answered from the index keys alone.
+
+load("jstests/libs/analyze_plan.js");
+
+var t = db.covered_sort_count_distinct;
+t.drop();
+
+assert.commandWorked(t.ensureIndex({a: 1, b: 1}));
+for (var i = 0; i < 100; i++) {
+    assert.writeOK(t.insert({a: i % 10, b: "str" + (99 - i), c: i}));
+}
+
+// Covered blocking sort.
+var query = {a: {$gte: 5}};
+var proj = {_id: 0, a: 1, b: 1};
+var docs = t.find(query, proj).sort({b: 1}).toArray();
+assert.eq(50, docs.length);
+for (var i = 1; i < docs.length; i++) {
+    assert.lt(docs[i - 1].b, docs[i].b, tojson(docs));
+}
+assert.eq(docs, t.find(query, proj).sort({b: 1}).hint({$natural: 1}).toArray());
+
+var explain = t.find(query, proj).sort({b: 1}).explain("executionStats");
+assert(isCovered(explain.queryPlanner), tojson(explain));
+assert.eq(0, explain.executionStats.totalDocsExamined, tojson(explain));
+
+// Sorting on an index field that isn't projected is still covered.
+docs = t.find(query, {_id: 0, a: 1}).sort({b: -1}).limit(3).toArray();
+assert.eq([{a: 5}, {a: 6}, {a: 7}], docs);
+
+// Sorting on a field outside the index needs the documents.
+explain = t.find(query, {_id: 0, a: 1}).sort({c: 1}).explain("executionStats");
+assert(!isCovered(explain.queryPlanner), tojson(explain));
+assert.eq(50, explain.executionStats.totalDocsExamined, tojson(explain));
+
+// Count with a filter the index keys can answer.
+query = {a: {$in: [1, 2]}, b: /5/};
+assert.eq(t.find(query).hint({$natural: 1}).itcount(), t.count(query));
+explain = t.explain("executionStats").count(query);
+assert(isCovered(explain.queryPlanner), tojson(explain));
+assert.eq(0, explain.executionStats.totalDocsExamined, tojson(explain));
+
+// Count with a filter on an unindexed field still fetches.
+explain = t.explain("executionStats").count({a: 1, c: 1});
+assert(!isCovered(explain.queryPlanner), tojson(explain));
+
+// Distinct with a filter on an indexed field.
+var values = t.distinct("a", {b: /9$/});
+assert.eq([0], values);
+values = t.distinct("a", {b: /^str[0-4]$/});
+values.sort();
+assert.eq([5, 6, 7, 8, 9], values);
+
+// Once the index is multikey nothing can be covered.
+assert.writeOK(t.insert({a: [1, 2], b: "str"}));
+explain = t.find({a: {$gte: 5}}, {_id: 0, a: 1, b: 1}).sort({b: 1}).explain();
+assert(!isCovered(explain.queryPlanner), tojson(explain));
+
+t.drop();
@@ -0,0 +1,59 @@
+// Hashed indexes can choose their hash function with the "hashVersion" option: 0 (MD5, the
+// default) or 1 (MurmurHash3).
+
+var t = db.hashindex_version;
+t.drop();
+
+var createIndex = function( spec ) {
+    spec.key = { a : "hashed" };
+    return db.runCommand( { createIndexes : t.getName() , indexes : [ spec ] } );
+};
+
+var keysFor = function( query , name ) {
+    return t.find( query ).hint( name )._addSpecial( "$returnKey" , true ).toArray();
+};
+
+var hash = function( v , hashVersion ) {
+    var res = db.runCommand( { "_hashBSONElement" : v , "hashVersion" : hashVersion } );
+    assert.commandWorked( res );
+    return res.out;
+};
+
+// the versions are different functions of the same canonical form
+assert.eq( hash( NumberInt(3) , 1 ) , hash( 3.2 , 1 ) , "numeric types should hash the same" );
+assert.neq( hash( 3 , 0 ) , hash( 3 , 1 ) , "versions 0 and 1 should differ" );
+assert.commandFailed( db.runCommand( { "_hashBSONElement" : 3 , "hashVersion" : 2 } ) );
+
+// unknown versions are rejected when the index is built
+assert.commandFailed( createIndex( { name : "v2" , hashVersion : 2 } ) );
+assert.eq( 1 , t.getIndexes().length , "index with unknown hashVersion got created" );
+
+for ( var i = 0; i < 100; i++ ) {
+    t.insert( { _id : i , a : i % 2 ? i : "s" + i } );
+}
+t.insert( { _id : 100 } );
+
+assert.commandWorked( createIndex( { name : "v1" , hashVersion : 1 } ) );
+assert.commandWorked( createIndex( { name : "v0" } ) );
+
+[ "v0" , "v1" ].forEach( function( name ) {
+    var hashVersion = name == "v1" ? 1 : 0;
+
+    // the keys are the hashes of the chosen version
+    var keys = keysFor( { a : 7 } , name );
+    assert.eq( 1 , keys.length , name );
+    assert.eq( hash( 7 , hashVersion ) , keys[0].a , name );
+
+    // equality and $in use the index's version to build bounds
+    assert.eq( 7 , t.find( { a : 7 } ).hint( name ).next()._id , name );
+    assert.eq( 8 , t.find( { a : "s8" } ).hint( name ).next()._id , name );
+    assert.eq( 3 , t.find( { a : { $in : [ 1 , "s2" , 9 ] } } ).hint( name ).itcount() , name );
+
+    // a missing field is indexed as the hash of null
+    assert.eq( 100 , t.find( { a : null } ).hint( name ).next()._id , name );
+} );
+
+// the versions are kept through a reIndex
+assert.commandWorked( t.reIndex() );
+var keys = keysFor( { a : 7 } , "v1" );
+assert.eq( hash( 7 , 1 ) , keys[0].a );
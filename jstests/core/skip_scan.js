@@ -0,0 +1,142 @@
+// Test that distincts on a non-leading index field with equality on the fields before it, and
+// $group stages with only $first or only $last accumulators after a $sort an index provides, skip
+// from one value of the field to the next instead of looking at every index key.
+
+var t = db.skip_scan;
+t.drop();
+
+assert.commandWorked(t.ensureIndex({a: 1, b: 1, c: 1}));
+for (var i = 0; i < 1000; i++) {
+    assert.writeOK(t.insert({a: i % 4, b: i % 10, c: i, d: "str" + i}));
+}
+
+function getStage(explain, stageName) {
+    var found = null;
+    function walk(stage) {
+        if (stage.stage === stageName) {
+            found = stage;
+        }
+        if (stage.inputStage) {
+            walk(stage.inputStage);
+        }
+        if (stage.inputStages) {
+            stage.inputStages.forEach(walk);
+        }
+    }
+    walk(explain.queryPlanner ? explain.queryPlanner.winningPlan : explain);
+    return found;
+}
+
+function sorted(values) {
+    return values.sort(function(x, y) { return x - y; });
+}
+
+//
+// distinct
+//
+
+var values = t.distinct("b", {a: 1});
+assert.eq([1, 3, 5, 7, 9], sorted(values));
+
+var res = t.runCommand("distinct", {key: "b", query: {a: 1}});
+assert.commandWorked(res);
+assert.eq(/DISTINCT_SCAN/.test(res.stats.planSummary), true, tojson(res));
+assert.lte(res.stats.nscanned, 10, tojson(res));
+assert.eq(0, res.stats.nscannedObjects, tojson(res));
+
+// Several points on the leading field.
+values = t.distinct("b", {a: {$in: [0, 1]}});
+assert.eq([0, 1, 2, 3, 4, 5, 6, 7, 8, 9], sorted(values));
+res = t.runCommand("distinct", {key: "b", query: {a: {$in: [0, 1]}}});
+assert.eq(/DISTINCT_SCAN/.test(res.stats.planSummary), true, tojson(res));
+
+// Two leading fields.
+values = t.distinct("c", {a: 2, b: 2});
+assert.eq(50, values.length);
+assert.eq(t.find({a: 2, b: 2}).itcount(), values.length);
+
+// A range on the leading field can't be skipped through.
+values = t.distinct("b", {a: {$gt: 1}});
+assert.eq([0, 1, 2, 3, 4, 5, 6, 7, 8, 9], sorted(values));
+res = t.runCommand("distinct", {key: "b", query: {a: {$gt: 1}}});
+assert.eq(/DISTINCT_SCAN/.test(res.stats.planSummary), false, tojson(res));
+
+//
+// $sort + $group with $first or $last
+//
+
+// The same documents without any index, to run each pipeline against for the expected results.
+var noIndex = db.skip_scan_noindex;
+noIndex.drop();
+
+function runSorted(coll, pipeline) {
+    return coll.aggregate(pipeline).toArray().sort(function(x, y) {
+        return bsonWoCompare({x: x._id}, {x: y._id});
+    });
+}
+
+function checkGroup(pipeline, expectSkipScan) {
+    noIndex.drop();
+    t.find().forEach(function(doc) { assert.writeOK(noIndex.insert(doc)); });
+    assert.eq(runSorted(noIndex, pipeline), runSorted(t, pipeline), tojson(pipeline));
+
+    var explain = t.explain().aggregate(pipeline);
+    var distinctScan = getStage(explain.stages[0].$cursor.queryPlanner.winningPlan,
+                                "DISTINCT_SCAN");
+    if (expectSkipScan) {
+        assert.neq(null, distinctScan, tojson(explain));
+        assert(distinctScan.indexBounds, tojson(distinctScan));
+        assert(distinctScan.direction, tojson(distinctScan));
+        assert.eq(undefined, explain.stages[1].$sort, tojson(explain));
+    }
+    else {
+        assert.eq(null, distinctScan, tojson(explain));
+    }
+}
+
+checkGroup([{$match: {a: 3}},
+            {$sort: {b: 1, c: 1}},
+            {$group: {_id: "$b", first: {$first: "$d"}}}],
+           true);
+
+checkGroup([{$match: {a: 3}},
+            {$sort: {b: 1, c: 1}},
+            {$group: {_id: "$b", last: {$last: "$d"}, lastC: {$last: "$c"}}}],
+           true);
+
+// Grouping on the leading field of the index.
+checkGroup([{$sort: {a: 1, b: 1, c: 1}},
+            {$group: {_id: "$a", first: {$first: "$d"}}}],
+           true);
+
+// $first and $last together need every document, as do other accumulators.
+checkGroup([{$match: {a: 3}},
+            {$sort: {b: 1, c: 1}},
+            {$group: {_id: "$b", first: {$first: "$c"}, last: {$last: "$c"}}}],
+           false);
+checkGroup([{$match: {a: 3}},
+            {$sort: {b: 1, c: 1}},
+            {$group: {_id: "$b", first: {$first: "$d"}, n: {$sum: 1}}}],
+           false);
+
+// Several points on a leading field would give more than one document per group.
+checkGroup([{$match: {a: {$in: [1, 3]}}},
+            {$sort: {b: 1, c: 1}},
+            {$group: {_id: "$b", first: {$first: "$d"}}}],
+           false);
+
+// A filter on a field outside the index could reject the one document kept for a group.
+checkGroup([{$match: {a: 3, d: {$ne: "str3"}}},
+            {$sort: {b: 1, c: 1}},
+            {$group: {_id: "$b", first: {$first: "$d"}}}],
+           false);
+
+// Once the index is multikey the first key for a group needn't belong to its first document.
+assert.writeOK(t.insert({a: 3, b: [1, 11], c: -1, d: "multikey"}));
+checkGroup([{$match: {a: 3}},
+            {$sort: {b: 1, c: 1}},
+            {$group: {_id: "$b", first: {$first: "$d"}}}],
+           false);
+
+noIndex.drop();
+t.drop();
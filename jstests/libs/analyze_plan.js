@@ -41,6 +41,25 @@ function isIndexOnly(root) {
     return !planHasStage(root, "FETCH") && !planHasStage(root, "COLLSCAN");
 }
 
+/**
+ * Given the 'queryPlanner' section of explain's output, returns the planner's 'covered' flag.
+ * Through mongos the flag is reported per shard, and the plan is covered only if it is covered
+ * on every shard.
+ */
+function isCovered(queryPlanner) {
+    if ("covered" in queryPlanner) {
+        return queryPlanner.covered;
+    }
+
+    var shards = queryPlanner.winningPlan.shards;
+    for (var i = 0; i < shards.length; i++) {
+        if (!shards[i].covered) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * Returns true if the BSON representation of a plan rooted at 'root' is using
  * an index scan, and false otherwise.
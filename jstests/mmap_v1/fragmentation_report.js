@@ -0,0 +1,39 @@
+// Test the fragmentationReport command, which reports the free space of an mmapv1 collection.
+
+var t = db.fragmentation_report;
+t.drop();
+
+for (var i = 0; i < 1000; i++) {
+    assert.writeOK(t.insert({_id: i, pad: new Array(1 + (i % 10) * 100).join("x")}));
+}
+assert.writeOK(t.remove({_id: {$mod: [2, 0]}}));
+
+var res = db.runCommand({fragmentationReport: t.getName()});
+assert.commandWorked(res);
+assert.eq(t.getFullName(), res.ns);
+assert.gt(res.freeRecords, 0, tojson(res));
+assert.gt(res.freeBytes, 0, tojson(res));
+assert.lte(res.freeBytes, res.storageSize, tojson(res));
+assert.gte(res.fragmentation, 0, tojson(res));
+assert.lt(res.fragmentation, 1, tojson(res));
+
+var bytes = 0;
+res.sizeClasses.forEach(function(sizeClass) {
+    assert.gt(sizeClass.count, 0, tojson(sizeClass));
+    bytes += sizeClass.bytes;
+});
+assert.lte(bytes, res.freeBytes, tojson(res));
+
+// Deleted records are reused by later inserts rather than adding to the free space.
+assert.writeOK(t.insert({_id: 0, pad: "x"}));
+var after = db.runCommand({fragmentationReport: t.getName()});
+assert.lte(after.freeRecords, res.freeRecords, tojson(after));
+assert.lt(after.freeBytes, res.freeBytes, tojson(after));
+
+assert.commandFailed(db.runCommand({fragmentationReport: "fragmentation_report_missing"}));
+
+db.createCollection("fragmentation_report_capped", {capped: true, size: 4096});
+assert.commandFailed(db.runCommand({fragmentationReport: "fragmentation_report_capped"}));
+db.fragmentation_report_capped.drop();
+
+t.drop();
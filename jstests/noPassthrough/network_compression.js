@@ -0,0 +1,68 @@
+// Checks that wire protocol compression is negotiated through isMaster and reported in the
+// network section of serverStatus.
+
+(function() {
+    'use strict';
+
+    var baseName = "jstests_network_compression";
+    var port = allocatePorts(1)[0];
+    var dbpath = MongoRunner.dataPath + baseName + '/';
+
+    var bigString = new Array(10000).join("compressible ");
+
+    function getCompressionStats(conn) {
+        return assert.commandWorked(conn.getDB('admin').serverStatus()).network.compression;
+    }
+
+    function roundTrip(conn) {
+        var coll = conn.getDB('test').network_compression;
+        coll.drop();
+        for (var i = 0; i < 10; i++) {
+            assert.writeOK(coll.insert({_id: i, s: bigString}));
+        }
+        var docs = coll.find().sort({_id: 1}).toArray();
+        assert.eq(10, docs.length);
+        docs.forEach(function(doc, i) {
+            assert.eq(i, doc._id);
+            assert.eq(bigString, doc.s);
+        });
+    }
+
+    // The server accepts only the offered compressors it has enabled, in the client's order.
+    var mongo = startMongodEmpty('--port', port, '--dbpath', dbpath,
+                                 '--networkMessageCompressors', 'zlib');
+    var res = assert.commandWorked(mongo.getDB('admin').runCommand(
+        {isMaster: 1, compression: ['snappy', 'lz4', 'zlib']}));
+    assert.eq(['zlib'], res.compression, tojson(res));
+
+    res = assert.commandWorked(mongo.getDB('admin').runCommand({isMaster: 1}));
+    assert(!res.hasOwnProperty('compression'), tojson(res));
+
+    // The shell offers snappy and zlib by default, so this connection is compressed with zlib.
+    var before = getCompressionStats(mongo);
+    roundTrip(mongo);
+    var after = getCompressionStats(mongo);
+    assert.gt(after.zlib.decompressor.bytesIn, before.zlib.decompressor.bytesIn, tojson(after));
+    assert.gt(after.zlib.decompressor.bytesOut, after.zlib.decompressor.bytesIn, tojson(after));
+    assert.gt(after.zlib.compressor.bytesIn, before.zlib.compressor.bytesIn, tojson(after));
+    assert.gt(after.zlib.compressor.bytesIn, after.zlib.compressor.bytesOut, tojson(after));
+    assert.eq(0, after.snappy.decompressor.bytesIn, tojson(after));
+    stopMongod(port);
+
+    // With compression disabled nothing is accepted and messages are sent as they are.
+    mongo = startMongodEmpty('--port', port, '--dbpath', dbpath,
+                             '--networkMessageCompressors', 'disabled');
+    res = assert.commandWorked(mongo.getDB('admin').runCommand(
+        {isMaster: 1, compression: ['snappy', 'zlib']}));
+    assert.eq([], res.compression, tojson(res));
+
+    roundTrip(mongo);
+    after = getCompressionStats(mongo);
+    assert.eq(0, after.snappy.decompressor.bytesIn, tojson(after));
+    assert.eq(0, after.zlib.decompressor.bytesIn, tojson(after));
+    stopMongod(port);
+
+    // Unknown compressors are rejected at startup.
+    assert.neq(0, runMongoProgram('mongod', '--port', port, '--dbpath', dbpath,
+                                  '--networkMessageCompressors', 'snappy,lz4'));
+}());
@@ -0,0 +1,66 @@
+/**
+ * Test that plan cache entries are saved in <db>.system.plancache and loaded back into the plan
+ * cache when the server restarts, but only while the indexes of the collection are unchanged.
+ */
+
+var port = allocatePorts( 1 )[ 0 ];
+var name = "plan_cache_persistence";
+var dbpath = MongoRunner.dataPath + name;
+var args = [ "--port", port, "--dbpath", dbpath,
+             "--setParameter", "planCachePersistenceEnabled=true",
+             "--setParameter", "planCachePersistenceIntervalSecs=1" ];
+
+function getShapes( conn ) {
+    var res = conn.getDB( name ).runCommand( { planCacheListQueryShapes: "coll" } );
+    assert.commandWorked( res );
+    return res.shapes;
+}
+
+function getMetrics( conn ) {
+    return conn.getDB( "admin" ).serverStatus().metrics.query.planCache;
+}
+
+var conn = startMongodEmpty.apply( null, args );
+var t = conn.getDB( name ).coll;
+var store = conn.getDB( name ).system.plancache;
+
+for ( var i = 0; i < 100; i++ ) {
+    t.insert( { a: i % 10, b: i % 5 } );
+}
+assert.commandWorked( conn.getDB( name ).runCommand( {
+    createIndexes: "coll",
+    indexes: [ { key: { a: 1 }, name: "a_1" }, { key: { b: 1 }, name: "b_1" } ] } ) );
+
+// Two indexed plans compete, so the winner is cached and then saved.
+assert.eq( 10, t.find( { a: 1, b: 1 } ).itcount() );
+assert.eq( 1, getShapes( conn ).length );
+assert.soon( function() { return store.count() == 1; }, "plan cache entry was not saved" );
+
+var doc = store.findOne();
+assert.eq( t.getFullName(), doc._id.ns, tojson( doc ) );
+assert.eq( { a: 1, b: 1 }, doc.query, tojson( doc ) );
+assert.gte( doc.plans.length, 2, tojson( doc ) );
+assert.gte( getMetrics( conn ).persisted, 1 );
+
+// The saved entry is loaded on startup and used by the next run of the query.
+stopMongod( port );
+conn = startMongodNoReset.apply( null, args );
+t = conn.getDB( name ).coll;
+assert.soon( function() { return getShapes( conn ).length == 1; },
+             "plan cache entry was not loaded" );
+
+var metrics = getMetrics( conn );
+assert.eq( 1, metrics.loaded, tojson( metrics ) );
+assert.eq( 10, t.find( { a: 1, b: 1 } ).itcount() );
+assert.gt( getMetrics( conn ).hits, metrics.hits );
+
+// After an index is dropped the saved plans can no longer be trusted, so nothing is loaded.
+assert.commandWorked( t.dropIndex( { b: 1 } ) );
+stopMongod( port );
+conn = startMongodNoReset.apply( null, args );
+t = conn.getDB( name ).coll;
+sleep( 3000 );
+assert.eq( 0, getShapes( conn ).length );
+assert.eq( 0, getMetrics( conn ).loaded );
+
+stopMongod( port );
@@ -0,0 +1,65 @@
+/**
+ * This test is only for the WiredTiger storageEngine
+ * Test that j:true writes wait for the journal flusher thread, which groups concurrent waiters
+ * into shared journal syncs and reports them in serverStatus.
+ */
+
+// This test can only be run if the storageEngine is wiredTiger
+if ( typeof(TestData) != "object" ||
+     !TestData.storageEngine ||
+     TestData.storageEngine != "wiredTiger" ) {
+    jsTestLog("Skipping test because storageEngine is not wiredTiger");
+}
+else {
+    var conn = MongoRunner.runMongod( { storageEngine: "wiredTiger",
+                                        setParameter: "wiredTigerJournalFlushDelayMillis=5" } );
+    assert.neq( null, conn, "mongod failed to start" );
+    var t = conn.getDB( "test" ).wt_journal_flusher;
+
+    function getMetrics() {
+        return conn.getDB( "admin" ).serverStatus().wiredTiger.journalFlusher;
+    }
+
+    function sum( histogram ) {
+        var total = 0;
+        for ( var bucket in histogram ) {
+            total += histogram[bucket];
+        }
+        return total;
+    }
+
+    var before = getMetrics();
+
+    jsTestLog( "concurrent j:true writers" );
+    var writer = "var t = db.getSiblingDB('test').wt_journal_flusher;" +
+                 "for ( var i = 0; i < 100; i++ ) {" +
+                 "    assert.writeOK( t.insert( { x: i }, { writeConcern: { j: true } } ) );" +
+                 "}";
+    var shells = [];
+    for ( var i = 0; i < 4; i++ ) {
+        shells.push( startParallelShell( writer, conn.port ) );
+    }
+    for ( var i = 0; i < 100; i++ ) {
+        assert.writeOK( t.insert( { x: i }, { writeConcern: { j: true } } ) );
+    }
+    shells.forEach( function( join ) { join(); } );
+    assert.eq( 500, t.count() );
+
+    var after = getMetrics();
+    assert.gte( after.waiters - before.waiters, 500, tojson( after ) );
+    assert.gt( after.flushes, before.flushes, tojson( after ) );
+    assert.lte( after.flushes - before.flushes, after.waiters - before.waiters, tojson( after ) );
+    assert.eq( after.flushes, sum( after.batchSize ), tojson( after ) );
+    assert.eq( after.waiters, sum( after.waitMicros ), tojson( after ) );
+
+    // Writes without j:true don't wait for the journal.
+    assert.writeOK( t.insert( { x: -1 } ) );
+    assert.eq( after.waiters, getMetrics().waiters );
+
+    assert.commandWorked( conn.getDB( "admin" ).runCommand(
+        { setParameter: 1, wiredTigerJournalFlushDelayMillis: 0 } ) );
+    assert.writeOK( t.insert( { x: -2 }, { writeConcern: { j: true } } ) );
+    assert.eq( after.waiters + 1, getMetrics().waiters );
+
+    MongoRunner.stopMongod( conn.port );
+}
@@ -0,0 +1,52 @@
+/**
+ * This test is only for the WiredTiger storageEngine
+ * Test that the oplog is truncated a stone at a time by the background thread, keeping it near
+ * its configured size, and that the truncations are reported in serverStatus.
+ */
+
+// This test can only be run if the storageEngine is wiredTiger
+if ( typeof(TestData) != "object" ||
+     !TestData.storageEngine ||
+     TestData.storageEngine != "wiredTiger" ) {
+    jsTestLog("Skipping test because storageEngine is not wiredTiger");
+}
+else {
+    var name = "wt_oplog_truncation";
+    var replTest = new ReplSetTest( {name: name, nodes: 1, oplogSize: 1,
+        nodeOptions: {storageEngine: "wiredTiger"}} );
+    replTest.startSet();
+    replTest.initiate();
+
+    var master = replTest.getMaster();
+    var oplog = master.getDB("local").oplog.rs;
+    var maxSize = oplog.stats().maxSize;
+
+    function getMetrics() {
+        return master.getDB("admin").serverStatus().metrics.storage.oplogTruncation;
+    }
+
+    var before = getMetrics();
+
+    jsTestLog("write several times the size of the oplog");
+    var pad = new Array(1024).join("x");
+    for (var i = 0; i < 5 * 1024; i++) {
+        assert.writeOK(master.getDB("test").foo.insert({_id: i, pad: pad}));
+    }
+
+    assert.soon(function() {
+        return getMetrics().passes > before.passes;
+    }, "oplog was not truncated: " + tojson(getMetrics()));
+    assert.soon(function() {
+        return oplog.stats().size <= 1.5 * maxSize;
+    }, "oplog is too big: " + tojson(oplog.stats()));
+
+    var after = getMetrics();
+    assert.gt(after.recordsReclaimed, before.recordsReclaimed, tojson(after));
+    assert.gt(after.bytesReclaimed, before.bytesReclaimed, tojson(after));
+    assert.gte(after.totalTimeMicros, before.totalTimeMicros, tojson(after));
+
+    // The newest entries are still there.
+    assert.eq(1, oplog.find({"o._id": 5 * 1024 - 1}).itcount());
+
+    replTest.stopSet();
+}
@@ -0,0 +1,60 @@
+// Test that a blocking sort which exceeds the internal sort memory limit succeeds when the query
+// allows the sort to use temporary files, both with and without a limit.
+//
+// Note that this test sets the server parameter "internalQueryExecMaxBlockingSortBytes", and
+// restores the original value of the parameter before exiting.  As a result, this test cannot run
+// in the sharding passthrough (because mongos does not have this parameter), and cannot run in the
+// parallel suite (because the change of the parameter value would interfere with other tests).
+
+var coll = db.find_sort_allow_disk_use;
+coll.drop();
+
+// Set the internal sort memory limit to 1MB.
+var result = db.adminCommand({getParameter: 1, internalQueryExecMaxBlockingSortBytes: 1});
+assert.commandWorked(result);
+var oldSortLimit = result.internalQueryExecMaxBlockingSortBytes;
+var newSortLimit = 1024 * 1024;
+assert.commandWorked(db.adminCommand({setParameter: 1,
+                                      internalQueryExecMaxBlockingSortBytes: newSortLimit}));
+
+try {
+    // Insert ~3MB of data, in reverse order of the sort.
+    var largeStr = '';
+    for (var i = 0; i < 32 * 1024; ++i) {
+        largeStr += 'x';
+    }
+    for (var i = 0; i < 100; ++i) {
+        assert.writeOK(coll.insert({a: largeStr, b: 99 - i}));
+    }
+
+    // Without allowDiskUse the sort hits the memory limit.
+    assert.throws(function() { coll.find({}).sort({b: 1}).itcount(); });
+
+    // With allowDiskUse the whole result comes back in order.
+    var docs = coll.find({}).sort({b: 1}).allowDiskUse().toArray();
+    assert.eq(100, docs.length);
+    for (var i = 0; i < docs.length; ++i) {
+        assert.eq(i, docs[i].b);
+        assert.eq(largeStr, docs[i].a);
+    }
+
+    // Also with a limit too large to satisfy in memory, and with a projection.
+    docs = coll.find({}, {_id: 0, b: 1}).sort({b: -1}).limit(60).allowDiskUse().toArray();
+    assert.eq(60, docs.length);
+    for (var i = 0; i < docs.length; ++i) {
+        assert.eq({b: 99 - i}, docs[i]);
+    }
+
+    // Explain reports that the sort spilled.
+    var explain = coll.find({}).sort({b: 1}).allowDiskUse().explain("executionStats");
+    var sortStage = explain.executionStats.executionStages;
+    while (sortStage.stage !== "SORT") {
+        sortStage = sortStage.inputStage;
+    }
+    assert(sortStage.usedDisk, tojson(explain));
+}
+finally {
+    // Restore the orginal sort memory limit.
+    assert.commandWorked(db.adminCommand({setParameter: 1,
+                                          internalQueryExecMaxBlockingSortBytes: oldSortLimit}));
+}
@@ -0,0 +1,65 @@
+/**
+ *  Compares the thread per connection and reactor connection models: throughput of a small
+ *  benchRun workload and resident memory of the server while many mostly idle client
+ *  connections are open.
+ *
+ *  Opening 50k connections needs a raised open file limit (ulimit -n) for both the shell and
+ *  the server; levels which cannot be reached are reported and skipped.
+ */
+
+var levels = [ 1000, 10000, 50000 ];
+var models = [ "threadPerConnection", "reactor" ];
+var benchSeconds = 10;
+
+function openIdleConnections( host, conns, n ) {
+    while ( conns.length < n ) {
+        try {
+            var c = new Mongo( host );
+            // make sure the connection is established and has sent one request
+            c.getDB( "admin" ).runCommand( { isMaster: 1 } );
+            conns.push( c );
+        }
+        catch ( e ) {
+            print( "could only open " + conns.length + " connections: " + e );
+            return false;
+        }
+    }
+    return true;
+}
+
+function measure( mongod ) {
+    var host = mongod.host;
+    var t = mongod.getDB( "test" ).idleconns;
+    t.drop();
+    for ( var i = 0; i < 1000; i++ ) {
+        t.insert( { _id: i, x: i } );
+    }
+
+    var results = [];
+    var conns = [];
+    for ( var i = 0; i < levels.length; i++ ) {
+        if ( !openIdleConnections( host, conns, levels[i] ) )
+            break;
+
+        var res = benchRun( { ops: [ { ns: t.getFullName(), op: "findOne",
+                                       query: { _id: { "#RAND_INT": [ 0, 1000 ] } } } ],
+                              parallel: 16,
+                              seconds: benchSeconds,
+                              host: host } );
+        var status = mongod.getDB( "admin" ).serverStatus();
+        results.push( { connections: status.connections.current,
+                        opsPerSec: res.query,
+                        residentMB: status.mem.resident } );
+    }
+
+    return results;
+}
+
+var summary = {};
+models.forEach( function( model ) {
+    var mongod = MongoRunner.runMongod( { connectionModel: model, maxConns: 60000 } );
+    summary[model] = measure( mongod );
+    MongoRunner.stopMongod( mongod );
+} );
+
+printjson( summary );
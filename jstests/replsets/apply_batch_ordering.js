@@ -0,0 +1,62 @@
+/**
+ * Secondaries spread the CRUD ops of a batch across the writer threads by namespace and _id.
+ * Check that the collections where ops on different documents depend on each other (capped
+ * collections and collections with unique secondary indexes) still end up identical to the
+ * primary, and that their ops are counted as applied in namespace order.
+ */
+var rt = new ReplSetTest( { name : "apply_batch_ordering" , nodes: 2, oplogSize: 100 } );
+rt.startSet();
+rt.initiate();
+rt.awaitSecondaryNodes();
+
+var primary = rt.getPrimary();
+var secondary = rt.getSecondary();
+secondary.setSlaveOk();
+
+var testDB = primary.getDB("test");
+var secondaryDB = secondary.getDB("test");
+
+assert.commandWorked(testDB.createCollection("capped", { capped: true, size: 64 * 1024 }));
+assert.commandWorked(testDB.uniq.ensureIndex({ k: 1 }, { unique: true }));
+assert.commandWorked(testDB.plain.ensureIndex({ k: 1 }));
+rt.awaitReplication();
+
+function serializedOps() {
+    return secondaryDB.serverStatus().metrics.repl.apply.serializedOps;
+}
+
+// Plain collection: ops are spread by _id and never counted as serialized.
+var before = serializedOps();
+var bulk = testDB.plain.initializeOrderedBulkOp();
+for (var i = 0; i < 1000; i++) {
+    bulk.insert({ _id: i, k: i });
+}
+assert.writeOK(bulk.execute({ w: 2 }));
+assert.eq(before, serializedOps());
+
+// Capped collection: the natural order on the secondary must match the primary.
+bulk = testDB.capped.initializeOrderedBulkOp();
+for (var i = 0; i < 1000; i++) {
+    bulk.insert({ _id: 1000 - i, seq: i });
+}
+assert.writeOK(bulk.execute({ w: 2 }));
+assert.eq(testDB.capped.find().sort({ $natural: 1 }).toArray(),
+          secondaryDB.capped.find().sort({ $natural: 1 }).toArray());
+
+// Unique index: repeatedly move the same key between documents. Applying these ops out of
+// order on the secondary would violate the unique constraint.
+bulk = testDB.uniq.initializeOrderedBulkOp();
+for (var i = 0; i < 100; i++) {
+    bulk.insert({ _id: i, k: i });
+}
+for (var i = 0; i < 100; i++) {
+    bulk.find({ _id: i }).updateOne({ $set: { k: -1 - i } });
+    bulk.find({ _id: (i + 1) % 100 }).updateOne({ $set: { k: i } });
+}
+assert.writeOK(bulk.execute({ w: 2 }));
+assert.eq(testDB.uniq.find().sort({ _id: 1 }).toArray(),
+          secondaryDB.uniq.find().sort({ _id: 1 }).toArray());
+
+assert.gte(serializedOps() - before, 1000 + 300, "capped and unique ops not serialized");
+
+rt.stopSet();
@@ -23,6 +23,10 @@ function testSecondaryMetrics(secondary, opCount, offset) {
     assert(ss.metrics.repl.apply.batches.num > 0, "no batches")
     assert(ss.metrics.repl.apply.batches.totalMillis > 0, "no batch time")
     assert.eq(ss.metrics.repl.apply.ops, opCount + offset, "wrong number of applied ops")
+    assert(ss.metrics.repl.apply.batchLatency.num >= ss.metrics.repl.apply.batches.num,
+           "batch latency num missing")
+    assert(ss.metrics.repl.apply.batchLatency.totalMillis >= 0, "batch latency time missing")
+    assert(ss.metrics.repl.apply.serializedOps >= 0, "serialized ops missing")
 }
 
 var rt = new ReplSetTest( { name : "server_status_metrics" , nodes: 2, oplogSize: 100 } );
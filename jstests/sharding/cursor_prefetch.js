@@ -0,0 +1,69 @@
+// Test that mongos prefetches the next batch from each shard of a multi shard query, and that
+// prefetching doesn't change the results.
+
+var s = new ShardingTest( { name: "cursor_prefetch", shards: 2, mongos: 1 } );
+s.stopBalancer();
+
+var db = s.getDB( "test" );
+s.adminCommand( { enablesharding: "test" } );
+s.adminCommand( { shardcollection: "test.foo", key: { _id: 1 } } );
+s.adminCommand( { split: "test.foo", middle: { _id: 500 } } );
+s.adminCommand( { movechunk: "test.foo", find: { _id: 0 },
+                  to: s.getOther( s.getServer( "test" ) ).name, _waitForDelete: true } );
+
+var N = 1000;
+var bulk = db.foo.initializeUnorderedBulkOp();
+for ( var i = 0; i < N; i++ ) {
+    bulk.insert( { _id: i, x: N - i } );
+}
+assert.writeOK( bulk.execute() );
+
+function getMetrics() {
+    return s.s0.getDB( "admin" ).serverStatus().metrics.cursor.shardGetMore;
+}
+
+function setDepth( depth ) {
+    assert.commandWorked( s.s0.getDB( "admin" ).runCommand( { setParameter: 1,
+                                                              shardCursorPrefetchDepth: depth } ) );
+}
+
+function checkResults() {
+    // Sorted on a field which interleaves the shards' results.
+    var docs = db.foo.find().sort( { x: 1 } ).batchSize( 10 ).toArray();
+    assert.eq( N, docs.length );
+    for ( var i = 0; i < N; i++ ) {
+        assert.eq( i + 1, docs[i].x, tojson( docs[i] ) );
+    }
+
+    assert.eq( N, db.foo.find().batchSize( 7 ).itcount() );
+
+    // Closing a cursor with prefetched batches outstanding leaves the connections usable.
+    var cursor = db.foo.find().batchSize( 10 );
+    for ( var i = 0; i < 25; i++ ) {
+        cursor.next();
+    }
+    cursor.close();
+    assert.eq( N, db.foo.find().itcount() );
+}
+
+// Prefetching is on by default. Batches which arrived before they were needed are not waits.
+var before = getMetrics();
+checkResults();
+var after = getMetrics();
+assert.gt( after.prefetched, before.prefetched, tojson( after ) );
+assert.gte( after.waits, before.waits, tojson( after ) );
+assert.gte( after.waitMicros, before.waitMicros, tojson( after ) );
+
+// A deeper prefetch returns the same results.
+setDepth( 3 );
+checkResults();
+
+// With prefetching disabled every batch is requested when it is needed.
+setDepth( 0 );
+before = getMetrics();
+checkResults();
+after = getMetrics();
+assert.eq( before.prefetched, after.prefetched, tojson( after ) );
+assert.gt( after.waits, before.waits, tojson( after ) );
+
+s.stop();
@@ -0,0 +1,38 @@
+/**
+ * mongos hashes shard key values with the default hashVersion, so a collection can't be sharded
+ * on a hashed key whose only supporting index uses a different hashVersion.
+ *
+ * @tags : [ hashed ]
+ */
+var st = new ShardingTest({ shards: 1 });
+var testDB = st.s.getDB('test');
+assert.commandWorked(testDB.adminCommand({ enableSharding: 'test' }));
+
+assert.commandWorked(testDB.runCommand({ createIndexes: 'murmur',
+                                         indexes: [{ key: { x: 'hashed' },
+                                                     name: 'x_hashed',
+                                                     hashVersion: 1 }] }));
+assert.writeOK(testDB.murmur.insert({ x: 1 }));
+var res = testDB.adminCommand({ shardCollection: 'test.murmur', key: { x: 'hashed' } });
+assert.commandFailed(res);
+assert(/non-default hashVersion of 1/.test(res.errmsg), tojson(res));
+
+// Nothing was sharded, and the documents are still found through the index.
+assert.eq(null, st.config.collections.findOne({ _id: 'test.murmur', dropped: false }));
+assert.eq(1, testDB.murmur.find({ x: 1 }).hint({ x: 'hashed' }).itcount());
+
+// The default version still works, whether it is given explicitly or not.
+assert.writeOK(testDB.md5.insert({ x: 1 }));
+assert.commandWorked(testDB.runCommand({ createIndexes: 'md5',
+                                         indexes: [{ key: { x: 'hashed' }, name: 'x_hashed' }] }));
+assert.commandWorked(testDB.adminCommand({ shardCollection: 'test.md5', key: { x: 'hashed' } }));
+
+assert.writeOK(testDB.md5explicit.insert({ x: 1 }));
+assert.commandWorked(testDB.runCommand({ createIndexes: 'md5explicit',
+                                         indexes: [{ key: { x: 'hashed' },
+                                                     name: 'x_hashed',
+                                                     hashVersion: 0 }] }));
+assert.commandWorked(testDB.adminCommand({ shardCollection: 'test.md5explicit',
+                                           key: { x: 'hashed' } }));
+
+st.stop();
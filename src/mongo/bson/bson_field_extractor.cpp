@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bson_field_extractor.h"
+
+#include <cstring>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    BSONFieldExtractor::BSONFieldExtractor(const std::vector<const char*>& paths)
+        : _paths(paths) {
+
+        _nodes.push_back(Node());
+
+        for (size_t i = 0; i < _paths.size(); ++i) {
+            const StringData path(_paths[i]);
+            _pathEnds.push_back(_paths[i] + path.size());
+
+            if (path.empty() ||
+                path[0] == '.' ||
+                path[path.size() - 1] == '.' ||
+                path.find("..") != std::string::npos) {
+                _unusualPaths.push_back(i);
+                continue;
+            }
+
+            size_t node = 0;
+            size_t start = 0;
+            while (true) {
+                const size_t dot = path.find('.', start);
+                if (dot == std::string::npos) {
+                    node = _findOrAddChild(node, path.substr(start));
+                    _nodes[node].terminals.push_back(i);
+                    break;
+                }
+
+                node = _findOrAddChild(node, path.substr(start, dot - start));
+                _nodes[node].continuing.push_back(std::make_pair(i, dot + 1));
+                start = dot + 1;
+            }
+        }
+    }
+
+    size_t BSONFieldExtractor::_findOrAddChild(size_t parent, StringData name) {
+        for (size_t i = 0; i < _nodes[parent].children.size(); ++i) {
+            const size_t child = _nodes[parent].children[i];
+            if (name == _nodes[child].name) {
+                return child;
+            }
+        }
+
+        // Adding to '_nodes' may move the parent, so it is looked up again afterwards.
+        Node node;
+        node.name = name.toString();
+        _nodes.push_back(node);
+        _nodes[parent].children.push_back(_nodes.size() - 1);
+        return _nodes.size() - 1;
+    }
+
+    void BSONFieldExtractor::extract(const BSONObj& obj,
+                                     BSONElement* elements,
+                                     const char** remaining) const {
+        for (size_t i = 0; i < _paths.size(); ++i) {
+            elements[i] = BSONElement();
+            remaining[i] = _pathEnds[i];
+        }
+
+        _extract(obj, _nodes[0], elements, remaining);
+
+        for (size_t i = 0; i < _unusualPaths.size(); ++i) {
+            const size_t path = _unusualPaths[i];
+            const char* rest = _paths[path];
+            elements[path] = obj.getFieldDottedOrArray(rest);
+            if (elements[path].type() == Array) {
+                remaining[path] = rest;
+            }
+        }
+    }
+
+    void BSONFieldExtractor::_extract(const BSONObj& obj,
+                                      const Node& node,
+                                      BSONElement* elements,
+                                      const char** remaining) const {
+        const size_t numChildren = node.children.size();
+        size_t left = numChildren;
+
+        // Only the first field with a given name counts, as with getField().
+        uint64_t seenSmall = 0;
+        std::vector<bool> seenLarge;
+        if (numChildren > 64) {
+            seenLarge.resize(numChildren);
+        }
+
+        BSONObjIterator it(obj);
+        while (left > 0 && it.more()) {
+            const BSONElement e = it.next();
+            const StringData name = e.fieldNameStringData();
+
+            for (size_t i = 0; i < numChildren; ++i) {
+                const Node& child = _nodes[node.children[i]];
+                if (name != child.name) {
+                    continue;
+                }
+
+                if (numChildren > 64) {
+                    if (seenLarge[i]) {
+                        break;
+                    }
+                    seenLarge[i] = true;
+                }
+                else {
+                    if (seenSmall & (1ULL << i)) {
+                        break;
+                    }
+                    seenSmall |= 1ULL << i;
+                }
+                --left;
+
+                for (size_t j = 0; j < child.terminals.size(); ++j) {
+                    elements[child.terminals[j]] = e;
+                }
+
+                if (child.continuing.empty()) {
+                    break;
+                }
+
+                if (e.type() == Array) {
+                    for (size_t j = 0; j < child.continuing.size(); ++j) {
+                        const size_t path = child.continuing[j].first;
+                        elements[path] = e;
+                        remaining[path] = _paths[path] + child.continuing[j].second;
+                    }
+                }
+                else if (e.type() == Object) {
+                    _extract(e.embeddedObject(), child, elements, remaining);
+                }
+                break;
+            }
+        }
+    }
+
+}  // namespace mongo
@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mongo/bson/bsonelement.h"
+
+namespace mongo {
+
+    class BSONObj;
+
+    /**
+     * Looks up a fixed set of (possibly dotted) paths in many documents.
+     *
+     * Calling getFieldDottedOrArray() once per path scans the document once per path, and once
+     * more per path component. The extractor arranges the paths into a tree of their components
+     * when it is built, so that extract() visits each element of the document and of the
+     * subobjects on the paths at most once, no matter how many paths there are.
+     *
+     * The results are the same as those of BSONObj::getFieldDottedOrArray(): traversal stops at
+     * the first array on a path, and the part of the path after the array is returned.
+     *
+     * The path strings are not copied. They must outlive the extractor.
+     */
+    class BSONFieldExtractor {
+    public:
+        explicit BSONFieldExtractor(const std::vector<const char*>& paths);
+
+        size_t numPaths() const { return _paths.size(); }
+
+        /**
+         * For each path i, sets 'elements[i]' to obj.getFieldDottedOrArray(path) and
+         * 'remaining[i]' to the rest of the path that getFieldDottedOrArray() leaves, pointing
+         * into the path string: the part after the array if the element is an array that was
+         * reached before the end of the path, or the empty end of the path otherwise.
+         *
+         * 'elements' and 'remaining' must have room for numPaths() entries.
+         */
+        void extract(const BSONObj& obj, BSONElement* elements, const char** remaining) const;
+
+    private:
+        struct Node {
+            std::string name;
+            std::vector<size_t> children;
+
+            // Paths which end at this node.
+            std::vector<size_t> terminals;
+
+            // Paths which go on below this node, with the offset of the rest of the path. If
+            // the element for this node is an array, these paths stop at it.
+            std::vector<std::pair<size_t, size_t> > continuing;
+        };
+
+        size_t _findOrAddChild(size_t parent, StringData name);
+
+        void _extract(const BSONObj& obj,
+                      const Node& node,
+                      BSONElement* elements,
+                      const char** remaining) const;
+
+        std::vector<const char*> _paths;
+        std::vector<const char*> _pathEnds;
+
+        // _nodes[0] is the root, which stands for the document itself.
+        std::vector<Node> _nodes;
+
+        // Paths with an empty component, which are looked up one by one.
+        std::vector<size_t> _unusualPaths;
+    };
+
+}  // namespace mongo
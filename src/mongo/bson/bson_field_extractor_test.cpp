@@ -0,0 +1,142 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/bson/bson_field_extractor.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using mongo::BSONElement;
+    using mongo::BSONFieldExtractor;
+    using mongo::BSONObj;
+    using mongo::fromjson;
+    using std::vector;
+
+    /**
+     * Checks that extracting 'paths' from 'doc' agrees with getFieldDottedOrArray().
+     */
+    void assertSameAsGetFieldDottedOrArray(const vector<const char*>& paths, const char* doc) {
+        const BSONObj obj = fromjson(doc);
+        const BSONFieldExtractor extractor(paths);
+        vector<BSONElement> elements(paths.size());
+        vector<const char*> remaining(paths.size());
+        extractor.extract(obj, &elements[0], &remaining[0]);
+
+        for (size_t i = 0; i < paths.size(); ++i) {
+            const char* rest = paths[i];
+            const BSONElement expected = obj.getFieldDottedOrArray(rest);
+            if (expected.eoo()) {
+                ASSERT(elements[i].eoo());
+            }
+            else {
+                ASSERT_EQUALS(expected.rawdata(), elements[i].rawdata());
+            }
+            if (expected.type() == mongo::Array) {
+                ASSERT_EQUALS(rest, remaining[i]);
+            }
+            else {
+                ASSERT_EQUALS('\0', *remaining[i]);
+            }
+        }
+    }
+
+    vector<const char*> makePaths(const char* a, const char* b = NULL, const char* c = NULL,
+                                  const char* d = NULL, const char* e = NULL) {
+        vector<const char*> paths;
+        const char* all[] = {a, b, c, d, e};
+        for (size_t i = 0; i < 5 && all[i]; ++i) {
+            paths.push_back(all[i]);
+        }
+        return paths;
+    }
+
+    TEST(BSONFieldExtractor, TopLevel) {
+        const vector<const char*> paths = makePaths("a", "b", "c");
+        assertSameAsGetFieldDottedOrArray(paths, "{}");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: 1, b: 'x', c: null}");
+        assertSameAsGetFieldDottedOrArray(paths, "{c: 1, z: 2, a: 3}");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: [1, 2], b: {}, c: []}");
+    }
+
+    TEST(BSONFieldExtractor, Dotted) {
+        const vector<const char*> paths = makePaths("a.b", "a.c.d", "a", "e.f", "a.b");
+        assertSameAsGetFieldDottedOrArray(paths, "{}");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: {b: 1, c: {d: 2}}, e: {f: 3}}");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: 1, e: 'x'}");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: {c: 5}, e: {g: 1}}");
+        assertSameAsGetFieldDottedOrArray(paths, "{x: 1, a: {x: 1, c: {x: 1, d: 1}}}");
+    }
+
+    TEST(BSONFieldExtractor, StopsAtArrays) {
+        const vector<const char*> paths = makePaths("a.b.c", "a.b", "a", "d.0.e");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: [{b: {c: 1}}], d: [{e: 1}]}");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: {b: [{c: 1}, {c: 2}]}}");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: {b: {c: [1, 2]}}}");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: []}");
+    }
+
+    TEST(BSONFieldExtractor, FirstOfDuplicateFields) {
+        const vector<const char*> paths = makePaths("a", "b.c");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: 1, b: 2, a: 3, b: {c: 4}}");
+        assertSameAsGetFieldDottedOrArray(paths, "{b: {c: 1}, b: {c: 2}}");
+    }
+
+    TEST(BSONFieldExtractor, UnusualPaths) {
+        const vector<const char*> paths = makePaths("", "a.", ".a", "a..b", "a");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: {b: 1}, '': 5}");
+        assertSameAsGetFieldDottedOrArray(paths, "{a: [1]}");
+    }
+
+    TEST(BSONFieldExtractor, ManyChildren) {
+        vector<std::string> names;
+        for (int i = 0; i < 100; ++i) {
+            names.push_back("f" + mongo::BSONObjBuilder::numStr(i));
+        }
+        vector<const char*> paths;
+        mongo::BSONObjBuilder b;
+        for (int i = 0; i < 100; ++i) {
+            paths.push_back(names[i].c_str());
+            b.append(names[99 - i], i);
+        }
+        b.append("f5", "duplicate");
+        const BSONObj obj = b.obj();
+
+        const BSONFieldExtractor extractor(paths);
+        vector<BSONElement> elements(paths.size());
+        vector<const char*> remaining(paths.size());
+        extractor.extract(obj, &elements[0], &remaining[0]);
+        for (int i = 0; i < 100; ++i) {
+            ASSERT_EQUALS(99 - i, elements[i].numberInt());
+        }
+    }
+
+}  // namespace
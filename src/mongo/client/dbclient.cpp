@@ -47,6 +47,8 @@
 #include "mongo/util/assert_util.h"
 #include "mongo/util/debug_util.h"
 #include "mongo/util/log.h"
+#include "mongo/util/net/message_compression.h"
+#include "mongo/util/net/socket_poll.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/net/ssl_options.h"
 #include "mongo/util/password_digest.h"
@@ -1078,13 +1080,48 @@ namespace mongo {
         int sslModeVal = sslGlobalParams.sslMode.load();
         if (sslModeVal == SSLParams::SSLMode_preferSSL ||
             sslModeVal == SSLParams::SSLMode_requireSSL) {
-            return p->secure( sslManager(), _server.host() );
+            if ( !p->secure( sslManager(), _server.host() ) ) {
+                return false;
+            }
         }
 #endif
 
+        try {
+            _negotiateCompression();
+        }
+        catch ( const DBException& e ) {
+            errmsg = str::stream() << "couldn't connect to server " << toString()
+                                   << ", isMaster failed: " << e.toString();
+            _failed = true;
+            return false;
+        }
+
         return true;
     }
 
+    void DBClientConnection::_negotiateCompression() {
+        if ( getMessageCompressors().empty() )
+            return;
+
+        BSONObjBuilder cmd;
+        cmd.append( "isMaster", 1 );
+        appendMessageCompressorsToIsMaster( &cmd );
+
+        BSONObj info;
+        if ( !DBClientWithCommands::runCommand( "admin", cmd.obj(), info ) ) {
+            LOG( 1 ) << "not compressing messages to " << toString() << ", isMaster failed: "
+                     << info << endl;
+            return;
+        }
+
+        MessageCompressor compressor = chooseMessageCompressor( info );
+        if ( compressor != kNoCompressor ) {
+            LOG( 1 ) << "compressing messages to " << toString() << " with "
+                     << messageCompressorName( compressor ) << endl;
+        }
+        p->setCompressor( compressor );
+    }
+
     void DBClientConnection::logout(const string& dbname, BSONObj& info){
         authCache.erase(dbname);
         runCommand(dbname, BSON("logout" << 1), info);
@@ -1578,6 +1615,18 @@ namespace mongo {
         return false;
     }
 
+    bool DBClientConnection::replyReady() {
+        if ( !p || !isPollSupported() )
+            return false;
+
+        // Data buffered by SSL doesn't show up here, in which case the reply is taken as not
+        // there yet.
+        pollfd pollInfo;
+        pollInfo.fd = p->psock->rawFD();
+        pollInfo.events = POLLIN;
+        return socketPoll( &pollInfo, 1, 0 ) > 0 && ( pollInfo.revents & POLLIN );
+    }
+
     bool DBClientConnection::call( Message &toSend, Message &response, bool assertOk , string * actualServer ) {
         /* todo: this is very ugly messagingport::call returns an error code AND can throw
                  an exception.  we should make it return void and just throw an exception anytime
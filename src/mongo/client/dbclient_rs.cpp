@@ -867,6 +867,10 @@ namespace {
         }
     }
 
+    bool DBClientReplicaSet::replyReady() {
+        return _lazyState._lastClient && _lazyState._lastClient->replyReady();
+    }
+
     void DBClientReplicaSet::checkResponse( const char* data, int nReturned, bool* retry, string* targetHost ){
 
         // For now, do exactly as we did before, so as not to break things.  In general though, we
@@ -154,21 +154,30 @@ namespace mongo {
         return ok;
     }
 
+    void DBClientCursor::_assembleGetMore( Message& toSend ) {
+        BufBuilder b;
+        b.appendNum(opts);
+        b.appendStr(ns);
+        b.appendNum(nextBatchSize());
+        b.appendNum(cursorId);
+        toSend.setData(dbGetMore, b.buf(), b.len());
+    }
+
     void DBClientCursor::requestMore() {
         verify( cursorId && batch.pos == batch.nReturned );
 
+        if (_numPrefetched > 0) {
+            _receivePrefetched();
+            return;
+        }
+
         if (haveLimit) {
             nToReturn -= batch.nReturned;
             verify(nToReturn > 0);
         }
-        BufBuilder b;
-        b.appendNum(opts);
-        b.appendStr(ns);
-        b.appendNum(nextBatchSize());
-        b.appendNum(cursorId);
 
         Message toSend;
-        toSend.setData(dbGetMore, b.buf(), b.len());
+        _assembleGetMore(toSend);
         auto_ptr<Message> response(new Message());
 
         if ( _client ) {
@@ -176,6 +185,12 @@ namespace mongo {
             this->batch.m = response;
             dataReceived();
         }
+        else if ( _prefetchConn ) {
+            // Ask on the connection the cursor keeps for prefetching rather than take another.
+            (*_prefetchConn)->call( toSend, *response );
+            this->batch.m = response;
+            _receivedOnPrefetchConn();
+        }
         else {
             verify( _scopedHost.size() );
             ScopedDbConnection conn(_scopedHost);
@@ -188,6 +203,99 @@ namespace mongo {
         }
     }
 
+    bool DBClientCursor::prefetchMore() {
+        if (_prefetchDepth <= 0 || _numPrefetched >= _prefetchDepth)
+            return false;
+
+        // Only an attached cursor knows a host it can open a connection of its own to.
+        if (_client || _scopedHost.empty())
+            return false;
+
+        // The size of a batch after a limited cursor's current one depends on what the current
+        // one returned, so only prefetch cursors that ask for fixed size batches.
+        if (!cursorId || haveLimit || (opts & (QueryOption_CursorTailable | QueryOption_Exhaust)))
+            return false;
+
+        if (batch.pos * 2 < batch.nReturned)
+            return false;
+
+        if (!_prefetchConn) {
+            _prefetchConn = new ScopedDbConnection(_scopedHost);
+            if (!(*_prefetchConn)->lazySupported()) {
+                _prefetchConn->done();
+                delete _prefetchConn;
+                _prefetchConn = NULL;
+                _prefetchDepth = 0;
+                return false;
+            }
+        }
+
+        Message toSend;
+        _assembleGetMore(toSend);
+        (*_prefetchConn)->say(toSend);
+        _numPrefetched++;
+        return true;
+    }
+
+    void DBClientCursor::_receivePrefetched() {
+        verify( _prefetchConn && _numPrefetched > 0 );
+
+        auto_ptr<Message> response(new Message());
+        _numPrefetched--;
+        if (!(*_prefetchConn)->recv(*response)) {
+            _prefetchConn->kill();
+            delete _prefetchConn;
+            _prefetchConn = NULL;
+            _numPrefetched = 0;
+            uasserted(28630, "recv failed while receiving a prefetched batch");
+        }
+        batch.m = response;
+        _receivedOnPrefetchConn();
+    }
+
+    void DBClientCursor::_receivedOnPrefetchConn() {
+        // dataReceived() checks the response against the connection it came from.
+        _client = _prefetchConn->get();
+        try {
+            dataReceived();
+        }
+        catch (...) {
+            _client = 0;
+            throw;
+        }
+        _client = 0;
+
+        // The connection is kept for the next prefetch until the cursor is exhausted, rather
+        // than taken from the pool for every batch. The replies to getMores sent after the one
+        // which exhausted the cursor are empty.
+        if (cursorId == 0)
+            _discardPrefetched();
+    }
+
+    bool DBClientCursor::prefetchedBatchReady() {
+        return _numPrefetched > 0 && (*_prefetchConn)->replyReady();
+    }
+
+    void DBClientCursor::_discardPrefetched() {
+        verify( _prefetchConn );
+
+        // The connection can only go back to the pool once every reply has been read from it.
+        bool ok = true;
+        while (ok && _numPrefetched > 0) {
+            Message response;
+            ok = (*_prefetchConn)->recv(response);
+            _numPrefetched--;
+        }
+        _numPrefetched = 0;
+
+        if (ok)
+            _prefetchConn->done();
+        else
+            _prefetchConn->kill();
+        delete _prefetchConn;
+        _prefetchConn = NULL;
+    }
+
     /** with QueryOption_Exhaust, the server just blasts data at us (marked at end with cursorid==0). */
     void DBClientCursor::exhaustReceiveMore() {
         verify( cursorId && batch.pos == batch.nReturned );
@@ -362,6 +470,14 @@ namespace mongo {
     }
 
     DBClientCursor::~DBClientCursor() {
+        // Waits for the replies to any prefetched batches, which are thrown away.
+        DESTRUCTOR_GUARD (
+            if ( _prefetchConn )
+                _discardPrefetched();
+        );
+        // Still set only if discarding failed, in which case the connection is not reused.
+        delete _prefetchConn;
+
         DESTRUCTOR_GUARD (
 
         if ( cursorId && _ownCursor && ! inShutdown() ) {
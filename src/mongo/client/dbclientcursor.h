@@ -40,6 +40,7 @@
 namespace mongo {
 
     class AScopedConnection;
+    class ScopedDbConnection;
 
     /** for mock purposes only -- do not create variants of DBClientCursor, nor hang code here
         @see DBClientMockCursor
@@ -135,6 +136,31 @@ namespace mongo {
         /// Change batchSize after construction. Can change after requesting first batch.
         void setBatchSize(int newBatchSize) { batchSize = newBatchSize; }
 
+        /**
+         * Lets the cursor have up to 'depth' getMore requests outstanding, so that the server
+         * produces the next batches while the current one is being consumed. See prefetchMore().
+         * 0, the default, disables prefetching.
+         */
+        void setPrefetchDepth(int depth) { _prefetchDepth = depth; }
+
+        /**
+         * Sends a getMore for a batch after the current one if prefetching is enabled, at least
+         * half of the current batch has been consumed and fewer than the prefetch depth getMores
+         * are outstanding. more() then receives the reply instead of asking for the batch.
+         * Returns true if a getMore was sent.
+         *
+         * Only cursors which were attach()ed prefetch, using a connection of their own from the
+         * pool which they keep until they are exhausted or destroyed. Tailable, exhaust and
+         * limited cursors never prefetch.
+         */
+        bool prefetchMore();
+
+        /**
+         * True if a getMore sent by prefetchMore() is outstanding and its reply has arrived, so
+         * that more() won't wait on the server once the current batch is used up.
+         */
+        bool prefetchedBatchReady();
+
         DBClientCursor( DBClientBase* client, const std::string &_ns, BSONObj _query, int _nToReturn,
                         int _nToSkip, const BSONObj *_fieldsToReturn, int queryOptions , int bs ) :
             _client(client),
@@ -149,7 +175,10 @@ namespace mongo {
             resultFlags(0),
             cursorId(),
             _ownCursor( true ),
-            wasError( false ) {
+            wasError( false ),
+            _prefetchDepth( 0 ),
+            _numPrefetched( 0 ),
+            _prefetchConn( NULL ) {
             _finishConsInit();
         }
 
@@ -165,7 +194,10 @@ namespace mongo {
             resultFlags(0),
             cursorId(_cursorId),
             _ownCursor(true),
-            wasError(false) {
+            wasError(false),
+            _prefetchDepth(0),
+            _numPrefetched(0),
+            _prefetchConn(NULL) {
             _finishConsInit();
         }
 
@@ -240,9 +272,19 @@ namespace mongo {
         std::string _lazyHost;
         bool wasError;
 
+        // See prefetchMore(). The replies to the _numPrefetched outstanding getMores arrive on
+        // _prefetchConn in order. Once taken, _prefetchConn serves every getMore of the cursor.
+        int _prefetchDepth;
+        int _numPrefetched;
+        ScopedDbConnection* _prefetchConn;
+
         void dataReceived() { bool retry; std::string lazyHost; dataReceived( retry, lazyHost ); }
         void dataReceived( bool& retry, std::string& lazyHost );
         void requestMore();
+        void _assembleGetMore( Message& toSend );
+        void _receivePrefetched();
+        void _receivedOnPrefetchConn();
+        void _discardPrefetched();
         void exhaustReceiveMore(); // for exhaust
 
         // Don't call from a virtual function
@@ -575,6 +575,12 @@ namespace mongo {
             if( retry ) *retry = false; if( targetHost ) *targetHost = "";
         }
         virtual bool lazySupported() const = 0;
+
+        /**
+         * True if recv() would find a reply without waiting for it to arrive. Connections which
+         * can't tell return false.
+         */
+        virtual bool replyReady() { return false; }
     };
 
     /**
@@ -1323,6 +1329,7 @@ namespace mongo {
         virtual bool callRead( Message& toSend , Message& response ) { return call( toSend , response ); }
         virtual void say( Message &toSend, bool isRetry = false , std::string * actualServer = 0 );
         virtual bool recv( Message& m );
+        virtual bool replyReady();
         virtual void checkResponse( const char *data, int nReturned, bool* retry = NULL, std::string* host = NULL );
         virtual bool call( Message &toSend, Message &response, bool assertOk = true , std::string * actualServer = 0 );
         virtual ConnectionString::ConnectionType type() const { return ConnectionString::MASTER; }
@@ -1375,6 +1382,9 @@ namespace mongo {
         double _so_timeout;
         bool _connect( std::string& errmsg );
 
+        // Agrees on a compressor for the messages on this connection with the server.
+        void _negotiateCompression();
+
         static AtomicInt32 _numConnections;
         static bool _lazyKillCursor; // lazy means we piggy back kill cursors on next op
 
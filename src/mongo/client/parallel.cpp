@@ -36,18 +36,22 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include "mongo/base/counter.h"
 #include "mongo/client/connpool.h"
 #include "mongo/client/constants.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/client/dbclient_rs.h"
 #include "mongo/client/replica_set_monitor.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/query/lite_parsed_query.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/s/chunk_manager.h"
 #include "mongo/s/config.h"
 #include "mongo/s/grid.h"
 #include "mongo/s/stale_exception.h"
 #include "mongo/s/version_manager.h"
 #include "mongo/util/log.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -62,6 +66,40 @@ namespace mongo {
 
     LabeledLevel pc( "pcursor", 2 );
 
+    // Number of getMores kept outstanding on each shard cursor, see
+    // DBClientCursor::prefetchMore(). 0 disables prefetching.
+    MONGO_EXPORT_SERVER_PARAMETER(shardCursorPrefetchDepth, int, 1);
+
+namespace {
+
+    Counter64 shardGetMorePrefetched;
+    Counter64 shardGetMoreWaits;
+    Counter64 shardGetMoreWaitMicros;
+
+    ServerStatusMetricField<Counter64> displayShardGetMorePrefetched(
+        "cursor.shardGetMore.prefetched", &shardGetMorePrefetched);
+    ServerStatusMetricField<Counter64> displayShardGetMoreWaits(
+        "cursor.shardGetMore.waits", &shardGetMoreWaits);
+    ServerStatusMetricField<Counter64> displayShardGetMoreWaitMicros(
+        "cursor.shardGetMore.waitMicros", &shardGetMoreWaitMicros);
+
+    /**
+     * DBClientCursor::more() for a shard cursor, counting the time spent blocked on the shard
+     * when the current batch is used up and the next one hasn't arrived yet.
+     */
+    bool shardCursorMore(DBClientCursor* cursor) {
+        if (cursor->moreInCurrentBatch() || cursor->isDead() || cursor->prefetchedBatchReady())
+            return cursor->more();
+
+        Timer timer;
+        bool more = cursor->more();
+        shardGetMoreWaits.increment();
+        shardGetMoreWaitMicros.increment(timer.micros());
+        return more;
+    }
+
+}  // namespace
+
     void ParallelSortClusteredCursor::init() {
         if ( _didInit )
             return;
@@ -1114,6 +1152,7 @@ namespace mongo {
             PCMData& mdata = i->second;
 
             _cursors[ index ].reset( mdata.pcState->cursor.get(), &mdata );
+            mdata.pcState->cursor->setPrefetchDepth( shardCursorPrefetchDepth );
             _servers.insert( ServerAndQuery( i->first.getConnString(), BSONObj() ) );
 
             index++;
@@ -1502,7 +1541,7 @@ namespace mongo {
         }
 
         for ( int i=0; i<_numServers; i++ ) {
-            if (_cursors[i].get() && _cursors[i].get()->more())
+            if (_cursors[i].get() && shardCursorMore(_cursors[i].get()))
                 return true;
         }
         return false;
@@ -1520,7 +1559,7 @@ namespace mongo {
             int i = ( j + _lastFrom + 1 ) % _numServers;
 
             // Check to see if the cursor is finished
-            if (!_cursors[i].get() || !_cursors[i].get()->more()) {
+            if (!_cursors[i].get() || !shardCursorMore(_cursors[i].get())) {
                 if (_cursors[i].getMData())
                     _cursors[i].getMData()->pcState->done = true;
                 continue;
@@ -1551,6 +1590,10 @@ namespace mongo {
         uassert(10019, "no more elements", bestFrom >= 0);
         _cursors[bestFrom].get()->next();
 
+        // Ask the shard for its next batch while the rest of this one is merged.
+        if (_cursors[bestFrom].get()->prefetchMore())
+            shardGetMorePrefetched.increment();
+
         // Make sure the result data won't go away after the next call to more()
         if (!_cursors[bestFrom].get()->moreInCurrentBatch()) {
             best = best.getOwned();
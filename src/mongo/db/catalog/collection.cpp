@@ -203,6 +203,63 @@ namespace mongo {
         return res;
     }
 
+    Status Collection::insertDocuments( OperationContext* txn,
+                                        const std::vector<BSONObj>& docs,
+                                        bool enforceQuota ) {
+        dassert(txn->lockState()->isCollectionLockedForMode(ns().toString(), MODE_IX));
+
+        const SnapshotId sid = txn->recoveryUnit()->getSnapshotId();
+
+        if ( _indexCatalog.findIdIndex( txn ) ) {
+            for ( size_t i = 0; i < docs.size(); i++ ) {
+                if ( docs[i]["_id"].eoo() ) {
+                    return Status( ErrorCodes::InternalError,
+                                   str::stream() << "Collection::insertDocuments got "
+                                   "document without _id for ns:" << _ns.ns() );
+                }
+            }
+        }
+
+        // A capped record store may delete earlier documents of the batch to make room for later
+        // ones before any of them are indexed, leaving index entries for the deleted records.
+        // Insert those one at a time so each is indexed before the next can delete it.
+        if ( isCapped() ) {
+            for ( size_t i = 0; i < docs.size(); i++ ) {
+                StatusWith<RecordId> res = _insertDocument( txn, docs[i], enforceQuota );
+                if ( !res.isOK() )
+                    return res.getStatus();
+            }
+            invariant( sid == txn->recoveryUnit()->getSnapshotId() );
+            return Status::OK();
+        }
+
+        std::vector<RecordData> records;
+        records.reserve( docs.size() );
+        for ( size_t i = 0; i < docs.size(); i++ ) {
+            records.push_back( RecordData( docs[i].objdata(), docs[i].objsize() ) );
+        }
+
+        std::vector<RecordId> locs;
+        Status status = _recordStore->insertRecords( txn,
+                                                     records,
+                                                     &locs,
+                                                     _enforceQuota( enforceQuota ) );
+        if ( !status.isOK() )
+            return status;
+
+        invariant( locs.size() == docs.size() );
+        for ( size_t i = 0; i < locs.size(); i++ ) {
+            invariant( RecordId::min() < locs[i] );
+            invariant( locs[i] < RecordId::max() );
+        }
+
+        _infoCache.notifyOfWriteOp();
+
+        status = _indexCatalog.indexRecords( txn, docs, locs );
+        invariant( sid == txn->recoveryUnit()->getSnapshotId() );
+        return status;
+    }
+
     StatusWith<RecordId> Collection::insertDocument( OperationContext* txn,
                                                     const BSONObj& doc,
                                                     MultiIndexBlock* indexBlock,
@@ -169,6 +169,18 @@ namespace mongo {
                                             const BSONObj& doc,
                                             bool enforceQuota );
 
+        /**
+         * Inserts all of 'docs' at once, handing the record store and each index the whole batch.
+         * Like insertDocument(), this does NOT modify the docs. On error, some of the documents
+         * may have been written, so the caller must roll back its WriteUnitOfWork. Capped
+         * collections insert the documents one at a time.
+         *
+         * If enforceQuota is false, quotas will be ignored.
+         */
+        Status insertDocuments( OperationContext* txn,
+                                const std::vector<BSONObj>& docs,
+                                bool enforceQuota );
+
         StatusWith<RecordId> insertDocument( OperationContext* txn,
                                             const DocWriter* doc,
                                             bool enforceQuota );
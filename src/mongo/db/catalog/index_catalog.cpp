@@ -1156,6 +1156,32 @@ namespace {
         return index->accessMethod()->insert(txn, obj, loc, options, &inserted);
     }
 
+    Status IndexCatalog::_indexRecords(OperationContext* txn,
+                                       IndexCatalogEntry* index,
+                                       const std::vector<BSONObj>& objs,
+                                       const std::vector<RecordId>& locs) {
+        InsertDeleteOptions options;
+        options.logIfError = false;
+        options.dupsAllowed = isDupsAllowed( index->descriptor() );
+
+        int64_t inserted;
+        const MatchExpression* filter = index->getFilterExpression();
+        if ( !filter ) {
+            return index->accessMethod()->insertMany(txn, objs, locs, options, &inserted);
+        }
+
+        std::vector<BSONObj> filteredObjs;
+        std::vector<RecordId> filteredLocs;
+        for ( size_t i = 0; i < objs.size(); i++ ) {
+            if ( filter->matchesBSON( objs[i] ) ) {
+                filteredObjs.push_back( objs[i] );
+                filteredLocs.push_back( locs[i] );
+            }
+        }
+        return index->accessMethod()->insertMany(txn, filteredObjs, filteredLocs, options,
+                                                 &inserted);
+    }
+
     Status IndexCatalog::_unindexRecord(OperationContext* txn,
                                         IndexCatalogEntry* index,
                                         const BSONObj& obj,
@@ -1198,6 +1224,21 @@ namespace {
         return Status::OK();
     }
 
+    Status IndexCatalog::indexRecords(OperationContext* txn,
+                                      const std::vector<BSONObj>& objs,
+                                      const std::vector<RecordId>& locs) {
+
+        for ( IndexCatalogEntryContainer::const_iterator i = _entries.begin();
+              i != _entries.end();
+              ++i ) {
+            Status s = _indexRecords(txn, *i, objs, locs);
+            if (!s.isOK())
+                return s;
+        }
+
+        return Status::OK();
+    }
+
     void IndexCatalog::unindexRecord(OperationContext* txn,
                                      const BSONObj& obj,
                                      const RecordId& loc,
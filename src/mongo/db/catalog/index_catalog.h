@@ -287,6 +287,14 @@ namespace mongo {
         // this throws for now
         Status indexRecord(OperationContext* txn, const BSONObj& obj, const RecordId &loc);
 
+        /**
+         * Indexes each of 'objs', stored at the matching location of 'locs', handing each index
+         * the keys of all of the documents at once. On error the caller must roll back.
+         */
+        Status indexRecords(OperationContext* txn,
+                            const std::vector<BSONObj>& objs,
+                            const std::vector<RecordId>& locs);
+
         void unindexRecord(OperationContext* txn,
                            const BSONObj& obj,
                            const RecordId& loc,
@@ -326,6 +334,11 @@ namespace mongo {
                             const BSONObj& obj,
                             const RecordId &loc );
 
+        Status _indexRecords(OperationContext* txn,
+                             IndexCatalogEntry* index,
+                             const std::vector<BSONObj>& objs,
+                             const std::vector<RecordId>& locs);
+
         Status _unindexRecord(OperationContext* txn,
                               IndexCatalogEntry* index,
                               const BSONObj& obj,
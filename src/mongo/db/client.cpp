@@ -124,6 +124,22 @@ namespace {
         clients.insert(client);
     }
 
+    Client* Client::releaseCurrent() {
+        return currentClient.release();
+    }
+
+    void Client::setCurrent(Client* client) {
+        invariant(currentClient.get() == 0);
+        invariant(client);
+
+        setThreadName(client->desc());
+        {
+            boost::unique_lock<SpinLock> uniqueLock(client->_lock);
+            client->_threadId = boost::this_thread::get_id();
+        }
+        currentClient.reset(client);
+    }
+
     Client::Client(const string& desc, AbstractMessagingPort *p)
         : ClientBasic(p),
           _desc(desc),
@@ -95,6 +95,19 @@ namespace mongo {
             initThread(getThreadName().c_str());
         }
 
+        /**
+         * Unbinds the current thread's Client without destroying it and returns it, so that it
+         * can later be bound to a (possibly different) thread with setCurrent. Used by servers
+         * which multiplex many connections over a pool of worker threads.
+         */
+        static Client* releaseCurrent();
+
+        /**
+         * Binds a Client previously obtained from releaseCurrent to this thread, which becomes
+         * the thread it reports. The thread must not already have a Client.
+         */
+        static void setCurrent(Client* client);
+
         /** this has to be called as the client goes away, but before thread termination
          *  @return true if anything was done
          */
@@ -144,8 +157,8 @@ namespace mongo {
         // Description for the client (e.g. conn8)
         const std::string _desc;
 
-        // OS id of the thread, which owns this client
-        const boost::thread::id _threadId;
+        // OS id of the thread, which owns this client. Changed by setCurrent under _lock.
+        boost::thread::id _threadId;
 
         // > 0 for things "conn", 0 otherwise
         const ConnectionId _connectionId;
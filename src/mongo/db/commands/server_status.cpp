@@ -47,6 +47,7 @@
 #include "mongo/platform/process_id.h"
 #include "mongo/util/log.h"
 #include "mongo/util/net/listen.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/ramlog.h"
@@ -272,6 +273,9 @@ namespace mongo {
 
                 BSONObjBuilder b;
                 networkCounter.append( b );
+                BSONObjBuilder compression( b.subobjStart( "compression" ) );
+                appendMessageCompressionStats( &compression );
+                compression.done();
                 return b.obj();
             }
                 
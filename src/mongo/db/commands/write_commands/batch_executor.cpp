@@ -110,6 +110,13 @@ namespace mongo {
     // TODO: Determine queueing behavior we want here
     MONGO_EXPORT_SERVER_PARAMETER( queueForMigrationCommit, bool, true );
 
+    // Maximum number of consecutive documents of an insert batch to insert with a single call into
+    // the collection. Set to 0 or 1 to insert every document on its own.
+    MONGO_EXPORT_SERVER_PARAMETER( insertGroupMaxDocs, int, 64 );
+
+    // Maximum total size of the documents inserted with a single call into the collection.
+    static const int kInsertGroupMaxBytes = 256 * 1024;
+
     using mongoutils::str::stream;
 
     WriteBatchExecutor::WriteBatchExecutor( OperationContext* txn,
@@ -682,7 +689,7 @@ namespace mongo {
         /**
          * Returns true if this executor has the lock on the target database.
          */
-        bool hasLock() { return _writeLock.get(); }
+        bool hasLock() const { return _writeLock.get(); }
 
         /**
          * Gets the lock-holding object.  Only valid if hasLock().
@@ -693,7 +700,13 @@ namespace mongo {
          * Gets the target collection for the batch operation.  Value is undefined
          * unless hasLock() is true.
          */
-        Collection* getCollection() { return _collection; }
+        Collection* getCollection() const { return _collection; }
+
+        /**
+         * Gets the profiling level of the target database.  Value is undefined unless hasLock()
+         * is true.
+         */
+        int getProfilingLevel() { return _context->db()->getProfilingLevel(); }
 
         OperationContext* txn;
 
@@ -829,6 +842,29 @@ namespace mongo {
         }
     }
 
+    // Returns the end of the run of documents, starting at the current insert of "state", which
+    // may be inserted together.  The run is empty if the current insert can't be grouped.
+    static size_t findInsertGroupEnd( const WriteBatchExecutor::ExecInsertsState& state ) {
+        if ( state.request->isInsertIndexRequest() || insertGroupMaxDocs <= 1 )
+            return state.currIndex;
+
+        // Capped collections may delete documents of a group before they are indexed.
+        if ( state.hasLock() && state.getCollection() && state.getCollection()->isCapped() )
+            return state.currIndex;
+
+        const size_t maxEnd = std::min( state.normalizedInserts.size(),
+                                        state.currIndex + insertGroupMaxDocs );
+        size_t end = state.currIndex;
+        int bytes = 0;
+        while ( end < maxEnd && state.normalizedInserts[end].isOK() ) {
+            bytes += state.request->getInsertRequest()->getDocumentsAt( end ).objsize();
+            if ( end > state.currIndex && bytes > kInsertGroupMaxBytes )
+                break;
+            ++end;
+        }
+        return end;
+    }
+
     void WriteBatchExecutor::execInserts( const BatchedCommandRequest& request,
                                           const WriteConcernOptions& originalWC,
                                           std::vector<WriteErrorDetail*>* errors ) {
@@ -870,6 +906,10 @@ namespace mongo {
         ElapsedTracker elapsedTracker(internalQueryExecYieldIterations,
                                       internalQueryExecYieldPeriodMS);
 
+        // When a group fails, its documents are inserted one at a time up to this index, so that
+        // a bad document is only found once rather than by every group which still includes it.
+        size_t singleInsertsEnd = 0;
+
         for (state.currIndex = 0;
              state.currIndex < state.request->sizeWriteOps();
              ++state.currIndex) {
@@ -901,6 +941,24 @@ namespace mongo {
                 elapsedTracker.resetLastTime();
             }
 
+            // Insert a run of valid documents with one call into the collection where possible,
+            // which lets the storage engine and indexes handle the run as a batch.
+            const size_t groupEnd = state.currIndex < singleInsertsEnd ?
+                                    state.currIndex : findInsertGroupEnd(state);
+            if (groupEnd > state.currIndex + 1) {
+                if (groupEnd == state.request->sizeWriteOps()) {
+                    // The group includes the last write in the batch; see above.
+                    _txn->setWriteConcern(originalWC);
+                    setupSynchronousCommit(_txn);
+                }
+
+                if (execInsertGroup(&state, groupEnd)) {
+                    state.currIndex = groupEnd - 1;
+                    continue;
+                }
+                singleInsertsEnd = groupEnd;
+            }
+
             WriteErrorDetail* error = NULL;
             execOneInsert(&state, &error);
             if (error) {
@@ -1178,6 +1236,98 @@ namespace mongo {
         }
     }
 
+    /**
+     * Inserts 'docs' into the target collection of 'state' in one WriteUnitOfWork.  Returns false
+     * without writing anything if the group can't or shouldn't be inserted together.
+     */
+    static bool tryInsertGroup(WriteBatchExecutor::ExecInsertsState* state,
+                               const std::vector<BSONObj>& docs,
+                               WriteOpResult* result) {
+        OperationContext* txn = state->txn;
+
+        // Lock and check failures are reported by the single inserts.
+        if (!state->lockAndCheck(result))
+            return false;
+
+        // Profiled databases get one entry per document.
+        if (state->getProfilingLevel() != 0)
+            return false;
+
+        // Capped collections may delete documents of the group before they are indexed.
+        Collection* collection = state->getCollection();
+        if (collection->isCapped())
+            return false;
+
+        const string& insertNS = collection->ns().ns();
+
+        WriteUnitOfWork wunit(txn);
+        Status status = collection->insertDocuments(txn, docs, true);
+        if (!status.isOK())
+            return false;
+
+        for (size_t i = 0; i < docs.size(); ++i) {
+            getGlobalServiceContext()->getOpObserver()->onInsert(txn, insertNS, docs[i]);
+        }
+        wunit.commit();
+        return true;
+    }
+
+    bool WriteBatchExecutor::execInsertGroup(ExecInsertsState* state, size_t end) {
+        invariant(!_txn->lockState()->inAWriteUnitOfWork());
+
+        const size_t begin = state->currIndex;
+        std::vector<BSONObj> docs;
+        docs.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            const BSONObj& normalized = state->normalizedInserts[i].getValue();
+            docs.push_back(normalized.isEmpty() ?
+                           state->request->getInsertRequest()->getDocumentsAt(i) :
+                           normalized);
+        }
+
+        BatchItemRef firstInsertItem(state->request, begin);
+        CurOp currentOp( _txn->getClient(), _txn->getClient()->curop() );
+        beginCurrentOp( &currentOp, _txn->getClient(), firstInsertItem );
+
+        WriteOpResult result;
+        bool inserted = false;
+        try {
+            inserted = tryInsertGroup(state, docs, &result);
+        }
+        catch (const WriteConflictException&) {
+            _txn->getCurOp()->debug().writeConflicts++;
+            _txn->recoveryUnit()->commitAndRestart();
+            state->unlock();
+        }
+        catch (const StaleConfigException&) {
+            _txn->recoveryUnit()->commitAndRestart();
+            state->unlock();
+        }
+        catch (const DBException& ex) {
+            if (ErrorCodes::isInterruption(ex.getCode())) {
+                currentOp.done();
+                throw;
+            }
+            _txn->recoveryUnit()->commitAndRestart();
+            state->unlock();
+        }
+
+        if (!inserted) {
+            // The single inserts which follow report this work, so just end the group's op.
+            currentOp.done();
+            return false;
+        }
+
+        for (size_t i = begin; i < end; ++i) {
+            incOpStats(BatchItemRef(state->request, i));
+        }
+
+        result.getStats().n = docs.size();
+        incWriteStats(firstInsertItem, result.getStats(), NULL, &currentOp);
+        finishCurrentOp(_txn, &currentOp, NULL);
+        return true;
+    }
+
     /**
      * Perform a single insert into a collection.  Requires the insert be preprocessed and the
      * collection already has been created.
@@ -104,6 +104,15 @@ namespace mongo {
          */
         void execOneInsert( ExecInsertsState* state, WriteErrorDetail** error );
 
+        /**
+         * Inserts the documents from the current insert of "state" up to, but not including,
+         * "end" with one call into the collection, in a single WriteUnitOfWork and CurOp.
+         *
+         * Returns false, having inserted nothing, if the group could not be inserted as a whole,
+         * in which case the caller must insert the documents one at a time to report errors.
+         */
+        bool execInsertGroup( ExecInsertsState* state, size_t end );
+
         /**
          * Executes an update item (which may update many documents or upsert), and returns the
          * upserted _id on upsert or error on failure.
@@ -163,7 +163,7 @@ namespace mongo {
         }
 
         virtual bool isBatchWriter() const {
-            invariant(false);
+            return false;
         }
 
         virtual void setLockPendingParallelWriter(bool newValue) {
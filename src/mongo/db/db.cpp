@@ -41,6 +41,7 @@
 #include <signal.h>
 #include <string>
 
+#include "mongo/base/checked_cast.h"
 #include "mongo/base/init.h"
 #include "mongo/base/initializer.h"
 #include "mongo/base/status.h"
@@ -75,6 +76,7 @@
 #include "mongo/db/mongod_options.h"
 #include "mongo/db/op_observer.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/plan_cache_persistence.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/range_deleter_service.h"
 #include "mongo/db/repair_database.h"
@@ -246,6 +248,14 @@ namespace mongo {
             if( c ) c->shutdown();
         }
 
+        virtual ClientBasic* detachFromThread( AbstractMessagingPort* p ) {
+            return Client::releaseCurrent();
+        }
+
+        virtual void attachToThread( AbstractMessagingPort* p , ClientBasic* client ) {
+            Client::setCurrent( checked_cast<Client*>( client ) );
+        }
+
     };
 
     static void logStartup() {
@@ -448,6 +458,10 @@ namespace mongo {
         MessageServer::Options options;
         options.port = listenPort;
         options.ipList = serverGlobalParams.bind_ip;
+        if (serverGlobalParams.reactorNetworking) {
+            options.connectionModel = MessageServer::Options::kReactor;
+            options.workerThreads = serverGlobalParams.reactorWorkerThreads;
+        }
 
         MessageServer* server = createServer(options, new MyMessageHandler());
         server->setAsTimeTracker();
@@ -634,6 +648,7 @@ namespace mongo {
                 startTTLBackgroundJob();
             }
 
+            startPlanCachePersistenceJob();
         }
 
         startClientCursorMonitor();
@@ -37,6 +37,7 @@
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/catalog/collection.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/record_fetcher.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
@@ -48,6 +49,11 @@ namespace mongo {
     using std::auto_ptr;
     using std::vector;
 
+namespace {
+    // How many records to read from the iterator at a time when it supports batches.
+    const size_t kRecordsPerBatch = 64;
+}
+
     // static
     const char* CollectionScan::kStageType = "COLLSCAN";
 
@@ -60,11 +66,17 @@ namespace mongo {
           _filter(filter),
           _params(params),
           _isDead(false),
+          _useBatches(false),
+          _batchPos(0),
           _wsidForFetch(_workingSet->allocate()),
           _commonStats(kStageType) {
         // Explain reports the direction of the collection scan.
         _specificStats.direction = params.direction;
 
+        if (NULL != _filter && internalQueryExecCompileFilters) {
+            _compiledFilter.reset(CompiledMatchExpression::compile(_filter));
+        }
+
         // We pre-allocate a WSM and use it to pass up fetch requests. This should never be used
         // for anything other than passing up NEED_YIELD. We use the loc and owned obj state, but
         // the loc isn't really pointing at any obj. The obj field of the WSM should never be used.
@@ -92,6 +104,7 @@ namespace mongo {
                     _iter.reset( _params.collection->getIterator( _txn,
                                                                   _params.start,
                                                                   _params.direction ) );
+                    _useBatches = !_params.tailable && _iter->hasNativeBatches();
                 }
                 else {
                     invariant(_params.tailable);
@@ -121,6 +134,9 @@ namespace mongo {
             return PlanStage::NEED_TIME;
         }
 
+        if (_useBatches)
+            return workFromBatch(out);
+
         // Should we try getNext() on the underlying _iter?
         if (isEOF())
             return PlanStage::IS_EOF;
@@ -177,12 +193,81 @@ namespace mongo {
         return returnIfMatches(member, id, out);
     }
 
+    PlanStage::StageState CollectionScan::workFromBatch(WorkingSetID* out) {
+        if (_batchPos == _batch.size()) {
+            if (isEOF())
+                return PlanStage::IS_EOF;
+
+            _batch.clear();
+            _batchPos = 0;
+
+            size_t maxRecords = kRecordsPerBatch;
+            if (0 != _params.maxScan) {
+                maxRecords = std::min(maxRecords, _params.maxScan - _specificStats.docsTested);
+            }
+
+            try {
+                _iter->getNextBatch(maxRecords, &_batch);
+            }
+            catch (const WriteConflictException& wce) {
+                // The records read before the conflict can still be returned.
+                if (_batch.empty()) {
+                    *out = WorkingSet::INVALID_ID;
+                    return PlanStage::NEED_YIELD;
+                }
+            }
+            _batchSnapshotId = _txn->recoveryUnit()->getSnapshotId();
+
+            if (_batch.empty())
+                return PlanStage::IS_EOF;
+        }
+
+        // Test the records against the filter directly, so that a working set member is only
+        // allocated for the record which is returned.
+        while (_batchPos < _batch.size()) {
+            RecordIdAndData& record = _batch[_batchPos++];
+            _lastSeenLoc = record.id;
+            ++_specificStats.docsTested;
+
+            Snapshotted<BSONObj> obj;
+            if (NULL == record.data.data()) {
+                // Changed during a yield.
+                obj = _params.collection->docFor(_txn, record.id);
+            }
+            else {
+                obj = Snapshotted<BSONObj>(_batchSnapshotId, record.data.releaseToBson());
+            }
+
+            if (_compiledFilter) {
+                if (!_compiledFilter->matchesBSON(obj.value())) {
+                    continue;
+                }
+            }
+            else if (NULL != _filter && !_filter->matchesBSON(obj.value())) {
+                continue;
+            }
+
+            WorkingSetID id = _workingSet->allocate();
+            WorkingSetMember* member = _workingSet->get(id);
+            member->loc = record.id;
+            member->obj = obj;
+            member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+
+            *out = id;
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+
+        ++_commonStats.needTime;
+        return PlanStage::NEED_TIME;
+    }
+
     PlanStage::StageState CollectionScan::returnIfMatches(WorkingSetMember* member,
                                                           WorkingSetID memberID,
                                                           WorkingSetID* out) {
         ++_specificStats.docsTested;
 
-        if (Filter::passes(member, _filter)) {
+        if (Filter::passes(member, _filter, _compiledFilter.get())) {
             *out = memberID;
             ++_commonStats.advanced;
             return PlanStage::ADVANCED;
@@ -201,7 +286,7 @@ namespace mongo {
         if (_isDead) { return true; }
         if (NULL == _iter) { return false; }
         if (_params.tailable) { return false; } // tailable cursors can return data later.
-        return _iter->isEOF();
+        return _batchPos == _batch.size() && _iter->isEOF();
     }
 
     void CollectionScan::invalidate(OperationContext* txn,
@@ -209,6 +294,20 @@ namespace mongo {
                                     InvalidationType type) {
         ++_commonStats.invalidates;
 
+        // Records read ahead in a batch must not be returned as they were before a change.
+        for (size_t i = _batchPos; i < _batch.size(); ++i) {
+            if (_batch[i].id == dl) {
+                if (INVALIDATION_DELETION == type) {
+                    _batch.erase(_batch.begin() + i);
+                }
+                else {
+                    // Read it again when it is returned.
+                    _batch[i].data = RecordData();
+                }
+                break;
+            }
+        }
+
         // We don't care about mutations since we apply any filters to the result when we (possibly)
         // return it.
         if (INVALIDATION_DELETION != type) {
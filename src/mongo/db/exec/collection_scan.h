@@ -32,8 +32,11 @@
 
 #include "mongo/db/exec/collection_scan_common.h"
 #include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/matcher/compiled_expression.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/db/record_id.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/db/storage/snapshot.h"
 
 namespace mongo {
 
@@ -82,6 +85,13 @@ namespace mongo {
                                    WorkingSetID memberID,
                                    WorkingSetID* out);
 
+        /**
+         * work() for iterators which read records in batches natively. Returns the next record
+         * of the current batch which passes our filter, reading a new batch first if the current
+         * one is used up.
+         */
+        StageState workFromBatch(WorkingSetID* out);
+
         // transactional context for read locks. Not owned by us
         OperationContext* _txn;
 
@@ -91,6 +101,9 @@ namespace mongo {
         // The filter is not owned by us.
         const MatchExpression* _filter;
 
+        // '_filter' compiled for matching documents, or NULL.
+        boost::scoped_ptr<CompiledMatchExpression> _compiledFilter;
+
         boost::scoped_ptr<RecordIterator> _iter;
 
         CollectionScanParams _params;
@@ -99,6 +112,19 @@ namespace mongo {
 
         RecordId _lastSeenLoc;
 
+        // Set if the records are read from _iter in batches, which is only done for non-tailable
+        // scans of record stores which support it natively.
+        bool _useBatches;
+
+        // The records read from _iter in the current batch, and the position of the next one to
+        // return. Records which were changed during a yield have their data cleared, and are read
+        // again before they are returned.
+        std::vector<RecordIdAndData> _batch;
+        size_t _batchPos;
+
+        // The snapshot the current batch was read in.
+        SnapshotId _batchSnapshotId;
+
         // We allocate a working set member with this id on construction of the stage. It gets
         // used for all fetch requests, changing the RecordId as appropriate.
         const WorkingSetID _wsidForFetch;
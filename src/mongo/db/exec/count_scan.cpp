@@ -29,6 +29,7 @@
 #include "mongo/db/exec/count_scan.h"
 
 #include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/index/index_cursor.h"
 #include "mongo/db/index/index_descriptor.h"
@@ -43,11 +44,15 @@ namespace mongo {
 
     CountScan::CountScan(OperationContext* txn,
                          const CountScanParams& params,
-                         WorkingSet* workingSet)
+                         WorkingSet* workingSet,
+                         const MatchExpression* filter)
         : _txn(txn),
           _workingSet(workingSet),
           _descriptor(params.descriptor),
           _iam(params.descriptor->getIndexCatalog()->getIndex(params.descriptor)),
+          _keyEltsToUse(0),
+          _movePastKeyElts(false),
+          _filter(filter),
           _params(params),
           _hitEnd(false),
           _shouldDedup(params.descriptor->isMultikey(txn)),
@@ -56,6 +61,9 @@ namespace mongo {
         _specificStats.indexName = _params.descriptor->indexName();
         _specificStats.isMultiKey = _params.descriptor->isMultikey(txn);
         _specificStats.indexVersion = _params.descriptor->version();
+        if (!_params.bounds.fields.empty()) {
+            _specificStats.indexBounds = _params.bounds.toBSON();
+        }
     }
 
     void CountScan::initIndexCursor() {
@@ -68,6 +76,27 @@ namespace mongo {
         verify(cursor);
         _cursor.reset(cursor);
 
+        if (!_params.bounds.fields.empty()) {
+            // The bounds checker gives us our start key and the keys to skip to between
+            // intervals.  There is no end cursor: the checker tells us when we're done.
+            _checker.reset(new IndexBoundsChecker(&_params.bounds,
+                                                  _descriptor->keyPattern(),
+                                                  1));
+
+            int nFields = _descriptor->keyPattern().nFields();
+            vector<const BSONElement*> key(nFields);
+            vector<bool> inc(nFields);
+            if (_checker->getStartKey(&key, &inc)) {
+                _cursor->seek(key, inc);
+                _keyElts.resize(nFields);
+                _keyEltsInc.resize(nFields);
+            }
+            else {
+                _hitEnd = true;
+            }
+            return;
+        }
+
         // _cursor points at our start position.  We move it forward until it hits a cursor
         // that points at the end.
         _cursor->seek(_params.startKey, !_params.startKeyInclusive);
@@ -92,6 +121,9 @@ namespace mongo {
     void CountScan::checkEnd() {
         if (isEOF()) { return; }
 
+        // The bounds checker decides when a scan over 'bounds' is done.
+        if (NULL != _checker.get()) { return; }
+
         if (_endCursor->isEOF()) {
             // If the endCursor is EOF we're only done when our 'current count position' hits EOF.
             _hitEnd = _cursor->isEOF();
@@ -102,6 +134,29 @@ namespace mongo {
         }
     }
 
+    bool CountScan::checkBounds() {
+        IndexBoundsChecker::KeyState keyState = _checker->checkKey(_cursor->getKey(),
+                                                                   &_keyEltsToUse,
+                                                                   &_movePastKeyElts,
+                                                                   &_keyElts,
+                                                                   &_keyEltsInc);
+
+        if (IndexBoundsChecker::DONE == keyState) {
+            _hitEnd = true;
+            return false;
+        }
+
+        if (IndexBoundsChecker::VALID == keyState) {
+            return true;
+        }
+
+        verify(IndexBoundsChecker::MUST_ADVANCE == keyState);
+        ++_specificStats.keysExamined;
+        _cursor->skip(_cursor->getKey(), _keyEltsToUse, _movePastKeyElts,
+                      _keyElts, _keyEltsInc);
+        return false;
+    }
+
     PlanStage::StageState CountScan::work(WorkingSetID* out) {
         ++_commonStats.works;
 
@@ -127,8 +182,31 @@ namespace mongo {
 
         if (isEOF()) { return PlanStage::IS_EOF; }
 
+        if (NULL != _checker.get()) {
+            bool inBounds;
+            try {
+                inBounds = checkBounds();
+            }
+            catch (const WriteConflictException& wce) {
+                *out = WorkingSet::INVALID_ID;
+                return PlanStage::NEED_YIELD;
+            }
+
+            if (!inBounds) {
+                // Either we're done or we skipped towards the next interval.  Either way the new
+                // position has to be checked on the next call.
+                ++_commonStats.needTime;
+                return PlanStage::NEED_TIME;
+            }
+        }
+
         RecordId loc = _cursor->getValue();
 
+        // The key is only valid until the cursor moves, so check it against the filter first.
+        const bool filterPasses = Filter::passes(_cursor->getKey(),
+                                                 _descriptor->keyPattern(),
+                                                 _filter);
+
         try {
             _cursor->next();
         }
@@ -143,6 +221,11 @@ namespace mongo {
 
         ++_specificStats.keysExamined;
 
+        if (!filterPasses) {
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+
         if (_shouldDedup) {
             if (_returned.end() != _returned.find(loc)) {
                 ++_commonStats.needTime;
@@ -173,7 +256,9 @@ namespace mongo {
         if (_hitEnd || (NULL == _cursor.get())) { return; }
 
         _cursor->savePosition();
-        _endCursor->savePosition();
+        if (NULL != _endCursor.get()) {
+            _endCursor->savePosition();
+        }
     }
 
     void CountScan::restoreState(OperationContext* opCtx) {
@@ -192,6 +277,15 @@ namespace mongo {
             return;
         }
 
+        // This can change during yielding.
+        _shouldDedup = _descriptor->isMultikey(_txn);
+
+        // A scan over 'bounds' checks the key under the cursor on every call to work(), so
+        // wherever the restored cursor ended up is fine.
+        if (NULL != _checker.get()) {
+            return;
+        }
+
         // See if we're somehow already past our end key (maybe the thing we were pointing at got
         // deleted...)
         int cmp = _cursor->getKey().woCompare(_params.endKey, _descriptor->keyPattern(), false);
@@ -217,9 +311,6 @@ namespace mongo {
         // If we weren't EOF our end position might have moved around.  Relocate it.
         _endCursor->seek(_params.endKey, _params.endKeyInclusive);
 
-        // This can change during yielding.
-        _shouldDedup = _descriptor->isMultikey(_txn);
-
         checkEnd();
     }
 
@@ -247,6 +338,14 @@ namespace mongo {
 
     PlanStageStats* CountScan::getStats() {
         _commonStats.isEOF = isEOF();
+
+        // Add a BSON representation of the filter to the stats tree, if there is one.
+        if (NULL != _filter) {
+            BSONObjBuilder bob;
+            _filter->toBSON(&bob);
+            _commonStats.filter = bob.obj();
+        }
+
         auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_COUNT_SCAN));
 
         CountScanStats* countStats = new CountScanStats(_specificStats);
@@ -35,6 +35,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/query/index_bounds.h"
 #include "mongo/db/record_id.h"
 #include "mongo/platform/unordered_set.h"
 
@@ -55,6 +56,10 @@ namespace mongo {
 
         BSONObj endKey;
         bool endKeyInclusive;
+
+        // If 'bounds' has any fields the scan walks the intervals of 'bounds' in increasing
+        // order, skipping from one to the next, and the start and end keys are ignored.
+        IndexBounds bounds;
     };
 
     /**
@@ -62,12 +67,18 @@ namespace mongo {
      * any WorkingSetMember(s) for any of the data, instead returning ADVANCED to indicate to the
      * caller that another result should be counted.
      *
+     * If a filter is given, only the keys which pass it are counted.  The filter must be
+     * answerable from the index key alone.
+     *
      * Only created through the getExecutorCount path, as count is the only operation that doesn't
      * care about its data.
      */
     class CountScan : public PlanStage {
     public:
-        CountScan(OperationContext* txn, const CountScanParams& params, WorkingSet* workingSet);
+        CountScan(OperationContext* txn,
+                  const CountScanParams& params,
+                  WorkingSet* workingSet,
+                  const MatchExpression* filter);
         virtual ~CountScan() { }
 
         virtual StageState work(WorkingSetID* out);
@@ -99,6 +110,12 @@ namespace mongo {
          */
         void checkEnd();
 
+        /**
+         * Used when scanning 'bounds'.  Returns true if the cursor points at a key inside the
+         * bounds.  Otherwise moves the cursor towards the next interval, or sets _hitEnd.
+         */
+        bool checkBounds();
+
         // transactional context for read locks. Not owned by us
         OperationContext* _txn;
 
@@ -112,9 +129,19 @@ namespace mongo {
         // Our start cursor.
         boost::scoped_ptr<IndexCursor> _cursor;
 
-        // Our end marker.
+        // Our end marker.  Not used when scanning 'bounds'.
         boost::scoped_ptr<IndexCursor> _endCursor;
 
+        // Only used when scanning 'bounds': keeps the cursor inside the intervals.
+        boost::scoped_ptr<IndexBoundsChecker> _checker;
+        int _keyEltsToUse;
+        bool _movePastKeyElts;
+        std::vector<const BSONElement*> _keyElts;
+        std::vector<bool> _keyEltsInc;
+
+        // Applied to each key before it is counted.  The filter is not owned by us.
+        const MatchExpression* _filter;
+
         // Could our index have duplicates?  If so, we use _returned to dedup.
         unordered_set<RecordId, RecordId::Hasher> _returned;
 
@@ -43,17 +43,23 @@ namespace mongo {
     // static
     const char* DistinctScan::kStageType = "DISTINCT_SCAN";
 
-    DistinctScan::DistinctScan(OperationContext* txn, const DistinctParams& params, WorkingSet* workingSet)
+    DistinctScan::DistinctScan(OperationContext* txn,
+                               const DistinctParams& params,
+                               WorkingSet* workingSet,
+                               const MatchExpression* filter)
         : _txn(txn),
           _workingSet(workingSet),
           _descriptor(params.descriptor),
           _iam(params.descriptor->getIndexCatalog()->getIndex(params.descriptor)),
           _scanState(INITIALIZING),
+          _filter(filter),
           _params(params),
           _commonStats(kStageType) {
         _specificStats.keyPattern = _params.descriptor->keyPattern();
         _specificStats.indexName = _params.descriptor->indexName();
         _specificStats.indexVersion = _params.descriptor->version();
+        _specificStats.direction = _params.direction;
+        _specificStats.indexBounds = _params.bounds.toBSON();
     }
 
     void DistinctScan::initIndexCursor() {
@@ -128,6 +134,15 @@ namespace mongo {
         }
 
         if (GETTING_NEXT == _scanState) {
+            // A key which fails the filter doesn't tell us anything about the other keys with the
+            // same value for the distinct field, so step over just this one.
+            if (!Filter::passes(_cursor->getKey(), _descriptor->keyPattern(), _filter)) {
+                _cursor->next();
+                _scanState = CHECKING_END;
+                ++_commonStats.needTime;
+                return PlanStage::NEED_TIME;
+            }
+
             // Grab the next (key, value) from the index.
             BSONObj ownedKeyObj = _cursor->getKey().getOwned();
             RecordId loc = _cursor->getValue();
@@ -254,6 +269,14 @@ namespace mongo {
 
     PlanStageStats* DistinctScan::getStats() {
         _commonStats.isEOF = isEOF();
+
+        // Add a BSON representation of the filter to the stats tree, if there is one.
+        if (NULL != _filter) {
+            BSONObjBuilder bob;
+            _filter->toBSON(&bob);
+            _commonStats.filter = bob.obj();
+        }
+
         auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_DISTINCT_SCAN));
         ret->specific.reset(new DistinctScanStats(_specificStats));
         return ret.release();
@@ -74,6 +74,9 @@ namespace mongo {
      * for that field, so there is no point in examining all keys with the same value for that
      * field.
      *
+     * If a filter is given, keys which don't pass it are stepped over one at a time, since a
+     * later key with the same value for the distinct field may still pass.
+     *
      * Only created through the getExecutorDistinct path.  See db/query/get_executor.cpp
      */
     class DistinctScan : public PlanStage {
@@ -96,7 +99,10 @@ namespace mongo {
             HIT_END
         };
 
-        DistinctScan(OperationContext* txn, const DistinctParams& params, WorkingSet* workingSet);
+        DistinctScan(OperationContext* txn,
+                     const DistinctParams& params,
+                     WorkingSet* workingSet,
+                     const MatchExpression* filter);
         virtual ~DistinctScan() { }
 
         virtual StageState work(WorkingSetID* out);
@@ -142,6 +148,9 @@ namespace mongo {
         // Keeps track of what work we need to do next.
         ScanState _scanState;
 
+        // Applied to each key before it is returned.  The filter is not owned by us.
+        const MatchExpression* _filter;
+
         // For yielding.
         BSONObj _savedKey;
         RecordId _savedLoc;
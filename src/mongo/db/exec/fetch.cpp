@@ -35,6 +35,7 @@
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/record_fetcher.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/mongoutils/str.h"
@@ -58,7 +59,12 @@ namespace mongo {
           _child(child),
           _filter(filter),
           _idRetrying(WorkingSet::INVALID_ID),
-          _commonStats(kStageType) { }
+          _commonStats(kStageType) {
+
+        if (NULL != _filter && internalQueryExecCompileFilters) {
+            _compiledFilter.reset(CompiledMatchExpression::compile(_filter));
+        }
+    }
 
     FetchStage::~FetchStage() { }
 
@@ -209,7 +215,7 @@ namespace mongo {
         // predicate.
         ++_specificStats.docsExamined;
 
-        if (Filter::passes(member, _filter)) {
+        if (Filter::passes(member, _filter, _compiledFilter.get())) {
             if (NULL != _filter) {
                 ++_specificStats.matchTested;
             }
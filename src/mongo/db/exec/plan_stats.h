@@ -253,6 +253,7 @@ namespace mongo {
             CountScanStats* specific = new CountScanStats(*this);
             // BSON objects have to be explicitly copied.
             specific->keyPattern = keyPattern.getOwned();
+            specific->indexBounds = indexBounds.getOwned();
             return specific;
         }
 
@@ -260,6 +261,9 @@ namespace mongo {
 
         BSONObj keyPattern;
 
+        // Empty unless the scan is over index bounds rather than between two keys.
+        BSONObj indexBounds;
+
         int indexVersion;
 
         bool isMultiKey;
@@ -283,11 +287,12 @@ namespace mongo {
     };
 
     struct DistinctScanStats : public SpecificStats {
-        DistinctScanStats() : keysExamined(0), indexVersion(0) { }
+        DistinctScanStats() : keysExamined(0), indexVersion(0), direction(1) { }
 
         virtual SpecificStats* clone() const {
             DistinctScanStats* specific = new DistinctScanStats(*this);
             specific->keyPattern = keyPattern.getOwned();
+            specific->indexBounds = indexBounds.getOwned();
             return specific;
         }
 
@@ -299,6 +304,10 @@ namespace mongo {
         BSONObj keyPattern;
 
         int indexVersion;
+
+        int direction;
+
+        BSONObj indexBounds;
     };
 
     struct FetchStats : public SpecificStats {
@@ -479,7 +488,7 @@ namespace mongo {
     };
 
     struct SortStats : public SpecificStats {
-        SortStats() : forcedFetches(0), memUsage(0), memLimit(0) { }
+        SortStats() : forcedFetches(0), memUsage(0), memLimit(0), usedDisk(false) { }
 
         virtual ~SortStats() { }
 
@@ -497,6 +506,9 @@ namespace mongo {
         // What's our memory limit?
         size_t memLimit;
 
+        // Did we exceed memLimit and fall back to an external sort?
+        bool usedDisk;
+
         // The number of results to return from the sort.
         size_t limit;
 
@@ -41,6 +41,7 @@
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner.h"
+#include "mongo/db/storage_options.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
@@ -52,6 +53,40 @@ namespace mongo {
     // static
     const char* SortStage::kStageType = "SORT";
 
+namespace {
+
+    bool hasComputedData(const WorkingSetMember& member) {
+        for (int i = 0; i < WSM_COMPUTED_NUM_TYPES; ++i) {
+            if (member.hasComputed(static_cast<WorkingSetComputedDataType>(i))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Builds a document out of the index key data of 'member' so that a covered member can be
+     * handed to the external sorter.  Only the undotted key fields are kept: they are the only
+     * ones a covered projection above the sort can ask for.
+     */
+    BSONObj objFromIndexKeys(const WorkingSetMember& member) {
+        BSONObjBuilder bob;
+        for (size_t i = 0; i < member.keyData.size(); ++i) {
+            BSONObjIterator patternIt(member.keyData[i].indexKeyPattern);
+            BSONObjIterator keyIt(member.keyData[i].keyData);
+            while (patternIt.more() && keyIt.more()) {
+                const char* fieldName = patternIt.next().fieldName();
+                BSONElement keyElt = keyIt.next();
+                if (!mongoutils::str::contains(fieldName, '.') && !bob.hasField(fieldName)) {
+                    bob.appendAs(keyElt, fieldName);
+                }
+            }
+        }
+        return bob.obj();
+    }
+
+}  // namespace
+
     SortStageKeyGenerator::SortStageKeyGenerator(const Collection* collection,
                                                  const BSONObj& sortSpec,
                                                  const BSONObj& queryObj) {
@@ -128,7 +163,9 @@ namespace mongo {
                                              BSONObj* objOut) const {
         BSONObj btreeKeyToUse;
 
-        Status btreeStatus = getBtreeKey(member.obj.value(), &btreeKeyToUse);
+        Status btreeStatus = member.hasObj()
+                             ? getBtreeKey(member.obj.value(), &btreeKeyToUse)
+                             : getBtreeKeyFromIndexKeys(member, &btreeKeyToUse);
         if (!btreeStatus.isOK()) {
             return btreeStatus;
         }
@@ -166,6 +203,24 @@ namespace mongo {
         return Status::OK();
     }
 
+    Status SortStageKeyGenerator::getBtreeKeyFromIndexKeys(const WorkingSetMember& member,
+                                                           BSONObj* objOut) const {
+        BSONObjBuilder bob;
+        BSONObjIterator it(_btreeObj);
+        while (it.more()) {
+            const char* fieldName = it.next().fieldName();
+            BSONElement keyElt;
+            if (!member.getFieldDotted(fieldName, &keyElt)) {
+                mongoutils::str::stream ss;
+                ss << "sort field " << fieldName << " is not available from the index keys";
+                return Status(ErrorCodes::InternalError, ss);
+            }
+            bob.appendAs(keyElt, "");
+        }
+        *objOut = bob.obj();
+        return Status::OK();
+    }
+
     Status SortStageKeyGenerator::getBtreeKey(const BSONObj& memberObj, BSONObj* objOut) const {
         // Not sorting by anything in the key, just bail out early.
         if (_btreeObj.isEmpty()) {
@@ -285,6 +340,13 @@ namespace mongo {
         return lhs.loc < rhs.loc;
     }
 
+    int SortStage::SpillComparator::operator()(const SpillSorter::Data& lhs,
+                                               const SpillSorter::Data& rhs) const {
+        // The RecordId appended to each key is past the end of '_pattern' and therefore always
+        // compared ascending, just like WorkingSetComparator breaks ties.
+        return lhs.first.woCompare(rhs.first, _pattern, false);
+    }
+
     SortStage::SortStage(const SortStageParams& params,
                          WorkingSet* ws,
                          PlanStage* child)
@@ -294,6 +356,7 @@ namespace mongo {
           _pattern(params.pattern),
           _query(params.query),
           _limit(params.limit),
+          _allowDiskUse(params.allowDiskUse),
           _sorted(false),
           _resultIterator(_data.end()),
           _commonStats(kStageType),
@@ -305,7 +368,13 @@ namespace mongo {
     bool SortStage::isEOF() {
         // We're done when our child has no more results, we've sorted the child's results, and
         // we've returned all sorted results.
-        return _child->isEOF() && _sorted && (_data.end() == _resultIterator);
+        if (!_child->isEOF() || !_sorted) {
+            return false;
+        }
+        if (_sortedRuns) {
+            return !_sortedRuns->more();
+        }
+        return _data.end() == _resultIterator;
     }
 
     PlanStage::StageState SortStage::work(WorkingSetID* out) {
@@ -329,12 +398,11 @@ namespace mongo {
 
         const size_t maxBytes = static_cast<size_t>(internalQueryExecMaxBlockingSortBytes);
         if (_memUsage > maxBytes) {
-            mongoutils::str::stream ss;
-            ss << "sort stage buffered data usage of " << _memUsage
-               << " bytes exceeds internal limit of " << maxBytes << " bytes";
-            Status status(ErrorCodes::Overflow, ss);
-            *out = WorkingSetCommon::allocateStatusMember( _ws, status);
-            return PlanStage::FAILURE;
+            Status status = spillToDisk();
+            if (!status.isOK()) {
+                *out = WorkingSetCommon::allocateStatusMember( _ws, status);
+                return PlanStage::FAILURE;
+            }
         }
 
         if (isEOF()) { return PlanStage::IS_EOF; }
@@ -350,11 +418,13 @@ namespace mongo {
                 // the WorkingSet as quickly as possible to handle it.
                 WorkingSetMember* member = _ws->get(id);
 
-                // Planner must put a fetch before we get here.
-                verify(member->hasObj());
+                // Planner must put a fetch before we get here, unless the sort and the projection
+                // above it are both covered by the index keys.
+                verify(member->hasObj() || !member->keyData.empty());
 
-                // We might be sorting something that was invalidated at some point.
-                if (member->hasLoc()) {
+                // We might be sorting something that was invalidated at some point. Once we have
+                // spilled the document is copied out right away, so no need to track it.
+                if (member->hasLoc() && !_sorter) {
                     _wsidByDiskLoc[member->loc] = id;
                 }
 
@@ -371,7 +441,12 @@ namespace mongo {
                     item.loc = member->loc;
                 }
 
-                addToBuffer(item);
+                if (_sorter) {
+                    addToSorter(item);
+                }
+                else {
+                    addToBuffer(item);
+                }
 
                 ++_commonStats.needTime;
                 return PlanStage::NEED_TIME;
@@ -379,8 +454,14 @@ namespace mongo {
             else if (PlanStage::IS_EOF == code) {
                 // TODO: We don't need the lock for this.  We could ask for a yield and do this work
                 // unlocked.  Also, this is performing a lot of work for one call to work(...)
-                sortBuffer();
-                _resultIterator = _data.begin();
+                if (_sorter) {
+                    _sortedRuns.reset(_sorter->done());
+                    _sorter.reset();
+                }
+                else {
+                    sortBuffer();
+                    _resultIterator = _data.begin();
+                }
                 _sorted = true;
                 ++_commonStats.needTime;
                 return PlanStage::NEED_TIME;
@@ -410,8 +491,23 @@ namespace mongo {
         }
 
         // Returning results.
-        verify(_resultIterator != _data.end());
         verify(_sorted);
+
+        if (_sortedRuns) {
+            // Spilled documents are owned copies, hence can't be invalidated and have no loc.
+            verify(_sortedRuns->more());
+            SpillSorter::Data next = _sortedRuns->next();
+
+            *out = _ws->allocate();
+            WorkingSetMember* member = _ws->get(*out);
+            member->obj = Snapshotted<BSONObj>(SnapshotId(), next.second.getOwned());
+            member->state = WorkingSetMember::OWNED_OBJ;
+
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+
+        verify(_resultIterator != _data.end());
         *out = _resultIterator->wsid;
         _resultIterator++;
 
@@ -574,6 +670,73 @@ namespace mongo {
         }
     }
 
+    Status SortStage::spillToDisk() {
+        const size_t maxBytes = static_cast<size_t>(internalQueryExecMaxBlockingSortBytes);
+        if (!_allowDiskUse) {
+            mongoutils::str::stream ss;
+            ss << "sort stage buffered data usage of " << _memUsage
+               << " bytes exceeds internal limit of " << maxBytes << " bytes";
+            return Status(ErrorCodes::Overflow, ss);
+        }
+
+        vector<SortableDataItem> buffered;
+        if (_dataSet) {
+            buffered.assign(_dataSet->begin(), _dataSet->end());
+        }
+        else {
+            buffered = _data;
+        }
+
+        for (size_t i = 0; i < buffered.size(); ++i) {
+            if (hasComputedData(*_ws->get(buffered[i].wsid))) {
+                mongoutils::str::stream ss;
+                ss << "sort stage buffered data usage of " << _memUsage
+                   << " bytes exceeds internal limit of " << maxBytes << " bytes"
+                   << " and the sorted documents carry metadata which cannot be written to disk";
+                return Status(ErrorCodes::Overflow, ss);
+            }
+        }
+
+        LOG(1) << "sort stage buffered data usage of " << _memUsage << " bytes exceeds "
+               << maxBytes << " bytes, switching to external sort" << endl;
+
+        SortOptions opts;
+        opts.limit = _limit;
+        opts.maxMemoryUsageBytes = maxBytes;
+        opts.extSortAllowed = true;
+        opts.tempDir = storageGlobalParams.dbpath + "/_tmp";
+        _sorter.reset(SpillSorter::make(opts,
+                                        SpillComparator(_sortKeyGen->getSortComparator())));
+
+        for (size_t i = 0; i < buffered.size(); ++i) {
+            addToSorter(buffered[i]);
+        }
+
+        _data.clear();
+        if (_dataSet) {
+            _dataSet->clear();
+        }
+        _memUsage = 0;
+        _specificStats.usedDisk = true;
+        return Status::OK();
+    }
+
+    void SortStage::addToSorter(const SortableDataItem& item) {
+        WorkingSetMember* member = _ws->get(item.wsid);
+
+        BSONObjBuilder keyBob(item.sortKey.objsize() + 16);
+        keyBob.appendElements(item.sortKey);
+        keyBob.append("", static_cast<long long>(item.loc.repr()));
+
+        _sorter->add(keyBob.obj(), member->hasObj() ? member->obj.value().getOwned()
+                                                    : objFromIndexKeys(*member));
+
+        if (member->hasLoc()) {
+            _wsidByDiskLoc.erase(member->loc);
+        }
+        _ws->free(item.wsid);
+    }
+
     void SortStage::sortBuffer() {
         if (_limit == 0) {
             const WorkingSetComparator& cmp = *_sortKeyComparator;
@@ -594,3 +757,6 @@ namespace mongo {
     }
 
 }  // namespace mongo
+
+#include "mongo/db/sorter/sorter.cpp"
+// Explicit instantiation unneeded since we aren't exposing Sorter outside of this file.
@@ -37,6 +37,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/query/index_bounds.h"
 #include "mongo/db/record_id.h"
+#include "mongo/db/sorter/sorter.h"
 #include "mongo/platform/unordered_map.h"
 
 
@@ -47,7 +48,7 @@ namespace mongo {
     // Parameters that must be provided to a SortStage
     class SortStageParams {
     public:
-        SortStageParams() : collection(NULL), limit(0) { }
+        SortStageParams() : collection(NULL), limit(0), allowDiskUse(false) { }
 
         // Used for resolving RecordIds to BSON
         const Collection* collection;
@@ -60,6 +61,10 @@ namespace mongo {
 
         // Equal to 0 for no limit.
         size_t limit;
+
+        // If true, buffered data is spilled to temporary files instead of failing the query
+        // once it exceeds internalQueryExecMaxBlockingSortBytes.
+        bool allowDiskUse;
     };
 
     /**
@@ -79,7 +84,8 @@ namespace mongo {
                               const BSONObj& queryObj);
 
         /**
-         * Returns the key used to sort 'member'.
+         * Returns the key used to sort 'member'.  If 'member' has no object the key is built
+         * from its index key data, which the planner only allows when the sort is covered.
          */
         Status getSortKey(const WorkingSetMember& member,
                           BSONObj* objOut) const;
@@ -94,6 +100,12 @@ namespace mongo {
     private:
         Status getBtreeKey(const BSONObj& memberObj, BSONObj* objOut) const;
 
+        /**
+         * Like getBtreeKey, but reads the values of the sort fields out of the index keys
+         * attached to 'member'.
+         */
+        Status getBtreeKeyFromIndexKeys(const WorkingSetMember& member, BSONObj* objOut) const;
+
         /**
          * In order to emulate the existing sort behavior we must make unindexed sort behavior as
          * consistent as possible with indexed sort behavior.  As such, we must only consider index
@@ -191,6 +203,9 @@ namespace mongo {
         // Equal to 0 for no limit.
         size_t _limit;
 
+        // Can we fall back to an external sort when our buffered data gets too big?
+        bool _allowDiskUse;
+
         //
         // Sort key generation
         //
@@ -244,6 +259,46 @@ namespace mongo {
         // Initialization follows sort key generator
         boost::scoped_ptr<WorkingSetComparator> _sortKeyComparator;
 
+        //
+        // External sort
+        //
+
+        // Spilled data is keyed by the sort key with the RecordId appended as a tie-breaker and
+        // carries an owned copy of the document as its value.
+        typedef Sorter<BSONObj, BSONObj> SpillSorter;
+
+        // Orders spilled data the same way WorkingSetComparator orders buffered data.
+        class SpillComparator {
+        public:
+            explicit SpillComparator(const BSONObj& pattern) : _pattern(pattern) { }
+
+            int operator()(const SpillSorter::Data& lhs, const SpillSorter::Data& rhs) const;
+
+        private:
+            BSONObj _pattern;
+        };
+
+        /**
+         * Moves everything buffered so far into an external Sorter, which spills sorted runs to
+         * temporary files as needed. Once this succeeds all further input goes to the Sorter
+         * and results are produced from its output.
+         *
+         * Fails if disk use is not allowed or if buffered members carry computed data (such as a
+         * text score) that would be lost when writing the documents out.
+         */
+        Status spillToDisk();
+
+        /**
+         * Adds 'item' to the external Sorter and frees its working set member.
+         */
+        void addToSorter(const SortableDataItem& item);
+
+        // Non-NULL once we have spilled and are still reading input.
+        boost::scoped_ptr<SpillSorter> _sorter;
+
+        // Non-NULL once we have spilled and finished reading input. Produces owned documents.
+        boost::scoped_ptr<SpillSorter::Iterator> _sortedRuns;
+
         // The data we buffer and sort.
         // _data will contain sorted data when all data is gathered
         // and sorted.
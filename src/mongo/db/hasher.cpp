@@ -37,23 +37,43 @@
 #include <boost/scoped_ptr.hpp>
 
 #include "mongo/db/jsobj.h"
+#include "mongo/util/assert_util.h"
 #include "mongo/util/startup_test.h"
+#include "third_party/murmurhash3/MurmurHash3.h"
 
 namespace mongo {
 
     using boost::scoped_ptr;
 
-    Hasher::Hasher( HashSeed seed ) : _seed( seed ) {
-        md5_init( &_md5State );
-        md5_append( &_md5State , reinterpret_cast< const md5_byte_t * >( & _seed ) , sizeof( _seed ) );
+    Hasher::Hasher( HashSeed seed , int hashVersion ) : _seed( seed ), _hashVersion( hashVersion ) {
+        verify( BSONElementHasher::isValidHashVersion( _hashVersion ) );
+        if ( _hashVersion == kHashVersionMD5 ) {
+            md5_init( &_md5State );
+            md5_append( &_md5State ,
+                        reinterpret_cast< const md5_byte_t * >( & _seed ) ,
+                        sizeof( _seed ) );
+        }
     }
 
     void Hasher::addData( const void * keyData , size_t numBytes ) {
-        md5_append( &_md5State , static_cast< const md5_byte_t * >( keyData ), numBytes );
+        if ( _hashVersion == kHashVersionMD5 ) {
+            md5_append( &_md5State , static_cast< const md5_byte_t * >( keyData ), numBytes );
+        }
+        else {
+            _murmurInput.appendBuf( keyData , numBytes );
+        }
     }
 
     void Hasher::finish( HashDigest out ) {
-        md5_finish( &_md5State , out );
+        if ( _hashVersion == kHashVersionMD5 ) {
+            md5_finish( &_md5State , out );
+        }
+        else {
+            MurmurHash3_x64_128( _murmurInput.buf() ,
+                                 _murmurInput.len() ,
+                                 static_cast< uint32_t >( _seed ) ,
+                                 out );
+        }
     }
 
     long long int BSONElementHasher::hash64( const BSONElement& e , HashSeed seed ){
@@ -66,6 +86,21 @@ namespace mongo {
         return *reinterpret_cast< long long int * >( d );
     }
 
+    long long int BSONElementHasher::hash64( const BSONElement& e ,
+                                             HashSeed seed ,
+                                             int hashVersion ) {
+        if ( hashVersion == kHashVersionMD5 ) {
+            return hash64( e , seed );
+        }
+
+        Hasher h( seed , hashVersion );
+        recursiveHash( &h , e , false );
+        HashDigest d;
+        h.finish(d);
+        // NOTE: assumes little-endian, as above
+        return *reinterpret_cast< long long int * >( d );
+    }
+
     void BSONElementHasher::recursiveHash( Hasher* h ,
                                            const BSONElement& e ,
                                            bool includeFieldName ) {
@@ -114,6 +149,8 @@ namespace mongo {
             // Hard-coded check to ensure the hash function is consistent across platforms
             BSONObj o = BSON( "check" << 42 );
             verify( BSONElementHasher::hash64( o.firstElement(), 0 ) == -944302157085130861LL );
+            verify( BSONElementHasher::hash64( o.firstElement(), 0, 0 ) == -944302157085130861LL );
+            verify( BSONElementHasher::hash64( o.firstElement(), 0, 1 ) == 8715208212397937794LL );
         }
     } hasherUnitTest;
 }
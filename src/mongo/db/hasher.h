@@ -39,6 +39,7 @@
 #include <boost/noncopyable.hpp>
 
 #include "mongo/bson/bsonelement.h"
+#include "mongo/bson/util/builder.h"
 #include "mongo/util/md5.hpp"
 
 namespace mongo {
@@ -46,10 +47,25 @@ namespace mongo {
     typedef int HashSeed;
     typedef unsigned char HashDigest[16];
 
+    /* Versions of the hash function used by hashed indexes (the "hashVersion" field of the
+     * index spec).
+     *
+     * Version 0 is the first 8 bytes of the MD5 digest of the seed followed by the data.
+     * Version 1 is the first 8 bytes of MurmurHash3_x64_128 of the data, using the seed as
+     * the MurmurHash3 seed. It is much cheaper to compute and mixes as well for our purposes.
+     *
+     * WARNING: the output of an existing version must never change; indexes and hashed shard
+     * keys store these values.
+     */
+    enum HashVersion {
+        kHashVersionMD5 = 0,
+        kHashVersionMurmur3 = 1
+    };
+
     class Hasher : private boost::noncopyable {
     public:
 
-        explicit Hasher( HashSeed seed );
+        explicit Hasher( HashSeed seed , int hashVersion = kHashVersionMD5 );
         ~Hasher() { };
 
         //pointer to next part of input key, length in bytes to read
@@ -61,7 +77,12 @@ namespace mongo {
 
     private:
         md5_state_t _md5State;
+
+        // MurmurHash3 is not incremental, so version 1 collects the input and hashes it in finish
+        StackBufBuilder _murmurInput;
+
         HashSeed _seed;
+        int _hashVersion;
     };
 
     class HasherFactory : private boost::noncopyable  {
@@ -89,6 +110,16 @@ namespace mongo {
          */
         static const int DEFAULT_HASH_SEED = 0;
 
+        /* Hashed shard keys, and hashed indexes without a "hashVersion", use this version.
+         */
+        static const int DEFAULT_HASH_VERSION = kHashVersionMD5;
+
+        /* Returns true if "hashVersion" names a hash function this version of the server knows.
+         */
+        static bool isValidHashVersion( int hashVersion ) {
+            return hashVersion == kHashVersionMD5 || hashVersion == kHashVersionMurmur3;
+        }
+
         /* This computes a 64-bit hash of the value part of BSONElement "e",
          * preceded by the seed "seed".  Squashes element (and any sub-elements)
          * of the same canonical type, so hash({a:{b:4}}) will be the same
@@ -103,6 +134,12 @@ namespace mongo {
          */
         static long long int hash64( const BSONElement& e , HashSeed seed );
 
+        /* As above, but using the hash function "hashVersion", which must be valid.
+         * Both versions hash the same canonical form of the element, so they squash the same
+         * values together.
+         */
+        static long long int hash64( const BSONElement& e , HashSeed seed , int hashVersion );
+
         /* This incrementally computes the hash of BSONElement "e"
          * using hash function "h".  If "includeFieldName" is true,
          * then the name of the field is hashed in between the type of
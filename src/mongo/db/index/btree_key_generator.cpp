@@ -218,7 +218,8 @@ namespace {
                                              std::vector<BSONElement> fixed,
                                              bool isSparse)
         : BtreeKeyGenerator(fieldNames, fixed, isSparse),
-          _emptyPositionalInfo(fieldNames.size()) {
+          _emptyPositionalInfo(fieldNames.size()),
+          _extractor(fieldNames) {
     }
 
     BSONElement BtreeKeyGeneratorV1::extractNextElement(const BSONObj &obj,
@@ -283,7 +284,17 @@ namespace {
                                           std::vector<BSONElement> fixed,
                                           const BSONObj& obj,
                                           BSONObjSet* keys) const {
-        getKeysImplWithArray(fieldNames, fixed, obj, keys, 0, _emptyPositionalInfo);
+        // At the top level there is no positional info, so extractNextElement() comes down to
+        // getFieldDottedOrArray() for every field, which the extractor does in a single pass.
+        if (fieldNames.empty()) {
+            getKeysImplWithArray(fieldNames, fixed, obj, keys, 0, _emptyPositionalInfo);
+            return;
+        }
+        std::vector<BSONElement> extracted(fieldNames.size());
+        std::vector<const char*> remaining(fieldNames.size());
+        _extractor.extract(obj, &extracted[0], &remaining[0]);
+        getKeysImplWithArray(fieldNames, fixed, obj, keys, 0, _emptyPositionalInfo,
+                             &extracted, &remaining);
     }
 
     void BtreeKeyGeneratorV1::getKeysImplWithArray(
@@ -292,7 +303,9 @@ namespace {
             const BSONObj& obj,
             BSONObjSet* keys,
             unsigned numNotFound,
-            const std::vector<PositionalPathInfo>& positionalInfo) const {
+            const std::vector<PositionalPathInfo>& positionalInfo,
+            const std::vector<BSONElement>* extracted,
+            const std::vector<const char*>* remaining) const {
         BSONElement arrElt;
         std::set<unsigned> arrIdxs;
         bool mayExpandArrayUnembedded = true;
@@ -301,12 +314,16 @@ namespace {
                 continue;
             }
 
-            bool arrayNestedArray;
+            bool arrayNestedArray = false;
             // Extract element matching fieldName[ i ] from object xor array.
-            BSONElement e = extractNextElement(obj,
-                                               positionalInfo[i],
-                                               &fieldNames[i],
-                                               &arrayNestedArray);
+            BSONElement e;
+            if ( extracted ) {
+                e = (*extracted)[i];
+                fieldNames[i] = (*remaining)[i];
+            }
+            else {
+                e = extractNextElement(obj, positionalInfo[i], &fieldNames[i], &arrayNestedArray);
+            }
 
             if ( e.eoo() ) {
                 // if field not present, set to null
@@ -30,6 +30,7 @@
 
 #include <vector>
 #include <set>
+#include "mongo/bson/bson_field_extractor.h"
 #include "mongo/db/jsobj.h"
 
 namespace mongo {
@@ -160,13 +161,19 @@ namespace mongo {
 
         /**
          * This recursive method does the heavy-lifting for getKeysImpl().
+         *
+         * If 'extracted' is not NULL, it holds the element extractNextElement() would return for
+         * each field, and 'remaining' the path it would leave in 'fieldNames'. The top level call
+         * finds them for all fields at once with '_extractor'.
          */
         void getKeysImplWithArray(std::vector<const char*> fieldNames,
                                   std::vector<BSONElement> fixed,
                                   const BSONObj& obj,
                                   BSONObjSet* keys,
                                   unsigned numNotFound,
-                                  const std::vector<PositionalPathInfo>& positionalInfo) const;
+                                  const std::vector<PositionalPathInfo>& positionalInfo,
+                                  const std::vector<BSONElement>* extracted = NULL,
+                                  const std::vector<const char*>* remaining = NULL) const;
         /**
          * A call to getKeysImplWithArray() begins by calling this for each field in the key
          * pattern. It uses getFieldDottedOrArray() to traverse the path '*field' in 'obj'.
@@ -220,6 +227,9 @@ namespace mongo {
                                  const std::vector<PositionalPathInfo>& positionalInfo) const;
 
         const std::vector<PositionalPathInfo> _emptyPositionalInfo;
+
+        // Looks up all of '_fieldNames' in a document in one pass.
+        const BSONFieldExtractor _extractor;
     };
 
 }  // namespace mongo
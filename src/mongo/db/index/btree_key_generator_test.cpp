@@ -805,6 +805,49 @@ namespace {
         ASSERT(testKeygen(keyPattern, genKeysFrom, expectedKeys));
     }
 
+    // The top level fields of a compound pattern are all looked up in one pass over the document,
+    // whether they are plain, dotted, reached through an array or missing.
+    TEST(BtreeKeyGeneratorTest, GetKeysCompoundPlainDottedArrayMissing) {
+        BSONObj keyPattern = fromjson("{a: 1, 'b.c': 1, 'd.e': 1, f: 1}");
+        BSONObj genKeysFrom = fromjson("{f: 'x', d: [{e: 1}, {e: 2}], b: {c: 3}, a: 4}");
+        BSONObjSet expectedKeys;
+        expectedKeys.insert(fromjson("{'': 4, '': 3, '': 1, '': 'x'}"));
+        expectedKeys.insert(fromjson("{'': 4, '': 3, '': 2, '': 'x'}"));
+        ASSERT(testKeygen(keyPattern, genKeysFrom, expectedKeys));
+
+        genKeysFrom = fromjson("{b: {c: 3}, d: 5}");
+        expectedKeys.clear();
+        expectedKeys.insert(fromjson("{'': null, '': 3, '': null, '': null}"));
+        ASSERT(testKeygen(keyPattern, genKeysFrom, expectedKeys));
+    }
+
+    TEST(BtreeKeyGeneratorTest, GetKeysSameGeneratorManyDocuments) {
+        vector<const char*> fieldNames;
+        fieldNames.push_back("a");
+        fieldNames.push_back("b.c");
+        BtreeKeyGeneratorV1 keyGen(fieldNames, vector<BSONElement>(2), false);
+
+        BSONObjSet keys;
+        keyGen.getKeys(fromjson("{a: 1, b: {c: 2}}"), &keys);
+        BSONObjSet expectedKeys;
+        expectedKeys.insert(fromjson("{'': 1, '': 2}"));
+        ASSERT(keysetsMatch(expectedKeys, keys));
+
+        keys.clear();
+        keyGen.getKeys(fromjson("{a: [1, 2], b: {c: 3}}"), &keys);
+        expectedKeys.clear();
+        expectedKeys.insert(fromjson("{'': 1, '': 3}"));
+        expectedKeys.insert(fromjson("{'': 2, '': 3}"));
+        ASSERT(keysetsMatch(expectedKeys, keys));
+
+        keys.clear();
+        keyGen.getKeys(fromjson("{b: [{c: 4}, {c: 5}]}"), &keys);
+        expectedKeys.clear();
+        expectedKeys.insert(fromjson("{'': null, '': 4}"));
+        expectedKeys.insert(fromjson("{'': null, '': 5}"));
+        ASSERT(keysetsMatch(expectedKeys, keys));
+    }
+
     // Descriptive test.
     TEST(BtreeKeyGeneratorTest, PositionalKeyPatternNestedArrays6) {
         BSONObj keyPattern = fromjson("{'a': 1, 'a.b': 1, 'a.0.b':1, 'a.b.0': 1, 'a.0.b.0': 1}");
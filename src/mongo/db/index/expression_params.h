@@ -81,10 +81,10 @@ namespace mongo {
                 *seedOut = infoObj["seed"].numberInt();
             }
 
-            // In case we have hashed indexes based on other hash functions in the future, we store
-            // a hashVersion number. If hashVersion changes, "makeSingleHashKey" will need to change
-            // accordingly.  Defaults to 0 if "hashVersion" is not included in the index spec or if
-            // the value of "hashversion" is not a number
+            // The hashVersion selects the hash function, see HashVersion in hasher.h. Defaults to
+            // 0 (MD5) if "hashVersion" is not included in the index spec or if the value of
+            // "hashVersion" is not a number. Version 1 (MurmurHash3) is much cheaper to compute
+            // but can't be used for a hashed shard key.
             *versionOut = infoObj["hashVersion"].numberInt();
 
             // Get the hashfield name
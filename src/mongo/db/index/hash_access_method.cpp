@@ -30,6 +30,7 @@
 #include "mongo/db/index/expression_keys_private.h"
 #include "mongo/db/index/expression_params.h"
 #include "mongo/db/index/hash_access_method.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
@@ -49,6 +50,11 @@ namespace mongo {
                                           &_seed,
                                           &_hashVersion,
                                           &_hashedField);
+
+        uassert(28628, str::stream() << "Unknown hashVersion " << _hashVersion
+                                     << " for hashed index, the valid versions are "
+                                     << kHashVersionMD5 << " and " << kHashVersionMurmur3,
+                BSONElementHasher::isValidHashVersion(_hashVersion));
     }
 
     void HashAccessMethod::getKeys(const BSONObj& obj, BSONObjSet* keys) const {
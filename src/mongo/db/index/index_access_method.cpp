@@ -172,6 +172,74 @@ namespace mongo {
         return Status::OK();
     }
 
+    // Find the keys of every doc in objs and put them all in the tree in one batch
+    Status IndexAccessMethod::insertMany(OperationContext* txn,
+                                         const std::vector<BSONObj>& objs,
+                                         const std::vector<RecordId>& locs,
+                                         const InsertDeleteOptions& options,
+                                         int64_t* numInserted) {
+        invariant(objs.size() == locs.size());
+        *numInserted = 0;
+
+        // The keys of every document, remembering which document each came from.
+        std::vector<IndexKeyEntry> entries;
+        std::vector<size_t> docOfEntry;
+        for (size_t i = 0; i < objs.size(); ++i) {
+            BSONObjSet keys;
+            // Delegate to the subclass.
+            getKeys(objs[i], &keys);
+            for (BSONObjSet::const_iterator k = keys.begin(); k != keys.end(); ++k) {
+                entries.push_back(IndexKeyEntry(*k, locs[i]));
+                docOfEntry.push_back(i);
+            }
+        }
+
+        std::vector<int64_t> keysInserted(objs.size(), 0);
+        size_t done = 0;
+        while (true) {
+            size_t inserted = 0;
+            Status status = (done == 0)
+                ? _newInterface->insertKeys(txn, entries, options.dupsAllowed, &inserted)
+                : _newInterface->insertKeys(txn,
+                                            std::vector<IndexKeyEntry>(entries.begin() + done,
+                                                                       entries.end()),
+                                            options.dupsAllowed,
+                                            &inserted);
+            for (size_t j = done; j < done + inserted; ++j) {
+                ++keysInserted[docOfEntry[j]];
+            }
+            *numInserted += inserted;
+            done += inserted;
+
+            if (status.isOK())
+                break;
+
+            // Skip over the same errors as insert() does, and carry on with the next key.
+            if (status.code() == ErrorCodes::KeyTooLong && ignoreKeyTooLong(txn)) {
+                ++done;
+                continue;
+            }
+
+            if (status.code() == ErrorCodes::DuplicateKeyValue && !_btreeState->isReady(txn)) {
+                LOG(3) << "key " << entries[done].key
+                       << " already in index during background indexing (ok)";
+                ++done;
+                continue;
+            }
+
+            return status;
+        }
+
+        for (size_t i = 0; i < keysInserted.size(); ++i) {
+            if (keysInserted[i] > 1) {
+                _btreeState->setMultikey( txn );
+                break;
+            }
+        }
+
+        return Status::OK();
+    }
+
     // Remove the provided doc from the index.
     Status IndexAccessMethod::remove(OperationContext* txn,
                                      const BSONObj &obj,
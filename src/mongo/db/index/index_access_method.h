@@ -81,6 +81,19 @@ namespace mongo {
                       const InsertDeleteOptions& options,
                       int64_t* numInserted);
 
+        /**
+         * Like insert() for each document of 'objs', stored at the matching location of 'locs',
+         * but hands the keys of all of the documents to the index in one batch. Unlike insert(),
+         * keys inserted before an error are not removed, so the caller must roll back its
+         * WriteUnitOfWork on error. 'numInserted' is set to the number of keys added for all of
+         * the documents.
+         */
+        Status insertMany(OperationContext* txn,
+                          const std::vector<BSONObj>& objs,
+                          const std::vector<RecordId>& locs,
+                          const InsertDeleteOptions& options,
+                          int64_t* numInserted);
+
         /**
          * Analogous to above, but remove the records instead of inserting them.  If not NULL,
          * numDeleted will be set to the number of keys removed from the index for the document.
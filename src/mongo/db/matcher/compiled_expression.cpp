@@ -0,0 +1,279 @@
+// compiled_expression.cpp
+
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/matcher/compiled_expression.h"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/matcher/expression_leaf.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    using std::auto_ptr;
+
+    // static
+    CompiledMatchExpression* CompiledMatchExpression::compile(const MatchExpression* root) {
+        auto_ptr<CompiledMatchExpression> compiled(new CompiledMatchExpression());
+        compiled->_compile(root);
+        if (0 == compiled->_numLeaves) {
+            return NULL;
+        }
+        return compiled.release();
+    }
+
+    void CompiledMatchExpression::_compile(const MatchExpression* expr) {
+        switch (expr->matchType()) {
+        case MatchExpression::AND:
+            _compileList(expr, kJumpIfFalse, true);
+            return;
+        case MatchExpression::OR:
+            _compileList(expr, kJumpIfTrue, false);
+            return;
+        case MatchExpression::NOR:
+            _compileList(expr, kJumpIfTrue, false);
+            _program.push_back(Instruction(kNot));
+            return;
+        case MatchExpression::NOT:
+            _compile(expr->getChild(0));
+            _program.push_back(Instruction(kNot));
+            return;
+        default:
+            if (_canCompileLeaf(expr)) {
+                _compileLeaf(expr);
+            }
+            else {
+                _compileFallback(expr);
+            }
+            return;
+        }
+    }
+
+    void CompiledMatchExpression::_compileList(const MatchExpression* expr,
+                                               OpCode jump,
+                                               bool emptyResult) {
+        const size_t numChildren = expr->numChildren();
+        if (0 == numChildren) {
+            Instruction ins(kConstant);
+            ins.constant = emptyResult;
+            _program.push_back(ins);
+            return;
+        }
+
+        // Each child but the last jumps past the rest of the list once it decides the result.
+        std::vector<size_t> jumps;
+        for (size_t i = 0; i < numChildren; ++i) {
+            _compile(expr->getChild(i));
+            if (i + 1 < numChildren) {
+                jumps.push_back(_program.size());
+                _program.push_back(Instruction(jump));
+            }
+        }
+
+        for (size_t i = 0; i < jumps.size(); ++i) {
+            _program[jumps[i]].target = _program.size();
+        }
+    }
+
+    // static
+    bool CompiledMatchExpression::_canCompileLeaf(const MatchExpression* expr) {
+        switch (expr->matchType()) {
+        case MatchExpression::LTE:
+        case MatchExpression::LT:
+        case MatchExpression::EQ:
+        case MatchExpression::GT:
+        case MatchExpression::GTE:
+        case MatchExpression::REGEX:
+        case MatchExpression::MOD:
+        case MatchExpression::EXISTS:
+        case MatchExpression::MATCH_IN:
+        case MatchExpression::TYPE_OPERATOR:
+            break;
+        default:
+            return false;
+        }
+
+        // Dotted paths need the array traversal rules of BSONElementIterator.
+        const StringData path = expr->path();
+        return !path.empty() && path.find('.') == std::string::npos;
+    }
+
+    void CompiledMatchExpression::_compileLeaf(const MatchExpression* expr) {
+        const std::string path = expr->path().toString();
+
+        size_t slot = 0;
+        while (slot < _fields.size() && _fields[slot] != path) {
+            ++slot;
+        }
+        if (slot == _fields.size()) {
+            if (_fields.size() == kMaxFields) {
+                _compileFallback(expr);
+                return;
+            }
+            _fields.push_back(path);
+        }
+
+        Instruction ins(kLeaf);
+        ins.expr = expr;
+        ins.slot = slot;
+
+        switch (expr->matchType()) {
+        case MatchExpression::LTE:
+        case MatchExpression::LT:
+        case MatchExpression::EQ:
+        case MatchExpression::GT:
+        case MatchExpression::GTE: {
+            const BSONElement& rhs = static_cast<const ComparisonMatchExpression*>(expr)->getData();
+            ins.rhs = &rhs;
+            ins.rhsCanonicalType = rhs.canonicalType();
+            // MinKey, MaxKey and NaN have special rules; leave those to the expression.
+            ins.fastCompare = rhs.type() != MinKey &&
+                              rhs.type() != MaxKey &&
+                              !(rhs.isNumber() && std::isnan(rhs.numberDouble()));
+            break;
+        }
+        case MatchExpression::TYPE_OPERATOR:
+            ins.skipOuterArray =
+                static_cast<const TypeMatchExpression*>(expr)->getData() == Array;
+            break;
+        default:
+            break;
+        }
+
+        _program.push_back(ins);
+        ++_numLeaves;
+    }
+
+    void CompiledMatchExpression::_compileFallback(const MatchExpression* expr) {
+        Instruction ins(kFallback);
+        ins.expr = expr;
+        _program.push_back(ins);
+        ++_numFallbacks;
+    }
+
+    bool CompiledMatchExpression::matchesBSON(const BSONObj& doc) const {
+        // Collect the first occurrence of every referenced field in one pass. Fields which are not
+        // in the document are left EOO, which is what the path traversal gives the leaves too.
+        BSONElement elements[kMaxFields];
+        size_t remaining = _fields.size();
+        BSONObjIterator it(doc);
+        while (remaining > 0 && it.more()) {
+            const BSONElement e = it.next();
+            const char* const fieldName = e.fieldName();
+            for (size_t i = 0; i < _fields.size(); ++i) {
+                if (elements[i].eoo() && 0 == strcmp(_fields[i].c_str(), fieldName)) {
+                    elements[i] = e;
+                    --remaining;
+                    break;
+                }
+            }
+        }
+
+        bool result = true;
+        const size_t size = _program.size();
+        for (size_t pc = 0; pc < size;) {
+            const Instruction& ins = _program[pc++];
+            switch (ins.op) {
+            case kLeaf:
+                result = _matchesLeaf(ins, elements[ins.slot]);
+                break;
+            case kFallback:
+                result = ins.expr->matchesBSON(doc);
+                break;
+            case kNot:
+                result = !result;
+                break;
+            case kJumpIfFalse:
+                if (!result) {
+                    pc = ins.target;
+                }
+                break;
+            case kJumpIfTrue:
+                if (result) {
+                    pc = ins.target;
+                }
+                break;
+            case kConstant:
+                result = ins.constant;
+                break;
+            }
+        }
+        return result;
+    }
+
+    // static
+    bool CompiledMatchExpression::_matchesLeaf(const Instruction& ins, const BSONElement& e) {
+        if (e.type() != Array) {
+            return _matchesElement(ins, e);
+        }
+
+        // Like BSONElementIterator for a leaf array: each member, then the array itself.
+        BSONObjIterator it(e.embeddedObject());
+        while (it.more()) {
+            if (_matchesElement(ins, it.next())) {
+                return true;
+            }
+        }
+        return !ins.skipOuterArray && _matchesElement(ins, e);
+    }
+
+    // static
+    bool CompiledMatchExpression::_matchesElement(const Instruction& ins, const BSONElement& e) {
+        if (ins.fastCompare &&
+            e.canonicalType() == ins.rhsCanonicalType &&
+            !(e.isNumber() && std::isnan(e.numberDouble()))) {
+
+            const int x = compareElementValues(e, *ins.rhs);
+            switch (ins.expr->matchType()) {
+            case MatchExpression::LT:
+                return x < 0;
+            case MatchExpression::LTE:
+                return x <= 0;
+            case MatchExpression::EQ:
+                return x == 0;
+            case MatchExpression::GT:
+                return x > 0;
+            case MatchExpression::GTE:
+                return x >= 0;
+            default:
+                invariant(false);
+            }
+        }
+
+        return ins.expr->matchesSingleElement(e);
+    }
+
+}  // namespace mongo
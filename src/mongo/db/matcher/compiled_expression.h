@@ -0,0 +1,137 @@
+// compiled_expression.h
+
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/bson/bsonelement.h"
+#include "mongo/db/matcher/expression.h"
+
+namespace mongo {
+
+    class BSONObj;
+
+    /**
+     * A MatchExpression tree flattened into a program for matching whole BSON documents.
+     *
+     * Matching through the tree resolves the path of every leaf separately, allocating an
+     * ElementIterator per leaf per document. The compiled program instead collects every
+     * top-level field referenced by a leaf in a single pass over the document, then runs the
+     * leaves against those elements, with AND/OR/NOR/NOT turned into forward jumps.
+     *
+     * Leaves on top-level fields ($eq, $lt, $lte, $gt, $gte, $in, $regex, $mod, $exists, $type)
+     * are compiled. Every other node ($where, geo, text, $elemMatch, $size, dotted paths, ...) is
+     * kept as a call into the tree evaluator for that subtree, so any tree can be compiled with
+     * the same results. Match details (the $elemMatch position) are not supported; callers that
+     * need them must use the tree.
+     *
+     * The program points into the tree it was compiled from, which must outlive it.
+     */
+    class CompiledMatchExpression {
+        MONGO_DISALLOW_COPYING(CompiledMatchExpression);
+    public:
+        /**
+         * Returns NULL if no part of 'root' can be compiled, in which case the tree is as fast.
+         * The caller owns the result.
+         */
+        static CompiledMatchExpression* compile(const MatchExpression* root);
+
+        bool matchesBSON(const BSONObj& doc) const;
+
+        /**
+         * The number of distinct top-level fields that are extracted from each document.
+         */
+        size_t numFields() const { return _fields.size(); }
+
+        /**
+         * The number of subtrees that are matched through the tree evaluator.
+         */
+        size_t numFallbacks() const { return _numFallbacks; }
+
+        // Fields beyond this many are matched through the tree evaluator.
+        static const size_t kMaxFields = 32;
+
+    private:
+        enum OpCode {
+            // Match a leaf against the element in 'slot', setting the result.
+            kLeaf,
+            // Match 'expr' against the whole document with the tree evaluator.
+            kFallback,
+            kNot,
+            kJumpIfFalse,
+            kJumpIfTrue,
+            // Set the result to 'constant'.
+            kConstant,
+        };
+
+        struct Instruction {
+            Instruction(OpCode op)
+                : op(op), expr(NULL), slot(0), target(0), constant(false),
+                  rhs(NULL), rhsCanonicalType(0), fastCompare(false), skipOuterArray(false) {}
+
+            OpCode op;
+            const MatchExpression* expr;
+            size_t slot;
+            size_t target;
+            bool constant;
+
+            // For comparisons: the constant, pre-resolved so that the common case of an element of
+            // the same canonical type goes straight to compareElementValues().
+            const BSONElement* rhs;
+            int rhsCanonicalType;
+            bool fastCompare;
+
+            // $type:4 matches arrays nested in the field, not the field itself.
+            bool skipOuterArray;
+        };
+
+        CompiledMatchExpression() : _numFallbacks(0), _numLeaves(0) {}
+
+        void _compile(const MatchExpression* expr);
+        void _compileLeaf(const MatchExpression* expr);
+        void _compileFallback(const MatchExpression* expr);
+        void _compileList(const MatchExpression* expr, OpCode jump, bool emptyResult);
+
+        static bool _canCompileLeaf(const MatchExpression* expr);
+
+        static bool _matchesLeaf(const Instruction& ins, const BSONElement& e);
+        static bool _matchesElement(const Instruction& ins, const BSONElement& e);
+
+        std::vector<Instruction> _program;
+        std::vector<std::string> _fields;
+        size_t _numFallbacks;
+        size_t _numLeaves;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,186 @@
+// compiled_expression_test.cpp
+
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/unittest/unittest.h"
+
+#include "mongo/db/matcher/compiled_expression.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    using boost::scoped_ptr;
+
+    namespace {
+
+        MatchExpression* parse(const char* query) {
+            StatusWithMatchExpression result = MatchExpressionParser::parse(fromjson(query));
+            ASSERT_OK(result.getStatus());
+            return result.getValue();
+        }
+
+        const char* docs[] = {
+            "{}",
+            "{a: 1}",
+            "{a: 5, b: 'x'}",
+            "{a: 5.5, b: 'y', c: true}",
+            "{a: NumberLong(5), b: null}",
+            "{a: null, b: undefined}",
+            "{a: NaN}",
+            "{a: [1, 5, 9]}",
+            "{a: []}",
+            "{a: [[5], 7]}",
+            "{a: {b: 5}, b: [{c: 1}, {c: 2}]}",
+            "{a: 'abc', b: 'ABC', c: 10}",
+            "{a: {$minKey: 1}, c: {$maxKey: 1}}",
+            "{c: 7, a: 3, b: 'x', a: 100}",
+            "{a: ObjectId('4ea0e1efd1dc7c2b8fb15df2'), b: [1, 'x']}",
+        };
+
+        /**
+         * Checks that the compiled form of 'query' agrees with the tree on every document.
+         */
+        void assertSameResults(const char* query) {
+            scoped_ptr<MatchExpression> expr(parse(query));
+            scoped_ptr<CompiledMatchExpression> compiled(CompiledMatchExpression::compile(expr.get()));
+            ASSERT(compiled);
+
+            for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); ++i) {
+                const BSONObj doc = fromjson(docs[i]);
+                if (expr->matchesBSON(doc) != compiled->matchesBSON(doc)) {
+                    FAIL(str::stream() << "query " << query << " disagrees on " << doc);
+                }
+            }
+        }
+
+    }  // namespace
+
+    TEST(CompiledMatchExpressionTest, Comparisons) {
+        assertSameResults("{a: 5}");
+        assertSameResults("{a: {$lt: 5}}");
+        assertSameResults("{a: {$lte: 5}}");
+        assertSameResults("{a: {$gt: 5}}");
+        assertSameResults("{a: {$gte: 5}}");
+        assertSameResults("{a: {$gt: 1, $lt: 9}}");
+        assertSameResults("{a: 'abc'}");
+        assertSameResults("{a: {$gt: 'a'}}");
+        assertSameResults("{a: null}");
+        assertSameResults("{a: {$gte: null}}");
+        assertSameResults("{a: NaN}");
+        assertSameResults("{a: {$lte: NaN}}");
+        assertSameResults("{a: {$gt: {$minKey: 1}}}");
+        assertSameResults("{a: {$lt: {$maxKey: 1}}}");
+        assertSameResults("{a: [1, 5, 9]}");
+        assertSameResults("{a: []}");
+        assertSameResults("{a: [5]}");
+        assertSameResults("{a: {b: 5}}");
+        assertSameResults("{a: 100}");
+    }
+
+    TEST(CompiledMatchExpressionTest, OtherLeaves) {
+        assertSameResults("{a: {$in: [1, 'abc', null]}}");
+        assertSameResults("{a: {$in: [/^a/, 9]}}");
+        assertSameResults("{a: {$nin: [1, 5]}}");
+        assertSameResults("{a: /b/}");
+        assertSameResults("{b: /^a/i}");
+        assertSameResults("{a: {$mod: [2, 1]}}");
+        assertSameResults("{a: {$exists: true}}");
+        assertSameResults("{a: {$exists: false}}");
+        assertSameResults("{a: {$type: 4}}");
+        assertSameResults("{a: {$type: 1}}");
+        assertSameResults("{b: {$type: 10}}");
+        assertSameResults("{a: {$ne: 5}}");
+    }
+
+    TEST(CompiledMatchExpressionTest, Trees) {
+        assertSameResults("{a: 5, b: 'x'}");
+        assertSameResults("{$or: [{a: 1}, {b: 'x'}, {c: true}]}");
+        assertSameResults("{$nor: [{a: 1}, {b: 'x'}]}");
+        assertSameResults("{a: {$not: {$gt: 3}}}");
+        assertSameResults("{$and: [{$or: [{a: 5}, {a: 1}]}, {$or: [{b: 'x'}, {c: {$exists: true}}]}]}");
+        assertSameResults("{$or: [{a: {$gt: 5}}, {$and: [{b: null}, {a: {$lt: 10}}]}]}");
+    }
+
+    TEST(CompiledMatchExpressionTest, FallsBackForUnsupportedNodes) {
+        assertSameResults("{'a.b': 5, c: {$gt: 1}}");
+        assertSameResults("{b: {$elemMatch: {c: 2}}, a: {$exists: true}}");
+        assertSameResults("{a: {$size: 3}, b: {$exists: false}}");
+        assertSameResults("{$or: [{'b.c': 1}, {a: 1}]}");
+        assertSameResults("{'a.0': 5, b: {$exists: true}}");
+
+        scoped_ptr<MatchExpression> expr(parse("{'a.b': 5, b: {$elemMatch: {c: 1}}, c: 2}"));
+        scoped_ptr<CompiledMatchExpression> compiled(CompiledMatchExpression::compile(expr.get()));
+        ASSERT(compiled);
+        ASSERT_EQUALS(1U, compiled->numFields());
+        ASSERT_EQUALS(2U, compiled->numFallbacks());
+    }
+
+    TEST(CompiledMatchExpressionTest, NothingToCompile) {
+        scoped_ptr<MatchExpression> expr(parse("{'a.b': 5, b: {$elemMatch: {c: 1}}}"));
+        ASSERT(NULL == CompiledMatchExpression::compile(expr.get()));
+    }
+
+    TEST(CompiledMatchExpressionTest, ExtractsEachFieldOnce) {
+        scoped_ptr<MatchExpression> expr(parse("{a: {$gt: 1}, $or: [{a: 5}, {b: 1}]}"));
+        scoped_ptr<CompiledMatchExpression> compiled(CompiledMatchExpression::compile(expr.get()));
+        ASSERT(compiled);
+        ASSERT_EQUALS(2U, compiled->numFields());
+        ASSERT_EQUALS(0U, compiled->numFallbacks());
+    }
+
+    TEST(CompiledMatchExpressionTest, TooManyFields) {
+        BSONObjBuilder query;
+        for (size_t i = 0; i < CompiledMatchExpression::kMaxFields + 2; ++i) {
+            const std::string name = str::stream() << "f" << i;
+            query.append(name, static_cast<int>(i));
+        }
+        StatusWithMatchExpression result = MatchExpressionParser::parse(query.obj());
+        ASSERT_OK(result.getStatus());
+        scoped_ptr<MatchExpression> expr(result.getValue());
+        scoped_ptr<CompiledMatchExpression> compiled(CompiledMatchExpression::compile(expr.get()));
+        ASSERT(compiled);
+        ASSERT_EQUALS(CompiledMatchExpression::kMaxFields, compiled->numFields());
+        ASSERT_EQUALS(2U, compiled->numFallbacks());
+
+        BSONObjBuilder doc;
+        for (size_t i = 0; i < CompiledMatchExpression::kMaxFields + 2; ++i) {
+            const std::string name = str::stream() << "f" << i;
+            doc.append(name, static_cast<int>(i));
+        }
+        ASSERT(compiled->matchesBSON(doc.obj()));
+    }
+
+}  // namespace mongo
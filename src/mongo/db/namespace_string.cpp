@@ -46,6 +46,7 @@ namespace mongo {
         if ( ns == "admin.system.backup_users" ) return true;
 
         if ( ns.find( ".system.js" ) != string::npos ) return true;
+        if ( ns.find( ".system.plancache" ) != string::npos ) return true;
 
         return false;
     }
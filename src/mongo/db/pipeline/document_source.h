@@ -45,6 +45,7 @@
 #include "mongo/db/pipeline/dependencies.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/group_table.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/db/sorter/sorter.h"
 #include "mongo/s/shard.h"
@@ -428,6 +429,11 @@ namespace mongo {
     };
 
 
+    /**
+     * Whether $group keeps its groups in a GroupTable when all of its accumulators allow it.
+     */
+    extern bool internalDocumentSourceGroupUseGroupTable;
+
     class DocumentSourceGroup : public DocumentSource
                               , public SplittableDocumentSource {
     public:
@@ -467,6 +473,14 @@ namespace mongo {
         /// Tell this source if it is doing a merge from shards. Defaults to false.
         void setDoingMerge(bool doingMerge) { _doingMerge = doingMerge; }
 
+        /**
+         * Returns true if this $group is keyed on a single field path and all its accumulators are
+         * $first, or all are $last.  Given input sorted so that each group is contiguous, it then
+         * only needs the first document of each group, or the last one for $last.  Sets
+         * 'groupField' to the dotted path grouped on and 'usesLast' to whether it's $last.
+         */
+        bool needsOnlyFirstOrLastPerGroup(std::string* groupField, bool* usesLast) const;
+
         /**
           Create a grouping DocumentSource from BSON.
 
@@ -493,6 +507,7 @@ namespace mongo {
 
         /// Spill groups map to disk and returns an iterator to the file.
         boost::shared_ptr<Sorter<Value, Value>::Iterator> spill();
+        boost::shared_ptr<Sorter<Value, Value>::Iterator> spillGroupTable();
 
         // Only used by spill. Would be function-local if that were legal in C++03.
         class SpillSTLComparator;
@@ -545,6 +560,13 @@ namespace mongo {
 
 
         Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
+        Document makeDocument(size_t group, bool mergeableOutput);
+
+        /**
+         * Returns a GroupTable for the accumulators of this $group, or NULL if one of them has
+         * state which does not fit in a GroupTable and the groups map must be used instead.
+         */
+        GroupTable* createGroupTable();
 
         bool _doingMerge;
         bool _spilled;
@@ -554,8 +576,12 @@ namespace mongo {
         std::vector<std::string> _idFieldNames; // used when id is a document
         std::vector<boost::intrusive_ptr<Expression> > _idExpressions;
 
+        // Used instead of groups when all accumulators are supported by GroupTable.
+        boost::scoped_ptr<GroupTable> _groupTable;
+
         // only used when !_spilled
         GroupsMap::iterator groupsIterator;
+        size_t _groupTableIterator;
 
         // only used when _spilled
         boost::scoped_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
@@ -36,6 +36,7 @@
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
 
 namespace mongo {
 
@@ -44,6 +45,8 @@ namespace mongo {
     using std::pair;
     using std::vector;
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceGroupUseGroupTable, bool, true);
+
     const char DocumentSourceGroup::groupName[] = "$group";
 
     const char *DocumentSourceGroup::getSourceName() const {
@@ -100,6 +103,17 @@ namespace mongo {
 
             return makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
 
+        } else if (_groupTable) {
+            if (_groupTableIterator == _groupTable->size())
+                return boost::none;
+
+            Document out = makeDocument(_groupTableIterator, pExpCtx->inShard);
+
+            if (++_groupTableIterator == _groupTable->size())
+                dispose();
+
+            return out;
+
         } else {
             if (groups.empty())
                 return boost::none;
@@ -118,10 +132,13 @@ namespace mongo {
     void DocumentSourceGroup::dispose() {
         // free our resources
         GroupsMap().swap(groups);
+        if (_groupTable)
+            _groupTable->clear();
         _sorterIterator.reset();
 
         // make us look done
         groupsIterator = groups.end();
+        _groupTableIterator = 0;
 
         // free our source's resources
         pSource->dispose();
@@ -191,6 +208,39 @@ namespace mongo {
         return EXHAUSTIVE_ALL;
     }
 
+    bool DocumentSourceGroup::needsOnlyFirstOrLastPerGroup(std::string* groupField,
+                                                           bool* usesLast) const {
+        if (_doingMerge || !_idFieldNames.empty() || _idExpressions.size() != 1)
+            return false;
+
+        // The _id must be a path off of the document itself, not $$ROOT or another variable.
+        if (!dynamic_cast<ExpressionFieldPath*>(_idExpressions[0].get()))
+            return false;
+
+        DepsTracker idDeps;
+        _idExpressions[0]->addDependencies(&idDeps);
+        if (idDeps.needWholeDocument || idDeps.fields.size() != 1)
+            return false;
+
+        size_t numFirst = 0;
+        size_t numLast = 0;
+        for (size_t i = 0; i < vpAccumulatorFactory.size(); i++) {
+            if (vpAccumulatorFactory[i] == &AccumulatorFirst::create)
+                numFirst++;
+            else if (vpAccumulatorFactory[i] == &AccumulatorLast::create)
+                numLast++;
+            else
+                return false;
+        }
+
+        if (numFirst && numLast)
+            return false;
+
+        *groupField = *idDeps.fields.begin();
+        *usesLast = numLast > 0;
+        return true;
+    }
+
     intrusive_ptr<DocumentSourceGroup> DocumentSourceGroup::create(
         const intrusive_ptr<ExpressionContext> &pExpCtx) {
         intrusive_ptr<DocumentSourceGroup> pSource(
@@ -205,6 +255,7 @@ namespace mongo {
         , _spilled(false)
         , _extSortAllowed(pExpCtx->extSortAllowed && !pExpCtx->inRouter)
         , _maxMemoryUsageBytes(100*1024*1024)
+        , _groupTableIterator(0)
     {}
 
     void DocumentSourceGroup::addAccumulator(
@@ -357,6 +408,8 @@ namespace mongo {
         const size_t numAccumulators = vpAccumulatorFactory.size();
         dassert(numAccumulators == vpExpression.size());
 
+        _groupTable.reset(createGroupTable());
+
         // pushed to on spill()
         vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
         int memoryUsageBytes = 0;
@@ -380,36 +433,49 @@ namespace mongo {
             if (id.missing())
                 id = Value(BSONNULL);
 
-            /*
-              Look for the _id value in the map; if it's not there, add a
-              new entry with a blank accumulator.
-            */
-            const size_t oldSize = groups.size();
-            vector<intrusive_ptr<Accumulator> >& group = groups[id];
-            const bool inserted = groups.size() != oldSize;
+            bool inserted;
+            if (_groupTable) {
+                const size_t group = _groupTable->findOrInsert(id, &inserted);
+                for (size_t i = 0; i < numAccumulators; i++) {
+                    _groupTable->process(group,
+                                         i,
+                                         vpExpression[i]->evaluate(_variables.get()),
+                                         _doingMerge);
+                }
+                memoryUsageBytes = _groupTable->memUsageBytes();
+            }
+            else {
+                /*
+                  Look for the _id value in the map; if it's not there, add a
+                  new entry with a blank accumulator.
+                */
+                const size_t oldSize = groups.size();
+                vector<intrusive_ptr<Accumulator> >& group = groups[id];
+                inserted = groups.size() != oldSize;
 
-            if (inserted) {
-                memoryUsageBytes += id.getApproximateSize();
+                if (inserted) {
+                    memoryUsageBytes += id.getApproximateSize();
 
-                // Add the accumulators
-                group.reserve(numAccumulators);
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    group.push_back(vpAccumulatorFactory[i]());
+                    // Add the accumulators
+                    group.reserve(numAccumulators);
+                    for (size_t i = 0; i < numAccumulators; i++) {
+                        group.push_back(vpAccumulatorFactory[i]());
+                    }
+                } else {
+                    for (size_t i = 0; i < numAccumulators; i++) {
+                        // subtract old mem usage. New usage added back after processing.
+                        memoryUsageBytes -= group[i]->memUsageForSorter();
+                    }
                 }
-            } else {
+
+                /* tickle all the accumulators for the group we found */
+                dassert(numAccumulators == group.size());
                 for (size_t i = 0; i < numAccumulators; i++) {
-                    // subtract old mem usage. New usage added back after processing.
-                    memoryUsageBytes -= group[i]->memUsageForSorter();
+                    group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
+                    memoryUsageBytes += group[i]->memUsageForSorter();
                 }
             }
 
-            /* tickle all the accumulators for the group we found */
-            dassert(numAccumulators == group.size());
-            for (size_t i = 0; i < numAccumulators; i++) {
-                group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
-                memoryUsageBytes += group[i]->memUsageForSorter();
-            }
-
             // We are done with the ROOT document so release it.
             _variables->clearRoot();
 
@@ -428,12 +494,13 @@ namespace mongo {
         // These blocks do any final steps necessary to prepare to output results.
         if (!sortedFiles.empty()) {
             _spilled = true;
-            if (!groups.empty()) {
+            if (!groups.empty() || (_groupTable && !_groupTable->empty())) {
                 sortedFiles.push_back(spill());
             }
 
             // We won't be using groups again so free its memory.
             GroupsMap().swap(groups);
+            _groupTable.reset();
 
             _sorterIterator.reset(
                     Sorter<Value,Value>::Iterator::merge(
@@ -450,6 +517,7 @@ namespace mongo {
         } else {
             // start the group iterator
             groupsIterator = groups.begin();
+            _groupTableIterator = 0;
         }
 
         populated = true;
@@ -462,7 +530,23 @@ namespace mongo {
         }
     };
 
+    namespace {
+        class GroupTableSpillComparator {
+        public:
+            explicit GroupTableSpillComparator(const GroupTable* table) : _table(table) {}
+            bool operator() (size_t lhs, size_t rhs) const {
+                return Value::compare(_table->getId(lhs), _table->getId(rhs)) < 0;
+            }
+        private:
+            const GroupTable* _table;
+        };
+    }
+
     shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
+        if (_groupTable) {
+            return spillGroupTable();
+        }
+
         vector<const GroupsMap::value_type*> ptrs; // using pointers to speed sorting
         ptrs.reserve(groups.size());
         for (GroupsMap::const_iterator it=groups.begin(), end=groups.end(); it != end; ++it) {
@@ -502,6 +586,61 @@ namespace mongo {
         return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
     }
 
+    shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spillGroupTable() {
+        vector<size_t> order(_groupTable->size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+
+        stable_sort(order.begin(), order.end(), GroupTableSpillComparator(_groupTable.get()));
+
+        // Uses the same serialization as the groups map, so the merge in getNext() is shared.
+        SortedFileWriter<Value, Value> writer(SortOptions().TempDir(pExpCtx->tempDir));
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+        for (size_t i = 0; i < order.size(); i++) {
+            const size_t group = order[i];
+            switch (numAccumulators) {
+            case 0:
+                writer.addAlreadySorted(_groupTable->getId(group), Value());
+                break;
+
+            case 1:
+                writer.addAlreadySorted(_groupTable->getId(group),
+                                        _groupTable->getValue(group, 0, /*toBeMerged=*/true));
+                break;
+
+            default: {
+                vector<Value> accums;
+                accums.reserve(numAccumulators);
+                for (size_t j = 0; j < numAccumulators; j++) {
+                    accums.push_back(_groupTable->getValue(group, j, /*toBeMerged=*/true));
+                }
+                writer.addAlreadySorted(_groupTable->getId(group), Value::consume(accums));
+                break;
+            }
+            }
+        }
+
+        _groupTable->clear();
+
+        return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
+    }
+
+    GroupTable* DocumentSourceGroup::createGroupTable() {
+        if (!internalDocumentSourceGroupUseGroupTable)
+            return NULL;
+
+        vector<GroupTable::Op> ops;
+        for (size_t i = 0; i < vpAccumulatorFactory.size(); i++) {
+            GroupTable::Op op;
+            if (!GroupTable::opFromName(vpAccumulatorFactory[i]()->getOpName(), &op))
+                return NULL;
+            ops.push_back(op);
+        }
+
+        return new GroupTable(ops);
+    }
+
     void DocumentSourceGroup::parseIdExpression(BSONElement groupField,
                                                 const VariablesParseState& vps) {
         if (groupField.type() == Object && !groupField.Obj().isEmpty()) {
@@ -593,6 +732,26 @@ namespace mongo {
         return out.freeze();
     }
 
+    Document DocumentSourceGroup::makeDocument(size_t group, bool mergeableOutput) {
+        const size_t n = vFieldName.size();
+        MutableDocument out (1 + n);
+
+        out.addField("_id", expandId(_groupTable->getId(group)));
+
+        for(size_t i = 0; i < n; ++i) {
+            Value val = _groupTable->getValue(group, i, mergeableOutput);
+            if (val.missing()) {
+                // we return null in this case so return objects are predictable
+                out.addField(vFieldName[i], Value(BSONNULL));
+            }
+            else {
+                out.addField(vFieldName[i], val);
+            }
+        }
+
+        return out.freeze();
+    }
+
     intrusive_ptr<DocumentSource> DocumentSourceGroup::getShardSource() {
         return this; // No modifications necessary when on shard
     }
@@ -0,0 +1,279 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/group_table.h"
+
+#include <algorithm>
+#include <new>
+
+#include "mongo/db/pipeline/document.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    using std::vector;
+
+namespace {
+    // Field names of the mergeable $avg state. Must match AccumulatorAvg.
+    const char subTotalName[] = "subTotal";
+    const char countName[] = "count";
+
+    const size_t kBlockBytes = 64 * 1024;
+    const size_t kInitialBuckets = 16;
+
+    /**
+     * Value::Hash combines the hashes of the parts of a Value, which leaves small integers as
+     * nearly sequential hashes. Mix the bits so that masking off the low bits for a bucket
+     * doesn't turn regular _id patterns into long probe sequences.
+     */
+    size_t mixHash(size_t h) {
+        unsigned long long k = h;
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return static_cast<size_t>(k);
+    }
+}
+
+    bool GroupTable::opFromName(StringData opName, Op* op) {
+        if (opName == "$sum") *op = kSum;
+        else if (opName == "$avg") *op = kAvg;
+        else if (opName == "$min") *op = kMin;
+        else if (opName == "$max") *op = kMax;
+        else if (opName == "$first") *op = kFirst;
+        else if (opName == "$last") *op = kLast;
+        else return false;
+        return true;
+    }
+
+    GroupTable::GroupTable(const vector<Op>& ops)
+        : _ops(ops)
+        , _entrySize(sizeof(Value) + ops.size() * sizeof(Slot))
+        , _groupsPerBlock(std::max(size_t(1), kBlockBytes / _entrySize))
+        , _numGroups(0)
+        , _memUsageBytes(0)
+        , _buckets(kInitialBuckets, 0)
+    {}
+
+    GroupTable::~GroupTable() {
+        clear();
+    }
+
+    size_t GroupTable::findOrInsert(const Value& id, bool* inserted) {
+        // Keep the load factor at or below one half.
+        if ((_numGroups + 1) * 2 > _buckets.size()) {
+            _grow();
+        }
+
+        const size_t hash = mixHash(Value::Hash()(id));
+        const size_t mask = _buckets.size() - 1;
+        size_t bucket = hash & mask;
+        while (_buckets[bucket] != 0) {
+            const size_t group = _buckets[bucket] - 1;
+            if (_hashes[group] == hash && Value::compare(getId(group), id) == 0) {
+                *inserted = false;
+                return group;
+            }
+            bucket = (bucket + 1) & mask;
+        }
+
+        // Not found, so add a new entry at the end of the last block.
+        const size_t group = _numGroups;
+        if (group / _groupsPerBlock == _blocks.size()) {
+            _blocks.push_back(new char[_groupsPerBlock * _entrySize]);
+        }
+
+        char* entry = _entry(group);
+        new (entry) Value(id);
+        Slot* slots = _slots(group);
+        for (size_t i = 0; i < _ops.size(); i++) {
+            new (&slots[i]) Slot();
+        }
+
+        _buckets[bucket] = group + 1;
+        _hashes.push_back(hash);
+        _numGroups++;
+
+        // Count the entry, the part of the _id outside of the entry, and the hash table overhead
+        // for this group.
+        _memUsageBytes += _entrySize + id.getApproximateSize() - sizeof(Value)
+                        + 2 * sizeof(uint32_t) + sizeof(size_t);
+
+        *inserted = true;
+        return group;
+    }
+
+    void GroupTable::process(size_t group, size_t accum, const Value& input, bool merging) {
+        Slot& slot = _slots(group)[accum];
+
+        switch (_ops[accum]) {
+        case kSum: // mirrors AccumulatorSum::processInternal()
+            // do nothing with non numeric types
+            if (!input.numeric())
+                return;
+
+            // upgrade to the widest type required to hold the result
+            slot.totalType = Value::getWidestNumeric(slot.totalType, input.getType());
+
+            if (slot.totalType == NumberInt || slot.totalType == NumberLong) {
+                long long v = input.coerceToLong();
+                slot.longTotal += v;
+                slot.doubleTotal += v;
+            }
+            else {
+                dassert(slot.totalType == NumberDouble);
+                slot.doubleTotal += input.coerceToDouble();
+            }
+            return;
+
+        case kAvg: // mirrors AccumulatorAvg::processInternal()
+            if (!merging) {
+                // non numeric types have no impact on average
+                if (!input.numeric())
+                    return;
+
+                slot.doubleTotal += input.getDouble();
+                slot.longTotal += 1;
+            }
+            else {
+                // We expect an object that contains both a subtotal and a count.
+                verify(input.getType() == Object);
+                slot.doubleTotal += input[subTotalName].getDouble();
+                slot.longTotal += input[countName].getLong();
+            }
+            return;
+
+        case kMin:
+        case kMax: { // mirrors AccumulatorMinMax::processInternal()
+            // nullish values should have no impact on result
+            if (input.nullish())
+                return;
+
+            const int sense = _ops[accum] == kMin ? 1 : -1;
+            const int cmp = Value::compare(slot.value, input) * sense;
+            if (cmp > 0 || slot.value.missing()) { // missing is lower than all other values
+                _replace(&slot.value, input);
+            }
+            return;
+        }
+
+        case kFirst: // mirrors AccumulatorFirst::processInternal()
+            // remember the first value seen, even if it is missing
+            if (!slot.haveFirst) {
+                slot.haveFirst = true;
+                _replace(&slot.value, input);
+            }
+            return;
+
+        case kLast: // mirrors AccumulatorLast::processInternal()
+            _replace(&slot.value, input);
+            return;
+        }
+
+        verify(false);
+    }
+
+    Value GroupTable::getValue(size_t group, size_t accum, bool toBeMerged) const {
+        const Slot& slot = _slots(group)[accum];
+
+        switch (_ops[accum]) {
+        case kSum: // mirrors AccumulatorSum::getValue()
+            if (slot.totalType == NumberLong) {
+                return Value(slot.longTotal);
+            }
+            else if (slot.totalType == NumberDouble) {
+                return Value(slot.doubleTotal);
+            }
+            else if (slot.totalType == NumberInt) {
+                return Value::createIntOrLong(slot.longTotal);
+            }
+            massert(28629, "$sum resulted in a non-numeric type", false);
+
+        case kAvg: // mirrors AccumulatorAvg::getValue()
+            if (!toBeMerged) {
+                if (slot.longTotal == 0)
+                    return Value(0.0);
+
+                return Value(slot.doubleTotal / static_cast<double>(slot.longTotal));
+            }
+            return Value(DOC(subTotalName << slot.doubleTotal
+                          << countName << slot.longTotal));
+
+        case kMin:
+        case kMax:
+        case kFirst:
+        case kLast:
+            return slot.value;
+        }
+
+        verify(false);
+    }
+
+    void GroupTable::clear() {
+        for (size_t group = 0; group < _numGroups; group++) {
+            reinterpret_cast<Value*>(_entry(group))->~Value();
+            Slot* slots = _slots(group);
+            for (size_t i = 0; i < _ops.size(); i++) {
+                slots[i].~Slot();
+            }
+        }
+
+        for (size_t i = 0; i < _blocks.size(); i++) {
+            delete [] _blocks[i];
+        }
+
+        vector<char*>().swap(_blocks);
+        vector<uint32_t>(kInitialBuckets, 0).swap(_buckets);
+        vector<size_t>().swap(_hashes);
+        _numGroups = 0;
+        _memUsageBytes = 0;
+    }
+
+    void GroupTable::_replace(Value* dest, const Value& src) {
+        _memUsageBytes += static_cast<int>(src.getApproximateSize())
+                        - static_cast<int>(dest->getApproximateSize());
+        *dest = src;
+    }
+
+    void GroupTable::_grow() {
+        vector<uint32_t>(_buckets.size() * 2, 0).swap(_buckets);
+
+        const size_t mask = _buckets.size() - 1;
+        for (size_t group = 0; group < _numGroups; group++) {
+            size_t bucket = _hashes[group] & mask;
+            while (_buckets[bucket] != 0) {
+                bucket = (bucket + 1) & mask;
+            }
+            _buckets[bucket] = group + 1;
+        }
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+    /**
+     * Holds the groups of a $group whose accumulators all have fixed size state.
+     *
+     * Rather than a hash map of _id to a vector of heap allocated Accumulators, each group is a
+     * single entry holding its _id followed by the state of every accumulator. Entries are carved
+     * out of large blocks in insertion order and found through an open addressing hash table of
+     * entry indexes. Accumulators are updated by switching on their Op, so there is no per group
+     * allocation and no virtual call per document.
+     *
+     * getValue() returns exactly what the corresponding Accumulator would, including the
+     * mergeable form written when spilling and sent from shards, which process() accepts when
+     * merging.
+     */
+    class GroupTable {
+        MONGO_DISALLOW_COPYING(GroupTable);
+    public:
+        enum Op {
+            kSum,
+            kAvg,
+            kMin,
+            kMax,
+            kFirst,
+            kLast,
+        };
+
+        /**
+         * Returns true and sets 'op' if the accumulator called 'opName', as returned by
+         * Accumulator::getOpName(), can be run by a GroupTable.
+         */
+        static bool opFromName(StringData opName, Op* op);
+
+        explicit GroupTable(const std::vector<Op>& ops);
+        ~GroupTable();
+
+        /**
+         * Returns the index of the group for 'id', adding a group in its initial state if there
+         * was none. Indexes are assigned in insertion order from 0 to size() - 1.
+         */
+        size_t findOrInsert(const Value& id, bool* inserted);
+
+        /**
+         * Feeds 'input' to accumulator 'accum' of group 'group'.
+         * merging should be true when 'input' came from getValue(true).
+         */
+        void process(size_t group, size_t accum, const Value& input, bool merging);
+
+        Value getValue(size_t group, size_t accum, bool toBeMerged) const;
+
+        const Value& getId(size_t group) const {
+            return *reinterpret_cast<const Value*>(_entry(group));
+        }
+
+        size_t size() const { return _numGroups; }
+        bool empty() const { return _numGroups == 0; }
+
+        /** Approximate bytes used by the groups, comparable to the Accumulator accounting. */
+        int memUsageBytes() const { return _memUsageBytes; }
+
+        /** Removes all groups and frees the memory they used. */
+        void clear();
+
+    private:
+        /**
+         * State of one accumulator of one group. Each Op uses only some of the fields.
+         */
+        struct Slot {
+            Slot() : doubleTotal(0), longTotal(0), totalType(NumberInt), haveFirst(false) {}
+
+            Value value;            // $min, $max, $first and $last
+            double doubleTotal;     // $sum and $avg
+            long long longTotal;    // $sum, and the count for $avg
+            BSONType totalType;     // $sum: the widest numeric type seen
+            bool haveFirst;         // $first
+        };
+
+        char* _entry(size_t group) const {
+            return _blocks[group / _groupsPerBlock] + (group % _groupsPerBlock) * _entrySize;
+        }
+
+        Slot* _slots(size_t group) const {
+            return reinterpret_cast<Slot*>(_entry(group) + sizeof(Value));
+        }
+
+        /** Replaces 'dest' with 'src', keeping the memory accounting up to date. */
+        void _replace(Value* dest, const Value& src);
+
+        /** Doubles the number of buckets and reinserts every group. */
+        void _grow();
+
+        const std::vector<Op> _ops;
+        const size_t _entrySize;        // an _id followed by one Slot per accumulator
+        const size_t _groupsPerBlock;
+
+        std::vector<char*> _blocks;
+        size_t _numGroups;
+        int _memUsageBytes;
+
+        // Open addressing with linear probing. Each bucket holds a group index plus one, or 0 if
+        // the bucket is empty. The number of buckets is a power of two.
+        std::vector<uint32_t> _buckets;
+        std::vector<size_t> _hashes;    // hash of each group's _id, indexed by group
+    };
+}
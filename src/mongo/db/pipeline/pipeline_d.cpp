@@ -42,6 +42,7 @@
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/query/query_planner.h"
+#include "mongo/db/query/query_planner_common.h"
 #include "mongo/s/d_state.h"
 
 namespace mongo {
@@ -176,7 +177,53 @@ namespace {
 
         const WhereCallbackReal whereCallback(pExpCtx->opCtx, pExpCtx->ns.db());
 
-        if (sortStage) {
+        // A $sort followed by a $group on the leading sort field whose accumulators are all
+        // $first, or all $last, only needs one document per group.  If an index provides the
+        // sort we can skip through it from one value of the group field to the next.  For $last
+        // we walk the index backwards, so that the one document we see per group is the last.
+        string groupField;
+        bool groupUsesLast = false;
+        DocumentSourceGroup* groupStage = sources.size() >= 2
+            ? dynamic_cast<DocumentSourceGroup*>(sources[1].get())
+            : NULL;
+        if (sortStage
+                && !sortStage->getLimitSrc()
+                && !deps.needTextScore
+                && groupStage
+                && groupStage->needsOnlyFirstOrLastPerGroup(&groupField, &groupUsesLast)
+                && sortObj.firstElement().isNumber()
+                && groupField == sortObj.firstElementFieldName()) {
+            const BSONObj skipScanSort = groupUsesLast
+                ? QueryPlannerCommon::reverseSortObj(sortObj)
+                : sortObj;
+
+            CanonicalQuery* cq;
+            Status status =
+                CanonicalQuery::canonicalize(pExpCtx->ns,
+                                             queryObj,
+                                             skipScanSort,
+                                             projectionForQuery,
+                                             &cq,
+                                             whereCallback);
+
+            PlanExecutor* rawExec;
+            if (status.isOK() && getExecutorSkipScan(txn,
+                                                     collection,
+                                                     cq,
+                                                     groupField,
+                                                     PlanExecutor::YIELD_AUTO,
+                                                     &rawExec).isOK()) {
+                // success: The PlanExecutor returns the one document each group needs, so the
+                // $sort is no longer needed.  The $group stays to shape the results.
+                exec.reset(rawExec);
+                sortInRunner = true;
+                sortObj = skipScanSort;
+
+                sources.pop_front();
+            }
+        }
+
+        if (sortStage && !exec.get()) {
             CanonicalQuery* cq;
             Status status =
                 CanonicalQuery::canonicalize(pExpCtx->ns,
@@ -0,0 +1,509 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/plan_cache_persistence.h"
+
+#include <algorithm>
+#include <boost/scoped_ptr.hpp>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "mongo/base/counter.h"
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/database_catalog_entry.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/fsync.h"
+#include "mongo/db/commands/server_status_metric.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/db_raii.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/ops/delete.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/plan_ranker.h"
+#include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/background.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/log.h"
+#include "mongo/util/md5.hpp"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    using boost::scoped_ptr;
+    using std::auto_ptr;
+    using std::list;
+    using std::map;
+    using std::set;
+    using std::string;
+    using std::vector;
+
+    MONGO_EXPORT_SERVER_PARAMETER(planCachePersistenceEnabled, bool, false);
+    MONGO_EXPORT_SERVER_PARAMETER(planCachePersistenceIntervalSecs, int, 60);
+
+namespace {
+
+    const char kStoreCollection[] = "system.plancache";
+
+    Counter64 planCachePersisted;
+    Counter64 planCacheLoaded;
+
+    ServerStatusMetricField<Counter64> displayPlanCachePersisted("query.planCache.persisted",
+                                                                 &planCachePersisted);
+    ServerStatusMetricField<Counter64> displayPlanCacheLoaded("query.planCache.loaded",
+                                                              &planCacheLoaded);
+
+    void getIndexEntries(OperationContext* txn,
+                         Collection* collection,
+                         vector<IndexEntry>* indexes) {
+        IndexCatalog::IndexIterator ii =
+            collection->getIndexCatalog()->getIndexIterator(txn, false);
+        while (ii.more()) {
+            const IndexDescriptor* desc = ii.next();
+            indexes->push_back(IndexEntry(desc->keyPattern(),
+                                          desc->getAccessMethodName(),
+                                          desc->isMultikey(txn),
+                                          desc->isSparse(),
+                                          desc->unique(),
+                                          desc->indexName(),
+                                          desc->infoObj()));
+        }
+    }
+
+    bool indexNameLess(const IndexEntry& lhs, const IndexEntry& rhs) {
+        return lhs.name < rhs.name;
+    }
+
+    /**
+     * Identifies the indexes of a collection as far as the planner is concerned: a persisted
+     * plan is only valid for the indexes it was chosen from.
+     */
+    string indexCatalogVersion(vector<IndexEntry> indexes) {
+        std::sort(indexes.begin(), indexes.end(), indexNameLess);
+
+        BSONArrayBuilder arr;
+        for (size_t i = 0; i < indexes.size(); ++i) {
+            arr.append(BSON("spec" << indexes[i].infoObj << "multikey" << indexes[i].multikey));
+        }
+        BSONArray specs = arr.arr();
+        return md5simpledigest(specs.objdata(), specs.objsize());
+    }
+
+    BSONObj makeDocument(const string& ns,
+                         const string& version,
+                         const PlanCacheKey& key,
+                         const PlanCacheEntry& entry) {
+        BSONObjBuilder bob;
+        // The key can be long, so identify the query shape by its digest.
+        bob.append("_id", BSON("ns" << ns << "shape" << md5simpledigest(key)));
+        bob.append("version", version);
+        bob.append("query", entry.query);
+        bob.append("sort", entry.sort);
+        bob.append("projection", entry.projection);
+
+        BSONArrayBuilder plans(bob.subarrayStart("plans"));
+        for (size_t i = 0; i < entry.plannerData.size(); ++i) {
+            plans.append(entry.plannerData[i]->toBSON());
+        }
+        plans.doneFast();
+
+        BSONArrayBuilder scores(bob.subarrayStart("scores"));
+        for (size_t i = 0; i < entry.decision->scores.size(); ++i) {
+            scores.append(entry.decision->scores[i]);
+        }
+        scores.doneFast();
+
+        if (entry.backupSoln) {
+            bob.append("backupSoln", static_cast<int>(*entry.backupSoln));
+        }
+        bob.appendDate("savedAt", curTimeMillis64());
+        return bob.obj();
+    }
+
+    Status loadEntry(const string& ns,
+                     const BSONObj& doc,
+                     const vector<IndexEntry>& indexes,
+                     PlanCache* planCache) {
+        if (Object != doc["query"].type() || Object != doc["sort"].type()
+            || Object != doc["projection"].type() || Array != doc["plans"].type()
+            || Array != doc["scores"].type()) {
+            return Status(ErrorCodes::BadValue, "malformed persisted plan cache entry");
+        }
+
+        CanonicalQuery* rawCq;
+        Status status = CanonicalQuery::canonicalize(ns,
+                                                     doc["query"].Obj(),
+                                                     doc["sort"].Obj(),
+                                                     doc["projection"].Obj(),
+                                                     &rawCq);
+        if (!status.isOK()) {
+            return status;
+        }
+        scoped_ptr<CanonicalQuery> cq(rawCq);
+
+        if (!PlanCache::shouldCacheQuery(*cq)) {
+            return Status(ErrorCodes::BadValue, "query shape is not cacheable");
+        }
+
+        OwnedPointerVector<SolutionCacheData> plannerData;
+        BSONObjIterator plans(doc["plans"].Obj());
+        while (plans.more()) {
+            BSONElement plan = plans.next();
+            if (Object != plan.type()) {
+                return Status(ErrorCodes::BadValue, "malformed persisted plan");
+            }
+            SolutionCacheData* scd;
+            status = SolutionCacheData::parseFromBSON(plan.Obj(), indexes, &scd);
+            if (!status.isOK()) {
+                return status;
+            }
+            plannerData.push_back(scd);
+        }
+
+        vector<double> scores;
+        BSONObjIterator scoreIt(doc["scores"].Obj());
+        while (scoreIt.more()) {
+            scores.push_back(scoreIt.next().numberDouble());
+        }
+
+        boost::optional<size_t> backupSoln;
+        if (doc["backupSoln"].isNumber() && doc["backupSoln"].numberInt() >= 0) {
+            backupSoln.reset(doc["backupSoln"].numberInt());
+        }
+
+        return planCache->addPersisted(*cq, plannerData.release(), scores, backupSoln);
+    }
+
+    // The keys of the plan cache entries taken for saving, by collection namespace.
+    typedef vector<std::pair<string, vector<PlanCacheKey> > > PersistedKeys;
+
+    /**
+     * Tells the plan cache of each collection that the entries under 'persistedKeys' are saved,
+     * so that they are not handed out for saving again.
+     */
+    void markPersisted(OperationContext* txn,
+                       const string& dbName,
+                       const PersistedKeys& persistedKeys) {
+        if (persistedKeys.empty()) {
+            return;
+        }
+
+        ScopedTransaction transaction(txn, MODE_IS);
+        AutoGetDb autoDb(txn, dbName, MODE_IS);
+        Database* db = autoDb.getDb();
+        if (!db) {
+            return;
+        }
+
+        for (size_t i = 0; i < persistedKeys.size(); ++i) {
+            Lock::CollectionLock collLock(txn->lockState(), persistedKeys[i].first, MODE_IS);
+            Collection* collection = db->getCollection(persistedKeys[i].first);
+            if (!collection) {
+                continue;
+            }
+            collection->infoCache()->getPlanCache()->markPersisted(persistedKeys[i].second);
+        }
+    }
+
+    class PlanCachePersistenceJob : public BackgroundJob {
+    public:
+        virtual string name() const { return "PlanCachePersistence"; }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+
+            // Load the persisted entries on the first pass, then save on each pass after it.
+            bool loaded = false;
+            while (!inShutdown()) {
+                if (planCachePersistenceEnabled) {
+                    try {
+                        if (doPass(!loaded)) {
+                            loaded = true;
+                        }
+                    }
+                    catch (const DBException& e) {
+                        warning() << "plan cache persistence pass failed: " << e.toString();
+                    }
+                }
+
+                sleepsecs(std::max(1, static_cast<int>(planCachePersistenceIntervalSecs)));
+            }
+        }
+
+    private:
+        /**
+         * Returns false if the pass was skipped because the node can't be read from yet.
+         */
+        bool doPass(bool load) {
+            OperationContextImpl txn;
+
+            // if part of replSet but not in a readable state (e.g. during initial sync), skip.
+            if (repl::getGlobalReplicationCoordinator()->getReplicationMode() ==
+                repl::ReplicationCoordinator::modeReplSet &&
+                !repl::getGlobalReplicationCoordinator()->getMemberState().readable())
+                return false;
+
+            if (!load && lockedForWriting()) {
+                return true;
+            }
+
+            set<string> dbs;
+            dbHolder().getAllShortNames(dbs);
+
+            int count = 0;
+            for (set<string>::const_iterator i = dbs.begin(); i != dbs.end(); ++i) {
+                try {
+                    count += load ? loadPersistedPlanCaches(&txn, *i)
+                                  : persistPlanCaches(&txn, *i);
+                }
+                catch (const DBException& e) {
+                    warning() << "could not " << (load ? "load" : "save")
+                              << " the plan caches of database " << *i << ": " << e.toString();
+                }
+            }
+
+            if (load) {
+                log() << "loaded " << count << " persisted plan cache entries";
+            }
+            else {
+                LOG(1) << "saved " << count << " plan cache entries";
+            }
+            return true;
+        }
+    };
+
+}  // namespace
+
+    int persistPlanCaches(OperationContext* txn, const string& dbName) {
+        const string storeNs = dbName + "." + kStoreCollection;
+
+        // Only the primary saves plans; the secondaries get them through replication.
+        if (!repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(dbName)) {
+            return 0;
+        }
+
+        // Collect the entries to save and the current index catalog version of each collection.
+        vector<BSONObj> docs;
+        vector<std::pair<string, string> > versions;
+        PersistedKeys persistedKeys;
+        bool haveStore;
+        {
+            ScopedTransaction transaction(txn, MODE_IS);
+            AutoGetDb autoDb(txn, dbName, MODE_IS);
+            Database* db = autoDb.getDb();
+            if (!db) {
+                return 0;
+            }
+            haveStore = NULL != db->getCollection(storeNs);
+
+            list<string> namespaces;
+            db->getDatabaseCatalogEntry()->getCollectionNamespaces(&namespaces);
+
+            for (list<string>::const_iterator it = namespaces.begin();
+                 it != namespaces.end(); ++it) {
+                const string& ns = *it;
+                if (NamespaceString(ns).isSystem()) {
+                    continue;
+                }
+
+                Lock::CollectionLock collLock(txn->lockState(), ns, MODE_IS);
+                Collection* collection = db->getCollection(ns);
+                if (!collection) {
+                    continue;
+                }
+
+                std::vector<std::pair<PlanCacheKey, PlanCacheEntry*> > entries =
+                    collection->infoCache()->getPlanCache()->getEntriesToPersist();
+                OwnedPointerVector<PlanCacheEntry> ownedEntries;
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    ownedEntries.push_back(entries[i].second);
+                }
+                if (entries.empty()) {
+                    continue;
+                }
+
+                vector<IndexEntry> indexes;
+                getIndexEntries(txn, collection, &indexes);
+                const string version = indexCatalogVersion(indexes);
+
+                persistedKeys.push_back(std::make_pair(ns, vector<PlanCacheKey>()));
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    const PlanCacheEntry& entry = *entries[i].second;
+                    // Plans chosen under an index filter are only good while the filter is set,
+                    // so they are never saved.
+                    persistedKeys.back().second.push_back(entries[i].first);
+                    if (entry.plannerData[0]->indexFilterApplied) {
+                        continue;
+                    }
+                    docs.push_back(makeDocument(ns, version, entries[i].first, entry));
+                }
+                versions.push_back(std::make_pair(ns, version));
+            }
+        }
+
+        if (docs.empty()) {
+            markPersisted(txn, dbName, persistedKeys);
+            return 0;
+        }
+
+        if (!haveStore) {
+            ScopedTransaction transaction(txn, MODE_IX);
+            Lock::DBLock dbLock(txn->lockState(), dbName, MODE_X);
+            Database* db = dbHolder().get(txn, dbName);
+            if (!db
+                || !repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(dbName)) {
+                return 0;
+            }
+            if (!db->getCollection(storeNs)) {
+                MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+                    WriteUnitOfWork wunit(txn);
+                    uassertStatusOK(userCreateNS(txn, db, storeNs, BSONObj(), true));
+                    wunit.commit();
+                } MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "planCachePersistence", storeNs);
+            }
+        }
+
+        {
+            ScopedTransaction transaction(txn, MODE_IX);
+            AutoGetDb autoDb(txn, dbName, MODE_IX);
+            Database* db = autoDb.getDb();
+            if (!db) {
+                return 0;
+            }
+            Lock::CollectionLock collLock(txn->lockState(), storeNs, MODE_IX);
+
+            if (!repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(dbName)
+                || !db->getCollection(storeNs)) {
+                return 0;
+            }
+
+            for (size_t i = 0; i < docs.size(); ++i) {
+                MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+                    Helpers::upsert(txn, storeNs, docs[i]);
+                } MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "planCachePersistence", storeNs);
+            }
+
+            // Entries saved against indexes which have changed since can never be loaded again.
+            for (size_t i = 0; i < versions.size(); ++i) {
+                BSONObj stale = BSON("_id.ns" << versions[i].first
+                                     << "version" << BSON("$ne" << versions[i].second));
+                MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+                    deleteObjects(txn, db, storeNs, stale, PlanExecutor::YIELD_MANUAL,
+                                  false,  // justOne
+                                  true,   // logop
+                                  true);  // god
+                } MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "planCachePersistence", storeNs);
+            }
+        }
+
+        // Only now that the entries are written are they not handed out again. If anything
+        // above failed or returned early, the next pass tries them again.
+        markPersisted(txn, dbName, persistedKeys);
+
+        planCachePersisted.increment(docs.size());
+        return docs.size();
+    }
+
+    int loadPersistedPlanCaches(OperationContext* txn, const string& dbName) {
+        const string storeNs = dbName + "." + kStoreCollection;
+
+        // Read the persisted entries, grouped by collection.
+        map<string, vector<BSONObj> > docsByNs;
+        {
+            DBDirectClient client(txn);
+            auto_ptr<DBClientCursor> cursor = client.query(storeNs, Query(), 0, 0, NULL,
+                                                           QueryOption_SlaveOk);
+            while (cursor.get() && cursor->more()) {
+                BSONObj doc = cursor->nextSafe().getOwned();
+                docsByNs[doc["_id"]["ns"].str()].push_back(doc);
+            }
+        }
+
+        int loaded = 0;
+        for (map<string, vector<BSONObj> >::const_iterator it = docsByNs.begin();
+             it != docsByNs.end(); ++it) {
+            const string& ns = it->first;
+            if (!NamespaceString(ns).isValid() || nsToDatabaseSubstring(ns) != dbName) {
+                continue;
+            }
+
+            AutoGetCollectionForRead ctx(txn, ns);
+            Collection* collection = ctx.getCollection();
+            if (!collection) {
+                continue;
+            }
+
+            vector<IndexEntry> indexes;
+            getIndexEntries(txn, collection, &indexes);
+            const string version = indexCatalogVersion(indexes);
+            PlanCache* planCache = collection->infoCache()->getPlanCache();
+
+            const vector<BSONObj>& docs = it->second;
+            for (size_t i = 0; i < docs.size(); ++i) {
+                if (docs[i]["version"].str() != version) {
+                    LOG(2) << "not loading persisted plan cache entry " << docs[i]["_id"]
+                           << ": the indexes of " << ns << " have changed";
+                    continue;
+                }
+
+                Status status = loadEntry(ns, docs[i], indexes, planCache);
+                if (!status.isOK()) {
+                    LOG(1) << "not loading persisted plan cache entry " << docs[i]["_id"]
+                           << ": " << status;
+                    continue;
+                }
+                ++loaded;
+            }
+        }
+
+        planCacheLoaded.increment(loaded);
+        return loaded;
+    }
+
+    void startPlanCachePersistenceJob() {
+        PlanCachePersistenceJob* job = new PlanCachePersistenceJob();
+        job->go();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+
+namespace mongo {
+
+    class OperationContext;
+
+    /**
+     * Plan cache persistence saves the plan cache entries of every collection in
+     * <db>.system.plancache and loads them back into the plan caches after a restart, so that a
+     * node doesn't have to run plan selection for every query shape again. The collection is
+     * replicated, so secondaries also start with the plans chosen on the primary.
+     *
+     * An entry is only loaded if the indexes of its collection are the same as when it was
+     * saved.
+     */
+
+    /**
+     * Starts the background job which, while the planCachePersistenceEnabled server parameter
+     * is set, first loads the persisted plan caches and then saves new entries every
+     * planCachePersistenceIntervalSecs.
+     */
+    void startPlanCachePersistenceJob();
+
+    /**
+     * Saves the plan cache entries of the collections of 'dbName' which have not been saved
+     * yet. Does nothing unless this node can accept writes for 'dbName'.
+     * Returns the number of entries saved.
+     */
+    int persistPlanCaches(OperationContext* txn, const std::string& dbName);
+
+    /**
+     * Loads the persisted plan cache entries of 'dbName' into the plan caches of its
+     * collections. Entries which are already cached, or were saved against other indexes, are
+     * skipped. Returns the number of entries loaded.
+     */
+    int loadPersistedPlanCaches(OperationContext* txn, const std::string& dbName);
+
+}  // namespace mongo
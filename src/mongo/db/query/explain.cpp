@@ -63,6 +63,29 @@ namespace {
         }
     }
 
+    /**
+     * Returns true if the plan whose stats are rooted at 'root' is answered from index keys
+     * alone: every leaf is a scan over an index and no stage fetches documents.
+     */
+    bool isCoveredPlan(const PlanStageStats* root) {
+        if (STAGE_FETCH == root->stageType) {
+            return false;
+        }
+
+        if (root->children.empty()) {
+            return STAGE_IXSCAN == root->stageType
+                || STAGE_DISTINCT_SCAN == root->stageType
+                || STAGE_COUNT_SCAN == root->stageType;
+        }
+
+        for (size_t i = 0; i < root->children.size(); ++i) {
+            if (!isCoveredPlan(root->children[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     /**
      * Traverse the tree rooted at 'root', and add all nodes into the list 'flattened'.
      */
@@ -292,6 +315,34 @@ namespace mongo {
             bob->append("indexName", spec->indexName);
             bob->appendBool("isMultiKey", spec->isMultiKey);
             bob->append("indexVersion", spec->indexVersion);
+
+            if (!spec->indexBounds.isEmpty()) {
+                if ((topLevelBob->len() + spec->indexBounds.objsize()) > kMaxStatsBSONSize) {
+                    bob->append("warning", "index bounds omitted due to BSON size limit");
+                }
+                else {
+                    bob->append("indexBounds", spec->indexBounds);
+                }
+            }
+        }
+        else if (STAGE_DISTINCT_SCAN == stats.stageType) {
+            DistinctScanStats* spec = static_cast<DistinctScanStats*>(stats.specific.get());
+
+            bob->append("keyPattern", spec->keyPattern);
+            bob->append("indexName", spec->indexName);
+            bob->append("indexVersion", spec->indexVersion);
+            bob->append("direction", spec->direction > 0 ? "forward" : "backward");
+
+            if ((topLevelBob->len() + spec->indexBounds.objsize()) > kMaxStatsBSONSize) {
+                bob->append("warning", "index bounds omitted due to BSON size limit");
+            }
+            else {
+                bob->append("indexBounds", spec->indexBounds);
+            }
+
+            if (verbosity >= ExplainCommon::EXEC_STATS) {
+                bob->appendNumber("keysExamined", spec->keysExamined);
+            }
         }
         else if (STAGE_DELETE == stats.stageType) {
             DeleteStats* spec = static_cast<DeleteStats*>(stats.specific.get());
@@ -403,6 +454,7 @@ namespace mongo {
             if (verbosity >= ExplainCommon::EXEC_STATS) {
                 bob->appendNumber("memUsage", spec->memUsage);
                 bob->appendNumber("memLimit", spec->memLimit);
+                bob->appendBool("usedDisk", spec->usedDisk);
             }
 
             if (spec->limit > 0) {
@@ -524,6 +576,9 @@ namespace mongo {
         statsToBSON(*winnerStats, &winningPlanBob, ExplainCommon::QUERY_PLANNER);
         winningPlanBob.doneFast();
 
+        // Whether the winning plan gets everything it needs out of the index keys.
+        plannerBob.append("covered", isCoveredPlan(winnerStats));
+
         // Genenerate array of rejected plans.
         BSONArrayBuilder allPlansBob(plannerBob.subarrayStart("rejectedPlans"));
         for (size_t i = 0; i < rejectedStats.size(); i++) {
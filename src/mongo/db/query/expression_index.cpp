@@ -41,9 +41,17 @@ namespace mongo {
 
     using std::set;
 
-    BSONObj ExpressionMapping::hash(const BSONElement& value) {
+    BSONObj ExpressionMapping::hash(const BSONElement& value, const BSONObj& indexInfoObj) {
+        // Same defaults as ExpressionParams::parseHashParams(). The info object is empty for
+        // some test indexes, which therefore get the default seed and version.
+        HashSeed seed = BSONElementHasher::DEFAULT_HASH_SEED;
+        if (!indexInfoObj["seed"].eoo()) {
+            seed = indexInfoObj["seed"].numberInt();
+        }
+        const int hashVersion = indexInfoObj["hashVersion"].numberInt();
+
         BSONObjBuilder bob;
-        bob.append("", BSONElementHasher::hash64(value, BSONElementHasher::DEFAULT_HASH_SEED));
+        bob.append("", BSONElementHasher::hash64(value, seed, hashVersion));
         return bob.obj();
     }
 
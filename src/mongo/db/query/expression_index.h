@@ -44,7 +44,11 @@ namespace mongo {
     class ExpressionMapping {
     public:
 
-        static BSONObj hash(const BSONElement& value);
+        /**
+         * Returns the key of 'value' in the hashed index described by 'indexInfoObj', using the
+         * seed and hashVersion of that index.
+         */
+        static BSONObj hash(const BSONElement& value, const BSONObj& indexInfoObj);
 
         static void cover2d(const R2Region& region,
                             const BSONObj& indexInfoObj,
@@ -111,7 +111,7 @@ namespace mongo {
 
     namespace {
         // The body is below in the "count hack" section but getExecutor calls it.
-        bool turnIxscanIntoCount(QuerySolution* soln);
+        bool turnIxscanIntoCount(QuerySolution* soln, bool canUseBounds);
 
         bool filteredIndexBad(const MatchExpression* filter, CanonicalQuery* query) {
             if (!filter)
@@ -323,7 +323,7 @@ namespace mongo {
                     // The working set is shared by the root and backupRoot plans.
                     verify(StageBuilder::build(opCtx, collection, *qs, ws, rootOut));
                     if ((plannerParams.options & QueryPlannerParams::PRIVATE_IS_COUNT)
-                        && turnIxscanIntoCount(qs)) {
+                        && turnIxscanIntoCount(qs, false)) {
 
                         LOG(2) << "Using fast count: " << canonicalQuery->toStringShort()
                                << ", planSummary: " << Explain::getPlanSummary(*rootOut);
@@ -368,10 +368,13 @@ namespace mongo {
                               << " No query solutions");
             }
 
-            // See if one of our solutions is a fast count hack in disguise.
+            // See if one of our solutions is a fast count hack in disguise.  Count scans over
+            // arbitrary bounds are only used when there is no other plan to compare against, as
+            // taking the first one that qualifies would skip plan ranking.
             if (plannerParams.options & QueryPlannerParams::PRIVATE_IS_COUNT) {
+                const bool canUseBounds = (1 == solutions.size());
                 for (size_t i = 0; i < solutions.size(); ++i) {
-                    if (turnIxscanIntoCount(solutions[i])) {
+                    if (turnIxscanIntoCount(solutions[i], canUseBounds)) {
                         // Great, we can use solutions[i].  Clean up the other QuerySolution(s).
                         for (size_t j = 0; j < solutions.size(); ++j) {
                             if (j != i) {
@@ -938,32 +941,32 @@ namespace {
          * Returns 'true' if the provided solution 'soln' can be rewritten to use
          * a fast counting stage.  Mutates the tree in 'soln->root'.
          *
+         * If 'canUseBounds' is true, index scans over several intervals or with a filter over the
+         * index keys are turned into count scans as well.  Otherwise only a single interval
+         * without a filter qualifies.
+         *
          * Otherwise, returns 'false'.
          */
-        bool turnIxscanIntoCount(QuerySolution* soln) {
+        bool turnIxscanIntoCount(QuerySolution* soln, bool canUseBounds) {
             QuerySolutionNode* root = soln->root.get();
 
-            // Root should be a fetch w/o any filters.
-            if (STAGE_FETCH != root->getType()) {
-                return false;
-            }
-
-            if (NULL != root->filter.get()) {
-                return false;
+            // Root should either be an ixscan, or a fetch w/o any filters over an ixscan.
+            if (STAGE_FETCH == root->getType()) {
+                if (NULL != root->filter.get()) {
+                    return false;
+                }
+                root = root->children[0];
             }
 
-            // Child should be an ixscan.
-            if (STAGE_IXSCAN != root->children[0]->getType()) {
+            if (STAGE_IXSCAN != root->getType()) {
                 return false;
             }
 
-            IndexScanNode* isn = static_cast<IndexScanNode*>(root->children[0]);
-
-            // No filters allowed and side-stepping isSimpleRange for now.  TODO: do we ever see
-            // isSimpleRange here?  because we could well use it.  I just don't think we ever do see
-            // it.
+            IndexScanNode* isn = static_cast<IndexScanNode*>(root);
 
-            if (NULL != isn->filter.get() || isn->bounds.isSimpleRange) {
+            // Side-stepping isSimpleRange for now.  TODO: do we ever see isSimpleRange here?
+            // because we could well use it.  I just don't think we ever do see it.
+            if (isn->bounds.isSimpleRange) {
                 return false;
             }
 
@@ -973,33 +976,57 @@ namespace {
             BSONObj endKey;
             bool endKeyInclusive;
 
-            if (!IndexBoundsBuilder::isSingleInterval( isn->bounds,
-                                                       &startKey,
-                                                       &startKeyInclusive,
-                                                       &endKey,
-                                                       &endKeyInclusive )) {
+            const bool singleInterval =
+                NULL == isn->filter.get() &&
+                IndexBoundsBuilder::isSingleInterval( isn->bounds,
+                                                      &startKey,
+                                                      &startKeyInclusive,
+                                                      &endKey,
+                                                      &endKeyInclusive );
+
+            // The count scan walks its bounds in increasing order only.
+            if (!singleInterval && (!canUseBounds || 1 != isn->direction)) {
                 return false;
             }
 
-            // Make the count node that we replace the fetch + ixscan with.
+            // Make the count node that we replace the (fetch +) ixscan with.
             CountNode* cn = new CountNode();
             cn->indexKeyPattern = isn->indexKeyPattern;
-            cn->startKey = startKey;
-            cn->startKeyInclusive = startKeyInclusive;
-            cn->endKey = endKey;
-            cn->endKeyInclusive = endKeyInclusive;
+            if (singleInterval) {
+                cn->startKey = startKey;
+                cn->startKeyInclusive = startKeyInclusive;
+                cn->endKey = endKey;
+                cn->endKeyInclusive = endKeyInclusive;
+            }
+            else {
+                cn->bounds = isn->bounds;
+                cn->filter.swap(isn->filter);
+            }
             // Takes ownership of 'cn' and deletes the old root.
             soln->root.reset(cn);
             return true;
         }
 
+        /**
+         * Returns true if one of the fields of 'keyPattern' is 'field'.
+         */
+        bool indexHasField(const BSONObj& keyPattern, const std::string& field) {
+            BSONObjIterator it(keyPattern);
+            while (it.more()) {
+                if (field == it.next().fieldName()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
         /**
          * Returns true if indices contains an index that can be
          * used with DistinctNode. Sets indexOut to the array index
          * of PlannerParams::indices.
          * Look for the index for the fewest fields.
          * Criteria for suitable index is that the index cannot be special
-         * (geo, hashed, text, ...).
+         * (geo, hashed, text, ...) and must be prefixed by the field.
          *
          * Multikey indices are not suitable for DistinctNode when the projection
          * is on an array element. Arrays are flattened in a multikey index which
@@ -1020,6 +1047,10 @@ namespace {
                 if (!IndexNames::findPluginName(indices[i].keyPattern).empty()) {
                     continue;
                 }
+                // Without a query only an index prefixed by the field can be distinct-scanned.
+                if (indices[i].keyPattern.firstElement().fieldName() != field) {
+                    continue;
+                }
                 // Skip multikey indices if we are projecting on a dotted field.
                 if (indices[i].multikey && isDottedField) {
                     continue;
@@ -1188,44 +1219,74 @@ namespace {
     // Distinct hack
     //
 
-    bool turnIxscanIntoDistinctIxscan(QuerySolution* soln, const string& field) {
-        QuerySolutionNode* root = soln->root.get();
-
-        // We're looking for a project on top of an ixscan.
-        if (STAGE_PROJECTION == root->getType() && (STAGE_IXSCAN == root->children[0]->getType())) {
-            IndexScanNode* isn = static_cast<IndexScanNode*>(root->children[0]);
-
-            // An additional filter must be applied to the data in the key, so we can't just skip
-            // all the keys with a given value; we must examine every one to find the one that (may)
-            // pass the filter.
-            if (NULL != isn->filter.get()) {
-                return false;
-            }
+    namespace {
 
+        /**
+         * Returns a DistinctNode which skips through the keys of 'isn' from one value of 'field'
+         * to the next, or NULL if that isn't possible.  Every field of the index before 'field'
+         * must be restricted to points by the bounds, so that the skips stay within the keys we
+         * want.  If 'singlePoints' is true they must each be a single point, so that the scan
+         * returns each value of 'field' exactly once.  On success the filter of 'isn', if any, is
+         * moved to the new node, which steps over failing keys one at a time instead of skipping
+         * to the next value.
+         */
+        DistinctNode* makeSkipScan(IndexScanNode* isn, const string& field, bool singlePoints) {
             // We only set this when we have special query modifiers (.max() or .min()) or other
             // special cases.  Don't want to handle the interactions between those and distinct.
             // Don't think this will ever really be true but if it somehow is, just ignore this
             // soln.
             if (isn->bounds.isSimpleRange) {
-                return false;
+                return NULL;
             }
 
-            // Make a new DistinctNode.  We swap this for the ixscan in the provided solution.
-            DistinctNode* dn = new DistinctNode();
-            dn->indexKeyPattern = isn->indexKeyPattern;
-            dn->direction = isn->direction;
-            dn->bounds = isn->bounds;
-
-            // Figure out which field we're skipping to the next value of.  TODO: We currently only
-            // try to distinct-hack when there is an index prefixed by the field we're distinct-ing
-            // over.  Consider removing this code if we stick with that policy.
-            dn->fieldNo = 0;
+            // Figure out which field we're skipping to the next value of.
+            int fieldNo = 0;
             BSONObjIterator it(isn->indexKeyPattern);
             while (it.more()) {
                 if (field == it.next().fieldName()) {
                     break;
                 }
-                dn->fieldNo++;
+                fieldNo++;
+            }
+
+            if (fieldNo >= static_cast<int>(isn->bounds.fields.size())) {
+                return NULL;
+            }
+
+            for (int i = 0; i < fieldNo; ++i) {
+                const vector<Interval>& intervals = isn->bounds.fields[i].intervals;
+                if (singlePoints && intervals.size() != 1) {
+                    return NULL;
+                }
+                for (size_t j = 0; j < intervals.size(); ++j) {
+                    if (!intervals[j].isPoint()) {
+                        return NULL;
+                    }
+                }
+            }
+
+            DistinctNode* dn = new DistinctNode();
+            dn->indexKeyPattern = isn->indexKeyPattern;
+            dn->direction = isn->direction;
+            dn->bounds = isn->bounds;
+            dn->fieldNo = fieldNo;
+            dn->filter.swap(isn->filter);
+            return dn;
+        }
+
+    }  // namespace
+
+    bool turnIxscanIntoDistinctIxscan(QuerySolution* soln, const string& field) {
+        QuerySolutionNode* root = soln->root.get();
+
+        // We're looking for a project on top of an ixscan.
+        if (STAGE_PROJECTION == root->getType() && (STAGE_IXSCAN == root->children[0]->getType())) {
+            IndexScanNode* isn = static_cast<IndexScanNode*>(root->children[0]);
+
+            // Make a new DistinctNode.  We swap this for the ixscan in the provided solution.
+            DistinctNode* dn = makeSkipScan(isn, field, false);
+            if (NULL == dn) {
+                return false;
             }
 
             // Delete the old index scan, set the child of project to the fast distinct scan.
@@ -1237,6 +1298,37 @@ namespace {
         return false;
     }
 
+    bool turnIxscanIntoSkipScan(QuerySolution* soln, const string& field) {
+        QuerySolutionNode* root = soln->root.get();
+
+        // We're looking for a fetch without a filter on top of an ixscan.  A filter over the
+        // documents could reject the one document we keep for a value of 'field' while accepting
+        // another one with the same value.
+        if (STAGE_FETCH == root->getType()
+            && NULL == root->filter.get()
+            && STAGE_IXSCAN == root->children[0]->getType()) {
+            IndexScanNode* isn = static_cast<IndexScanNode*>(root->children[0]);
+
+            // A multikey index has several keys per document, so the first key for a value of
+            // 'field' need not belong to the first document in index order.
+            if (isn->indexIsMultiKey) {
+                return false;
+            }
+
+            // The caller wants one document per value of 'field', the first in index order.
+            DistinctNode* dn = makeSkipScan(isn, field, true);
+            if (NULL == dn) {
+                return false;
+            }
+
+            delete root->children[0];
+            root->children[0] = dn;
+            return true;
+        }
+
+        return false;
+    }
+
     Status getExecutorDistinct(OperationContext* txn,
                                Collection* collection,
                                const BSONObj& query,
@@ -1250,8 +1342,9 @@ namespace {
 
         // When can we do a fast distinct hack?
         // 1. There is a plan with just one leaf and that leaf is an ixscan.
-        // 2. The ixscan indexes the field we're interested in.
-        // 2a: We are correct if the index contains the field but for now we look for prefix.
+        // 2. The ixscan indexes the field we're interested in.  Any fields of the index before
+        //    that one must be restricted to points by the query, so the scan can skip from one
+        //    value of the field to the next within each point.
         // 3. The query is covered/no fetch.
         //
         // We go through normal planning (with limited parameters) to see if we can produce
@@ -1263,9 +1356,10 @@ namespace {
         IndexCatalog::IndexIterator ii = collection->getIndexCatalog()->getIndexIterator(txn,false);
         while (ii.more()) {
             const IndexDescriptor* desc = ii.next();
-            // The distinct hack can work if any field is in the index but it's not always clear
-            // if it's a win unless it's the first field.
-            if (desc->keyPattern().firstElement().fieldName() == field) {
+            // The distinct hack can work if any field is in the index.  Whether it's a win when
+            // the field isn't the first one depends on the bounds of the fields before it, which
+            // turnIxscanIntoDistinctIxscan checks once we have a plan.
+            if (indexHasField(desc->keyPattern(), field)) {
                 plannerParams.indices.push_back(IndexEntry(desc->keyPattern(),
                                                            desc->getAccessMethodName(),
                                                            desc->isMultikey(txn),
@@ -1293,7 +1387,7 @@ namespace {
         }
 
         //
-        // If we're here, we have an index prefixed by the field we're distinct-ing over.
+        // If we're here, we have an index containing the field we're distinct-ing over.
         //
 
         // Applying a projection allows the planner to try to give us covered plans that we can turn
@@ -1395,4 +1489,81 @@ namespace {
         return getExecutor(txn, collection, autoCq.release(), yieldPolicy, out);
     }
 
+    Status getExecutorSkipScan(OperationContext* txn,
+                               Collection* collection,
+                               CanonicalQuery* rawCanonicalQuery,
+                               const std::string& field,
+                               PlanExecutor::YieldPolicy yieldPolicy,
+                               PlanExecutor** out) {
+        auto_ptr<CanonicalQuery> cq(rawCanonicalQuery);
+
+        if (!collection) {
+            return Status(ErrorCodes::BadValue, "cannot skip-scan a missing collection");
+        }
+
+        // The first document for a value of the field may be an orphan.  A shard filter would
+        // drop it and the value along with it.
+        if (shardingState.getCollectionMetadata(collection->ns().ns())) {
+            return Status(ErrorCodes::BadValue, "cannot skip-scan a sharded collection");
+        }
+
+        QueryPlannerParams plannerParams;
+        plannerParams.options = QueryPlannerParams::NO_TABLE_SCAN
+                              | QueryPlannerParams::NO_BLOCKING_SORT;
+
+        IndexCatalog::IndexIterator ii = collection->getIndexCatalog()->getIndexIterator(txn,false);
+        while (ii.more()) {
+            const IndexDescriptor* desc = ii.next();
+            if (!IndexNames::findPluginName(desc->keyPattern()).empty()
+                || desc->isMultikey(txn)
+                || !indexHasField(desc->keyPattern(), field)) {
+                continue;
+            }
+            plannerParams.indices.push_back(IndexEntry(desc->keyPattern(),
+                                                       desc->getAccessMethodName(),
+                                                       false,
+                                                       desc->isSparse(),
+                                                       desc->unique(),
+                                                       desc->indexName(),
+                                                       desc->infoObj()));
+        }
+
+        if (plannerParams.indices.empty()) {
+            return Status(ErrorCodes::BadValue, "no index to skip-scan " + field + " with");
+        }
+
+        vector<QuerySolution*> solutions;
+        Status status = QueryPlanner::plan(*cq, plannerParams, &solutions);
+        if (!status.isOK()) {
+            return status;
+        }
+
+        for (size_t i = 0; i < solutions.size(); ++i) {
+            if (turnIxscanIntoSkipScan(solutions[i], field)) {
+                for (size_t j = 0; j < solutions.size(); ++j) {
+                    if (j != i) {
+                        delete solutions[j];
+                    }
+                }
+
+                WorkingSet* ws = new WorkingSet();
+                PlanStage* root;
+                verify(StageBuilder::build(txn, collection, *solutions[i], ws, &root));
+
+                LOG(2) << "Using skip scan: " << cq->toStringShort()
+                       << ", planSummary: " << Explain::getPlanSummary(root);
+
+                // Takes ownership of 'ws', 'root', 'solutions[i]', and 'cq'.
+                return PlanExecutor::make(txn, ws, root, solutions[i], cq.release(),
+                                          collection, yieldPolicy, out);
+            }
+        }
+
+        for (size_t i = 0; i < solutions.size(); ++i) {
+            delete solutions[i];
+        }
+
+        return Status(ErrorCodes::BadValue, "no plan can skip-scan " + field);
+    }
+
 }  // namespace mongo
@@ -121,6 +121,16 @@ namespace mongo {
      */
     bool turnIxscanIntoDistinctIxscan(QuerySolution* soln, const std::string& field);
 
+    /**
+     * If possible, turn the provided QuerySolution, a fetch over an index scan, into one that
+     * fetches only the first document in index order for each value of 'field', skipping the
+     * index keys in between.
+     *
+     * If the provided solution could be mutated successfully, returns true, otherwise returns
+     * false.
+     */
+    bool turnIxscanIntoSkipScan(QuerySolution* soln, const std::string& field);
+
     /*
      * Get an executor for a query executing as part of a distinct command.
      *
@@ -135,6 +145,23 @@ namespace mongo {
                                PlanExecutor::YieldPolicy yieldPolicy,
                                PlanExecutor** out);
 
+    /**
+     * Get a PlanExecutor which returns only the first document, in the order of the sort of
+     * 'rawCanonicalQuery', for each value of 'field' among the documents matching the query.  The
+     * executor skips from one value of 'field' to the next in an index ordered by the sort, so it
+     * looks at one index key and one document per value instead of all of them.  Used by
+     * aggregation for a $group on 'field' which only has $first or only $last accumulators.
+     *
+     * Takes ownership of 'rawCanonicalQuery'.  Returns a non-OK status if there is no such plan,
+     * in which case the caller should plan the query normally.
+     */
+    Status getExecutorSkipScan(OperationContext* txn,
+                               Collection* collection,
+                               CanonicalQuery* rawCanonicalQuery,
+                               const std::string& field,
+                               PlanExecutor::YieldPolicy yieldPolicy,
+                               PlanExecutor** out);
+
     /*
      * Get a PlanExecutor for a query executing as part of a count command.
      *
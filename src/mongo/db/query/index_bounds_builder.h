@@ -159,7 +159,12 @@ namespace mongo {
                                    OrderedIntervalList* oil,
                                    BoundsTightness* tightnessOut);
 
+        /**
+         * If 'isHashed' is true, the point interval is the hash of 'data' in the hashed
+         * index 'index'.
+         */
         static void translateEquality(const BSONElement& data,
+                                      const IndexEntry& index,
                                       bool isHashed,
                                       OrderedIntervalList* oil,
                                       BoundsTightness* tightnessOut);
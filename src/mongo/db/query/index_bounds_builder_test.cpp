@@ -473,6 +473,33 @@ namespace {
         ASSERT_EQUALS(tightness, IndexBoundsBuilder::EXACT);
     }
 
+    // The point of a hashed index equality must use the index's seed and hashVersion.
+    TEST(IndexBoundsBuilderTest, TranslateEqualHashed) {
+        const int hashVersions[] = {0, 1};
+        for (size_t i = 0; i < 2; i++) {
+            BSONObj keyPattern = BSON("a" << "hashed");
+            BSONObj infoObj = BSON("key" << keyPattern
+                                   << "seed" << 0x5eed
+                                   << "hashVersion" << hashVersions[i]);
+            IndexEntry testIndex(keyPattern, false, false, false, "a_hashed", infoObj);
+            BSONObj obj = BSON("a" << 4);
+            auto_ptr<MatchExpression> expr(parseMatchExpression(obj));
+            BSONElement elt = keyPattern.firstElement();
+            OrderedIntervalList oil;
+            IndexBoundsBuilder::BoundsTightness tightness;
+            IndexBoundsBuilder::translate(expr.get(), elt, testIndex, &oil, &tightness);
+            ASSERT_EQUALS(oil.name, "a");
+            ASSERT_EQUALS(oil.intervals.size(), 1U);
+
+            long long hash = BSONElementHasher::hash64(obj.firstElement(),
+                                                       0x5eed,
+                                                       hashVersions[i]);
+            ASSERT_EQUALS(Interval::INTERVAL_EQUALS, oil.intervals[0].compare(
+                Interval(BSON("" << hash << "" << hash), true, true)));
+            ASSERT_EQUALS(tightness, IndexBoundsBuilder::INEXACT_FETCH);
+        }
+    }
+
     TEST(IndexBoundsBuilderTest, TranslateArrayEqualBasic) {
         IndexEntry testIndex = IndexEntry(BSONObj());
         BSONObj obj = fromjson("{a: [1, 2, 3]}");
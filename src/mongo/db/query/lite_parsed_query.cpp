@@ -255,6 +255,14 @@ namespace mongo {
             else if (mongoutils::str::equals(fieldName, "$readPreference")) {
                 pq->_hasReadPref = true;
             }
+            else if (mongoutils::str::equals(fieldName, "allowDiskUse")) {
+                Status status = checkFieldType(el, Bool);
+                if (!status.isOK()) {
+                    return status;
+                }
+
+                pq->_allowDiskUse = el.boolean();
+            }
             else if (mongoutils::str::equals(fieldName, "tailable")) {
                 Status status = checkFieldType(el, Bool);
                 if (!status.isOK()) {
@@ -567,6 +575,7 @@ namespace mongo {
         _showDiskLoc(false),
         _snapshot(false),
         _hasReadPref(false),
+        _allowDiskUse(false),
         _tailable(false),
         _slaveOk(false),
         _oplogReplay(false),
@@ -725,6 +734,10 @@ namespace mongo {
                     // Won't throw.
                     _snapshot = e.trueValue();
                 }
+                else if (str::equals("allowDiskUse", name)) {
+                    // Won't throw.
+                    _allowDiskUse = e.trueValue();
+                }
                 else if (str::equals("min", name)) {
                     if (!e.isABSONObj()) {
                         return Status(ErrorCodes::BadValue, "$min must be a BSONObj");
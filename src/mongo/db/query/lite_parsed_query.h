@@ -136,6 +136,7 @@ namespace mongo {
         bool showDiskLoc() const { return _showDiskLoc; }
         bool isSnapshot() const { return _snapshot; }
         bool hasReadPref() const { return _hasReadPref; }
+        bool allowDiskUse() const { return _allowDiskUse; }
 
         bool isTailable() const { return _tailable; }
         bool isSlaveOk() const { return _slaveOk; }
@@ -243,6 +244,9 @@ namespace mongo {
         bool _snapshot;
         bool _hasReadPref;
 
+        // Can a blocking sort spill to disk rather than fail when it uses too much memory?
+        bool _allowDiskUse;
+
         // Options that can be specified in the OP_QUERY 'flags' header.
         bool _tailable;
         bool _slaveOk;
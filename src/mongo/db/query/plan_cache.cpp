@@ -35,9 +35,12 @@
 #include <algorithm>
 #include <math.h>
 #include <memory>
+#include <set>
 #include "boost/thread/locks.hpp"
+#include "mongo/base/counter.h"
 #include "mongo/base/owned_pointer_vector.h"
 #include "mongo/client/dbclientinterface.h"   // For QueryOption_foobar
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/query/plan_ranker.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/query_knobs.h"
@@ -49,6 +52,21 @@ namespace mongo {
     using std::string;
     using std::vector;
 
+namespace {
+    Counter64 planCacheHits;
+    Counter64 planCacheMisses;
+    Counter64 planCacheReplans;
+
+    ServerStatusMetricField<Counter64> displayPlanCacheHits("query.planCache.hits",
+                                                            &planCacheHits);
+    ServerStatusMetricField<Counter64> displayPlanCacheMisses("query.planCache.misses",
+                                                              &planCacheMisses);
+    // Entries evicted because their plan performed badly, so the next run of the query shape
+    // is planned again.
+    ServerStatusMetricField<Counter64> displayPlanCacheReplans("query.planCache.replans",
+                                                               &planCacheReplans);
+}
+
     //
     // Cache-related functions for CanonicalQuery
     //
@@ -137,7 +155,8 @@ namespace mongo {
     PlanCacheEntry::PlanCacheEntry(const std::vector<QuerySolution*>& solutions,
                                    PlanRankingDecision* why)
         : plannerData(solutions.size()),
-          decision(why) {
+          decision(why),
+          persisted(false) {
         invariant(why);
 
         // The caller of this constructor is responsible for ensuring
@@ -185,6 +204,7 @@ namespace mongo {
         }
         entry->averageScore = averageScore;
         entry->stddevScore = stddevScore;
+        entry->persisted = persisted;
         return entry;
     }
 
@@ -252,6 +272,89 @@ namespace mongo {
         return ss;
     }
 
+    void PlanCacheIndexTree::appendToBSON(BSONObjBuilder* bob) const {
+        if (NULL != entry.get()) {
+            bob->append("index", entry->name);
+            bob->append("keyPattern", entry->keyPattern);
+            bob->append("pos", static_cast<int>(index_pos));
+        }
+
+        if (!children.empty()) {
+            BSONArrayBuilder childrenBob(bob->subarrayStart("children"));
+            for (vector<PlanCacheIndexTree*>::const_iterator it = children.begin();
+                    it != children.end(); ++it) {
+                BSONObjBuilder childBob(childrenBob.subobjStart());
+                (*it)->appendToBSON(&childBob);
+                childBob.doneFast();
+            }
+            childrenBob.doneFast();
+        }
+    }
+
+    // static
+    Status PlanCacheIndexTree::parseFromBSON(const BSONObj& obj,
+                                             const std::vector<IndexEntry>& indexes,
+                                             PlanCacheIndexTree** out) {
+        std::auto_ptr<PlanCacheIndexTree> tree(new PlanCacheIndexTree());
+
+        BSONElement nameElt = obj["index"];
+        if (!nameElt.eoo()) {
+            BSONElement keyPatternElt = obj["keyPattern"];
+            BSONElement posElt = obj["pos"];
+            if (String != nameElt.type() || Object != keyPatternElt.type()
+                || !posElt.isNumber() || posElt.numberInt() < 0) {
+                return Status(ErrorCodes::BadValue,
+                              mongoutils::str::stream()
+                                  << "malformed index in cached plan: " << obj);
+            }
+
+            const IndexEntry* found = NULL;
+            for (size_t i = 0; i < indexes.size(); ++i) {
+                if (indexes[i].name == nameElt.valueStringData()
+                    && indexes[i].keyPattern.binaryEqual(keyPatternElt.Obj())) {
+                    found = &indexes[i];
+                    break;
+                }
+            }
+            if (NULL == found) {
+                return Status(ErrorCodes::IndexNotFound,
+                              mongoutils::str::stream()
+                                  << "cached plan uses missing index "
+                                  << nameElt.valueStringData());
+            }
+
+            tree->setIndexEntry(*found);
+            tree->index_pos = posElt.numberInt();
+        }
+
+        BSONElement childrenElt = obj["children"];
+        if (!childrenElt.eoo()) {
+            if (Array != childrenElt.type()) {
+                return Status(ErrorCodes::BadValue,
+                              mongoutils::str::stream()
+                                  << "malformed cached plan tree: " << obj);
+            }
+            BSONObjIterator it(childrenElt.Obj());
+            while (it.more()) {
+                BSONElement childElt = it.next();
+                if (Object != childElt.type()) {
+                    return Status(ErrorCodes::BadValue,
+                                  mongoutils::str::stream()
+                                      << "malformed cached plan tree: " << obj);
+                }
+                PlanCacheIndexTree* child;
+                Status status = parseFromBSON(childElt.Obj(), indexes, &child);
+                if (!status.isOK()) {
+                    return status;
+                }
+                tree->children.push_back(child);
+            }
+        }
+
+        *out = tree.release();
+        return Status::OK();
+    }
+
     //
     // SolutionCacheData
     //
@@ -291,6 +394,78 @@ namespace mongo {
         return ss;
     }
 
+    BSONObj SolutionCacheData::toBSON() const {
+        BSONObjBuilder bob;
+        switch (this->solnType) {
+        case WHOLE_IXSCAN_SOLN:
+            bob.append("type", "wholeIxscan");
+            bob.append("dir", this->wholeIXSolnDir);
+            break;
+        case COLLSCAN_SOLN:
+            bob.append("type", "collscan");
+            break;
+        case USE_INDEX_TAGS_SOLN:
+            bob.append("type", "indexTags");
+            break;
+        }
+        bob.append("indexFilterApplied", this->indexFilterApplied);
+
+        if (NULL != this->tree.get()) {
+            BSONObjBuilder treeBob(bob.subobjStart("tree"));
+            this->tree->appendToBSON(&treeBob);
+            treeBob.doneFast();
+        }
+        return bob.obj();
+    }
+
+    // static
+    Status SolutionCacheData::parseFromBSON(const BSONObj& obj,
+                                            const std::vector<IndexEntry>& indexes,
+                                            SolutionCacheData** out) {
+        std::auto_ptr<SolutionCacheData> data(new SolutionCacheData());
+
+        const string type = obj["type"].str();
+        if ("wholeIxscan" == type) {
+            data->solnType = WHOLE_IXSCAN_SOLN;
+            data->wholeIXSolnDir = obj["dir"].numberInt() < 0 ? -1 : 1;
+        }
+        else if ("collscan" == type) {
+            data->solnType = COLLSCAN_SOLN;
+        }
+        else if ("indexTags" == type) {
+            data->solnType = USE_INDEX_TAGS_SOLN;
+        }
+        else {
+            return Status(ErrorCodes::BadValue,
+                          mongoutils::str::stream()
+                              << "unknown cached solution type: " << obj);
+        }
+        data->indexFilterApplied = obj["indexFilterApplied"].trueValue();
+
+        BSONElement treeElt = obj["tree"];
+        if (COLLSCAN_SOLN != data->solnType && Object != treeElt.type()) {
+            return Status(ErrorCodes::BadValue,
+                          mongoutils::str::stream()
+                              << "cached solution is missing its tree: " << obj);
+        }
+        if (Object == treeElt.type()) {
+            PlanCacheIndexTree* tree;
+            Status status = PlanCacheIndexTree::parseFromBSON(treeElt.Obj(), indexes, &tree);
+            if (!status.isOK()) {
+                return status;
+            }
+            data->tree.reset(tree);
+        }
+        if (WHOLE_IXSCAN_SOLN == data->solnType && NULL == data->tree->entry.get()) {
+            return Status(ErrorCodes::BadValue,
+                          mongoutils::str::stream()
+                              << "whole index scan solution has no index: " << obj);
+        }
+
+        *out = data.release();
+        return Status::OK();
+    }
+
     //
     // PlanCache
     //
@@ -362,10 +537,12 @@ namespace mongo {
         PlanCacheEntry* entry;
         Status cacheStatus = _cache.get(key, &entry);
         if (!cacheStatus.isOK()) {
+            planCacheMisses.increment();
             return cacheStatus;
         }
         invariant(entry);
 
+        planCacheHits.increment();
         *crOut = new CachedSolution(key, *entry);
 
         return Status::OK();
@@ -444,6 +621,7 @@ namespace mongo {
                 LOG(1) << _ns << ": removing plan cache entry " << entry->toString()
                        << " - detected degradation in performance of cached solution.";
                 _cache.remove(ck);
+                planCacheReplans.increment();
             }
         }
         else {
@@ -494,6 +672,81 @@ namespace mongo {
         return entries;
     }
 
+    std::vector<std::pair<PlanCacheKey, PlanCacheEntry*> > PlanCache::getEntriesToPersist() {
+        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        std::vector<std::pair<PlanCacheKey, PlanCacheEntry*> > entries;
+        typedef std::list< std::pair<PlanCacheKey, PlanCacheEntry*> >::const_iterator ConstIterator;
+        for (ConstIterator i = _cache.begin(); i != _cache.end(); i++) {
+            PlanCacheEntry* entry = i->second;
+            if (entry->persisted) {
+                continue;
+            }
+            entries.push_back(std::make_pair(i->first, entry->clone()));
+        }
+
+        return entries;
+    }
+
+    void PlanCache::markPersisted(const std::vector<PlanCacheKey>& keys) {
+        const std::set<PlanCacheKey> persistedKeys(keys.begin(), keys.end());
+        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        // Walk the entries rather than look each key up, so as not to touch their LRU order.
+        typedef std::list< std::pair<PlanCacheKey, PlanCacheEntry*> >::const_iterator ConstIterator;
+        for (ConstIterator i = _cache.begin(); i != _cache.end(); i++) {
+            if (persistedKeys.count(i->first)) {
+                i->second->persisted = true;
+            }
+        }
+    }
+
+    Status PlanCache::addPersisted(const CanonicalQuery& query,
+                                   const std::vector<SolutionCacheData*>& plannerData,
+                                   const std::vector<double>& scores,
+                                   boost::optional<size_t> backupSoln) {
+        // The solutions own the planner data from here on.
+        OwnedPointerVector<QuerySolution> solutions;
+        for (size_t i = 0; i < plannerData.size(); ++i) {
+            QuerySolution* qs = new QuerySolution();
+            qs->cacheData.reset(plannerData[i]);
+            solutions.mutableVector().push_back(qs);
+        }
+
+        if (plannerData.empty()) {
+            return Status(ErrorCodes::BadValue, "no solutions provided");
+        }
+
+        if (scores.size() != plannerData.size()) {
+            return Status(ErrorCodes::BadValue, "number of scores must match solutions");
+        }
+
+        if (backupSoln && *backupSoln >= plannerData.size()) {
+            return Status(ErrorCodes::BadValue, "backup solution out of range");
+        }
+
+        PlanRankingDecision* why = new PlanRankingDecision();
+        for (size_t i = 0; i < plannerData.size(); ++i) {
+            why->stats.mutableVector().push_back(NULL);
+            why->candidateOrder.push_back(i);
+        }
+        why->scores = scores;
+
+        std::auto_ptr<PlanCacheEntry> entry(new PlanCacheEntry(solutions.vector(), why));
+        const LiteParsedQuery& pq = query.getParsed();
+        entry->query = pq.getFilter().getOwned();
+        entry->sort = pq.getSort().getOwned();
+        entry->projection = pq.getProj().getOwned();
+        entry->backupSoln = backupSoln;
+        entry->persisted = true;
+
+        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        if (_cache.hasKey(query.getPlanCacheKey())) {
+            return Status(ErrorCodes::BadValue, "query shape is already cached");
+        }
+        _cache.add(query.getPlanCacheKey(), entry.release());
+
+        return Status::OK();
+    }
+
     bool PlanCache::contains(const CanonicalQuery& cq) const {
         boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
         return _cache.hasKey(cq.getPlanCacheKey());
@@ -107,6 +107,21 @@ namespace mongo {
          */
         std::string toString(int indents = 0) const;
 
+        /**
+         * Appends the tree to 'bob' for persisting the plan cache. Indexes are identified by
+         * name and key pattern.
+         */
+        void appendToBSON(BSONObjBuilder* bob) const;
+
+        /**
+         * Inverse of appendToBSON(). Index references are resolved against 'indexes', so the
+         * result refers to the current definition of each index. Fails if an index no longer
+         * exists. On success the caller owns '*out'.
+         */
+        static Status parseFromBSON(const BSONObj& obj,
+                                    const std::vector<IndexEntry>& indexes,
+                                    PlanCacheIndexTree** out);
+
         // Children owned here.
         std::vector<PlanCacheIndexTree*> children;
 
@@ -136,6 +151,12 @@ namespace mongo {
         // For debugging.
         std::string toString() const;
 
+        // For persisting the plan cache. See PlanCacheIndexTree::appendToBSON().
+        BSONObj toBSON() const;
+        static Status parseFromBSON(const BSONObj& obj,
+                                    const std::vector<IndexEntry>& indexes,
+                                    SolutionCacheData** out);
+
         // Owned here. If 'wholeIXSoln' is false, then 'tree'
         // can be used to tag an isomorphic match expression. If 'wholeIXSoln'
         // is true, then 'tree' is used to store the relevant IndexEntry.
@@ -267,6 +288,10 @@ namespace mongo {
         // In order to justify eviction, the deviation from the mean must exceed a
         // minimum threshold.
         static const double kMinDeviation;
+
+        // True once the entry has been saved and PlanCache::markPersisted() called for its key,
+        // or if it was loaded from the persisted plan cache.
+        bool persisted;
     };
 
     /**
@@ -369,6 +394,32 @@ namespace mongo {
          */
         std::vector<PlanCacheEntry*> getAllEntries() const;
 
+        /**
+         * Returns copies of the entries that have not been persisted yet, along with their keys.
+         * They are handed out again until markPersisted() is called for their keys. Caller owns
+         * the entry copies.
+         */
+        std::vector<std::pair<PlanCacheKey, PlanCacheEntry*> > getEntriesToPersist();
+
+        /**
+         * Marks the entries under 'keys' persisted, once the caller has saved them. Keys which
+         * are no longer in the cache are ignored.
+         */
+        void markPersisted(const std::vector<PlanCacheKey>& keys);
+
+        /**
+         * Adds an entry read back from the persisted plan cache. 'plannerData' is the planner
+         * data of the candidate plans, best first, with their scores in 'scores'. The trial
+         * stats of a persisted entry are not kept, so its decision has no stats.
+         *
+         * Takes ownership of the elements of 'plannerData', even on failure. Does not replace an
+         * entry which is already cached for 'query'.
+         */
+        Status addPersisted(const CanonicalQuery& query,
+                            const std::vector<SolutionCacheData*>& plannerData,
+                            const std::vector<double>& scores,
+                            boost::optional<size_t> backupSoln);
+
         /**
          * Returns true if there is an entry in the cache for the 'query'.
          * Internally calls hasKey() on the LRU cache.
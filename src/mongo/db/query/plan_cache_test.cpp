@@ -423,6 +423,54 @@ namespace {
         ASSERT_EQUALS(planCache.size(), 1U);
     }
 
+    TEST(PlanCacheTest, AddPersisted) {
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        QuerySolution qs;
+        qs.cacheData.reset(new SolutionCacheData());
+        qs.cacheData->tree.reset(new PlanCacheIndexTree());
+        std::vector<QuerySolution*> solns;
+        solns.push_back(&qs);
+        ASSERT_OK(planCache.add(*cq, solns, createDecision(1U)));
+
+        // Entries are handed out for persisting until they are marked persisted.
+        std::vector<std::pair<PlanCacheKey, PlanCacheEntry*> > entries =
+            planCache.getEntriesToPersist();
+        ASSERT_EQUALS(entries.size(), 1U);
+        ASSERT_EQUALS(entries[0].first, cq->getPlanCacheKey());
+        ASSERT_EQUALS(entries[0].second->plannerData.size(), 1U);
+        delete entries[0].second;
+
+        entries = planCache.getEntriesToPersist();
+        ASSERT_EQUALS(entries.size(), 1U);
+        delete entries[0].second;
+
+        planCache.markPersisted(std::vector<PlanCacheKey>(1, cq->getPlanCacheKey()));
+        ASSERT_TRUE(planCache.getEntriesToPersist().empty());
+
+        // A loaded entry doesn't replace one the server has already cached.
+        std::vector<SolutionCacheData*> plannerData;
+        plannerData.push_back(qs.cacheData->clone());
+        ASSERT_NOT_OK(planCache.addPersisted(*cq, plannerData, std::vector<double>(1, 1.5),
+                                             boost::none));
+
+        planCache.clear();
+        plannerData.clear();
+        plannerData.push_back(qs.cacheData->clone());
+        ASSERT_OK(planCache.addPersisted(*cq, plannerData, std::vector<double>(1, 1.5),
+                                         boost::none));
+        ASSERT_TRUE(planCache.contains(*cq));
+        ASSERT_TRUE(planCache.getEntriesToPersist().empty());
+
+        PlanCacheEntry* entry;
+        ASSERT_OK(planCache.getEntry(*cq, &entry));
+        boost::scoped_ptr<PlanCacheEntry> scopedEntry(entry);
+        ASSERT_EQUALS(entry->decision->scores.size(), 1U);
+        ASSERT_EQUALS(entry->decision->scores[0], 1.5);
+        ASSERT_EQUALS(entry->decision->stats.size(), 1U);
+        ASSERT(NULL == entry->decision->stats[0]);
+    }
+
     /**
      * Each test in the CachePlanSelectionTest suite goes through
      * the following flow:
@@ -722,6 +770,17 @@ namespace {
             QuerySolution* planSoln = planQueryFromCache(query, sort, proj, *bestSoln);
             assertSolutionMatches(planSoln, solnJson);
             delete planSoln;
+
+            // The cache data must also survive being persisted and loaded again.
+            SolutionCacheData* parsed;
+            ASSERT_OK(SolutionCacheData::parseFromBSON(bestSoln->cacheData->toBSON(),
+                                                       params.indices,
+                                                       &parsed));
+            QuerySolution loaded;
+            loaded.cacheData.reset(parsed);
+            planSoln = planQueryFromCache(query, sort, proj, loaded);
+            assertSolutionMatches(planSoln, solnJson);
+            delete planSoln;
         }
 
         /**
@@ -96,8 +96,7 @@ namespace mongo {
             PlanRankingDecision* decision = new PlanRankingDecision();
             for (size_t i = 0; i < stats.size(); ++i) {
                 PlanStageStats* s = stats.vector()[i];
-                invariant(s);
-                decision->stats.mutableVector().push_back(s->clone());
+                decision->stats.mutableVector().push_back(s ? s->clone() : NULL);
             }
             decision->scores = scores;
             decision->candidateOrder = candidateOrder;
@@ -106,7 +105,7 @@ namespace mongo {
         }
 
         // Stats of all plans sorted in descending order by score.
-        // Owned by us.
+        // Owned by us. NULL for plan cache entries loaded from the persisted plan cache.
         OwnedPointerVector<PlanStageStats> stats;
 
         // The "goodness" score corresponding to 'stats'.
@@ -258,6 +258,37 @@ namespace mongo {
             return false;
         }
 
+        /**
+         * Returns true if the blocking sort of 'query' can be computed from the index keys that
+         * 'solnRoot' provides, so that no FETCH is needed beneath the SORT.  That is the case when
+         * the projection is going to be covered anyway and every sort field is available from a
+         * non-multikey index.
+         */
+        bool canSortCovered(const CanonicalQuery& query, const QuerySolutionNode* solnRoot) {
+            const ParsedProjection* proj = query.getProj();
+            if (NULL == proj || proj->requiresDocument() || proj->wantIndexKey()) {
+                return false;
+            }
+
+            const vector<string>& fields = proj->getRequiredFields();
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (!solnRoot->hasField(fields[i])) {
+                    return false;
+                }
+            }
+
+            BSONObjIterator it(query.getParsed().getSort());
+            while (it.more()) {
+                BSONElement elt = it.next();
+                // A $meta sort needs computed data which only comes with the document.
+                if (!elt.isNumber() || !solnRoot->hasField(elt.fieldName())) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
     }  // namespace
 
     // static
@@ -452,10 +483,9 @@ namespace mongo {
             return NULL;
         }
 
-        // Add a fetch stage so we have the full object when we hit the sort stage.  TODO: Can we
-        // pull the values that we sort by out of the key and if so in what cases?  Perhaps we can
-        // avoid a fetch.
-        if (!solnRoot->fetched()) {
+        // Add a fetch stage so we have the full object when we hit the sort stage, unless the
+        // sort can be done on the index keys and the projection above it will be covered.
+        if (!solnRoot->fetched() && !canSortCovered(query, solnRoot)) {
             FetchNode* fetch = new FetchNode();
             fetch->children.push_back(solnRoot);
             solnRoot = fetch;
@@ -465,6 +495,7 @@ namespace mongo {
         SortNode* sort = new SortNode();
         sort->pattern = sortObj;
         sort->query = query.getParsed().getFilter();
+        sort->allowDiskUse = query.getParsed().allowDiskUse();
         sort->children.push_back(solnRoot);
         solnRoot = sort;
         // When setting the limit on the sort, we need to consider both
@@ -716,8 +747,10 @@ namespace mongo {
             solnRoot = projNode;
         }
         else {
-            // If there's no projection, we must fetch, as the user wants the entire doc.
-            if (!solnRoot->fetched()) {
+            // If there's no projection, we must fetch, as the user wants the entire doc.  A count
+            // only looks at how many results there are, so any predicates that the index keys
+            // could not answer have already put a fetch in the tree and we can skip it here.
+            if (!solnRoot->fetched() && !(params.options & QueryPlannerParams::PRIVATE_IS_COUNT)) {
                 FetchNode* fetch = new FetchNode();
                 fetch->children.push_back(solnRoot);
                 solnRoot = fetch;
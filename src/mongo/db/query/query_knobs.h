@@ -104,4 +104,7 @@ namespace mongo {
     // Yield if it's been at least this many milliseconds since we last yielded.
     extern int internalQueryExecYieldPeriodMS;
 
+    // Do collection scans and fetches match documents with a CompiledMatchExpression?
+    extern bool internalQueryExecCompileFilters;
+
 }  // namespace mongo
@@ -1143,6 +1143,78 @@ namespace {
                                 "bounds: {a:[[1,1,true,true]], b:[[1,1,true,true]]}}}}}");
     }
 
+    TEST_F(QueryPlannerTest, BlockingSortCoveredByIndexKeys) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuerySortProj(fromjson("{a: {$gt: 1}}"), fromjson("{b: 1}"),
+                         fromjson("{_id: 0, a: 1, b: 1}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{proj: {spec: {_id: 0, a: 1, b: 1}, type: 'coveredIndex', node: "
+                                "{sort: {pattern: {b: 1}, limit: 0, node: "
+                                "{ixscan: {filter: null, pattern: {a: 1, b: 1}}}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, BlockingSortOnFieldOutsideProjectionCovered) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuerySortProj(fromjson("{a: {$gt: 1}}"), fromjson("{b: -1}"),
+                         fromjson("{_id: 0, a: 1}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, type: 'coveredIndex', node: "
+                                "{sort: {pattern: {b: -1}, limit: 0, node: "
+                                "{ixscan: {filter: null, pattern: {a: 1, b: 1}}}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, BlockingSortNotCoveredFetches) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuerySortProj(fromjson("{a: {$gt: 1}}"), fromjson("{c: 1}"),
+                         fromjson("{_id: 0, a: 1}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: "
+                                "{sort: {pattern: {c: 1}, limit: 0, node: {fetch: {node: "
+                                "{ixscan: {filter: null, pattern: {a: 1, b: 1}}}}}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, BlockingSortMultikeyNotCovered) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN;
+        // true means multikey
+        addIndex(BSON("a" << 1 << "b" << 1), true);
+        runQuerySortProj(fromjson("{a: {$gt: 1}}"), fromjson("{b: 1}"),
+                         fromjson("{_id: 0, a: 1, b: 1}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{proj: {spec: {_id: 0, a: 1, b: 1}, node: "
+                                "{sort: {pattern: {b: 1}, limit: 0, node: {fetch: {node: "
+                                "{ixscan: {filter: null, pattern: {a: 1, b: 1}}}}}}}}}");
+    }
+
+    //
+    // Count
+    //
+
+    TEST_F(QueryPlannerTest, CountDoesNotFetchWhenIndexAnswersPredicate) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN | QueryPlannerParams::PRIVATE_IS_COUNT;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{a: {$in: [1, 5]}, b: /foo/}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{ixscan: {filter: {b: /foo/}, pattern: {a: 1, b: 1}}}");
+    }
+
+    TEST_F(QueryPlannerTest, CountFetchesForUnindexedPredicate) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN | QueryPlannerParams::PRIVATE_IS_COUNT;
+        addIndex(BSON("a" << 1));
+        runQuery(fromjson("{a: {$in: [1, 5]}, b: 1}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{fetch: {filter: {b: 1}, node: "
+                                "{ixscan: {filter: null, pattern: {a: 1}}}}}");
+    }
+
     //
     // Sort with limit and/or skip
     //
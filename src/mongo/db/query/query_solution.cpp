@@ -631,6 +631,10 @@ namespace mongo {
         *ss << "query for bounds = " << query.toString() << '\n';
         addIndent(ss, indent + 1);
         *ss << "limit = " << limit << '\n';
+        if (allowDiskUse) {
+            addIndent(ss, indent + 1);
+            *ss << "allowDiskUse\n";
+        }
         addCommon(ss, indent);
         addIndent(ss, indent + 1);
         *ss << "Child:" << '\n';
@@ -645,6 +649,7 @@ namespace mongo {
         copy->pattern = this->pattern;
         copy->query = this->query;
         copy->limit = this->limit;
+        copy->allowDiskUse = this->allowDiskUse;
 
         return copy;
     }
@@ -831,6 +836,10 @@ namespace mongo {
         *ss << "direction = " << direction << '\n';
         addIndent(ss, indent + 1);
         *ss << "bounds = " << bounds.toString() << '\n';
+        if (NULL != filter) {
+            addIndent(ss, indent + 1);
+            *ss << " filter = " << filter->toString() << '\n';
+        }
     }
 
     QuerySolutionNode* DistinctNode::clone() const {
@@ -859,6 +868,14 @@ namespace mongo {
         *ss << "startKey = " << startKey << '\n';
         addIndent(ss, indent + 1);
         *ss << "endKey = " << endKey << '\n';
+        if (!bounds.fields.empty()) {
+            addIndent(ss, indent + 1);
+            *ss << "bounds = " << bounds.toString() << '\n';
+        }
+        if (NULL != filter) {
+            addIndent(ss, indent + 1);
+            *ss << " filter = " << filter->toString() << '\n';
+        }
     }
 
     QuerySolutionNode* CountNode::clone() const {
@@ -871,6 +888,7 @@ namespace mongo {
         copy->startKeyInclusive = this->startKeyInclusive;
         copy->endKey = this->endKey;
         copy->endKeyInclusive = this->endKeyInclusive;
+        copy->bounds = this->bounds;
 
         return copy;
     }
@@ -499,7 +499,7 @@ namespace mongo {
     };
 
     struct SortNode : public QuerySolutionNode {
-        SortNode() : limit(0) { }
+        SortNode() : limit(0), allowDiskUse(false) { }
         virtual ~SortNode() { }
 
         virtual StageType getType() const { return STAGE_SORT; }
@@ -530,6 +530,9 @@ namespace mongo {
 
         // Sum of both limit and skip count in the parsed query.
         size_t limit;
+
+        // May the sort spill to disk if it exceeds its memory limit?
+        bool allowDiskUse;
     };
 
     struct LimitNode : public QuerySolutionNode {
@@ -702,7 +705,7 @@ namespace mongo {
 
     /**
      * Some count queries reduce to counting how many keys are between two entries in a
-     * Btree.
+     * Btree, or how many keys within some index bounds pass a filter over the key.
      */
     struct CountNode : public QuerySolutionNode {
         CountNode() { }
@@ -727,6 +730,9 @@ namespace mongo {
 
         BSONObj endKey;
         bool endKeyInclusive;
+
+        // If this has any fields it is scanned instead of the range between the two keys.
+        IndexBounds bounds;
     };
 
 }  // namespace mongo
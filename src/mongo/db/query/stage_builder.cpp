@@ -111,6 +111,7 @@ namespace mongo {
             params.pattern = sn->pattern;
             params.query = sn->query;
             params.limit = sn->limit;
+            params.allowDiskUse = sn->allowDiskUse;
             return new SortStage(params, ws, childStage);
         }
         else if (STAGE_PROJECTION == root->getType()) {
@@ -303,7 +304,7 @@ namespace mongo {
             params.direction = dn->direction;
             params.bounds = dn->bounds;
             params.fieldNo = dn->fieldNo;
-            return new DistinctScan(txn, params, ws);
+            return new DistinctScan(txn, params, ws, dn->filter.get());
         }
         else if (STAGE_COUNT_SCAN == root->getType()) {
             const CountNode* cn = static_cast<const CountNode*>(root);
@@ -321,8 +322,9 @@ namespace mongo {
             params.startKeyInclusive = cn->startKeyInclusive;
             params.endKey = cn->endKey;
             params.endKeyInclusive = cn->endKeyInclusive;
+            params.bounds = cn->bounds;
 
-            return new CountScan(txn, params, ws);
+            return new CountScan(txn, params, ws, cn->filter.get());
         }
         else {
             mongoutils::str::stream ss;
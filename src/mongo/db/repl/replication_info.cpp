@@ -47,6 +47,7 @@
 #include "mongo/db/storage_options.h"
 #include "mongo/db/wire_version.h"
 #include "mongo/s/write_ops/batched_command_request.h"
+#include "mongo/util/net/message_compression.h"
 
 namespace mongo {
 
@@ -221,6 +222,10 @@ namespace repl {
             result.appendDate("localTime", jsTime());
             result.append("maxWireVersion", maxWireVersion);
             result.append("minWireVersion", minWireVersion);
+            std::vector<MessageCompressor> acceptedCompressors;
+            appendNegotiatedMessageCompressors(cmdObj, &result, &acceptedCompressors);
+            if (txn->getClient()->port())
+                txn->getClient()->port()->acceptCompressors(acceptedCompressors);
             return true;
         }
     } cmdismaster;
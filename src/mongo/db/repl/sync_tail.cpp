@@ -41,11 +41,13 @@
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/db_raii.h"
+#include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/prefetch.h"
@@ -54,6 +56,7 @@
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/stats/timer_stats.h"
+#include "mongo/platform/unordered_map.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
@@ -86,6 +89,18 @@ namespace repl {
     static ServerStatusMetricField<TimerStats> displayOpBatchesApplied(
                                                     "repl.apply.batches",
                                                     &applyBatchStats );
+
+    // Number and time of each whole batch, from prefetching through writing the oplog
+    static TimerStats applyBatchLatencyStats;
+    static ServerStatusMetricField<TimerStats> displayBatchLatency(
+                                                    "repl.apply.batchLatency",
+                                                    &applyBatchLatencyStats );
+
+    // CRUD ops which could not be spread across writers by _id and were kept in namespace order
+    static Counter64 serializedOpsStats;
+    static ServerStatusMetricField<Counter64> displaySerializedOps( "repl.apply.serializedOps",
+                                                                    &serializedOpsStats );
+
     void initializePrefetchThread() {
         if (!ClientBasic::getCurrent()) {
             Client::initThreadIfNotAlready();
@@ -102,6 +117,36 @@ namespace repl {
             }
             return false;
         }
+
+        /**
+         * Returns true if CRUD ops on 'ns' must be applied in their oplog order relative to each
+         * other, rather than only in order per _id. This is the case for capped collections,
+         * where insertion order is observable, and for collections with a unique secondary
+         * index, where ops on different documents can conflict on the same key. A collection
+         * which does not exist yet is created during the batch, so we cannot tell and must be
+         * conservative.
+         */
+        bool mustApplyInNamespaceOrder(OperationContext* txn, StringData ns) {
+            ScopedTransaction transaction(txn, MODE_IS);
+            Lock::DBLock dbLock(txn->lockState(), nsToDatabaseSubstring(ns), MODE_IS);
+            Lock::CollectionLock collLock(txn->lockState(), ns, MODE_IS);
+
+            Database* db = dbHolder().get(txn, nsToDatabaseSubstring(ns));
+            Collection* collection = db ? db->getCollection(ns) : NULL;
+            if (!collection || collection->isCapped()) {
+                return true;
+            }
+
+            IndexCatalog::IndexIterator ii =
+                collection->getIndexCatalog()->getIndexIterator(txn, true);
+            while (ii.more()) {
+                const IndexDescriptor* desc = ii.next();
+                if (desc->unique() && !desc->isIdIndex()) {
+                    return true;
+                }
+            }
+            return false;
+        }
     }
 
     SyncTail::SyncTail(BackgroundSyncInterface *q, MultiSyncApplyFunc func) :
@@ -266,6 +311,7 @@ namespace repl {
 
     // Doles out all the work to the writer pool threads and waits for them to complete
     OpTime SyncTail::multiApply(OperationContext* txn, std::deque<BSONObj>& ops) {
+        TimerHolder batchTimer(&applyBatchLatencyStats);
 
         if (getGlobalServiceContext()->getGlobalStorageEngine()->isMmapV1()) {
             // Use a ThreadPool to prefetch all the operations in a batch.
@@ -275,7 +321,7 @@ namespace repl {
         std::vector< std::vector<BSONObj> > writerVectors(replWriterThreadCount);
         bool mustAwaitCommit = false;
 
-        fillWriterVectors(ops, &writerVectors, &mustAwaitCommit);
+        fillWriterVectors(txn, ops, &writerVectors, &mustAwaitCommit);
         LOG(2) << "replication batch size is " << ops.size() << endl;
         // We must grab this because we're going to grab write locks later.
         // We hold this mutex the entire time we're writing; it doesn't matter
@@ -316,10 +362,16 @@ namespace repl {
         return lastOpTime;
     }
 
-    void SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops,
+    void SyncTail::fillWriterVectors(OperationContext* txn,
+                                     const std::deque<BSONObj>& ops,
                                      std::vector< std::vector<BSONObj> >* writerVectors,
                                      bool* mustAwaitCommit) {
 
+        // Whether each namespace touched by the batch must keep its CRUD ops in oplog order.
+        // Commands and index builds are always applied in batches of their own (see
+        // tryPopAndWaitForMore), so the answer cannot change in the middle of a batch.
+        unordered_map<std::string, bool> namespaceOrdered;
+
         for (std::deque<BSONObj>::const_iterator it = ops.begin();
              it != ops.end();
              ++it) {
@@ -338,8 +390,7 @@ namespace repl {
                 *mustAwaitCommit = true;
             }
 
-            if (getGlobalServiceContext()->getGlobalStorageEngine()->supportsDocLocking() &&
-                isCrudOpType(opType)) {
+            if (isCrudOpType(opType)) {
                 BSONElement id;
                 switch (opType[0]) {
                 case 'u':
@@ -351,13 +402,28 @@ namespace repl {
                     break;
                 }
 
-                const size_t idHash = BSONElement::Hasher()( id );
-                MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
+                unordered_map<std::string, bool>::iterator ordered = namespaceOrdered.find(ns);
+                if (ordered == namespaceOrdered.end()) {
+                    ordered = namespaceOrdered.insert(
+                        std::make_pair(std::string(ns), mustApplyInNamespaceOrder(txn, ns))).first;
+                }
+
+                if (ordered->second || id.eoo()) {
+                    // Every op on this namespace goes to the same writer, in oplog order.
+                    serializedOpsStats.increment();
+                }
+                else {
+                    // Ops on distinct documents are independent; only the ops on one _id
+                    // need to stay ordered, so spread the namespace across the writers.
+                    const size_t idHash = BSONElement::Hasher()( id );
+                    MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
+                }
             }
 
             (*writerVectors)[hash % writerVectors->size()].push_back(*it);
         }
     }
+
     void SyncTail::oplogApplication(OperationContext* txn, const OpTime& endOpTime) {
         _applyOplogUntil(txn, endOpTime);
     }
@@ -124,9 +124,12 @@ namespace repl {
         // Doles out all the work to the writer pool threads and waits for them to complete
         void applyOps(const std::vector< std::vector<BSONObj> >& writerVectors);
 
+        // Partitions 'ops' across the writer vectors by namespace and, for CRUD ops on
+        // collections where that is safe, by _id as well.
         // mustAwaitCommit is an out-parameter and indicates that at least one of the ops
         // in 'ops' had j:true.
-        void fillWriterVectors(const std::deque<BSONObj>& ops, 
+        void fillWriterVectors(OperationContext* txn,
+                               const std::deque<BSONObj>& ops,
                                std::vector< std::vector<BSONObj> >* writerVectors,
                                bool* mustAwaitCommit);
         void handleSlaveDelay(const BSONObj& op);
@@ -42,6 +42,7 @@ namespace mongo {
             configsvr(false), cpu(false), objcheck(true), defaultProfile(0),
             slowMS(100), defaultLocalThresholdMillis(15), moveParanoia(true),
             noUnixSocket(false), doFork(0), socket("/tmp"), maxConns(DEFAULT_MAX_CONN), 
+            reactorNetworking(false), reactorWorkerThreads(0),
             unixSocketPermissions(DEFAULT_UNIX_PERMS), logAppend(false), logRenameOnRotate(true),
             logWithSyslog(false), isHttpInterfaceEnabled(false)
         {
@@ -84,6 +85,9 @@ namespace mongo {
 
         int maxConns;          // Maximum number of simultaneous open connections.
 
+        bool reactorNetworking;    // --connectionModel reactor
+        int reactorWorkerThreads;  // --reactorWorkerThreads, 0 picks a default
+
         int unixSocketPermissions; // permissions for the UNIX domain socket
 
         std::string keyFile;   // Path to keyfile, or empty if none.
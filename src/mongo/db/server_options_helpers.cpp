@@ -53,6 +53,7 @@
 #include "mongo/util/map_util.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/net/listen.h" // For DEFAULT_MAX_CONN
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/ssl_options.h"
 #include "mongo/util/options_parser/startup_options.h"
 
@@ -201,6 +202,19 @@ namespace {
         options->addOptionChaining("net.maxIncomingConnections", "maxConns", moe::Int,
                 maxConnInfoBuilder.str().c_str());
 
+        options->addOptionChaining("net.connectionModel", "connectionModel", moe::String,
+                "how client connections are serviced (threadPerConnection/reactor)")
+                                  .format("(:?threadPerConnection)|(:?reactor)",
+                                          "(threadPerConnection/reactor)");
+
+        options->addOptionChaining("net.reactorWorkerThreads", "reactorWorkerThreads", moe::Int,
+                "number of threads processing requests with connectionModel reactor");
+
+        options->addOptionChaining("net.compression.compressors", "networkMessageCompressors",
+                moe::String,
+                "comma separated list of compressors to use for network messages, most preferred "
+                "first (snappy,zlib/disabled)");
+
         options->addOptionChaining("logpath", "logpath", moe::String,
                 "log file to send write to instead of stdout - has to be a file, not directory")
                                   .setSources(moe::SourceAllLegacy)
@@ -754,6 +768,30 @@ namespace {
             }
         }
 
+        if (params.count("net.connectionModel")) {
+            serverGlobalParams.reactorNetworking =
+                params["net.connectionModel"].as<std::string>() == "reactor";
+        }
+
+        if (params.count("net.reactorWorkerThreads")) {
+            serverGlobalParams.reactorWorkerThreads =
+                params["net.reactorWorkerThreads"].as<int>();
+
+            if (serverGlobalParams.reactorWorkerThreads < 1) {
+                return Status(ErrorCodes::BadValue, "reactorWorkerThreads has to be at least 1");
+            }
+        }
+
+        if (params.count("net.compression.compressors")) {
+            std::vector<MessageCompressor> compressors;
+            Status status = parseMessageCompressors(
+                params["net.compression.compressors"].as<std::string>(), &compressors);
+            if (!status.isOK()) {
+                return status;
+            }
+            setMessageCompressors(compressors);
+        }
+
         if (params.count("net.wireObjectCheck")) {
             serverGlobalParams.objcheck = params["net.wireObjectCheck"].as<bool>();
         }
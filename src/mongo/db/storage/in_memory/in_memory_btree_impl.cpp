@@ -34,11 +34,12 @@
 
 #include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
-#include <set>
 
 #include "mongo/db/catalog/index_catalog_entry.h"
 #include "mongo/db/storage/index_entry_comparison.h"
 #include "mongo/db/storage/in_memory/in_memory_recovery_unit.h"
+#include "mongo/db/storage/in_memory/in_memory_versioned_map.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
@@ -51,6 +52,9 @@ namespace {
 
     const int TempKeyMaxSize = 1024; // this goes away with SERVER-3372
 
+    // Not counted in the key: the entry, its version bookkeeping and its node in the map.
+    const int64_t kEntryOverhead = sizeof(IndexKeyEntry) + 64;
+
     bool hasFieldNames(const BSONObj& obj) {
         BSONForEach(e, obj) {
             if (e.fieldName()[0])
@@ -70,7 +74,40 @@ namespace {
         return bb.obj();
     }
 
-    typedef std::set<IndexKeyEntry, IndexEntryComparison> IndexSet;
+    typedef InMemoryVersionedMap<IndexKeyEntry, IndexEntryComparison> IndexMap;
+
+    // This is the "persistent" data, shared by all of the instances for the same ident.
+    struct IndexData {
+        explicit IndexData(const Ordering& ordering)
+            : entries(boost::make_shared<IndexMap>(IndexEntryComparison(ordering))),
+              comparator(ordering) {
+        }
+
+        const shared_ptr<IndexMap> entries;
+        const IndexEntryComparison comparator;
+
+        // Updated as writes happen, like the counts of the record stores.
+        AtomicInt64 numEntries;
+        AtomicInt64 keyBytes;
+    };
+
+    class CountChange : public RecoveryUnit::Change {
+    public:
+        CountChange(const shared_ptr<IndexData>& data, int64_t numEntriesDiff, int64_t keyBytesDiff)
+            : _data(data), _numEntriesDiff(numEntriesDiff), _keyBytesDiff(keyBytesDiff) {
+        }
+
+        virtual void commit() {}
+        virtual void rollback() {
+            _data->numEntries.fetchAndSubtract(_numEntriesDiff);
+            _data->keyBytes.fetchAndSubtract(_keyBytesDiff);
+        }
+
+    private:
+        const shared_ptr<IndexData> _data;
+        const int64_t _numEntriesDiff;
+        const int64_t _keyBytesDiff;
+    };
 
     // taken from btree_logic.cpp
     Status dupKeyError(const BSONObj& key) {
@@ -81,23 +118,45 @@ namespace {
         return Status(ErrorCodes::DuplicateKey, sb.str());
     }
 
-    bool isDup(const IndexSet& data, const BSONObj& key, RecordId loc) {
-        const IndexSet::const_iterator it = data.find(IndexKeyEntry(key, RecordId()));
-        if (it == data.end())
-            return false;
+    Status memoryLimitError() {
+        return Status(ErrorCodes::ExceededMemoryLimit,
+                      "cannot add index key: the in-memory storage engine is full");
+    }
+
+    /**
+     * Returns true if the recovery unit of 'txn' sees an entry for 'key' with another RecordId
+     * than 'loc'.
+     */
+    bool isDup(OperationContext* txn, const IndexData& data, const BSONObj& key, RecordId loc) {
+        // A null RecordId compares equal to all others, so this probe finds the entries for
+        // 'key' in RecordId order.
+        IndexKeyEntry start(key, RecordId());
+        bool inclusive = true;
+        IndexMap::Entry entry(start, IndexMap::Version());
+        while (data.entries->next(txn, &start, inclusive, true, &entry)) {
+            if (data.comparator.compare(IndexKeyEntry(key, RecordId()), entry.first) != 0)
+                return false;
+
+            // Not a dup if the entry is for the same loc.
+            if (entry.first.loc != loc)
+                return true;
 
-        // Not a dup if the entry is for the same loc.
-        return it->loc != loc;
+            start = entry.first;
+            inclusive = false;
+        }
+        return false;
     }
 
     class InMemoryBtreeBuilderImpl : public SortedDataBuilderInterface {
     public:
-        InMemoryBtreeBuilderImpl(IndexSet* data, long long* currentKeySize, bool dupsAllowed)
-                : _data(data),
-                  _currentKeySize( currentKeySize ),
+        InMemoryBtreeBuilderImpl(OperationContext* txn,
+                                 IndexData* data,
+                                 bool dupsAllowed)
+                : _txn(txn),
+                  _data(data),
                   _dupsAllowed(dupsAllowed),
-                  _comparator(_data->key_comp()) {
-            invariant(_data->empty());
+                  _hasLast(false),
+                  _last(BSONObj(), RecordId()) {
         }
 
         Status addKey(const BSONObj& key, const RecordId& loc) {
@@ -110,44 +169,52 @@ namespace {
             invariant(loc.isNormal());
             invariant(!hasFieldNames(key));
 
-            if (!_data->empty()) {
+            if (_hasLast) {
                 // Compare specified key with last inserted key, ignoring its RecordId
-                int cmp = _comparator.compare(IndexKeyEntry(key, RecordId()), *_last);
-                if (cmp < 0 || (_dupsAllowed && cmp == 0 && loc < _last->loc)) {
+                int cmp = _data->comparator.compare(IndexKeyEntry(key, RecordId()), _last);
+                if (cmp < 0 || (_dupsAllowed && cmp == 0 && loc < _last.loc)) {
                     return Status(ErrorCodes::InternalError,
                                   "expected ascending (key, RecordId) order in bulk builder");
                 }
-                else if (!_dupsAllowed && cmp == 0 && loc != _last->loc) {
+                else if (!_dupsAllowed && cmp == 0 && loc != _last.loc) {
                     return dupKeyError(key);
                 }
             }
 
-            BSONObj owned = key.getOwned();
-            _last = _data->insert(_data->end(), IndexKeyEntry(owned, loc));
-            *_currentKeySize += key.objsize();
+            // Bulk loaded entries are visible to everyone right away, since nobody uses the
+            // index until the build is done.
+            const IndexKeyEntry entry(key.getOwned(), loc);
+            if (!_data->entries->insertCommitted(_txn, entry, SharedBuffer(), 0,
+                                                 key.objsize() + kEntryOverhead)) {
+                return memoryLimitError();
+            }
+            _data->numEntries.fetchAndAdd(1);
+            _data->keyBytes.fetchAndAdd(key.objsize());
 
+            _last = entry;
+            _hasLast = true;
             return Status::OK();
         }
 
     private:
-        IndexSet* const _data;
-        long long* _currentKeySize;
+        OperationContext* const _txn; // not owned
+        IndexData* const _data;
         const bool _dupsAllowed;
 
-        IndexEntryComparison _comparator;  // used by the bulk builder to detect duplicate keys
-        IndexSet::const_iterator _last;    // or (key, RecordId) ordering violations
+        bool _hasLast;          // used by the bulk builder to detect duplicate keys
+        IndexKeyEntry _last;    // or (key, RecordId) ordering violations
     };
 
     class InMemoryBtreeImpl : public SortedDataInterface {
     public:
-        InMemoryBtreeImpl(IndexSet* data)
+        InMemoryBtreeImpl(const shared_ptr<IndexData>& data)
             : _data(data) {
-            _currentKeySize = 0;
         }
 
         virtual SortedDataBuilderInterface* getBulkBuilder(OperationContext* txn,
                                                            bool dupsAllowed) {
-            return new InMemoryBtreeBuilderImpl(_data, &_currentKeySize, dupsAllowed);
+            invariant(isEmpty(txn));
+            return new InMemoryBtreeBuilderImpl(txn, _data.get(), dupsAllowed);
         }
 
         virtual Status insert(OperationContext* txn,
@@ -165,15 +232,24 @@ namespace {
                 return Status(ErrorCodes::KeyTooLong, msg);
             }
 
-            // TODO optimization: save the iterator from the dup-check to speed up insert
-            if (!dupsAllowed && isDup(*_data, key, loc))
+            if (!dupsAllowed && isDup(txn, *_data, key, loc))
                 return dupKeyError(key);
 
-            IndexKeyEntry entry(key.getOwned(), loc);
-            if ( _data->insert(entry).second ) {
-                _currentKeySize += key.objsize();
-                txn->recoveryUnit()->registerChange(new IndexChange(_data, entry, true));
+            const IndexKeyEntry entry(key.getOwned(), loc);
+            IndexMap::Version existing;
+            if (_data->entries->find(txn, entry, &existing))
+                return Status::OK();
+
+            // For unique indexes, the write also checks that nobody else is adding the same key
+            // concurrently, since the dup check above can't see uncommitted entries.
+            const IndexKeyEntry probe(entry.key, RecordId());
+            if (!_data->entries->write(txn, entry, SharedBuffer(), 0, false,
+                                       key.objsize() + kEntryOverhead,
+                                       dupsAllowed ? NULL : &probe)) {
+                return memoryLimitError();
             }
+
+            _changeCounts(txn, 1, key.objsize());
             return Status::OK();
         }
 
@@ -184,19 +260,27 @@ namespace {
             invariant(loc.isNormal());
             invariant(!hasFieldNames(key));
 
-            IndexKeyEntry entry(key.getOwned(), loc);
-            const size_t numDeleted = _data->erase(entry);
-            invariant(numDeleted <= 1);
-            if ( numDeleted == 1 ) {
-                _currentKeySize -= key.objsize();
-                txn->recoveryUnit()->registerChange(new IndexChange(_data, entry, false));
-            }
+            const IndexKeyEntry entry(key.getOwned(), loc);
+            IndexMap::Version existing;
+            if (!_data->entries->find(txn, entry, &existing))
+                return;
+
+            _data->entries->write(txn, entry, SharedBuffer(), 0, true, 0);
+            _changeCounts(txn, -1, -key.objsize());
         }
 
         virtual void fullValidate(OperationContext* txn, bool full, long long *numKeysOut,
                                   BSONObjBuilder* output) const {
             // TODO check invariants?
-            *numKeysOut = _data->size();
+            long long numKeys = 0;
+            const IndexKeyEntry* start = NULL;
+            IndexMap::Entry entry = IndexMap::Entry(IndexKeyEntry(BSONObj(), RecordId()),
+                                                    IndexMap::Version());
+            while (_data->entries->next(txn, start, false, true, &entry)) {
+                numKeys++;
+                start = &entry.first;
+            }
+            *numKeysOut = numKeys;
         }
 
         virtual bool appendCustomStats(OperationContext* txn, BSONObjBuilder* output, double scale)
@@ -205,18 +289,20 @@ namespace {
         }
 
         virtual long long getSpaceUsedBytes( OperationContext* txn ) const {
-            return _currentKeySize + ( sizeof(IndexKeyEntry) * _data->size() );
+            return _data->keyBytes.load() + kEntryOverhead * _data->numEntries.load();
         }
 
         virtual Status dupKeyCheck(OperationContext* txn, const BSONObj& key, const RecordId& loc) {
             invariant(!hasFieldNames(key));
-            if (isDup(*_data, key, loc))
+            if (isDup(txn, *_data, key, loc))
                 return dupKeyError(key);
             return Status::OK();
         }
 
         virtual bool isEmpty(OperationContext* txn) {
-            return _data->empty();
+            IndexMap::Entry entry = IndexMap::Entry(IndexKeyEntry(BSONObj(), RecordId()),
+                                                    IndexMap::Version());
+            return !_data->entries->next(txn, NULL, true, true, &entry);
         }
 
         virtual Status touch(OperationContext* txn) const{
@@ -224,38 +310,46 @@ namespace {
             return Status::OK();
         }
 
-        class ForwardCursor : public SortedDataInterface::Cursor {
+        /**
+         * Cursors don't hold on to anything in the map: each move seeks from the entry they are
+         * positioned at, so they survive concurrent writes without saving their position.
+         */
+        class Cursor : public SortedDataInterface::Cursor {
         public:
-            ForwardCursor(const IndexSet& data, OperationContext* txn)
+            Cursor(OperationContext* txn, const IndexData& data, bool forward)
                 : _txn(txn),
                   _data(data),
-                  _it(data.end())
+                  _forward(forward),
+                  _eof(true),
+                  _entry(BSONObj(), RecordId())
             {}
 
-            virtual int getDirection() const { return 1; }
+            virtual int getDirection() const { return _forward ? 1 : -1; }
 
             virtual bool isEOF() const {
-                return _it == _data.end();
+                return _eof;
             }
 
             virtual bool pointsToSamePlaceAs(const SortedDataInterface::Cursor& otherBase) const {
-                const ForwardCursor& other = static_cast<const ForwardCursor&>(otherBase);
+                const Cursor& other = static_cast<const Cursor&>(otherBase);
                 invariant(&_data == &other._data); // iterators over same index
-                return _it == other._it;
+                if (_eof || other._eof)
+                    return _eof == other._eof;
+                return _entry.loc == other._entry.loc && _entry.key.binaryEqual(other._entry.key);
             }
 
             virtual bool locate(const BSONObj& keyRaw, const RecordId& loc) {
                 const BSONObj key = stripFieldNames(keyRaw);
-                _it = _data.lower_bound(IndexKeyEntry(key, loc)); // lower_bound is >= key
-                if ( _it == _data.end() ) {
+                _seek(IndexKeyEntry(key, loc), true); // >= key for forward, <= key for reverse
+                if ( _eof ) {
                     return false;
                 }
 
-                if ( _it->key != key ) {
+                if ( _entry.key != key ) {
                     return false;
                 }
 
-                return _it->loc == loc;
+                return _entry.loc == loc;
             }
 
             virtual void customLocate(const BSONObj& keyBegin,
@@ -264,14 +358,14 @@ namespace {
                                       const vector<const BSONElement*>& keyEnd,
                                       const vector<bool>& keyEndInclusive) {
                 // makeQueryObject handles stripping of fieldnames for us.
-                _it = _data.lower_bound(IndexKeyEntry(IndexEntryComparison::makeQueryObject(
-                                                        keyBegin,
-                                                        keyBeginLen,
-                                                        afterKey,
-                                                        keyEnd,
-                                                        keyEndInclusive,
-                                                        1), // forward
-                                                   RecordId()));
+                _seek(IndexKeyEntry(IndexEntryComparison::makeQueryObject(keyBegin,
+                                                                          keyBeginLen,
+                                                                          afterKey,
+                                                                          keyEnd,
+                                                                          keyEndInclusive,
+                                                                          getDirection()),
+                                    RecordId()),
+                      true);
             }
 
             void advanceTo(const BSONObj &keyBegin,
@@ -284,178 +378,50 @@ namespace {
             }
 
             virtual BSONObj getKey() const {
-                return _it->key;
+                return _entry.key;
             }
 
             virtual RecordId getRecordId() const {
-                return _it->loc;
+                return _entry.loc;
             }
 
             virtual void advance() {
-                if (_it != _data.end())
-                    ++_it;
+                if (!_eof)
+                    _seek(_entry, false);
             }
 
             virtual void savePosition() {
-                if (_it == _data.end()) {
-                    _savedAtEnd = true;
-                    return;
-                }
-
-                _savedAtEnd = false;
-                _savedKey = _it->key.getOwned();
-                _savedLoc = _it->loc;
+                // _entry is all we need to find our place again.
             }
 
             virtual void restorePosition(OperationContext* txn) {
-                if (_savedAtEnd) {
-                    _it = _data.end();
-                }
-                else {
-                    locate(_savedKey, _savedLoc);
-                }
-            }
-
-        private:
+                _txn = txn;
 
-            OperationContext* _txn; // not owned
-            const IndexSet& _data;
-            IndexSet::const_iterator _it;
-
-            // For save/restorePosition since _it may be invalidated durring a yield.
-            bool _savedAtEnd;
-            BSONObj _savedKey;
-            RecordId _savedLoc;
-
-        };
-
-        // TODO see if this can share any code with ForwardIterator
-        class ReverseCursor : public SortedDataInterface::Cursor {
-        public:
-            ReverseCursor(const IndexSet& data, OperationContext* txn)
-                : _txn(txn),
-                  _data(data),
-                  _it(data.rend())
-            {}
-
-            virtual int getDirection() const { return -1; }
-
-            virtual bool isEOF() const {
-                return _it == _data.rend();
-            }
-
-            virtual bool pointsToSamePlaceAs(const SortedDataInterface::Cursor& otherBase) const {
-                const ReverseCursor& other = static_cast<const ReverseCursor&>(otherBase);
-                invariant(&_data == &other._data); // iterators over same index
-                return _it == other._it;
-            }
-
-            virtual bool locate(const BSONObj& keyRaw, const RecordId& loc) {
-                const BSONObj key = stripFieldNames(keyRaw);
-                _it = lower_bound(IndexKeyEntry(key, loc)); // lower_bound is <= query
-
-                if ( _it == _data.rend() ) {
-                    return false;
-                }
-
-
-                if ( _it->key != key ) {
-                    return false;
-                }
-
-                return _it->loc == loc;
-            }
-
-            virtual void customLocate(const BSONObj& keyBegin,
-                                      int keyBeginLen,
-                                      bool afterKey,
-                                      const vector<const BSONElement*>& keyEnd,
-                                      const vector<bool>& keyEndInclusive) {
-                // makeQueryObject handles stripping of fieldnames for us.
-                _it = lower_bound(IndexKeyEntry(IndexEntryComparison::makeQueryObject(
-                                                  keyBegin,
-                                                  keyBeginLen,
-                                                  afterKey,
-                                                  keyEnd,
-                                                  keyEndInclusive,
-                                                  -1), // reverse
-                                             RecordId()));
-            }
-
-            void advanceTo(const BSONObj &keyBegin,
-                           int keyBeginLen,
-                           bool afterKey,
-                           const vector<const BSONElement*>& keyEnd,
-                           const vector<bool>& keyEndInclusive) {
-                // XXX I think these do the same thing????
-                customLocate(keyBegin, keyBeginLen, afterKey, keyEnd, keyEndInclusive);
-            }
-
-            virtual BSONObj getKey() const {
-                return _it->key;
-            }
-
-            virtual RecordId getRecordId() const {
-                return _it->loc;
-            }
-
-            virtual void advance() {
-                if (_it != _data.rend())
-                    ++_it;
-            }
-
-            virtual void savePosition() {
-                if (_it == _data.rend()) {
-                    _savedAtEnd = true;
-                    return;
-                }
-
-                _savedAtEnd = false;
-                _savedKey = _it->key.getOwned();
-                _savedLoc = _it->loc;
-            }
-
-            virtual void restorePosition(OperationContext* txn) {
-                if (_savedAtEnd) {
-                    _it = _data.rend();
-                }
-                else {
-                    locate(_savedKey, _savedLoc);
-                }
+                // The entry we were at may be gone from our snapshot, in which case we move on to
+                // the next one.
+                if (!_eof)
+                    _seek(_entry, true);
             }
 
         private:
-            /**
-             * Returns the first entry <= query. This is equivalent to ForwardCursors use of
-             * _data.lower_bound which returns the first entry >= query.
-             */
-            IndexSet::const_reverse_iterator lower_bound(const IndexKeyEntry& query) const {
-                // using upper_bound since we want to the right-most entry matching the query.
-                IndexSet::const_iterator it = _data.upper_bound(query);
-
-                // upper_bound returns the entry to the right of the one we want. Helpfully,
-                // converting to a reverse_iterator moves one to the left. This also correctly
-                // handles the case where upper_bound returns end() by converting to rbegin(),
-                // meaning that all data is to the right of the query.
-                return IndexSet::const_reverse_iterator(it);
+            void _seek(const IndexKeyEntry& start, bool inclusive) {
+                IndexMap::Entry found(start, IndexMap::Version());
+                _eof = !_data.entries->next(_txn, &start, inclusive, _forward, &found);
+                if (!_eof)
+                    _entry = found.first;
             }
 
             OperationContext* _txn; // not owned
-            const IndexSet& _data;
-            IndexSet::const_reverse_iterator _it;
+            const IndexData& _data;
+            const bool _forward;
 
-            // For save/restorePosition since _it may be invalidated durring a yield.
-            bool _savedAtEnd;
-            BSONObj _savedKey;
-            RecordId _savedLoc;
+            bool _eof;
+            IndexKeyEntry _entry;
         };
 
         virtual SortedDataInterface::Cursor* newCursor(OperationContext* txn, int direction) const {
-            if (direction == 1)
-                return new ForwardCursor(*_data, txn);
-
-            invariant(direction == -1);
-            return new ReverseCursor(*_data, txn);
+            invariant(direction == 1 || direction == -1);
+            return new Cursor(txn, *_data, direction == 1);
         }
 
         virtual Status initAsEmpty(OperationContext* txn) {
@@ -464,28 +430,14 @@ namespace {
         }
 
     private:
-        class IndexChange : public RecoveryUnit::Change {
-        public:
-            IndexChange(IndexSet* data, const IndexKeyEntry& entry, bool insert)
-                : _data(data), _entry(entry), _insert(insert)
-            {}
-
-            virtual void commit() {}
-            virtual void rollback() {
-                if (_insert)
-                    _data->erase(_entry);
-                else
-                    _data->insert(_entry);
-            }
-
-        private:
-            IndexSet* _data;
-            const IndexKeyEntry _entry;
-            const bool _insert;
-        };
+        void _changeCounts(OperationContext* txn, int64_t numEntriesDiff, int64_t keyBytesDiff) {
+            _data->numEntries.fetchAndAdd(numEntriesDiff);
+            _data->keyBytes.fetchAndAdd(keyBytesDiff);
+            txn->recoveryUnit()->registerChange(
+                new CountChange(_data, numEntriesDiff, keyBytesDiff));
+        }
 
-        IndexSet* _data;
-        long long _currentKeySize;
+        const shared_ptr<IndexData> _data;
     };
 } // namespace
 
@@ -495,9 +447,9 @@ namespace {
                                               boost::shared_ptr<void>* dataInOut) {
         invariant(dataInOut);
         if (!*dataInOut) {
-            *dataInOut = boost::make_shared<IndexSet>(IndexEntryComparison(ordering));
+            *dataInOut = boost::make_shared<IndexData>(ordering);
         }
-        return new InMemoryBtreeImpl(static_cast<IndexSet*>(dataInOut->get()));
+        return new InMemoryBtreeImpl(boost::static_pointer_cast<IndexData>(*dataInOut));
     }
 
 }  // namespace mongo
@@ -30,14 +30,18 @@
 
 #include "mongo/db/storage/in_memory/in_memory_btree_impl.h"
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/storage/in_memory/in_memory_recovery_unit.h"
+#include "mongo/db/storage/in_memory/in_memory_version_clock.h"
 #include "mongo/db/storage/sorted_data_interface_test_harness.h"
 #include "mongo/unittest/unittest.h"
 
 namespace mongo {
 
+    using boost::scoped_ptr;
     using boost::shared_ptr;
 
     class InMemoryHarnessHelper : public HarnessHelper {
@@ -51,10 +55,11 @@ namespace mongo {
         }
 
         virtual RecoveryUnit* newRecoveryUnit() {
-            return new InMemoryRecoveryUnit();
+            return new InMemoryRecoveryUnit(&_clock);
         }
 
     private:
+        InMemoryVersionClock _clock;
         shared_ptr<void> _data; // used by InMemoryBtreeImpl
         Ordering _order;
     };
@@ -63,4 +68,26 @@ namespace mongo {
         return new InMemoryHarnessHelper();
     }
 
+    TEST(InMemoryBtreeImpl, ConcurrentUniqueInsertsConflict) {
+        scoped_ptr<HarnessHelper> harnessHelper(newHarnessHelper());
+        scoped_ptr<SortedDataInterface> sorted(harnessHelper->newSortedDataInterface(true));
+        scoped_ptr<OperationContext> first(harnessHelper->newOperationContext());
+        scoped_ptr<OperationContext> second(harnessHelper->newOperationContext());
+
+        const BSONObj key = BSON("" << 1);
+
+        WriteUnitOfWork firstUow(first.get());
+        ASSERT_OK(sorted->insert(first.get(), key, RecordId(1, 1), false));
+
+        // The first insert isn't visible to the dup key check of the second one, but the second
+        // one still can't succeed.
+        WriteUnitOfWork secondUow(second.get());
+        ASSERT_OK(sorted->dupKeyCheck(second.get(), key, RecordId(1, 2)));
+        ASSERT_THROWS(sorted->insert(second.get(), key, RecordId(1, 2), false),
+                      WriteConflictException);
+
+        // Other keys are fine.
+        ASSERT_OK(sorted->insert(second.get(), BSON("" << 2), RecordId(1, 2), false));
+    }
+
 }
@@ -32,13 +32,17 @@
 
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/storage/in_memory/in_memory_btree_impl.h"
-#include "mongo/db/storage/in_memory/in_memory_record_store.h"
 #include "mongo/db/storage/in_memory/in_memory_recovery_unit.h"
+#include "mongo/db/storage/in_memory/in_memory_versioned_record_store.h"
 
 namespace mongo {
 
+    InMemoryEngine::InMemoryEngine(int64_t maxBytes)
+        : _clock(maxBytes) {
+    }
+
     RecoveryUnit* InMemoryEngine::newRecoveryUnit() {
-        return new InMemoryRecoveryUnit();
+        return new InMemoryRecoveryUnit(&_clock);
     }
 
     Status InMemoryEngine::createRecordStore(OperationContext* opCtx,
@@ -55,14 +59,15 @@ namespace mongo {
                                              const CollectionOptions& options) {
         boost::lock_guard<boost::mutex> lk(_mutex);
         if (options.capped) {
-            return new InMemoryRecordStore(ns,
-                                           &_dataMap[ident],
-                                           true,
-                                           options.cappedSize ? options.cappedSize : 4096,
-                                           options.cappedMaxDocs ? options.cappedMaxDocs : -1);
+            return new InMemoryVersionedRecordStore(
+                ns,
+                &_dataMap[ident],
+                true,
+                options.cappedSize ? options.cappedSize : 4096,
+                options.cappedMaxDocs ? options.cappedMaxDocs : -1);
         }
         else {
-            return new InMemoryRecordStore(ns, &_dataMap[ident]);
+            return new InMemoryVersionedRecordStore(ns, &_dataMap[ident]);
         }
     }
 
@@ -33,13 +33,23 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 
+#include "mongo/db/storage/in_memory/in_memory_version_clock.h"
 #include "mongo/db/storage/kv/kv_engine.h"
 #include "mongo/util/string_map.h"
 
 namespace mongo {
 
+    /**
+     * Keeps all data in versioned maps, which give readers a snapshot and let writers of
+     * different documents proceed concurrently.
+     */
     class InMemoryEngine : public KVEngine {
     public:
+        /**
+         * 'maxBytes' limits the memory used by the data. 0 means no limit.
+         */
+        explicit InMemoryEngine(int64_t maxBytes = 0);
+
         virtual RecoveryUnit* newRecoveryUnit();
 
         virtual Status createRecordStore( OperationContext* opCtx,
@@ -63,7 +73,7 @@ namespace mongo {
         virtual Status dropIdent( OperationContext* opCtx,
                                   StringData ident );
 
-        virtual bool supportsDocLocking() const { return false; }
+        virtual bool supportsDocLocking() const { return true; }
 
         virtual bool supportsDirectoryPerDB() const { return false; }
 
@@ -90,6 +100,8 @@ namespace mongo {
     private:
         typedef StringMap<boost::shared_ptr<void> > DataMap;
 
+        InMemoryVersionClock _clock;
+
         mutable boost::mutex _mutex;
         DataMap _dataMap; // All actual data is owned in here
     };
@@ -30,6 +30,7 @@
  */
 
 #include "mongo/base/init.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/in_memory/in_memory_engine.h"
 #include "mongo/db/storage/kv/kv_storage_engine.h"
@@ -39,6 +40,9 @@ namespace mongo {
 
     namespace {
 
+        // The limit on the memory used by the data of the engine. 0 means no limit.
+        MONGO_EXPORT_STARTUP_SERVER_PARAMETER(inMemoryMaxSizeMB, int, 0);
+
         class InMemoryFactory : public StorageEngine::Factory {
         public:
             virtual ~InMemoryFactory() { }
@@ -47,7 +51,8 @@ namespace mongo {
                 KVStorageEngineOptions options;
                 options.directoryPerDB = params.directoryperdb;
                 options.forRepair = params.repair;
-                return new KVStorageEngine(new InMemoryEngine(), options);
+                const int64_t maxBytes = static_cast<int64_t>(inMemoryMaxSizeMB) * 1024 * 1024;
+                return new KVStorageEngine(new InMemoryEngine(maxBytes), options);
             }
 
             virtual StringData getCanonicalName() const {
@@ -292,6 +292,44 @@ namespace mongo {
         return StatusWith<RecordId>(loc);
     }
 
+    Status InMemoryRecordStore::insertRecords(OperationContext* txn,
+                                              const std::vector<RecordData>& records,
+                                              std::vector<RecordId>* locsOut,
+                                              bool enforceQuota) {
+        for (size_t i = 0; i < records.size(); i++) {
+            const int len = records[i].size();
+            if (_isCapped && len > _cappedMaxSize) {
+                return Status(ErrorCodes::BadValue, "object to insert exceeds cappedMaxSize");
+            }
+
+            InMemoryRecord rec(len);
+            memcpy(rec.data.get(), records[i].data(), len);
+
+            RecordId loc;
+            if (_data->isOplog) {
+                StatusWith<RecordId> status = extractAndCheckLocForOplog(records[i].data(), len);
+                if (!status.isOK())
+                    return status.getStatus();
+                loc = status.getValue();
+            }
+            else {
+                loc = allocateLoc();
+            }
+
+            txn->recoveryUnit()->registerChange(new InsertChange(_data, loc));
+            _data->dataSize += len;
+            // New RecordIds are higher than all existing ones, so hint at the end of the map.
+            _data->records.insert(_data->records.end(), Records::value_type(loc, rec));
+            locsOut->push_back(loc);
+
+            // Delete as needed after each record, as single inserts do.  Deleting once for the
+            // whole batch could remove earlier records of it before the caller has indexed them.
+            cappedDeleteAsNeeded(txn);
+        }
+
+        return Status::OK();
+    }
+
     StatusWith<RecordId> InMemoryRecordStore::updateRecord(OperationContext* txn,
                                                           const RecordId& loc,
                                                           const char* data,
@@ -308,8 +346,8 @@ namespace mongo {
         }
 
         if (notifier) {
-            // The in-memory KV engine uses the invalidation framework (does not support
-            // doc-locking), and therefore must notify that it is updating a document.
+            // This store uses the invalidation framework (does not support doc-locking), and
+            // therefore must notify that it is updating a document.
             Status callbackStatus = notifier->recordStoreGoingToUpdateInPlace(txn, loc);
             if (!callbackStatus.isOK()) {
                 return StatusWith<RecordId>(callbackStatus);
@@ -589,6 +627,21 @@ namespace mongo {
         return _rs.dataFor(_txn, loc);
     }
 
+    size_t InMemoryRecordIterator::getNextBatch(size_t maxRecords,
+                                                std::vector<RecordIdAndData>* out) {
+        size_t n = 0;
+        for (; n < maxRecords && !isEOF(); ++n) {
+            RecordIdAndData record;
+            record.id = _it->first;
+            record.data = _it->second.toRecordData();
+            out->push_back(record);
+            ++_it;
+        }
+        if (n > 0 && _tailable && isEOF())
+            _lastLoc = out->back().id;
+        return n;
+    }
+
     //
     // Reverse Iterator
     //
@@ -674,4 +727,17 @@ namespace mongo {
         return _rs.dataFor(_txn, loc);
     }
 
+    size_t InMemoryRecordReverseIterator::getNextBatch(size_t maxRecords,
+                                                       std::vector<RecordIdAndData>* out) {
+        size_t n = 0;
+        for (; n < maxRecords && !isEOF(); ++n) {
+            RecordIdAndData record;
+            record.id = _it->first;
+            record.data = _it->second.toRecordData();
+            out->push_back(record);
+            ++_it;
+        }
+        return n;
+    }
+
 } // namespace mongo
@@ -42,7 +42,9 @@ namespace mongo {
     class InMemoryRecordIterator;
 
     /**
-     * A RecordStore that stores all data in-memory.
+     * A RecordStore that stores all data in-memory. Changes are visible to everyone as they are
+     * made, so it relies on the invalidation framework rather than document level locking. The
+     * in-memory storage engine uses InMemoryVersionedRecordStore instead.
      *
      * @param cappedMaxSize - required if isCapped. limit uses dataSize() in this impl.
      */
@@ -72,6 +74,11 @@ namespace mongo {
                                                   const DocWriter* doc,
                                                   bool enforceQuota );
 
+        virtual Status insertRecords( OperationContext* txn,
+                                      const std::vector<RecordData>& records,
+                                      std::vector<RecordId>* locsOut,
+                                      bool enforceQuota );
+
         virtual StatusWith<RecordId> updateRecord( OperationContext* txn,
                                                   const RecordId& oldLocation,
                                                   const char* data,
@@ -213,6 +220,10 @@ namespace mongo {
 
         virtual RecordData dataFor( const RecordId& loc ) const;
 
+        virtual size_t getNextBatch( size_t maxRecords, std::vector<RecordIdAndData>* out );
+
+        virtual bool hasNativeBatches() const { return true; }
+
     private:
         OperationContext* _txn; // not owned
         InMemoryRecordStore::Records::const_iterator _it;
@@ -245,6 +256,10 @@ namespace mongo {
 
         virtual RecordData dataFor( const RecordId& loc ) const;
 
+        virtual size_t getNextBatch( size_t maxRecords, std::vector<RecordIdAndData>* out );
+
+        virtual bool hasNativeBatches() const { return true; }
+
     private:
         OperationContext* _txn; // not owned
         InMemoryRecordStore::Records::const_reverse_iterator _it;
@@ -33,6 +33,7 @@
 #include <boost/shared_ptr.hpp>
 
 #include "mongo/db/storage/in_memory/in_memory_recovery_unit.h"
+#include "mongo/db/storage/in_memory/in_memory_version_clock.h"
 #include "mongo/db/storage/record_store_test_harness.h"
 #include "mongo/unittest/unittest.h"
 
@@ -48,9 +49,10 @@ namespace mongo {
         }
 
         virtual RecoveryUnit* newRecoveryUnit() {
-            return new InMemoryRecoveryUnit();
+            return new InMemoryRecoveryUnit(&_clock);
         }
 
+        InMemoryVersionClock _clock;
         boost::shared_ptr<void> data;
     };
 
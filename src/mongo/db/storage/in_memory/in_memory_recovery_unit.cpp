@@ -32,12 +32,31 @@
 
 #include "mongo/db/storage/in_memory/in_memory_recovery_unit.h"
 
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/base/checked_cast.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/storage/in_memory/in_memory_version_clock.h"
 #include "mongo/db/storage/sorted_data_interface.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
+    InMemoryRecoveryUnit::InMemoryRecoveryUnit(InMemoryVersionClock* clock)
+        : _clock(clock),
+          _depth(0),
+          _hasSnapshot(false),
+          _snapshot(0),
+          _mySnapshotId(1) {
+        invariant(_clock);
+    }
+
     InMemoryRecoveryUnit::~InMemoryRecoveryUnit() {
         invariant(_depth == 0);
+        _abort();
+    }
+
+    InMemoryRecoveryUnit* InMemoryRecoveryUnit::get(OperationContext* txn) {
+        return checked_cast<InMemoryRecoveryUnit*>(txn->recoveryUnit());
     }
 
     void InMemoryRecoveryUnit::beginUnitOfWork(OperationContext* opCtx) {
@@ -48,30 +67,91 @@ namespace mongo {
         if ( _depth > 1 )
             return;
 
+        _commit();
+    }
+
+    void InMemoryRecoveryUnit::endUnitOfWork() {
+         _depth--;
+         if (_depth > 0 )
+             return;
+
+         _abort();
+    }
+
+    void InMemoryRecoveryUnit::commitAndRestart() {
+        invariant( _depth == 0 );
+        _abort();
+    }
+
+    void InMemoryRecoveryUnit::registerWrite(VersionedWrite* write) {
+        _writes.push_back(WritePtr(write));
+    }
+
+    uint64_t InMemoryRecoveryUnit::getSnapshot() {
+        if (!_hasSnapshot) {
+            _snapshot = _clock->openSnapshot();
+            _hasSnapshot = true;
+        }
+        return _snapshot;
+    }
+
+    void InMemoryRecoveryUnit::_releaseSnapshot() {
+        if (!_hasSnapshot)
+            return;
+
+        _clock->closeSnapshot(_snapshot);
+        _hasSnapshot = false;
+        _mySnapshotId++;
+    }
+
+    void InMemoryRecoveryUnit::_commit() {
         try {
+            if (!_writes.empty()) {
+                boost::lock_guard<boost::mutex> lk(_clock->getCommitMutex());
+                const uint64_t timestamp = _clock->getLastCommitted() + 1;
+                for (Writes::iterator it = _writes.begin(), end = _writes.end(); it != end; ++it) {
+                    (*it)->commit(timestamp);
+                }
+                _clock->setLastCommitted(timestamp);
+            }
+
             for (Changes::iterator it = _changes.begin(), end = _changes.end(); it != end; ++it) {
                 (*it)->commit();
             }
             _changes.clear();
+
+            _releaseSnapshot();
+
+            if (!_writes.empty()) {
+                const uint64_t oldestSnapshot = _clock->getOldestSnapshot();
+                for (Writes::iterator it = _writes.begin(), end = _writes.end(); it != end; ++it) {
+                    (*it)->collectGarbage(oldestSnapshot);
+                }
+                _writes.clear();
+            }
         }
         catch (...) {
             std::terminate();
         }
     }
 
-    void InMemoryRecoveryUnit::endUnitOfWork() {
-         _depth--;
-         if (_depth > 0 )
-             return;
+    void InMemoryRecoveryUnit::_abort() {
+        try {
+            for (Writes::reverse_iterator it = _writes.rbegin(), end = _writes.rend();
+                    it != end; ++it) {
+                (*it)->rollback();
+            }
+            _writes.clear();
+
+            for (Changes::reverse_iterator it = _changes.rbegin(), end = _changes.rend();
+                    it != end; ++it) {
+                ChangePtr change = *it;
+                LOG(2) << "CUSTOM ROLLBACK " << demangleName(typeid(*change));
+                change->rollback();
+            }
+            _changes.clear();
 
-         try {
-             for (Changes::reverse_iterator it = _changes.rbegin(), end = _changes.rend();
-                     it != end; ++it) {
-                 ChangePtr change = *it;
-                 LOG(2) << "CUSTOM ROLLBACK " << demangleName(typeid(*change));
-                 change->rollback();
-             }
-             _changes.clear();
+            _releaseSnapshot();
         }
         catch (...) {
             std::terminate();
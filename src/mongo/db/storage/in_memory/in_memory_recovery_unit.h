@@ -35,14 +35,24 @@
 
 #include "mongo/db/record_id.h"
 #include "mongo/db/storage/recovery_unit.h"
+#include "mongo/platform/cstdint.h"
 
 namespace mongo {
 
-    class SortedDataInterface;
-
+    class InMemoryVersionClock;
+    class OperationContext;
+
+    /**
+     * Reads from a snapshot of the committed data, which is taken by the first read or write and
+     * kept until the unit of work commits or aborts, or commitAndRestart() is called.
+     *
+     * Writes add versions to the versioned data that only this unit of work sees until it
+     * commits. They are stamped with a commit timestamp all at once, so other units of work see
+     * either all or none of them.
+     */
     class InMemoryRecoveryUnit : public RecoveryUnit {
     public:
-        InMemoryRecoveryUnit() : _depth(0) {}
+        explicit InMemoryRecoveryUnit(InMemoryVersionClock* clock);
         virtual ~InMemoryRecoveryUnit();
 
         virtual void beginUnitOfWork(OperationContext* opCtx);
@@ -53,7 +63,7 @@ namespace mongo {
             return true;
         }
 
-        virtual void commitAndRestart() {}
+        virtual void commitAndRestart();
 
         virtual void registerChange(Change* change) {
             _changes.push_back(ChangePtr(change));
@@ -65,14 +75,59 @@ namespace mongo {
 
         virtual void setRollbackWritesDisabled() {}
 
-        virtual SnapshotId getSnapshotId() const { return SnapshotId(); }
+        virtual SnapshotId getSnapshotId() const { return SnapshotId(_mySnapshotId); }
+
+        /**
+         * A version written by this unit of work, which it stamps when it commits and removes
+         * when it rolls back.
+         */
+        class VersionedWrite {
+        public:
+            virtual ~VersionedWrite() {}
+
+            virtual void commit(uint64_t timestamp) = 0;
+            virtual void rollback() = 0;
+
+            /**
+             * Called after the commit to drop versions older than 'oldestSnapshot' can see.
+             */
+            virtual void collectGarbage(uint64_t oldestSnapshot) = 0;
+        };
+
+        /**
+         * Takes ownership of 'write'.
+         */
+        void registerWrite(VersionedWrite* write);
+
+        /**
+         * Returns the snapshot this unit of work reads from, taking one if needed.
+         */
+        uint64_t getSnapshot();
+
+        InMemoryVersionClock* getClock() const { return _clock; }
+
+        static InMemoryRecoveryUnit* get(OperationContext* txn);
 
     private:
+        void _commit();
+        void _abort();
+        void _releaseSnapshot();
+
         typedef boost::shared_ptr<Change> ChangePtr;
         typedef std::vector<ChangePtr> Changes;
 
+        typedef boost::shared_ptr<VersionedWrite> WritePtr;
+        typedef std::vector<WritePtr> Writes;
+
+        InMemoryVersionClock* const _clock; // not owned
+
         int _depth;
         Changes _changes;
+        Writes _writes;
+
+        bool _hasSnapshot;
+        uint64_t _snapshot;
+        uint64_t _mySnapshotId;
     };
 
 }
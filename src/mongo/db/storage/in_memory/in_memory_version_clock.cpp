@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_version_clock.h"
+
+#include <boost/thread/locks.hpp>
+
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    InMemoryVersionClock::InMemoryVersionClock(int64_t maxBytes)
+        : _maxBytes(maxBytes),
+          _lastCommitted(0) {
+    }
+
+    uint64_t InMemoryVersionClock::openSnapshot() {
+        boost::lock_guard<boost::mutex> lk(_snapshotMutex);
+        _openSnapshots.insert(_lastCommitted);
+        return _lastCommitted;
+    }
+
+    void InMemoryVersionClock::closeSnapshot(uint64_t snapshot) {
+        boost::lock_guard<boost::mutex> lk(_snapshotMutex);
+        std::multiset<uint64_t>::iterator it = _openSnapshots.find(snapshot);
+        invariant(it != _openSnapshots.end());
+        _openSnapshots.erase(it);
+    }
+
+    uint64_t InMemoryVersionClock::getOldestSnapshot() const {
+        boost::lock_guard<boost::mutex> lk(_snapshotMutex);
+        if (_openSnapshots.empty())
+            return _lastCommitted;
+        return *_openSnapshots.begin();
+    }
+
+    uint64_t InMemoryVersionClock::getLastCommitted() const {
+        boost::lock_guard<boost::mutex> lk(_snapshotMutex);
+        return _lastCommitted;
+    }
+
+    void InMemoryVersionClock::setLastCommitted(uint64_t timestamp) {
+        boost::lock_guard<boost::mutex> lk(_snapshotMutex);
+        invariant(timestamp > _lastCommitted);
+        _lastCommitted = timestamp;
+    }
+
+    bool InMemoryVersionClock::tryReserve(int64_t bytes) {
+        // Concurrent reservations may overshoot the limit a little, which is fine for a cap on
+        // memory use.
+        if (_maxBytes > 0 && _bytesInUse.load() + bytes > _maxBytes)
+            return false;
+        _bytesInUse.fetchAndAdd(bytes);
+        return true;
+    }
+
+    void InMemoryVersionClock::release(int64_t bytes) {
+        _bytesInUse.fetchAndSubtract(bytes);
+    }
+
+}  // namespace mongo
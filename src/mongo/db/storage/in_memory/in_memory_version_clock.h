@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <set>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    /**
+     * Engine-wide state shared by all of the versioned data of an InMemoryEngine.
+     *
+     * Every commit is stamped with a timestamp from this clock, and every unit of work reads from
+     * a snapshot, which is the timestamp of the last commit when it started reading. The clock
+     * tracks the open snapshots so that versions no snapshot can see anymore can be dropped. It
+     * also accounts for the memory used by the data, which may be capped.
+     */
+    class InMemoryVersionClock {
+        MONGO_DISALLOW_COPYING(InMemoryVersionClock);
+    public:
+        /**
+         * 'maxBytes' is the limit on the memory used by the data. 0 means no limit.
+         */
+        explicit InMemoryVersionClock(int64_t maxBytes = 0);
+
+        /**
+         * Returns the timestamp of the newest commit, which stays visible to the caller until it
+         * calls closeSnapshot() with it.
+         */
+        uint64_t openSnapshot();
+
+        void closeSnapshot(uint64_t snapshot);
+
+        /**
+         * Returns the oldest snapshot anyone can be reading from.
+         */
+        uint64_t getOldestSnapshot() const;
+
+        uint64_t getLastCommitted() const;
+
+        /**
+         * Commits are stamped and published while holding this mutex, which orders them.
+         */
+        boost::mutex& getCommitMutex() { return _commitMutex; }
+
+        /**
+         * Makes the commit at 'timestamp' visible to new snapshots. The caller must hold the
+         * commit mutex.
+         */
+        void setLastCommitted(uint64_t timestamp);
+
+        /**
+         * Accounts for 'bytes' more memory. Returns false without doing so if that would exceed
+         * the limit.
+         */
+        bool tryReserve(int64_t bytes);
+
+        void release(int64_t bytes);
+
+        int64_t getBytesInUse() const { return _bytesInUse.load(); }
+        int64_t getMaxBytes() const { return _maxBytes; }
+
+    private:
+        const int64_t _maxBytes;
+        AtomicInt64 _bytesInUse;
+
+        boost::mutex _commitMutex;
+
+        // Protects everything below.
+        mutable boost::mutex _snapshotMutex;
+        uint64_t _lastCommitted;
+        std::multiset<uint64_t> _openSnapshots;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,421 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/storage/in_memory/in_memory_recovery_unit.h"
+#include "mongo/db/storage/in_memory/in_memory_version_clock.h"
+#include "mongo/util/shared_buffer.h"
+
+namespace mongo {
+
+    /**
+     * An ordered map which keeps multiple versions of the value of each key, so that units of
+     * work can read a consistent snapshot while others write.
+     *
+     * Each key has a chain of versions, newest first. A version written by a unit of work is
+     * only visible to it until it commits, and then to the snapshots taken after the commit.
+     * Removing a key writes a deleted version. Writing a key which another unit of work has
+     * written since our snapshot throws a WriteConflictException, which gives document level
+     * concurrency control. Versions which no open snapshot can see are dropped after commits.
+     *
+     * The map is latched for the duration of each operation only, and doesn't hand out
+     * iterators: readers remember the last key they saw and seek past it for the next one.
+     *
+     * Instances must be owned by a boost::shared_ptr, since the writes of a unit of work keep the
+     * map alive until it commits or rolls back.
+     */
+    template <typename Key, typename Compare>
+    class InMemoryVersionedMap
+        : public boost::enable_shared_from_this<InMemoryVersionedMap<Key, Compare> > {
+        MONGO_DISALLOW_COPYING(InMemoryVersionedMap);
+    public:
+        struct Version {
+            Version() : timestamp(0), owner(NULL), size(0), bytes(0), deleted(false) {}
+
+            // The commit timestamp. Only meaningful once committed.
+            uint64_t timestamp;
+
+            // The unit of work which wrote this version, or NULL once it committed.
+            const InMemoryRecoveryUnit* owner;
+
+            SharedBuffer data;
+            int size;
+
+            // The memory accounted for this version.
+            int64_t bytes;
+
+            bool deleted;
+        };
+
+        typedef std::pair<Key, Version> Entry;
+
+        explicit InMemoryVersionedMap(const Compare& compare = Compare())
+            : _map(compare) {
+        }
+
+        /**
+         * Returns true and sets 'out' to the version of 'key' the unit of work of 'txn' sees, if
+         * it sees one which isn't deleted.
+         */
+        bool find(OperationContext* txn, const Key& key, Version* out) const {
+            InMemoryRecoveryUnit* ru = InMemoryRecoveryUnit::get(txn);
+            const uint64_t snapshot = ru->getSnapshot();
+
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            typename Map::const_iterator it = _map.find(key);
+            if (it == _map.end())
+                return false;
+
+            const Version* version = _visible(it->second, ru, snapshot);
+            if (!version || version->deleted)
+                return false;
+
+            *out = *version;
+            return true;
+        }
+
+        /**
+         * Returns true and sets 'out' to the first entry the unit of work of 'txn' sees after
+         * 'start' in the direction of the scan, or at 'start' if 'inclusive'. A NULL 'start'
+         * begins at the first entry in the direction of the scan.
+         */
+        bool next(OperationContext* txn, const Key* start, bool inclusive, bool forward,
+                  Entry* out) const {
+            std::vector<Entry> entries;
+            if (!nextBatch(txn, start, inclusive, forward, 1, &entries))
+                return false;
+
+            *out = entries.front();
+            return true;
+        }
+
+        /**
+         * Like next(), but appends up to 'maxEntries' consecutive entries to 'out'. Returns the
+         * number of entries appended.
+         *
+         * If 'stopAtInvisible', stops at the first key which has versions but none the unit of
+         * work sees yet, which is how capped collections keep readers from skipping over
+         * records which are committing out of order.
+         */
+        size_t nextBatch(OperationContext* txn, const Key* start, bool inclusive, bool forward,
+                         size_t maxEntries, std::vector<Entry>* out,
+                         bool stopAtInvisible = false) const {
+            InMemoryRecoveryUnit* ru = InMemoryRecoveryUnit::get(txn);
+            const uint64_t snapshot = ru->getSnapshot();
+
+            size_t found = 0;
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            for (typename Map::const_iterator it = _seek(start, inclusive, forward);
+                    it != _map.end() && found < maxEntries;
+                    it = _step(it, forward)) {
+                const Version* version = _visible(it->second, ru, snapshot);
+                if (!version && stopAtInvisible)
+                    break;
+                if (!version || version->deleted)
+                    continue;
+
+                out->push_back(Entry(it->first, *version));
+                found++;
+            }
+            return found;
+        }
+
+        /**
+         * Adds a new version of 'key' for the unit of work of 'txn', or removes 'key' if
+         * 'deleted'. 'bytes' is the memory to account for the version.
+         *
+         * Throws a WriteConflictException if another unit of work wrote 'key' and either hasn't
+         * committed or committed after our snapshot. If 'conflictProbe' is given, the same goes
+         * for every key equivalent to it, which is checked in the same critical section as the
+         * write so that concurrent writers of equivalent keys can't both succeed.
+         *
+         * Returns false without writing if the version doesn't fit in the memory limit.
+         */
+        bool write(OperationContext* txn,
+                   const Key& key,
+                   const SharedBuffer& data,
+                   int size,
+                   bool deleted,
+                   int64_t bytes,
+                   const Key* conflictProbe = NULL) {
+            InMemoryRecoveryUnit* ru = InMemoryRecoveryUnit::get(txn);
+            const uint64_t snapshot = ru->getSnapshot();
+            InMemoryVersionClock* clock = ru->getClock();
+
+            if (deleted)
+                bytes = 0;
+            else if (!clock->tryReserve(bytes))
+                return false;
+
+            bool isNewVersion = true;
+            {
+                boost::lock_guard<boost::mutex> lk(_mutex);
+                if (conflictProbe) {
+                    for (typename Map::const_iterator it = _map.lower_bound(*conflictProbe);
+                            it != _map.end() && !_map.key_comp()(*conflictProbe, it->first);
+                            ++it) {
+                        if (_conflicts(it->second.front(), ru, snapshot)) {
+                            clock->release(bytes);
+                            throw WriteConflictException();
+                        }
+                    }
+                }
+
+                typename Map::iterator it = _map.find(key);
+                if (it == _map.end()) {
+                    it = _map.insert(std::make_pair(key, Chain())).first;
+                }
+                else if (it->second.front().owner == ru) {
+                    // We already have a version of this key, so replace it.
+                    Version& head = it->second.front();
+                    clock->release(head.bytes);
+                    head.data = data;
+                    head.size = size;
+                    head.bytes = bytes;
+                    head.deleted = deleted;
+                    isNewVersion = false;
+                }
+                else if (_conflicts(it->second.front(), ru, snapshot)) {
+                    clock->release(bytes);
+                    throw WriteConflictException();
+                }
+
+                if (isNewVersion) {
+                    Version version;
+                    version.owner = ru;
+                    version.data = data;
+                    version.size = size;
+                    version.bytes = bytes;
+                    version.deleted = deleted;
+                    it->second.push_front(version);
+                }
+            }
+
+            if (isNewVersion) {
+                ru->registerWrite(new Write(this->shared_from_this(), key, ru, clock));
+            }
+            return true;
+        }
+
+        /**
+         * Adds a version of 'key' which is visible to everyone right away, for bulk loading.
+         * Returns false if it doesn't fit in the memory limit.
+         */
+        bool insertCommitted(OperationContext* txn,
+                             const Key& key,
+                             const SharedBuffer& data,
+                             int size,
+                             int64_t bytes) {
+            InMemoryVersionClock* clock = InMemoryRecoveryUnit::get(txn)->getClock();
+            if (!clock->tryReserve(bytes))
+                return false;
+
+            Version version;
+            version.data = data;
+            version.size = size;
+            version.bytes = bytes;
+
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            Chain& chain = _map[key];
+            if (!chain.empty())
+                clock->release(chain.front().bytes);
+            chain.clear();
+            chain.push_front(version);
+            return true;
+        }
+
+    private:
+        typedef std::list<Version> Chain;
+        typedef std::map<Key, Chain, Compare> Map;
+
+        /**
+         * Stamps, unlinks or garbage collects the version of a key written by a unit of work.
+         */
+        class Write : public InMemoryRecoveryUnit::VersionedWrite {
+        public:
+            Write(const boost::shared_ptr<InMemoryVersionedMap>& map,
+                  const Key& key,
+                  const InMemoryRecoveryUnit* owner,
+                  InMemoryVersionClock* clock)
+                : _map(map), _key(key), _owner(owner), _clock(clock) {
+            }
+
+            virtual void commit(uint64_t timestamp) {
+                _map->_commitVersion(_key, _owner, timestamp);
+            }
+
+            virtual void rollback() {
+                _map->_rollbackVersion(_key, _owner, _clock);
+            }
+
+            virtual void collectGarbage(uint64_t oldestSnapshot) {
+                _map->_collectGarbage(oldestSnapshot, _clock);
+            }
+
+        private:
+            const boost::shared_ptr<InMemoryVersionedMap> _map;
+            const Key _key;
+            const InMemoryRecoveryUnit* const _owner;
+            InMemoryVersionClock* const _clock;
+        };
+
+        static const Version* _visible(const Chain& chain,
+                                       const InMemoryRecoveryUnit* ru,
+                                       uint64_t snapshot) {
+            for (typename Chain::const_iterator it = chain.begin(); it != chain.end(); ++it) {
+                if (it->owner == ru)
+                    return &*it;
+                if (!it->owner && it->timestamp <= snapshot)
+                    return &*it;
+            }
+            return NULL;
+        }
+
+        static bool _conflicts(const Version& head,
+                               const InMemoryRecoveryUnit* ru,
+                               uint64_t snapshot) {
+            if (head.owner)
+                return head.owner != ru;
+            return head.timestamp > snapshot;
+        }
+
+        typename Map::const_iterator _seek(const Key* start, bool inclusive, bool forward) const {
+            if (forward) {
+                if (!start)
+                    return _map.begin();
+                return inclusive ? _map.lower_bound(*start) : _map.upper_bound(*start);
+            }
+
+            // The entry before the first one after (or at, if exclusive) 'start'.
+            typename Map::const_iterator it = _map.end();
+            if (start)
+                it = inclusive ? _map.upper_bound(*start) : _map.lower_bound(*start);
+            if (it == _map.begin())
+                return _map.end();
+            return --it;
+        }
+
+        typename Map::const_iterator _step(typename Map::const_iterator it, bool forward) const {
+            if (forward)
+                return ++it;
+            if (it == _map.begin())
+                return _map.end();
+            return --it;
+        }
+
+        void _commitVersion(const Key& key, const InMemoryRecoveryUnit* owner, uint64_t timestamp) {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            typename Map::iterator it = _map.find(key);
+            invariant(it != _map.end());
+
+            Version& head = it->second.front();
+            invariant(head.owner == owner);
+            head.owner = NULL;
+            head.timestamp = timestamp;
+
+            if (it->second.size() > 1 || head.deleted)
+                _garbage.push_back(std::make_pair(timestamp, key));
+        }
+
+        void _rollbackVersion(const Key& key,
+                              const InMemoryRecoveryUnit* owner,
+                              InMemoryVersionClock* clock) {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            typename Map::iterator it = _map.find(key);
+            invariant(it != _map.end());
+            invariant(it->second.front().owner == owner);
+
+            clock->release(it->second.front().bytes);
+            it->second.pop_front();
+            if (it->second.empty())
+                _map.erase(it);
+        }
+
+        void _collectGarbage(uint64_t oldestSnapshot, InMemoryVersionClock* clock) {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            while (!_garbage.empty() && _garbage.front().first <= oldestSnapshot) {
+                typename Map::iterator it = _map.find(_garbage.front().second);
+                _garbage.pop_front();
+                if (it != _map.end())
+                    _prune(it, oldestSnapshot, clock);
+            }
+        }
+
+        /**
+         * Drops the versions older than the newest one 'oldestSnapshot' sees, which nobody can
+         * see anymore, and that one too if it's a deletion.
+         */
+        void _prune(typename Map::iterator it,
+                    uint64_t oldestSnapshot,
+                    InMemoryVersionClock* clock) {
+            Chain& chain = it->second;
+            typename Chain::iterator oldestVisible = chain.begin();
+            while (oldestVisible != chain.end()
+                    && (oldestVisible->owner || oldestVisible->timestamp > oldestSnapshot)) {
+                ++oldestVisible;
+            }
+            if (oldestVisible == chain.end())
+                return;
+
+            typename Chain::iterator older = oldestVisible;
+            ++older;
+            while (older != chain.end()) {
+                clock->release(older->bytes);
+                older = chain.erase(older);
+            }
+
+            if (oldestVisible->deleted)
+                chain.erase(oldestVisible);
+
+            if (chain.empty())
+                _map.erase(it);
+        }
+
+        mutable boost::mutex _mutex;
+        Map _map;
+
+        // Keys which may have versions to drop, by the commit timestamp that made them obsolete.
+        std::deque<std::pair<uint64_t, Key> > _garbage;
+    };
+
+}  // namespace mongo
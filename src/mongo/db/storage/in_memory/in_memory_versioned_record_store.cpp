@@ -0,0 +1,643 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_versioned_record_store.h"
+
+#include <algorithm>
+#include <boost/make_shared.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/storage/oplog_hack.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    using boost::shared_ptr;
+    using std::vector;
+
+namespace {
+    // Not counted in the data of a record: the version bookkeeping and its node in the map.
+    const int64_t kRecordOverhead = 64;
+
+    RecordData toRecordData(const InMemoryVersionedRecordStore::Records::Version& version) {
+        return RecordData(version.data, version.size);
+    }
+}
+
+    class InMemoryVersionedRecordStore::CountChange : public RecoveryUnit::Change {
+    public:
+        CountChange(const shared_ptr<Data>& data, int64_t numRecordsDiff, int64_t dataSizeDiff)
+            : _data(data), _numRecordsDiff(numRecordsDiff), _dataSizeDiff(dataSizeDiff) {
+        }
+
+        virtual void commit() {}
+        virtual void rollback() {
+            _data->numRecords.fetchAndSubtract(_numRecordsDiff);
+            _data->dataSize.fetchAndSubtract(_dataSizeDiff);
+        }
+
+    private:
+        const shared_ptr<Data> _data;
+        const int64_t _numRecordsDiff;
+        const int64_t _dataSizeDiff;
+    };
+
+    class InMemoryVersionedRecordStore::CappedInsertChange : public RecoveryUnit::Change {
+    public:
+        CappedInsertChange(const shared_ptr<Data>& data, const RecordId& loc)
+            : _data(data), _loc(loc) {
+        }
+
+        virtual void commit() { _dealtWith(); }
+        virtual void rollback() { _dealtWith(); }
+
+    private:
+        void _dealtWith() {
+            boost::lock_guard<boost::mutex> lk(_data->uncommittedLocsMutex);
+            vector<RecordId>& locs = _data->uncommittedLocs;
+            vector<RecordId>::iterator it = std::find(locs.begin(), locs.end(), _loc);
+            invariant(it != locs.end());
+            locs.erase(it);
+        }
+
+        const shared_ptr<Data> _data;
+        const RecordId _loc;
+    };
+
+    InMemoryVersionedRecordStore::Data::Data(bool isOplog)
+        : records(boost::make_shared<Records>()),
+          isOplog(isOplog),
+          nextId(1) {
+    }
+
+    //
+    // RecordStore
+    //
+
+    InMemoryVersionedRecordStore::InMemoryVersionedRecordStore(
+            StringData ns,
+            boost::shared_ptr<void>* dataInOut,
+            bool isCapped,
+            int64_t cappedMaxSize,
+            int64_t cappedMaxDocs,
+            CappedDocumentDeleteCallback* cappedDeleteCallback)
+        : RecordStore(ns),
+          _isCapped(isCapped),
+          _cappedMaxSize(cappedMaxSize),
+          _cappedMaxDocs(cappedMaxDocs),
+          _cappedDeleteCallback(cappedDeleteCallback),
+          _data(*dataInOut ? boost::static_pointer_cast<Data>(*dataInOut)
+                           : boost::make_shared<Data>(NamespaceString::oplog(ns))) {
+        if (!*dataInOut) {
+            *dataInOut = _data;
+        }
+
+        if (_isCapped) {
+            invariant(_cappedMaxSize > 0);
+            invariant(_cappedMaxDocs == -1 || _cappedMaxDocs > 0);
+        }
+        else {
+            invariant(_cappedMaxSize == -1);
+            invariant(_cappedMaxDocs == -1);
+        }
+    }
+
+    const char* InMemoryVersionedRecordStore::name() const { return "InMemory"; }
+
+    RecordData InMemoryVersionedRecordStore::dataFor(OperationContext* txn,
+                                                     const RecordId& loc) const {
+        RecordData data;
+        if (!findRecord(txn, loc, &data)) {
+            error() << "InMemoryVersionedRecordStore::dataFor cannot find record for " << ns()
+                    << ":" << loc;
+            invariant(false);
+        }
+        return data;
+    }
+
+    bool InMemoryVersionedRecordStore::findRecord(OperationContext* txn,
+                                                  const RecordId& loc,
+                                                  RecordData* rd) const {
+        Records::Version version;
+        if (!_data->records->find(txn, loc, &version))
+            return false;
+
+        *rd = toRecordData(version);
+        return true;
+    }
+
+    void InMemoryVersionedRecordStore::deleteRecord(OperationContext* txn, const RecordId& loc) {
+        const int oldLen = dataFor(txn, loc).size();
+        _data->records->write(txn, loc, SharedBuffer(), 0, true, 0);
+        _changeNumRecordsAndDataSize(txn, -1, -oldLen);
+    }
+
+    bool InMemoryVersionedRecordStore::cappedAndNeedDelete() const {
+        if (!_isCapped)
+            return false;
+
+        if (_data->dataSize.load() > _cappedMaxSize)
+            return true;
+
+        if ((_cappedMaxDocs != -1) && (_data->numRecords.load() > _cappedMaxDocs))
+            return true;
+
+        return false;
+    }
+
+    void InMemoryVersionedRecordStore::cappedDeleteAsNeeded(OperationContext* txn) {
+        if (!cappedAndNeedDelete())
+            return;
+
+        // Only one inserter deletes at a time, since concurrent deleters would all be deleting
+        // the same oldest records and conflict with each other.
+        boost::unique_lock<boost::mutex> lk(_data->cappedDeleterMutex, boost::try_to_lock);
+        if (!lk.owns_lock())
+            return;
+
+        RecordId start = RecordId::min();
+        while (cappedAndNeedDelete()) {
+            Records::Entry oldest;
+            if (!_data->records->next(txn, &start, false, true, &oldest))
+                break;
+
+            const RecordId loc = oldest.first;
+            if (_cappedDeleteCallback) {
+                uassertStatusOK(_cappedDeleteCallback->aboutToDeleteCapped(
+                                    txn, loc, toRecordData(oldest.second)));
+            }
+
+            _data->records->write(txn, loc, SharedBuffer(), 0, true, 0);
+            _changeNumRecordsAndDataSize(txn, -1, -oldest.second.size);
+            start = loc;
+        }
+    }
+
+    StatusWith<RecordId> InMemoryVersionedRecordStore::_extractAndCheckLocForOplog(
+            const char* data, int len) {
+        StatusWith<RecordId> status = oploghack::extractKey(data, len);
+        if (!status.isOK())
+            return status;
+
+        // The entry may have been registered by oplogDiskLocRegister() already.
+        boost::lock_guard<boost::mutex> lk(_data->uncommittedLocsMutex);
+        if (status.getValue() < _data->oplogHighestSeen)
+            return StatusWith<RecordId>(ErrorCodes::BadValue, "ts not higher than highest");
+
+        _data->oplogHighestSeen = status.getValue();
+        return status;
+    }
+
+    void InMemoryVersionedRecordStore::_addUncommittedLoc_inlock(OperationContext* txn,
+                                                                 const RecordId& loc) {
+        invariant(_data->uncommittedLocs.empty() || _data->uncommittedLocs.back() < loc);
+        _data->uncommittedLocs.push_back(loc);
+        txn->recoveryUnit()->registerChange(new CappedInsertChange(_data, loc));
+        _data->oplogHighestSeen = loc;
+    }
+
+    bool InMemoryVersionedRecordStore::isCappedHidden(const RecordId& loc) const {
+        boost::lock_guard<boost::mutex> lk(_data->uncommittedLocsMutex);
+        return !_data->uncommittedLocs.empty() && _data->uncommittedLocs.front() <= loc;
+    }
+
+    void InMemoryVersionedRecordStore::_changeNumRecordsAndDataSize(OperationContext* txn,
+                                                                    int64_t numRecordsDiff,
+                                                                    int64_t dataSizeDiff) {
+        _data->numRecords.fetchAndAdd(numRecordsDiff);
+        _data->dataSize.fetchAndAdd(dataSizeDiff);
+        txn->recoveryUnit()->registerChange(new CountChange(_data, numRecordsDiff, dataSizeDiff));
+    }
+
+    Status InMemoryVersionedRecordStore::_memoryLimitError() const {
+        return Status(ErrorCodes::ExceededMemoryLimit,
+                      str::stream() << "cannot insert into " << ns()
+                                    << ": the in-memory storage engine is full");
+    }
+
+    StatusWith<RecordId> InMemoryVersionedRecordStore::_insertRecord(OperationContext* txn,
+                                                                     const SharedBuffer& buffer,
+                                                                     int len) {
+        if (_isCapped && len > _cappedMaxSize) {
+            // We use dataSize for capped rollover and we don't want to delete everything if we know
+            // this won't fit.
+            return StatusWith<RecordId>(ErrorCodes::BadValue,
+                                       "object to insert exceeds cappedMaxSize");
+        }
+
+        RecordId loc;
+        if (_data->isOplog) {
+            StatusWith<RecordId> status = _extractAndCheckLocForOplog(buffer.get(), len);
+            if (!status.isOK())
+                return status;
+            loc = status.getValue();
+        }
+        else if (_isCapped) {
+            boost::lock_guard<boost::mutex> lk(_data->uncommittedLocsMutex);
+            loc = RecordId(_data->nextId.fetchAndAdd(1));
+            _addUncommittedLoc_inlock(txn, loc);
+        }
+        else {
+            loc = RecordId(_data->nextId.fetchAndAdd(1));
+        }
+        invariant(loc < RecordId::max());
+
+        if (!_data->records->write(txn, loc, buffer, len, false, len + kRecordOverhead))
+            return StatusWith<RecordId>(_memoryLimitError());
+
+        _changeNumRecordsAndDataSize(txn, 1, len);
+        return StatusWith<RecordId>(loc);
+    }
+
+    StatusWith<RecordId> InMemoryVersionedRecordStore::insertRecord(OperationContext* txn,
+                                                                    const char* data,
+                                                                    int len,
+                                                                    bool enforceQuota) {
+        SharedBuffer buffer = SharedBuffer::allocate(len);
+        memcpy(buffer.get(), data, len);
+
+        StatusWith<RecordId> status = _insertRecord(txn, buffer, len);
+        if (status.isOK())
+            cappedDeleteAsNeeded(txn);
+        return status;
+    }
+
+    StatusWith<RecordId> InMemoryVersionedRecordStore::insertRecord(OperationContext* txn,
+                                                                    const DocWriter* doc,
+                                                                    bool enforceQuota) {
+        const int len = doc->documentSize();
+        SharedBuffer buffer = SharedBuffer::allocate(len);
+        doc->writeDocument(buffer.get());
+
+        StatusWith<RecordId> status = _insertRecord(txn, buffer, len);
+        if (status.isOK())
+            cappedDeleteAsNeeded(txn);
+        return status;
+    }
+
+    Status InMemoryVersionedRecordStore::insertRecords(OperationContext* txn,
+                                                       const vector<RecordData>& records,
+                                                       vector<RecordId>* locsOut,
+                                                       bool enforceQuota) {
+        for (size_t i = 0; i < records.size(); i++) {
+            const int len = records[i].size();
+            SharedBuffer buffer = SharedBuffer::allocate(len);
+            memcpy(buffer.get(), records[i].data(), len);
+
+            StatusWith<RecordId> status = _insertRecord(txn, buffer, len);
+            if (!status.isOK())
+                return status.getStatus();
+            locsOut->push_back(status.getValue());
+
+            // Delete as needed after each record, as single inserts do.  Deleting once for the
+            // whole batch could remove earlier records of it before the caller has indexed them.
+            cappedDeleteAsNeeded(txn);
+        }
+
+        return Status::OK();
+    }
+
+    StatusWith<RecordId> InMemoryVersionedRecordStore::updateRecord(OperationContext* txn,
+                                                                    const RecordId& loc,
+                                                                    const char* data,
+                                                                    int len,
+                                                                    bool enforceQuota,
+                                                                    UpdateNotifier* notifier) {
+        const int oldLen = dataFor(txn, loc).size();
+        if (_isCapped && len > oldLen) {
+            return StatusWith<RecordId>( ErrorCodes::InternalError,
+                                        "failing update: objects in a capped ns cannot grow",
+                                        10003 );
+        }
+
+        SharedBuffer buffer = SharedBuffer::allocate(len);
+        memcpy(buffer.get(), data, len);
+
+        if (!_data->records->write(txn, loc, buffer, len, false, len + kRecordOverhead))
+            return StatusWith<RecordId>(_memoryLimitError());
+
+        _changeNumRecordsAndDataSize(txn, 0, len - oldLen);
+
+        cappedDeleteAsNeeded(txn);
+
+        return StatusWith<RecordId>(loc);
+    }
+
+    Status InMemoryVersionedRecordStore::updateWithDamages(
+            OperationContext* txn,
+            const RecordId& loc,
+            const RecordData& oldRec,
+            const char* damageSource,
+            const mutablebson::DamageVector& damages) {
+        const RecordData old = dataFor(txn, loc);
+        const int len = old.size();
+
+        SharedBuffer buffer = SharedBuffer::allocate(len);
+        memcpy(buffer.get(), old.data(), len);
+
+        char* root = buffer.get();
+        mutablebson::DamageVector::const_iterator where = damages.begin();
+        const mutablebson::DamageVector::const_iterator end = damages.end();
+        for( ; where != end; ++where ) {
+            const char* sourcePtr = damageSource + where->sourceOffset;
+            char* targetPtr = root + where->targetOffset;
+            std::memcpy(targetPtr, sourcePtr, where->size);
+        }
+
+        if (!_data->records->write(txn, loc, buffer, len, false, len + kRecordOverhead))
+            return _memoryLimitError();
+
+        return Status::OK();
+    }
+
+    RecordIterator* InMemoryVersionedRecordStore::getIterator(
+            OperationContext* txn,
+            const RecordId& start,
+            const CollectionScanParams::Direction& dir) const {
+        return new InMemoryVersionedRecordIterator(txn, *this, start,
+                                                   dir == CollectionScanParams::FORWARD);
+    }
+
+    RecordIterator* InMemoryVersionedRecordStore::getIteratorForRepair(
+            OperationContext* txn) const {
+        return new InMemoryVersionedRecordIterator(txn, *this, RecordId(), true);
+    }
+
+    vector<RecordIterator*> InMemoryVersionedRecordStore::getManyIterators(
+            OperationContext* txn) const {
+        vector<RecordIterator*> out;
+        out.push_back(new InMemoryVersionedRecordIterator(txn, *this, RecordId(), true));
+        return out;
+    }
+
+    Status InMemoryVersionedRecordStore::truncate(OperationContext* txn) {
+        temp_cappedTruncateAfter(txn, RecordId::min(), true);
+        return Status::OK();
+    }
+
+    void InMemoryVersionedRecordStore::temp_cappedTruncateAfter(OperationContext* txn,
+                                                                RecordId end,
+                                                                bool inclusive) {
+        Records::Entry entry;
+        RecordId start = end;
+        while (_data->records->next(txn, &start, inclusive, true, &entry)) {
+            _data->records->write(txn, entry.first, SharedBuffer(), 0, true, 0);
+            _changeNumRecordsAndDataSize(txn, -1, -entry.second.size);
+            start = entry.first;
+            inclusive = false;
+        }
+    }
+
+    Status InMemoryVersionedRecordStore::validate(OperationContext* txn,
+                                                  bool full,
+                                                  bool scanData,
+                                                  ValidateAdaptor* adaptor,
+                                                  ValidateResults* results,
+                                                  BSONObjBuilder* output) {
+        results->valid = true;
+        long long nrecords = 0;
+
+        Records::Entry entry;
+        RecordId start = RecordId::min();
+        bool inclusive = true;
+        while (_data->records->next(txn, &start, inclusive, true, &entry)) {
+            nrecords++;
+            if (scanData && full) {
+                size_t dataSize;
+                const Status status = adaptor->validate(toRecordData(entry.second), &dataSize);
+                if (!status.isOK()) {
+                    results->valid = false;
+                    results->errors.push_back("invalid object detected (see logs)");
+                    log() << "Invalid object detected in " << _ns << ": " << status.reason();
+                }
+            }
+            start = entry.first;
+            inclusive = false;
+        }
+
+        output->appendNumber( "nrecords", nrecords );
+
+        return Status::OK();
+    }
+
+    void InMemoryVersionedRecordStore::appendCustomStats(OperationContext* txn,
+                                                         BSONObjBuilder* result,
+                                                         double scale) const {
+        result->appendBool( "capped", _isCapped );
+        if ( _isCapped ) {
+            result->appendIntOrLL( "max", _cappedMaxDocs );
+            result->appendIntOrLL( "maxSize", _cappedMaxSize / scale );
+        }
+
+        // The memory used by the whole engine, since that's what the limit applies to.
+        const InMemoryVersionClock* clock = InMemoryRecoveryUnit::get(txn)->getClock();
+        BSONObjBuilder engine(result->subobjStart("inMemory"));
+        engine.appendNumber("bytesInUse", static_cast<long long>(clock->getBytesInUse() / scale));
+        engine.appendNumber("maxBytes", static_cast<long long>(clock->getMaxBytes() / scale));
+        engine.done();
+    }
+
+    Status InMemoryVersionedRecordStore::touch(OperationContext* txn,
+                                               BSONObjBuilder* output) const {
+        if (output) {
+            output->append("numRanges", 1);
+            output->append("millis", 0);
+        }
+        return Status::OK();
+    }
+
+    void InMemoryVersionedRecordStore::increaseStorageSize(OperationContext* txn,
+                                                           int size, bool enforceQuota) {
+        // unclear what this would mean for this class. For now, just error if called.
+        invariant(!"increaseStorageSize not yet implemented");
+    }
+
+    int64_t InMemoryVersionedRecordStore::storageSize(OperationContext* txn,
+                                                      BSONObjBuilder* extraInfo,
+                                                      int infoLevel) const {
+        // Note: not making use of extraInfo or infoLevel since we don't have extents
+        return dataSize(txn) + numRecords(txn) * kRecordOverhead;
+    }
+
+    boost::optional<RecordId> InMemoryVersionedRecordStore::oplogStartHack(
+            OperationContext* txn,
+            const RecordId& startingPosition) const {
+
+        if (!_data->isOplog)
+            return boost::none;
+
+        Records::Entry entry;
+        if (!_data->records->next(txn, &startingPosition, true, false, &entry))
+            return RecordId();
+
+        return entry.first;
+    }
+
+    Status InMemoryVersionedRecordStore::oplogDiskLocRegister(OperationContext* txn,
+                                                              const OpTime& opTime) {
+        StatusWith<RecordId> loc = oploghack::keyForOptime(opTime);
+        if (!loc.isOK())
+            return loc.getStatus();
+
+        boost::lock_guard<boost::mutex> lk(_data->uncommittedLocsMutex);
+        _addUncommittedLoc_inlock(txn, loc.getValue());
+        return Status::OK();
+    }
+
+    //
+    // Iterator
+    //
+
+    InMemoryVersionedRecordIterator::InMemoryVersionedRecordIterator(
+            OperationContext* txn,
+            const InMemoryVersionedRecordStore& rs,
+            const RecordId& start,
+            bool forward)
+        : _txn(txn),
+          _rs(rs),
+          _forward(forward),
+          _eof(false) {
+        RecordId from = start;
+        if (from.isNull())
+            from = _forward ? RecordId::min() : RecordId::max();
+
+        vector<Records::Entry> entries;
+        if (_fetch(from, true, 1, &entries))
+            _current = entries.front();
+        else
+            _eof = true;
+    }
+
+    size_t InMemoryVersionedRecordIterator::_fetch(const RecordId& start,
+                                                   bool inclusive,
+                                                   size_t maxRecords,
+                                                   vector<Records::Entry>* out) const {
+        const bool capped = _forward && _rs.isCapped();
+        const size_t before = out->size();
+        _rs.records().nextBatch(_txn, &start, inclusive, _forward, maxRecords, out, capped);
+        if (capped) {
+            // Everything after the first hidden record is hidden too.
+            for (size_t i = before; i < out->size(); i++) {
+                if (_rs.isCappedHidden((*out)[i].first)) {
+                    out->resize(i);
+                    break;
+                }
+            }
+        }
+        return out->size() - before;
+    }
+
+    bool InMemoryVersionedRecordIterator::isEOF() {
+        return _eof;
+    }
+
+    RecordId InMemoryVersionedRecordIterator::curr() {
+        if (_eof)
+            return RecordId();
+        return _current.first;
+    }
+
+    RecordId InMemoryVersionedRecordIterator::getNext() {
+        if (_eof)
+            return RecordId();
+
+        _lastReturned = _current;
+
+        vector<Records::Entry> entries;
+        if (_fetch(_current.first, false, 1, &entries))
+            _current = entries.front();
+        else
+            _eof = true;
+
+        return _lastReturned.first;
+    }
+
+    size_t InMemoryVersionedRecordIterator::getNextBatch(size_t maxRecords,
+                                                         vector<RecordIdAndData>* out) {
+        if (_eof || maxRecords == 0)
+            return 0;
+
+        // Fetch one record more than the rest of the batch to find where to continue from.
+        vector<Records::Entry> entries;
+        entries.reserve(maxRecords);
+        entries.push_back(_current);
+        const size_t fetched = _fetch(_current.first, false, maxRecords, &entries);
+
+        const size_t n = std::min(entries.size(), maxRecords);
+        for (size_t i = 0; i < n; i++) {
+            RecordIdAndData record;
+            record.id = entries[i].first;
+            record.data = toRecordData(entries[i].second);
+            out->push_back(record);
+        }
+
+        _lastReturned = entries[n - 1];
+        if (fetched == maxRecords)
+            _current = entries.back();
+        else
+            _eof = true;
+        return n;
+    }
+
+    bool InMemoryVersionedRecordIterator::restoreState(OperationContext* txn) {
+        _txn = txn;
+        if (_eof)
+            return true;
+
+        // Our snapshot may be newer than before the yield, so the record we are positioned at
+        // may have been deleted since.
+        if (_rs.records().find(_txn, _current.first, &_current.second))
+            return true;
+
+        // Capped iterators die rather than skipping over deleted records.
+        if (_rs.isCapped())
+            return false;
+
+        vector<Records::Entry> entries;
+        if (_fetch(_current.first, false, 1, &entries))
+            _current = entries.front();
+        else
+            _eof = true;
+        return true;
+    }
+
+    RecordData InMemoryVersionedRecordIterator::dataFor(const RecordId& loc) const {
+        if (!_lastReturned.first.isNull() && loc == _lastReturned.first)
+            return toRecordData(_lastReturned.second);
+        return _rs.dataFor(_txn, loc);
+    }
+
+} // namespace mongo
@@ -0,0 +1,263 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <functional>
+#include <vector>
+
+#include "mongo/db/storage/capped_callback.h"
+#include "mongo/db/storage/in_memory/in_memory_versioned_map.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    /**
+     * The RecordStore of the in-memory storage engine. Records are kept in an
+     * InMemoryVersionedMap, so readers see the snapshot of their recovery unit and writers of
+     * different records don't block each other.
+     *
+     * As with the other document-locking engines, numRecords() and dataSize() are updated as
+     * writes happen rather than as they commit, and capped collections hide the records after the
+     * oldest uncommitted insert from forward scans.
+     *
+     * @param cappedMaxSize - required if isCapped. limit uses dataSize() in this impl.
+     */
+    class InMemoryVersionedRecordStore : public RecordStore {
+    public:
+        typedef InMemoryVersionedMap<RecordId, std::less<RecordId> > Records;
+
+        InMemoryVersionedRecordStore(StringData ns,
+                                     boost::shared_ptr<void>* dataInOut,
+                                     bool isCapped = false,
+                                     int64_t cappedMaxSize = -1,
+                                     int64_t cappedMaxDocs = -1,
+                                     CappedDocumentDeleteCallback* cappedDeleteCallback = NULL);
+
+        virtual const char* name() const;
+
+        virtual RecordData dataFor( OperationContext* txn, const RecordId& loc ) const;
+
+        virtual bool findRecord( OperationContext* txn, const RecordId& loc, RecordData* rd ) const;
+
+        virtual void deleteRecord( OperationContext* txn, const RecordId& dl );
+
+        virtual StatusWith<RecordId> insertRecord( OperationContext* txn,
+                                                  const char* data,
+                                                  int len,
+                                                  bool enforceQuota );
+
+        virtual StatusWith<RecordId> insertRecord( OperationContext* txn,
+                                                  const DocWriter* doc,
+                                                  bool enforceQuota );
+
+        virtual Status insertRecords( OperationContext* txn,
+                                      const std::vector<RecordData>& records,
+                                      std::vector<RecordId>* locsOut,
+                                      bool enforceQuota );
+
+        virtual StatusWith<RecordId> updateRecord( OperationContext* txn,
+                                                  const RecordId& oldLocation,
+                                                  const char* data,
+                                                  int len,
+                                                  bool enforceQuota,
+                                                  UpdateNotifier* notifier );
+
+        virtual bool updateWithDamagesSupported() const { return false; }
+
+        virtual Status updateWithDamages( OperationContext* txn,
+                                          const RecordId& loc,
+                                          const RecordData& oldRec,
+                                          const char* damageSource,
+                                          const mutablebson::DamageVector& damages );
+
+        virtual RecordIterator* getIterator( OperationContext* txn,
+                                             const RecordId& start,
+                                             const CollectionScanParams::Direction& dir) const;
+
+        virtual RecordIterator* getIteratorForRepair( OperationContext* txn ) const;
+
+        virtual std::vector<RecordIterator*> getManyIterators( OperationContext* txn ) const;
+
+        virtual Status truncate( OperationContext* txn );
+
+        virtual void temp_cappedTruncateAfter( OperationContext* txn, RecordId end, bool inclusive );
+
+        virtual Status validate( OperationContext* txn,
+                                 bool full,
+                                 bool scanData,
+                                 ValidateAdaptor* adaptor,
+                                 ValidateResults* results, BSONObjBuilder* output );
+
+        virtual void appendCustomStats( OperationContext* txn,
+                                        BSONObjBuilder* result,
+                                        double scale ) const;
+
+        virtual Status touch( OperationContext* txn, BSONObjBuilder* output ) const;
+
+        virtual void increaseStorageSize( OperationContext* txn,  int size, bool enforceQuota );
+
+        virtual int64_t storageSize( OperationContext* txn,
+                                     BSONObjBuilder* extraInfo = NULL,
+                                     int infoLevel = 0) const;
+
+        virtual long long dataSize( OperationContext* txn ) const {
+            return _data->dataSize.load();
+        }
+
+        virtual long long numRecords( OperationContext* txn ) const {
+            return _data->numRecords.load();
+        }
+
+        virtual boost::optional<RecordId> oplogStartHack(OperationContext* txn,
+                                                         const RecordId& startingPosition) const;
+
+        virtual Status oplogDiskLocRegister( OperationContext* txn,
+                                             const OpTime& opTime );
+
+        virtual void updateStatsAfterRepair(OperationContext* txn,
+                                            long long numRecords,
+                                            long long dataSize) {
+            _data->numRecords.store(numRecords);
+            _data->dataSize.store(dataSize);
+        }
+
+        //
+        // Not in RecordStore interface
+        //
+
+        bool isCapped() const { return _isCapped; }
+        void setCappedDeleteCallback(CappedDocumentDeleteCallback* cb) {
+            _cappedDeleteCallback = cb;
+        }
+
+        /**
+         * Returns true if 'loc' is at or after the oldest uncommitted insert into this capped
+         * collection, so scans must not return it yet.
+         */
+        bool isCappedHidden(const RecordId& loc) const;
+
+        const Records& records() const { return *_data->records; }
+
+    private:
+        class CountChange;
+        class CappedInsertChange;
+
+        // This is the "persistent" data, shared by all of the instances for the same ident.
+        struct Data {
+            explicit Data(bool isOplog);
+
+            const boost::shared_ptr<Records> records;
+            const bool isOplog;
+
+            AtomicInt64 nextId;
+            AtomicInt64 numRecords;
+            AtomicInt64 dataSize;
+
+            // Protects uncommittedLocs and oplogHighestSeen.
+            mutable boost::mutex uncommittedLocsMutex;
+            std::vector<RecordId> uncommittedLocs; // sorted
+            RecordId oplogHighestSeen;
+
+            // Held by the one inserter which deletes from a capped collection at a time.
+            boost::mutex cappedDeleterMutex;
+        };
+
+        StatusWith<RecordId> _insertRecord(OperationContext* txn,
+                                           const SharedBuffer& buffer,
+                                           int len);
+        StatusWith<RecordId> _extractAndCheckLocForOplog(const char* data, int len);
+        void _addUncommittedLoc_inlock(OperationContext* txn, const RecordId& loc);
+        void _changeNumRecordsAndDataSize(OperationContext* txn,
+                                          int64_t numRecordsDiff,
+                                          int64_t dataSizeDiff);
+        Status _memoryLimitError() const;
+
+        bool cappedAndNeedDelete() const;
+        void cappedDeleteAsNeeded(OperationContext* txn);
+
+        const bool _isCapped;
+        const int64_t _cappedMaxSize;
+        const int64_t _cappedMaxDocs;
+        CappedDocumentDeleteCallback* _cappedDeleteCallback;
+
+        const boost::shared_ptr<Data> _data;
+    };
+
+    class InMemoryVersionedRecordIterator : public RecordIterator {
+    public:
+        InMemoryVersionedRecordIterator(OperationContext* txn,
+                                        const InMemoryVersionedRecordStore& rs,
+                                        const RecordId& start,
+                                        bool forward);
+
+        virtual bool isEOF();
+
+        virtual RecordId curr();
+
+        virtual RecordId getNext();
+
+        virtual void invalidate(const RecordId& dl) {}
+
+        virtual void saveState() {}
+
+        virtual bool restoreState(OperationContext* txn);
+
+        virtual RecordData dataFor( const RecordId& loc ) const;
+
+        virtual size_t getNextBatch( size_t maxRecords, std::vector<RecordIdAndData>* out );
+
+        virtual bool hasNativeBatches() const { return true; }
+
+    private:
+        typedef InMemoryVersionedRecordStore::Records Records;
+
+        /**
+         * Appends up to 'maxRecords' records the recovery unit sees after 'start', or from
+         * 'start' if 'inclusive', to 'out', and returns how many. Stops before records which
+         * capped collections hide.
+         */
+        size_t _fetch(const RecordId& start, bool inclusive, size_t maxRecords,
+                      std::vector<Records::Entry>* out) const;
+
+        OperationContext* _txn; // not owned
+        const InMemoryVersionedRecordStore& _rs;
+        const bool _forward;
+
+        bool _eof;
+        Records::Entry _current;
+
+        // The record getNext() returned last, whose data is usually asked for next.
+        Records::Entry _lastReturned;
+    };
+
+} // namespace mongo
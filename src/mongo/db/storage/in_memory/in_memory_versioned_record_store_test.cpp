@@ -0,0 +1,247 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/db/storage/in_memory/in_memory_versioned_record_store.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/operation_context_noop.h"
+#include "mongo/db/storage/in_memory/in_memory_recovery_unit.h"
+#include "mongo/db/storage/in_memory/in_memory_version_clock.h"
+#include "mongo/db/storage/record_store_test_harness.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    using boost::scoped_ptr;
+    using std::string;
+
+    class InMemoryVersionedHarnessHelper : public HarnessHelper {
+    public:
+        explicit InMemoryVersionedHarnessHelper(int64_t maxBytes = 0)
+            : _clock(maxBytes) {
+        }
+
+        virtual RecordStore* newNonCappedRecordStore() {
+            return new InMemoryVersionedRecordStore( "a.b", &_data );
+        }
+
+        virtual RecoveryUnit* newRecoveryUnit() {
+            return new InMemoryRecoveryUnit(&_clock);
+        }
+
+        const InMemoryVersionClock& getClock() const { return _clock; }
+
+    private:
+        InMemoryVersionClock _clock;
+        boost::shared_ptr<void> _data;
+    };
+
+    HarnessHelper* newHarnessHelper() {
+        return new InMemoryVersionedHarnessHelper();
+    }
+
+namespace {
+
+    RecordId insert(OperationContext* txn, RecordStore* rs, const string& s) {
+        WriteUnitOfWork uow(txn);
+        StatusWith<RecordId> res = rs->insertRecord(txn, s.c_str(), s.size() + 1, false);
+        ASSERT_OK(res.getStatus());
+        uow.commit();
+        return res.getValue();
+    }
+
+    void update(OperationContext* txn, RecordStore* rs, const RecordId& loc, const string& s) {
+        WriteUnitOfWork uow(txn);
+        ASSERT_OK(rs->updateRecord(txn, loc, s.c_str(), s.size() + 1, false, NULL).getStatus());
+        uow.commit();
+    }
+
+    TEST(InMemoryVersionedRecordStore, ReadsFromSnapshot) {
+        InMemoryVersionedHarnessHelper helper;
+        scoped_ptr<RecordStore> rs(helper.newNonCappedRecordStore());
+        scoped_ptr<OperationContext> writer(helper.newOperationContext());
+        scoped_ptr<OperationContext> reader(helper.newOperationContext());
+
+        const RecordId loc = insert(writer.get(), rs.get(), "a");
+        ASSERT_EQUALS(string("a"), rs->dataFor(reader.get(), loc).data());
+
+        // The reader keeps its snapshot until it restarts.
+        update(writer.get(), rs.get(), loc, "b");
+        const RecordId other = insert(writer.get(), rs.get(), "c");
+        ASSERT_EQUALS(string("a"), rs->dataFor(reader.get(), loc).data());
+        RecordData rd;
+        ASSERT_FALSE(rs->findRecord(reader.get(), other, &rd));
+
+        reader->recoveryUnit()->commitAndRestart();
+        ASSERT_EQUALS(string("b"), rs->dataFor(reader.get(), loc).data());
+        ASSERT_TRUE(rs->findRecord(reader.get(), other, &rd));
+    }
+
+    TEST(InMemoryVersionedRecordStore, UncommittedWritesAreInvisible) {
+        InMemoryVersionedHarnessHelper helper;
+        scoped_ptr<RecordStore> rs(helper.newNonCappedRecordStore());
+        scoped_ptr<OperationContext> writer(helper.newOperationContext());
+        scoped_ptr<OperationContext> reader(helper.newOperationContext());
+
+        RecordId loc;
+        {
+            WriteUnitOfWork uow(writer.get());
+            StatusWith<RecordId> res = rs->insertRecord(writer.get(), "a", 2, false);
+            ASSERT_OK(res.getStatus());
+            loc = res.getValue();
+
+            // Visible to the writer, but not to anyone else.
+            RecordData rd;
+            ASSERT_TRUE(rs->findRecord(writer.get(), loc, &rd));
+            ASSERT_FALSE(rs->findRecord(reader.get(), loc, &rd));
+
+            scoped_ptr<RecordIterator> it(rs->getIterator(reader.get()));
+            ASSERT_TRUE(it->isEOF());
+            // Rolled back.
+        }
+
+        RecordData rd;
+        ASSERT_FALSE(rs->findRecord(writer.get(), loc, &rd));
+        ASSERT_EQUALS(0, rs->numRecords(writer.get()));
+    }
+
+    TEST(InMemoryVersionedRecordStore, ConcurrentUpdatesConflict) {
+        InMemoryVersionedHarnessHelper helper;
+        scoped_ptr<RecordStore> rs(helper.newNonCappedRecordStore());
+        scoped_ptr<OperationContext> first(helper.newOperationContext());
+        scoped_ptr<OperationContext> second(helper.newOperationContext());
+
+        const RecordId loc = insert(first.get(), rs.get(), "a");
+        const RecordId other = insert(first.get(), rs.get(), "b");
+
+        WriteUnitOfWork secondUow(second.get());
+        ASSERT_OK(rs->updateRecord(second.get(), other, "c", 2, false, NULL).getStatus());
+
+        // Writers of different records don't conflict...
+        update(first.get(), rs.get(), loc, "d");
+
+        // ...but writing a record which changed since our snapshot does.
+        ASSERT_THROWS(rs->updateRecord(second.get(), loc, "e", 2, false, NULL),
+                      WriteConflictException);
+
+        // As does writing a record someone else has an uncommitted write to.
+        WriteUnitOfWork firstUow(first.get());
+        ASSERT_THROWS(rs->deleteRecord(first.get(), other), WriteConflictException);
+    }
+
+    TEST(InMemoryVersionedRecordStore, OldVersionsAreDropped) {
+        InMemoryVersionedHarnessHelper helper;
+        scoped_ptr<RecordStore> rs(helper.newNonCappedRecordStore());
+        scoped_ptr<OperationContext> writer(helper.newOperationContext());
+        scoped_ptr<OperationContext> reader(helper.newOperationContext());
+
+        const RecordId loc = insert(writer.get(), rs.get(), "abc");
+        const int64_t bytesForOneVersion = helper.getClock().getBytesInUse();
+
+        // An open snapshot keeps the versions it can see.
+        ASSERT_EQUALS(string("abc"), rs->dataFor(reader.get(), loc).data());
+        update(writer.get(), rs.get(), loc, "def");
+        ASSERT_EQUALS(2 * bytesForOneVersion, helper.getClock().getBytesInUse());
+
+        reader->recoveryUnit()->commitAndRestart();
+        for (int i = 0; i < 10; i++) {
+            update(writer.get(), rs.get(), loc, "ghi");
+        }
+        ASSERT_EQUALS(bytesForOneVersion, helper.getClock().getBytesInUse());
+
+        {
+            WriteUnitOfWork uow(writer.get());
+            rs->deleteRecord(writer.get(), loc);
+            uow.commit();
+        }
+        ASSERT_EQUALS(0, helper.getClock().getBytesInUse());
+    }
+
+    TEST(InMemoryVersionedRecordStore, MemoryLimit) {
+        InMemoryVersionedHarnessHelper helper(1024);
+        scoped_ptr<RecordStore> rs(helper.newNonCappedRecordStore());
+        scoped_ptr<OperationContext> opCtx(helper.newOperationContext());
+
+        const string small(100, 'a');
+        insert(opCtx.get(), rs.get(), small);
+
+        const string big(2000, 'b');
+        WriteUnitOfWork uow(opCtx.get());
+        StatusWith<RecordId> res = rs->insertRecord(opCtx.get(), big.c_str(), big.size() + 1,
+                                                    false);
+        ASSERT_EQUALS(ErrorCodes::ExceededMemoryLimit, res.getStatus().code());
+        ASSERT_EQUALS(1, rs->numRecords(opCtx.get()));
+        ASSERT_LESS_THAN_OR_EQUALS(helper.getClock().getBytesInUse(), 1024);
+    }
+
+    TEST(InMemoryVersionedRecordStore, CappedHidesUncommittedInserts) {
+        InMemoryVersionClock clock;
+        boost::shared_ptr<void> data;
+        InMemoryVersionedRecordStore rs("a.b", &data, true, 100000, -1);
+        OperationContextNoop first(new InMemoryRecoveryUnit(&clock));
+        OperationContextNoop second(new InMemoryRecoveryUnit(&clock));
+        OperationContextNoop reader(new InMemoryRecoveryUnit(&clock));
+
+        insert(&first, &rs, "a");
+
+        WriteUnitOfWork firstUow(&first);
+        ASSERT_OK(rs.insertRecord(&first, "b", 2, false).getStatus());
+        const RecordId last = insert(&second, &rs, "c");
+
+        // The committed insert after the uncommitted one isn't returned yet, so that a tailing
+        // reader doesn't skip over the uncommitted one.
+        {
+            scoped_ptr<RecordIterator> it(rs.getIterator(&reader, RecordId(),
+                                                         CollectionScanParams::FORWARD));
+            ASSERT_FALSE(it->isEOF());
+            it->getNext();
+            ASSERT_TRUE(it->isEOF());
+        }
+
+        firstUow.commit();
+        reader.recoveryUnit()->commitAndRestart();
+        {
+            scoped_ptr<RecordIterator> it(rs.getIterator(&reader, RecordId(),
+                                                         CollectionScanParams::FORWARD));
+            int count = 0;
+            RecordId loc;
+            while (!it->isEOF()) {
+                loc = it->getNext();
+                count++;
+            }
+            ASSERT_EQUALS(3, count);
+            ASSERT_EQUALS(last, loc);
+        }
+    }
+
+} // namespace
+} // namespace mongo
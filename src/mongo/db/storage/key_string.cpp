@@ -42,6 +42,11 @@
 #include "mongo/util/hex.h"
 #include "mongo/util/log.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MONGO_KEYSTRING_SSE2
+#endif
+
 namespace mongo {
 
     using std::string;
@@ -170,10 +175,34 @@ namespace mongo {
 
     // some utility functions
     namespace {
+        /**
+         * dst may be the same as src, but the ranges must not otherwise overlap.
+         */
         void memcpy_flipBits(void* dst, const void* src, size_t bytes) {
             const char* input = static_cast<const char*>(src);
             char* output = static_cast<char*>(dst);
             const char* const end = input + bytes;
+
+#if defined(MONGO_KEYSTRING_SSE2)
+            // 16 bytes at a time, which covers an ObjectId or a short string in one go.
+            const __m128i allOnes = _mm_set1_epi32(-1);
+            while (end - input >= 16) {
+                const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_xor_si128(in, allOnes));
+                input += 16;
+                output += 16;
+            }
+#endif
+
+            while (end - input >= 8) {
+                uint64_t word;
+                memcpy(&word, input, sizeof(word));
+                word = ~word;
+                memcpy(output, &word, sizeof(word));
+                input += 8;
+                output += 8;
+            }
+
             while (input != end) {
                 *output++ = ~(*input++);
             }
@@ -281,17 +310,53 @@ namespace mongo {
             const int elemIdx = elemCount++;
             const bool invert = (ord.get(elemIdx) == -1);
 
-            _appendBsonValue(elem, invert, NULL);
+            _appendElementForIndexing(elem, invert);
+        }
+        _append(kEnd, false);
+    }
 
-            dassert(elem.fieldNameSize() < 3); // fieldNameSize includes the NUL
+    void KeyString::_appendElementForIndexing(const BSONElement& elem, bool invert) {
+        _appendBsonValue(elem, invert, NULL);
 
-            // These are used in IndexEntryComparison::makeQueryObject()
-            switch (*elem.fieldName()) {
-            case 'l':  _append(kLess, false); break;
-            case 'g':  _append(kGreater, false); break;
-            }
+        dassert(elem.fieldNameSize() < 3); // fieldNameSize includes the NUL
+
+        // These are used in IndexEntryComparison::makeQueryObject()
+        switch (*elem.fieldName()) {
+        case 'l':  _append(kLess, false); break;
+        case 'g':  _append(kGreater, false); break;
+        }
+    }
+
+    KeyString::Encoder::Encoder(const BSONObj& keyPattern, Ordering ord) : _ord(ord) {
+        int elemCount = 0;
+        BSONForEach(elem, keyPattern) {
+            _invert.push_back(ord.get(elemCount++) == -1);
         }
-        _append(kEnd, false);
+    }
+
+    void KeyString::Encoder::resetToKey(KeyString* out, const BSONObj& obj) const {
+        out->resetToEmpty();
+        _appendAllElements(out, obj);
+    }
+
+    void KeyString::Encoder::resetToKey(KeyString* out,
+                                        const BSONObj& obj,
+                                        RecordId recordId) const {
+        out->resetToEmpty();
+        _appendAllElements(out, obj);
+        out->appendRecordId(recordId);
+    }
+
+    void KeyString::Encoder::_appendAllElements(KeyString* out, const BSONObj& obj) const {
+        const size_t nFields = _invert.size();
+        size_t elemIdx = 0;
+        BSONForEach(elem, obj) {
+            const bool invert = elemIdx < nFields ? _invert[elemIdx] : (_ord.get(elemIdx) == -1);
+            elemIdx++;
+
+            out->_appendElementForIndexing(elem, invert);
+        }
+        out->_append(kEnd, false);
     }
 
     void KeyString::appendRecordId(RecordId loc) {
@@ -369,23 +434,33 @@ namespace mongo {
     }
 
     void KeyString::_appendOID(OID val, bool invert) {
-        _append(CType::kOID, invert);
-        _appendBytes(val.view().view(), OID::kOIDSize, invert);
+        // One copy, and a single 16 byte flip when inverted, for the ctype and the ObjectId.
+        char buf[1 + OID::kOIDSize];
+        buf[0] = CType::kOID;
+        memcpy(buf + 1, val.view().view(), OID::kOIDSize);
+        _appendBytes(buf, sizeof(buf), invert);
     }
 
     void KeyString::_appendString(StringData val, bool invert) {
         _typeBits.appendString();
+        if (_appendCTypeAndSimpleString(CType::kStringLike, val, invert))
+            return;
         _append(CType::kStringLike, invert);
         _appendStringLike(val, invert);
     }
 
     void KeyString::_appendSymbol(StringData val, bool invert) {
         _typeBits.appendSymbol();
-        _append(CType::kStringLike, invert); // Symbols and Strings compare equally
+        // Symbols and Strings compare equally
+        if (_appendCTypeAndSimpleString(CType::kStringLike, val, invert))
+            return;
+        _append(CType::kStringLike, invert);
         _appendStringLike(val, invert);
     }
 
     void KeyString::_appendCode(StringData val, bool invert) {
+        if (_appendCTypeAndSimpleString(CType::kCode, val, invert))
+            return;
         _append(CType::kCode, invert);
         _appendStringLike(val, invert);
     }
@@ -585,6 +660,21 @@ namespace mongo {
         }
     }
 
+    bool KeyString::_appendCTypeAndSimpleString(uint8_t ctype, StringData str, bool invert) {
+        if (memchr(str.rawData(), 0, str.size()))
+            return false;
+
+        // ctype, the string, and the terminating NUL in one piece of the buffer.
+        char* const dest = _buffer.skip(str.size() + 2);
+        dest[0] = ctype;
+        memcpy(dest + 1, str.rawData(), str.size());
+        dest[str.size() + 1] = 0;
+
+        if (invert)
+            memcpy_flipBits(dest, dest, str.size() + 2);
+        return true;
+    }
+
     void KeyString::_appendBson(const BSONObj& obj, bool invert) {
         BSONForEach(elem, obj) {
             // Force the order to be based on (ctype, name, value).
@@ -656,18 +746,21 @@ namespace mongo {
 
         const size_t bytesNeeded = (64 - countLeadingZeros64(value) + 7) / 8;
 
-        // Append the low bytes of value in big endian order.
-        value = endian::nativeToBig(value);
-        const void* firstUsedByte = reinterpret_cast<const char*>((&value) + 1) - bytesNeeded;
+        // The ctype followed by the low bytes of value in big endian order, in one append. The
+        // bytes of negative numbers are flipped relative to the ctype, so that larger magnitudes
+        // sort first.
+        char buf[1 + sizeof(value)];
+        value = endian::nativeToBig(isNegative ? ~value : value);
+        const char* firstUsedByte = reinterpret_cast<const char*>((&value) + 1) - bytesNeeded;
 
         if (isNegative) {
-            _append(uint8_t(CType::kNumericNegative1ByteInt - (bytesNeeded - 1)), invert);
-            _appendBytes(firstUsedByte, bytesNeeded, !invert);
+            buf[0] = uint8_t(CType::kNumericNegative1ByteInt - (bytesNeeded - 1));
         }
         else {
-            _append(uint8_t(CType::kNumericPositive1ByteInt + (bytesNeeded - 1)), invert);
-            _appendBytes(firstUsedByte, bytesNeeded, invert);
+            buf[0] = uint8_t(CType::kNumericPositive1ByteInt + (bytesNeeded - 1));
         }
+        memcpy(buf + 1, firstUsedByte, bytesNeeded);
+        _appendBytes(buf, 1 + bytesNeeded, invert);
     }
 
     template <typename T>
@@ -28,6 +28,10 @@
  *    it in the license file.
  */
 
+#pragma once
+
+#include <vector>
+
 #include "mongo/bson/bsonobj.h"
 #include "mongo/bson/bsonobjbuilder.h"
 #include "mongo/bson/bsonmisc.h"
@@ -182,6 +186,30 @@ namespace mongo {
             uint8_t _buf[1/*size*/ + kMaxBytesNeeded];
         };
 
+        /**
+         * Encodes the keys of one index. It is built once from the key pattern of the index, so
+         * that encoding a key doesn't have to consult the Ordering for every field, and skips the
+         * bit flipping entirely for ascending fields.
+         *
+         * Produces exactly the same KeyStrings as the KeyString constructors and resetToKey().
+         */
+        class Encoder {
+        public:
+            Encoder(const BSONObj& keyPattern, Ordering ord);
+
+            void resetToKey(KeyString* out, const BSONObj& obj) const;
+            void resetToKey(KeyString* out, const BSONObj& obj, RecordId recordId) const;
+
+        private:
+            void _appendAllElements(KeyString* out, const BSONObj& obj) const;
+
+            const Ordering _ord;
+
+            // Whether each field of the key pattern is descending. Keys with more fields than
+            // the pattern fall back to _ord.
+            std::vector<char> _invert;
+        };
+
         KeyString() {}
 
         KeyString(const BSONObj& obj, Ordering ord, RecordId recordId) {
@@ -246,6 +274,12 @@ namespace mongo {
 
         void _appendAllElementsForIndexing(const BSONObj& obj, Ordering ord);
 
+        /**
+         * Appends one top level element of an index key, including the marker for the 'l' and 'g'
+         * field names used by IndexEntryComparison::makeQueryObject().
+         */
+        void _appendElementForIndexing(const BSONElement& elem, bool invert);
+
         void _appendBool(bool val, bool invert);
         void _appendDate(Date_t val, bool invert);
         void _appendTimestamp(OpTime val, bool invert);
@@ -273,6 +307,12 @@ namespace mongo {
                               const StringData* name);
 
         void _appendStringLike(StringData str, bool invert);
+
+        /**
+         * Appends the ctype byte and a string without NUL bytes with a single copy.
+         * @return false, having appended nothing, if the string contains NUL bytes.
+         */
+        bool _appendCTypeAndSimpleString(uint8_t ctype, StringData str, bool invert);
         void _appendBson(const BSONObj& obj, bool invert);
         void _appendSmallDouble(double value, bool invert);
         void _appendLargeDouble(double value, bool invert);
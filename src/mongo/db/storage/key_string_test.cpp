@@ -38,6 +38,8 @@
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/hex.h"
 #include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
 #include "mongo/base/owned_pointer_vector.h"
 
 using std::string;
@@ -844,3 +846,161 @@ TEST(KeyStringTest, RecordIds) {
     }
 }
 
+
+namespace {
+    void assertSameKeyString(const KeyString& a, const KeyString& b) {
+        ASSERT_EQ(a.toString(), b.toString());
+        ASSERT_EQ(toHex(a.getTypeBits().getBuffer(), a.getTypeBits().getSize()),
+                  toHex(b.getTypeBits().getBuffer(), b.getTypeBits().getSize()));
+    }
+}
+
+TEST(KeyStringTest, EncoderMatchesKeyString) {
+    const std::vector<BSONObj>& elements = getInterestingElements();
+
+    std::vector<BSONObj> patterns;
+    patterns.push_back(BSON("a" << 1 << "b" << 1));
+    patterns.push_back(BSON("a" << -1 << "b" << 1));
+    patterns.push_back(BSON("a" << 1 << "b" << -1));
+
+    for (size_t p = 0; p < patterns.size(); p++) {
+        const Ordering ord = Ordering::make(patterns[p]);
+        const KeyString::Encoder encoder(patterns[p], ord);
+
+        for (size_t i = 0; i < elements.size(); i++) {
+            for (size_t j = 0; j < elements.size(); j += 7) {
+                BSONObjBuilder b;
+                b.appendElements(elements[i]);
+                b.appendElements(elements[j]);
+                const BSONObj key = b.obj();
+
+                KeyString encoded;
+                encoder.resetToKey(&encoded, key);
+                assertSameKeyString(KeyString(key, ord), encoded);
+
+                encoder.resetToKey(&encoded, key, RecordId(12345));
+                assertSameKeyString(KeyString(key, ord, RecordId(12345)), encoded);
+            }
+
+            // Keys with fewer fields than the pattern, and more.
+            KeyString encoded;
+            encoder.resetToKey(&encoded, elements[i]);
+            assertSameKeyString(KeyString(elements[i], ord), encoded);
+
+            const BSONObj longKey = BSON("" << 1 << "" << 2 << "" << elements[i].firstElement());
+            encoder.resetToKey(&encoded, longKey);
+            assertSameKeyString(KeyString(longKey, ord), encoded);
+        }
+
+        // Query objects from IndexEntryComparison::makeQueryObject() use 'l' and 'g' names.
+        const BSONObj query = BSON("" << 5 << "l" << "abc");
+        KeyString encoded;
+        encoder.resetToKey(&encoded, query);
+        assertSameKeyString(KeyString(query, ord), encoded);
+    }
+}
+
+TEST(KeyStringTest, StringsOfAllLengths) {
+    // Crosses the block sizes used to flip the bits of descending keys.
+    for (int len = 0; len < 70; len++) {
+        const std::string str(len, 'x');
+        ROUNDTRIP(BSON("" << str));
+        ROUNDTRIP(BSON("" << (str + '\0' + str)));
+        ROUNDTRIP(BSON("" << BSONSymbol(str)));
+        ROUNDTRIP(BSON("" << BSONCode(str)));
+
+        const std::string bigger(len, 'y');
+        COMPARES_SAME(BSON("" << str), BSON("" << bigger));
+        COMPARES_SAME(BSON("" << str), BSON("" << (str + '\0')));
+    }
+}
+
+namespace {
+    const int kBenchmarkKeys = 100 * 1000;
+
+    /**
+     * Encodes 'keys' with and without a KeyString::Encoder and logs the time per key.
+     */
+    void benchmarkEncoding(const std::string& shape,
+                           const BSONObj& keyPattern,
+                           const std::vector<BSONObj>& keys) {
+#if !defined(MONGO_CONFIG_OPTIMIZED_BUILD)
+        log() << "\t\t\tskipping benchmark on non-optimized build";
+        return;
+#endif
+        const Ordering ord = Ordering::make(keyPattern);
+        const KeyString::Encoder encoder(keyPattern, ord);
+        KeyString ks;
+        size_t totalSize = 0;
+
+        Timer generic;
+        for (int i = 0; i < kBenchmarkKeys; i++) {
+            ks.resetToKey(keys[i % keys.size()], ord, RecordId(i));
+            totalSize += ks.getSize();
+        }
+        const long long genericMicros = generic.micros();
+
+        Timer encoded;
+        for (int i = 0; i < kBenchmarkKeys; i++) {
+            encoder.resetToKey(&ks, keys[i % keys.size()], RecordId(i));
+            totalSize += ks.getSize();
+        }
+        const long long encodedMicros = encoded.micros();
+
+        Timer compare;
+        int sum = 0;
+        KeyString other;
+        for (int i = 0; i < kBenchmarkKeys; i++) {
+            encoder.resetToKey(&ks, keys[i % keys.size()]);
+            encoder.resetToKey(&other, keys[(i + 1) % keys.size()]);
+            sum += ks.compare(other);
+        }
+        const long long compareMicros = compare.micros();
+
+        log() << "KeyString benchmark " << shape << ": "
+              << (genericMicros * 1000 / kBenchmarkKeys) << " ns/key with resetToKey, "
+              << (encodedMicros * 1000 / kBenchmarkKeys) << " ns/key with an Encoder, "
+              << (compareMicros * 1000 / kBenchmarkKeys) << " ns to encode and compare two keys"
+              << " (" << totalSize << " bytes, " << sum << ")";
+    }
+
+    std::string benchmarkString(int i) {
+        return str::stream() << "user" << (i * 7919);
+    }
+}
+
+TEST(KeyStringBenchmark, Int) {
+    std::vector<BSONObj> keys;
+    for (int i = 0; i < 1000; i++) keys.push_back(BSON("" << i * 7919));
+    benchmarkEncoding("int", BSON("a" << 1), keys);
+    benchmarkEncoding("int descending", BSON("a" << -1), keys);
+}
+
+TEST(KeyStringBenchmark, Long) {
+    std::vector<BSONObj> keys;
+    for (int i = 0; i < 1000; i++) keys.push_back(BSON("" << (1LL << 40) * i));
+    benchmarkEncoding("long", BSON("a" << 1), keys);
+}
+
+TEST(KeyStringBenchmark, ObjectId) {
+    std::vector<BSONObj> keys;
+    for (int i = 0; i < 1000; i++) keys.push_back(BSON("" << OID::gen()));
+    benchmarkEncoding("ObjectId", BSON("a" << 1), keys);
+    benchmarkEncoding("ObjectId descending", BSON("a" << -1), keys);
+}
+
+TEST(KeyStringBenchmark, ShortString) {
+    std::vector<BSONObj> keys;
+    for (int i = 0; i < 1000; i++) keys.push_back(BSON("" << benchmarkString(i)));
+    benchmarkEncoding("short string", BSON("a" << 1), keys);
+    benchmarkEncoding("short string descending", BSON("a" << -1), keys);
+}
+
+TEST(KeyStringBenchmark, Compound) {
+    std::vector<BSONObj> keys;
+    for (int i = 0; i < 1000; i++) {
+        keys.push_back(BSON("" << (i % 10) << "" << benchmarkString(i) << "" << OID::gen()));
+    }
+    benchmarkEncoding("int, string, ObjectId", BSON("a" << 1 << "b" << 1 << "c" << 1), keys);
+    benchmarkEncoding("int, -string, ObjectId", BSON("a" << 1 << "b" << -1 << "c" << 1), keys);
+}
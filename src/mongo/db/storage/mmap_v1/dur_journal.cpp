@@ -50,6 +50,7 @@
 #include "mongo/platform/random.h"
 #include "mongo/util/checksum.h"
 #include "mongo/util/compress.h"
+#include "mongo/util/crc32c.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/file.h"
 #include "mongo/util/hex.h"
@@ -139,22 +140,31 @@ namespace mongo {
             reserved = 0;
             magic[0] = magic[1] = magic[2] = magic[3] = '\n';
 
-            Checksum c;
-            c.gen(begin, (unsigned) len);
-            memcpy(hash, c.bytes, sizeof(hash));
+            const uint32_t crc = crc32c(0, begin, (unsigned) len);
+            memset(hash, 0, sizeof(hash));
+            memcpy(hash, &crc, sizeof(crc));
         }
 
-        bool JSectFooter::checkHash(const void* begin, int len) const {
+        bool JSectFooter::checkHash(const void* begin, int len, bool crc32c) const {
             if( !magicOk() ) { 
                 log() << "journal footer not valid" << endl;
                 return false;
             }
-            Checksum c;
-            c.gen(begin, len);
-            DEV log() << "checkHash len:" << len << " hash:" << toHex(hash, 16) << " current:" << toHex(c.bytes, 16) << endl;
-            if( memcmp(hash, c.bytes, sizeof(hash)) == 0 ) 
+            unsigned char current[sizeof(hash)];
+            memset(current, 0, sizeof(current));
+            if( crc32c ) {
+                const uint32_t crc = mongo::crc32c(0, begin, len);
+                memcpy(current, &crc, sizeof(crc));
+            }
+            else {
+                Checksum c;
+                c.gen(begin, len);
+                memcpy(current, c.bytes, sizeof(current));
+            }
+            DEV log() << "checkHash len:" << len << " hash:" << toHex(hash, 16) << " current:" << toHex(current, 16) << endl;
+            if( memcmp(hash, current, sizeof(hash)) == 0 ) 
                 return true;
-            log() << "journal checkHash mismatch, got: " << toHex(c.bytes, 16) << " expected: " << toHex(hash,16) << endl;
+            log() << "journal checkHash mismatch, got: " << toHex(current, 16) << " expected: " << toHex(hash,16) << endl;
             return false;
         }
 
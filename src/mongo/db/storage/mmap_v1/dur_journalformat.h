@@ -53,10 +53,13 @@ namespace mongo {
 
             // x4142 is asci--readable if you look at the file with head/less -- thus the starting values were near
             // that.  simply incrementing the version # is safe on a fwd basis.
+            // CurrentVersion sections are checksummed with crc32c.  PreviousVersion sections use the
+            // Checksum from util/checksum.h, and are still accepted by recovery so that an upgrade
+            // can replay the journal of a previous version.
 #if defined(_NOCOMPRESS)
-            enum { CurrentVersion = 0x4148 };
+            enum { CurrentVersion = 0x414b, PreviousVersion = 0x4148 };
 #else
-            enum { CurrentVersion = 0x4149 };
+            enum { CurrentVersion = 0x414a, PreviousVersion = 0x4149 };
 #endif
             unsigned short _version;
 
@@ -72,7 +75,8 @@ namespace mongo {
             char reserved3[8026]; // 8KB total for the file header
             char txt2[2];         // "\n\n" at the end
 
-            bool versionOk() const { return _version == CurrentVersion; }
+            bool versionOk() const { return _version == CurrentVersion || _version == PreviousVersion; }
+            bool crc32cChecksums() const { return _version == CurrentVersion; }
             bool valid() const { return magic[0] == 'j' && txt2[1] == '\n' && fileId; }
         };
 
@@ -146,21 +150,22 @@ namespace mongo {
             }
         };
 
-        /** group commit section footer. md5 is a key field. */
+        /** group commit section footer. the checksum hash is a key field. */
         struct JSectFooter {
             JSectFooter();
             JSectFooter(const void* begin, int len); // needs buffer to compute hash
             unsigned sentinel;
-            unsigned char hash[16];
+            unsigned char hash[16]; // crc32c in the first 4 bytes, or a Checksum in PreviousVersion files
             unsigned long long reserved;
             char magic[4]; // "\n\n\n\n"
 
             /** used by recovery to see if buffer is valid
                 @param begin the buffer
                 @param len buffer len
+                @param crc32c true if the section is from a JHeader::CurrentVersion file
                 @return true if buffer looks valid
             */
-            bool checkHash(const void* begin, int len) const;
+            bool checkHash(const void* begin, int len, bool crc32c) const;
 
             bool magicOk() const { return *((unsigned*)magic) == 0x0a0a0a0a; }
         };
@@ -254,6 +254,7 @@ namespace mongo {
 
         RecoveryJob::RecoveryJob()
             : _recovering(false),
+              _crc32cChecksums(true),
               _lastDataSyncedFromLastRun(0),
               _lastSeqMentionedInConsoleLog(1) {
 
@@ -392,7 +393,7 @@ namespace mongo {
             // Check the footer checksum before doing anything else.
             if (_recovering) {
                 verify( ((const char *)h) + sizeof(JSectHeader) == p );
-                if (!f->checkHash(h, len + sizeof(JSectHeader))) {
+                if (!f->checkHash(h, len + sizeof(JSectHeader), _crc32cChecksums)) {
                     log() << "journal section checksum doesn't match";
                     throw JournalSectionCorruptException();
                 }
@@ -475,6 +476,7 @@ namespace mongo {
                         uasserted(13536, str::stream() << "journal version number mismatch " << h._version);
                     }
                     fileId = h.fileId;
+                    _crc32cChecksums = h.crc32cChecksums();
                     if (mmapv1GlobalOptions.journalOptions &
                         MMAPV1Options::JournalDumpJournal) {
                         log() << "JHeader::fileId=" << fileId << endl;
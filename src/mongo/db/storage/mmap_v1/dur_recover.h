@@ -92,6 +92,9 @@ namespace mongo {
             // Are we in recovery or WRITETODATAFILES
             bool _recovering;
 
+            // Whether the sections of the journal file being recovered use crc32c checksums
+            bool _crc32cChecksums;
+
             unsigned long long _lastDataSyncedFromLastRun;
             unsigned long long _lastSeqMentionedInConsoleLog;
 
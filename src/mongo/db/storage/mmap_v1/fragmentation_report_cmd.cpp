@@ -0,0 +1,104 @@
+// fragmentation_report_cmd.cpp
+
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/db_raii.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/storage/mmap_v1/record_store_v1_simple.h"
+
+namespace mongo {
+
+    using std::string;
+    using std::stringstream;
+
+    /**
+     * Reports how the free space of an MMAPv1 collection is spread over the deleted lists, to
+     * tell whether a compact would give back much space.
+     */
+    class FragmentationReportCmd : public Command {
+    public:
+        FragmentationReportCmd() : Command( "fragmentationReport" ) {}
+
+        virtual bool slaveOk() const { return true; }
+        virtual bool isWriteCommandForConfigServer() const { return false; }
+        virtual void help( stringstream& help ) const {
+            help << "report the free space and fragmentation of an mmapv1 collection\n"
+                    "{ fragmentationReport : <collection_name> }";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::collStats);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+
+        virtual bool run(OperationContext* txn,
+                         const string& dbname,
+                         BSONObj& cmdObj,
+                         int,
+                         string& errmsg,
+                         BSONObjBuilder& result,
+                         bool fromRepl) {
+            const NamespaceString nss(parseNsCollectionRequired(dbname, cmdObj));
+
+            AutoGetCollectionForRead ctx(txn, nss);
+
+            Collection* collection = ctx.getCollection();
+            if ( !collection ) {
+                errmsg = "collection not found";
+                return false;
+            }
+
+            const SimpleRecordStoreV1* rs =
+                dynamic_cast<const SimpleRecordStoreV1*>( collection->getRecordStore() );
+            if ( !rs ) {
+                errmsg = "fragmentationReport only supports non-capped mmapv1 collections";
+                return false;
+            }
+
+            result.append( "ns", nss.ns() );
+            rs->appendFragmentationStats( txn, &result );
+            return true;
+        }
+    };
+    static FragmentationReportCmd fragmentationReportCmd;
+}
@@ -251,12 +251,13 @@ namespace mongo {
             _files.push_back(allocFile.release());
         }
 
-        // Preallocate is asynchronous
+        // Preallocate is asynchronous: the FileAllocator creates the next file in the background
+        // and opening it for real later waits for that to finish.
         if (preallocateNextFile) {
             auto_ptr<DataFile> nextFile(new DataFile(allocFileId + 1));
             const string nextFileName = _fileName(allocFileId + 1).string();
 
-            nextFile->open(txn, nextFileName.c_str(), minSize, false);
+            nextFile->open(txn, nextFileName.c_str(), minSize, true);
         }
 
         // Returns the last file added
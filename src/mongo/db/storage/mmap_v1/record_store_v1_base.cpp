@@ -40,6 +40,7 @@
 #include "mongo/db/storage/mmap_v1/extent_manager.h"
 #include "mongo/db/storage/mmap_v1/record.h"
 #include "mongo/db/storage/mmap_v1/record_store_v1_repair_iterator.h"
+#include "mongo/platform/bits.h"
 #include "mongo/util/log.h"
 #include "mongo/util/progress_meter.h"
 #include "mongo/util/timer.h"
@@ -336,10 +337,48 @@ namespace mongo {
         return _insertRecord( txn, data, len, enforceQuota );
     }
 
+    Status RecordStoreV1Base::insertRecords( OperationContext* txn,
+                                             const std::vector<RecordData>& records,
+                                             std::vector<RecordId>* locsOut,
+                                             bool enforceQuota ) {
+        for ( size_t i = 0; i < records.size(); i++ ) {
+            const int len = records[i].size();
+            if ( len < 4 ) {
+                return Status( ErrorCodes::InvalidLength, "record has to be >= 4 bytes" );
+            }
+            if ( len + Record::HeaderSize > MaxAllowedAllocation ) {
+                return Status( ErrorCodes::InvalidLength, "record has to be <= 16.5MB" );
+            }
+        }
+
+        // The collection statistics are updated once for the whole batch, which saves declaring
+        // write intent on the NamespaceDetails for every record. Capped allocation relies on
+        // the statistics being current, so capped collections still update them per record.
+        const bool batchStats = !isCapped();
+        long long dataSize = 0;
+        for ( size_t i = 0; i < records.size(); i++ ) {
+            StatusWith<RecordId> loc = _insertRecord( txn,
+                                                      records[i].data(),
+                                                      records[i].size(),
+                                                      enforceQuota,
+                                                      !batchStats );
+            if ( !loc.isOK() )
+                return loc.getStatus();
+            locsOut->push_back( loc.getValue() );
+            dataSize += recordFor( DiskLoc::fromRecordId( loc.getValue() ) )->netLength();
+        }
+
+        if ( batchStats && !records.empty() )
+            _details->incrementStats( txn, dataSize, records.size() );
+
+        return Status::OK();
+    }
+
     StatusWith<RecordId> RecordStoreV1Base::_insertRecord( OperationContext* txn,
                                                           const char* data,
                                                           int len,
-                                                          bool enforceQuota ) {
+                                                          bool enforceQuota,
+                                                          bool updateStats ) {
 
         const int lenWHdr = len + Record::HeaderSize;
         const int lenToAlloc = shouldPadInserts() ? quantizeAllocationSpace(lenWHdr)
@@ -359,7 +398,8 @@ namespace mongo {
 
         _addRecordToRecListInExtent(txn, r, loc.getValue());
 
-        _details->incrementStats( txn, r->netLength(), 1 );
+        if ( updateStats )
+            _details->incrementStats( txn, r->netLength(), 1 );
 
         return StatusWith<RecordId>(loc.getValue().toRecordId());
     }
@@ -955,7 +995,14 @@ namespace mongo {
     }
 
     int RecordStoreV1Base::bucket(int size) {
-        for ( int i = 0; i < Buckets; i++ ) {
+        // The buckets below 2MB are consecutive powers of two starting at 32, so the bucket is
+        // just the position of the highest set bit.
+        if ( size < bucketSizes[0] )
+            return 0;
+        if ( size < 0x200000 )
+            return 63 - countLeadingZeros64(size) - 4;
+
+        for ( int i = 17; i < Buckets; i++ ) {
             if ( bucketSizes[i] > size ) {
                 // Return the first bucket sized _larger_ than the requested size. This is important
                 // since we want all records in a bucket to be >= the quantized size, therefore the
@@ -201,6 +201,11 @@ namespace mongo {
                                            const DocWriter* doc,
                                            bool enforceQuota );
 
+        virtual Status insertRecords( OperationContext* txn,
+                                      const std::vector<RecordData>& records,
+                                      std::vector<RecordId>* locsOut,
+                                      bool enforceQuota );
+
         virtual StatusWith<RecordId> updateRecord( OperationContext* txn,
                                                    const RecordId& oldLocation,
                                                    const char* data,
@@ -308,7 +313,8 @@ namespace mongo {
         StatusWith<RecordId> _insertRecord( OperationContext* txn,
                                             const char* data,
                                             int len,
-                                            bool enforceQuota );
+                                            bool enforceQuota,
+                                            bool updateStats = true );
 
         boost::scoped_ptr<RecordStoreV1MetaData> _details;
         ExtentManager* _extentManager;
@@ -43,6 +43,7 @@
 #include "mongo/db/storage/mmap_v1/record.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/db/storage/mmap_v1/record_store_v1_simple_iterator.h"
+#include "mongo/platform/bits.h"
 #include "mongo/util/log.h"
 #include "mongo/util/progress_meter.h"
 #include "mongo/util/mongoutils/str.h"
@@ -68,12 +69,31 @@ namespace mongo {
     static ServerStatusMetricField<Counter64> dFreelist3( "storage.freelist.search.scanned",
                                                           &freelistIterations );
 
+    namespace {
+        const uint32_t kAllBuckets = (1u << RecordStoreV1Base::Buckets) - 1;
+        BOOST_STATIC_ASSERT(RecordStoreV1Base::Buckets < 32);
+    }
+
+    /**
+     * A rollback can put records back on a list that was cleared in the bitmap. Rather than
+     * tracking which, assume every list may be non-empty again.
+     */
+    class SimpleRecordStoreV1::ResetNonEmptyBuckets : public RecoveryUnit::Change {
+    public:
+        explicit ResetNonEmptyBuckets( SimpleRecordStoreV1* rs ) : _rs( rs ) {}
+        virtual void commit() {}
+        virtual void rollback() { _rs->_nonEmptyBuckets = kAllBuckets; }
+    private:
+        SimpleRecordStoreV1* const _rs;
+    };
+
     SimpleRecordStoreV1::SimpleRecordStoreV1( OperationContext* txn,
                                               StringData ns,
                                               RecordStoreV1MetaData* details,
                                               ExtentManager* em,
                                               bool isSystemIndexes )
-        : RecordStoreV1Base( ns, details, em, isSystemIndexes ) {
+        : RecordStoreV1Base( ns, details, em, isSystemIndexes ),
+          _nonEmptyBuckets( kAllBuckets ) {
 
         invariant( !details->isCapped() );
         _normalCollection = NamespaceString::normal( ns );
@@ -105,21 +125,38 @@ namespace mongo {
         DiskLoc loc;
         DeletedRecord* dr = NULL;
         {
+            // Only the lists from the smallest bucket that can hold lenToAlloc upwards can have a
+            // fit, and of those only the ones not known to be empty are worth looking at.
+            uint32_t candidates = _nonEmptyBuckets & ~((1u << bucket(lenToAlloc)) - 1);
+            bool clearedBuckets = false;
+
+            int myBucket = Buckets;
+            while (candidates) {
+                const int b = countTrailingZeros64(candidates);
+                candidates &= candidates - 1;
+                freelistIterations.increment();
 
-            int myBucket;
-            for (myBucket = bucket(lenToAlloc); myBucket < Buckets; myBucket++) {
                 // Only look at the first entry in each bucket. This works because we are either
                 // quantizing or allocating fixed-size blocks.
-                const DiskLoc head = _details->deletedListEntry(myBucket);
-                if (head.isNull()) continue;
+                const DiskLoc head = _details->deletedListEntry(b);
+                if (head.isNull()) {
+                    freelistBucketExhausted.increment();
+                    _nonEmptyBuckets &= ~(1u << b);
+                    clearedBuckets = true;
+                    continue;
+                }
                 DeletedRecord* const candidate = drec(head);
                 if (candidate->lengthWithHeaders() >= lenToAlloc) {
                     loc = head;
                     dr = candidate;
+                    myBucket = b;
                     break;
                 }
             }
 
+            if (clearedBuckets)
+                txn->recoveryUnit()->registerChange(new ResetNonEmptyBuckets(this));
+
             if (!dr)
                 return DiskLoc(); // no space
 
@@ -235,6 +272,59 @@ namespace mongo {
         int b = bucket(d->lengthWithHeaders());
         *txn->recoveryUnit()->writing(&d->nextDeleted()) = _details->deletedListEntry(b);
         _details->setDeletedListEntry(txn, b, dloc);
+        _nonEmptyBuckets |= 1u << b;
+    }
+
+    void SimpleRecordStoreV1::appendFragmentationStats( OperationContext* txn,
+                                                        BSONObjBuilder* result ) const {
+        long long freeRecords = 0;
+        long long freeBytes = 0;
+        int largestFreeRecord = 0;
+
+        BSONArrayBuilder sizeClasses( result->subarrayStart( "sizeClasses" ) );
+        for ( int b = 0; b <= Buckets; b++ ) {
+            // The legacy grab bag is walked last; its records are not sorted by size.
+            const bool grabBag = ( b == Buckets );
+            long long count = 0;
+            long long bytes = 0;
+            DiskLoc loc = grabBag ? _details->deletedListLegacyGrabBag()
+                                  : _details->deletedListEntry( b );
+            while ( !loc.isNull() ) {
+                const DeletedRecord* const dr = drec( loc );
+                const int len = dr->lengthWithHeaders();
+                count++;
+                bytes += len;
+                largestFreeRecord = std::max( largestFreeRecord, len );
+                loc = dr->nextDeleted();
+
+                if ( count % 1000 == 0 )
+                    txn->checkForInterrupt();
+            }
+
+            freeRecords += count;
+            freeBytes += bytes;
+            if ( count == 0 || grabBag )
+                continue;
+
+            BSONObjBuilder sizeClass( sizeClasses.subobjStart() );
+            sizeClass.append( "maxSize", bucketSizes[b] );
+            sizeClass.append( "count", count );
+            sizeClass.append( "bytes", bytes );
+            sizeClass.done();
+        }
+        sizeClasses.done();
+
+        const long long storage = storageSize( txn );
+        result->append( "storageSize", storage );
+        result->append( "dataSize", dataSize( txn ) );
+        result->append( "freeRecords", freeRecords );
+        result->append( "freeBytes", freeBytes );
+        result->append( "largestFreeRecord", largestFreeRecord );
+
+        // The share of the free space that is not in the largest free record, i.e. that can only
+        // be reused by allocations smaller than it.
+        result->append( "fragmentation",
+                        freeBytes ? 1.0 - double(largestFreeRecord) / freeBytes : 0.0 );
     }
 
     RecordIterator* SimpleRecordStoreV1::getIterator( OperationContext* txn,
@@ -69,6 +69,12 @@ namespace mongo {
                                 const CompactOptions* options,
                                 CompactStats* stats );
 
+        /**
+         * Walks the deleted lists and reports how much of the storage is free and how it is
+         * spread over the size classes. Takes time proportional to the number of deleted records.
+         */
+        void appendFragmentationStats( OperationContext* txn, BSONObjBuilder* result ) const;
+
     protected:
         virtual bool isCapped() const { return false; }
         virtual bool shouldPadInserts() const {
@@ -82,6 +88,8 @@ namespace mongo {
         virtual void addDeletedRec(OperationContext* txn,
                                    const DiskLoc& dloc);
     private:
+        class ResetNonEmptyBuckets;
+
         DiskLoc _allocFromExistingExtents( OperationContext* txn,
                                            int lengthWithHeaders );
 
@@ -94,6 +102,12 @@ namespace mongo {
 
         bool _normalCollection;
 
+        // One bit per deleted list. A clear bit means the list is known to be empty, so that
+        // allocations can go straight to the smallest size class that may have a fit. Bits are
+        // set whenever a record is added to a list and only cleared once a list is seen empty, so
+        // this is always a superset of the non-empty lists. Protected by the collection lock.
+        uint32_t _nonEmptyBuckets;
+
         friend class SimpleRecordStoreV1Iterator;
     };
 
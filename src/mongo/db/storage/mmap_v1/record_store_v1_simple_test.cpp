@@ -34,13 +34,16 @@
 #include "mongo/db/storage/mmap_v1/extent.h"
 #include "mongo/db/storage/mmap_v1/record.h"
 #include "mongo/db/storage/mmap_v1/record_store_v1_test_help.h"
+#include "mongo/platform/random.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/timer.h"
 
 using namespace mongo;
 
 namespace {
 
     using std::string;
+    using std::vector;
 
     TEST( SimpleRecordStoreV1, quantizeAllocationSpaceSimple ) {
         ASSERT_EQUALS(RecordStoreV1Base::quantizeAllocationSpace(33), 64);
@@ -63,6 +66,21 @@ namespace {
         ASSERT_EQUALS(RecordStoreV1Base::quantizeAllocationSpace(maxSize), maxSize);
     }
 
+    /**
+     * The bucket of a size is the first bucket with a larger size, whether or not it is computed
+     * from the bit width of the size.
+     */
+    TEST( SimpleRecordStoreV1, bucketAroundBucketSizes ) {
+        for (int b = 0; b < RecordStoreV1Base::Buckets - 1; b++) {
+            const int size = RecordStoreV1Base::bucketSizes[b];
+            ASSERT_EQUALS(RecordStoreV1Base::bucket(size - 1), b);
+            ASSERT_EQUALS(RecordStoreV1Base::bucket(size), b + 1);
+            ASSERT_EQUALS(RecordStoreV1Base::bucket(size + 1), b + 1);
+        }
+        ASSERT_EQUALS(RecordStoreV1Base::bucket(0), 0);
+        ASSERT_EQUALS(RecordStoreV1Base::bucket(1000), 5);
+    }
+
     /**
      * Tests quantization of sizes around all valid bucket sizes.
      */
@@ -537,4 +555,94 @@ namespace {
             assertStateV1RS(&txn, recs, drecs, NULL, &em, md);
         }
     }
+
+    // -----------------
+
+    TEST( SimpleRecordStoreV1, FragmentationStats ) {
+        OperationContextNoop txn;
+        DummyExtentManager em;
+        DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData( false, 0 );
+        SimpleRecordStoreV1 rs( &txn, "test.foo", md, &em, false );
+
+        {
+            LocAndSize recs[] = {
+                {DiskLoc(0, 1000), 100},
+                {}
+            };
+            LocAndSize drecs[] = {
+                {DiskLoc(0, 1100), 100},
+                {DiskLoc(0, 1200), 100},
+                {DiskLoc(1, 1000), 1000},
+                {}
+            };
+            initializeV1RS(&txn, recs, drecs, NULL, &em, md);
+        }
+
+        BSONObjBuilder b;
+        rs.appendFragmentationStats( &txn, &b );
+        const BSONObj stats = b.obj();
+
+        ASSERT_EQUALS( 3, stats["freeRecords"].numberLong() );
+        ASSERT_EQUALS( 1200, stats["freeBytes"].numberLong() );
+        ASSERT_EQUALS( 1000, stats["largestFreeRecord"].numberInt() );
+        ASSERT_EQUALS( 1.0 - 1000.0 / 1200, stats["fragmentation"].numberDouble() );
+
+        const vector<BSONElement> sizeClasses = stats["sizeClasses"].Array();
+        ASSERT_EQUALS( 2U, sizeClasses.size() );
+        ASSERT_EQUALS( 128, sizeClasses[0]["maxSize"].numberInt() );
+        ASSERT_EQUALS( 2, sizeClasses[0]["count"].numberLong() );
+        ASSERT_EQUALS( 200, sizeClasses[0]["bytes"].numberLong() );
+        ASSERT_EQUALS( 1024, sizeClasses[1]["maxSize"].numberInt() );
+        ASSERT_EQUALS( 1, sizeClasses[1]["count"].numberLong() );
+    }
+
+    /**
+     * Inserts and deletes documents of random sizes while keeping the number of live documents
+     * constant. Once the free lists are warm almost every insert should reuse a deleted record,
+     * so the storage must stop growing.
+     */
+    TEST( SimpleRecordStoreV1, ChurnReusesDeletedRecords ) {
+        OperationContextNoop txn;
+        DummyExtentManager em;
+        DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData( false, 0 );
+        SimpleRecordStoreV1 rs( &txn, "test.foo", md, &em, false );
+
+        const int kLiveDocs = 1000;
+        const int kOps = 20 * 1000;
+        const string buf( 5000, 'x' );
+        PseudoRandom rand( 12345 );
+
+        vector<RecordId> live;
+        for ( int i = 0; i < kLiveDocs; i++ ) {
+            StatusWith<RecordId> result =
+                rs.insertRecord( &txn, buf.c_str(), 100 + rand.nextInt32( 4900 ), false );
+            ASSERT_OK( result.getStatus() );
+            live.push_back( result.getValue() );
+        }
+
+        long long insertedBytes = 0;
+        long long warmStorageSize = 0;
+        Timer t;
+        for ( int i = 0; i < kOps; i++ ) {
+            if ( i == kOps / 4 )
+                warmStorageSize = rs.storageSize( &txn );
+
+            const int victim = rand.nextInt32( kLiveDocs );
+            rs.deleteRecord( &txn, live[victim] );
+
+            const int len = 100 + rand.nextInt32( 4900 );
+            StatusWith<RecordId> result = rs.insertRecord( &txn, buf.c_str(), len, false );
+            ASSERT_OK( result.getStatus() );
+            live[victim] = result.getValue();
+            if ( i >= kOps / 4 )
+                insertedBytes += len;
+        }
+        const long long micros = t.micros();
+
+        ASSERT_EQUALS( kLiveDocs, md->numRecords() );
+        ASSERT_LESS_THAN( rs.storageSize( &txn ), warmStorageSize + insertedBytes / 10 );
+
+        unittest::log() << "churn: " << ( micros * 1000 / kOps ) << " ns per delete and insert, "
+                        << "storageSize " << rs.storageSize( &txn );
+    }
 }
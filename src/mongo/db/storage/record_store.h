@@ -86,6 +86,14 @@ namespace mongo {
      * A RecordIterator provides an interface for walking over a RecordStore.
      * The details of navigating the collection's structure are below this interface.
      */
+    /**
+     * A record returned in a batch by RecordIterator::getNextBatch.
+     */
+    struct RecordIdAndData {
+        RecordId id;
+        RecordData data;
+    };
+
     class RecordIterator {
     public:
         virtual ~RecordIterator() { }
@@ -115,6 +123,38 @@ namespace mongo {
         // normally this will just go back to the RecordStore and convert
         // but this gives the iterator an oppurtnity to optimize
         virtual RecordData dataFor( const RecordId& loc ) const = 0;
+
+        /**
+         * Appends up to 'maxRecords' records to 'out', starting at the one the iterator points
+         * at, and moves the iterator past the last one appended.  Returns the number of records
+         * appended, which is less than 'maxRecords' only if the iterator reached EOF.
+         *
+         * Data which is not owned is only valid until its record is changed or deleted, so
+         * callers which hold on to records across a yield must drop or re-read the records they
+         * are sent invalidations for.
+         *
+         * If this throws a WriteConflictException, the records appended before it are still
+         * valid and the iterator points at the first record which was not appended.
+         */
+        virtual size_t getNextBatch( size_t maxRecords, std::vector<RecordIdAndData>* out ) {
+            size_t n = 0;
+            for ( ; n < maxRecords && !isEOF(); n++ ) {
+                RecordIdAndData record;
+                record.id = curr();
+                record.data = dataFor( record.id );
+                invariant( getNext() == record.id );
+                out->push_back( record );
+            }
+            return n;
+        }
+
+        /**
+         * Returns true if getNextBatch() is implemented natively, making reading records in
+         * batches cheaper than reading them one at a time. Iterators over records which may
+         * need to be fetched from disk before being read should return false, so that callers
+         * can yield before each record instead.
+         */
+        virtual bool hasNativeBatches() const { return false; }
     };
 
 
@@ -171,6 +211,32 @@ namespace mongo {
                                                   const DocWriter* doc,
                                                   bool enforceQuota ) = 0;
 
+        /**
+         * Inserts each of 'records', in order, as insertRecord() would, and appends their
+         * RecordIds to 'locsOut'. Stops at the first error, at which point some of the records
+         * may already be inserted, so the caller must roll back its WriteUnitOfWork.
+         *
+         * Implementations can override this to share work, such as cursor positioning and
+         * collection statistics updates, between the records of a batch. Capped record stores
+         * must still delete as needed after each record, as a batch may delete its own earlier
+         * records.
+         */
+        virtual Status insertRecords( OperationContext* txn,
+                                      const std::vector<RecordData>& records,
+                                      std::vector<RecordId>* locsOut,
+                                      bool enforceQuota ) {
+            for ( size_t i = 0; i < records.size(); i++ ) {
+                StatusWith<RecordId> loc = insertRecord( txn,
+                                                         records[i].data(),
+                                                         records[i].size(),
+                                                         enforceQuota );
+                if ( !loc.isOK() )
+                    return loc.getStatus();
+                locsOut->push_back( loc.getValue() );
+            }
+            return Status::OK();
+        }
+
         /**
          * @param notifier - Only used by record stores which do not support doc-locking.
          *                   In the case of a document move, this is called after the document
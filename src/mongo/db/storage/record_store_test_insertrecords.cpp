@@ -0,0 +1,153 @@
+// record_store_test_insertrecords.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/db/storage/record_store_test_harness.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/db/record_id.h"
+#include "mongo/db/storage/record_data.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+namespace mongo {
+
+    using boost::scoped_ptr;
+
+namespace {
+
+    void makeRecords( int n, int size, vector<string>* data, vector<RecordData>* records ) {
+        data->clear();
+        for ( int i = 0; i < n; i++ ) {
+            stringstream ss;
+            ss << "record " << i << " ";
+            data->push_back( ss.str() + string( std::max( 0, size - int(ss.str().size()) ), 'x' ) );
+        }
+        records->clear();
+        for ( int i = 0; i < n; i++ ) {
+            records->push_back( RecordData( (*data)[i].c_str(), (*data)[i].size() + 1 ) );
+        }
+    }
+
+}  // namespace
+
+    // Insert a batch of records and verify that each one can be found at the location returned
+    // for it, and that the record count and data size include all of them.
+    TEST( RecordStoreTestHarness, InsertRecords ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
+
+        const int nToInsert = 10;
+        vector<string> data;
+        vector<RecordData> records;
+        makeRecords( nToInsert, 16, &data, &records );
+
+        vector<RecordId> locs;
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                ASSERT_OK( rs->insertRecords( opCtx.get(), records, &locs, false ) );
+                uow.commit();
+            }
+        }
+
+        ASSERT_EQUALS( static_cast<size_t>( nToInsert ), locs.size() );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            ASSERT_EQUALS( nToInsert, rs->numRecords( opCtx.get() ) );
+            ASSERT( rs->dataSize( opCtx.get() ) > 0 );
+
+            for ( int i = 0; i < nToInsert; i++ ) {
+                RecordData record = rs->dataFor( opCtx.get(), locs[i] );
+                ASSERT_EQUALS( data[i].size() + 1, static_cast<size_t>( record.size() ) );
+                ASSERT_EQUALS( data[i], record.data() );
+            }
+        }
+    }
+
+    // Compare inserting records one at a time with inserting them in batches, committing after
+    // every batch in both cases. Only the timings are reported, as they depend on the machine.
+    TEST( RecordStoreTestHarness, InsertRecordsBenchmark ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<RecordStore> singleRs( harnessHelper->newNonCappedRecordStore() );
+        scoped_ptr<RecordStore> batchRs( harnessHelper->newNonCappedRecordStore() );
+
+        const int nBatches = 100;
+        const int batchSize = 64;
+        vector<string> data;
+        vector<RecordData> records;
+        makeRecords( batchSize, 100, &data, &records );
+
+        Timer singleTimer;
+        for ( int b = 0; b < nBatches; b++ ) {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            WriteUnitOfWork uow( opCtx.get() );
+            for ( int i = 0; i < batchSize; i++ ) {
+                ASSERT_OK( singleRs->insertRecord( opCtx.get(),
+                                                   records[i].data(),
+                                                   records[i].size(),
+                                                   false ).getStatus() );
+            }
+            uow.commit();
+        }
+        const long long singleMicros = singleTimer.micros();
+
+        Timer batchTimer;
+        for ( int b = 0; b < nBatches; b++ ) {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            WriteUnitOfWork uow( opCtx.get() );
+            vector<RecordId> locs;
+            ASSERT_OK( batchRs->insertRecords( opCtx.get(), records, &locs, false ) );
+            uow.commit();
+        }
+        const long long batchMicros = batchTimer.micros();
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            ASSERT_EQUALS( nBatches * batchSize, singleRs->numRecords( opCtx.get() ) );
+            ASSERT_EQUALS( nBatches * batchSize, batchRs->numRecords( opCtx.get() ) );
+            ASSERT_EQUALS( singleRs->dataSize( opCtx.get() ), batchRs->dataSize( opCtx.get() ) );
+        }
+
+        log() << "inserted " << nBatches << " batches of " << batchSize << " records: "
+              << singleMicros << " micros one at a time, " << batchMicros << " micros batched";
+    }
+
+}  // namespace mongo
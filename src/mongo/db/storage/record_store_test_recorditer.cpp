@@ -364,4 +364,62 @@ namespace mongo {
         }
     }
 
+    // Insert multiple records and read them in batches in both directions. The last batch is
+    // short, and the iterator is at EOF after it.
+    TEST( RecordStoreTestHarness, IterateInBatches ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
+
+        const int nToInsert = 10;
+        RecordId locs[nToInsert];
+        string datas[nToInsert];
+        for ( int i = 0; i < nToInsert; i++ ) {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                stringstream ss;
+                ss << "record " << i;
+                datas[i] = ss.str();
+
+                WriteUnitOfWork uow( opCtx.get() );
+                StatusWith<RecordId> res = rs->insertRecord( opCtx.get(),
+                                                            datas[i].c_str(),
+                                                            datas[i].size() + 1,
+                                                            false );
+                ASSERT_OK( res.getStatus() );
+                locs[i] = res.getValue();
+                uow.commit();
+            }
+        }
+
+        for ( int dir = 0; dir < 2; dir++ ) {
+            const bool forward = dir == 0;
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            scoped_ptr<RecordIterator> it( rs->getIterator( opCtx.get(),
+                                                            RecordId(),
+                                                            forward ?
+                                                            CollectionScanParams::FORWARD :
+                                                            CollectionScanParams::BACKWARD ) );
+
+            std::vector<RecordIdAndData> records;
+            ASSERT_EQUALS( 4U, it->getNextBatch( 4, &records ) );
+            ASSERT_EQUALS( 4U, it->getNextBatch( 4, &records ) );
+            ASSERT_EQUALS( 2U, it->getNextBatch( 4, &records ) );
+            ASSERT( it->isEOF() );
+            ASSERT_EQUALS( 0U, it->getNextBatch( 4, &records ) );
+
+            ASSERT_EQUALS( static_cast<size_t>( nToInsert ), records.size() );
+            for ( int i = 0; i < nToInsert; i++ ) {
+                // Compare against the records in the order they were read.
+                const RecordIdAndData& record = records[forward ? i : nToInsert - 1 - i];
+                int j = std::find( locs, locs + nToInsert, record.id ) - locs;
+                ASSERT( j < nToInsert );
+                ASSERT_EQUALS( datas[j], record.data.data() );
+                if ( i > 0 ) {
+                    const RecordIdAndData& prev = records[forward ? i - 1 : nToInsert - i];
+                    ASSERT( prev.id < record.id );
+                }
+            }
+        }
+    }
+
 } // namespace mongo
@@ -31,6 +31,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/db/record_id.h"
+#include "mongo/db/storage/index_entry_comparison.h"
 #include "mongo/db/storage/record_store.h"
 
 #pragma once
@@ -98,6 +99,26 @@ namespace mongo {
                               const RecordId& loc,
                               bool dupsAllowed) = 0;
 
+        /**
+         * Insert each of 'entries', in order, as insert() would.
+         *
+         * Stops at the first entry which can't be inserted and returns its error, with
+         * 'numInserted' set to the number of entries inserted before it. This lets the caller
+         * skip over the failed entry and continue with the rest.
+         */
+        virtual Status insertKeys(OperationContext* txn,
+                                  const std::vector<IndexKeyEntry>& entries,
+                                  bool dupsAllowed,
+                                  size_t* numInserted) {
+            for (*numInserted = 0; *numInserted < entries.size(); ++*numInserted) {
+                const IndexKeyEntry& entry = entries[*numInserted];
+                Status status = insert(txn, entry.key, entry.loc, dupsAllowed);
+                if (!status.isOK())
+                    return status;
+            }
+            return Status::OK();
+        }
+
         /**
          * Remove the entry from the index with the specified key and RecordId.
          *
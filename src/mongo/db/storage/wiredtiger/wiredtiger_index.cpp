@@ -200,6 +200,7 @@ namespace {
                                      const std::string& uri,
                                      const IndexDescriptor* desc)
         : _ordering(Ordering::make(desc->keyPattern())),
+          _keyEncoder(desc->keyPattern(), _ordering),
           _uri( uri ),
           _instanceId( WiredTigerSession::genCursorId() ),
           _collectionNamespace( desc->parentNS() ),
@@ -233,6 +234,32 @@ namespace {
         return _insert( c, key, loc, dupsAllowed );
     }
 
+    Status WiredTigerIndex::insertKeys(OperationContext* txn,
+                                       const std::vector<IndexKeyEntry>& entries,
+                                       bool dupsAllowed,
+                                       size_t* numInserted) {
+        // Share one cursor between all of the keys.
+        WiredTigerCursor curwrap(_uri, _instanceId, false, txn);
+        curwrap.assertInActiveTxn();
+        WT_CURSOR *c = curwrap.get();
+
+        for (*numInserted = 0; *numInserted < entries.size(); ++*numInserted) {
+            const IndexKeyEntry& entry = entries[*numInserted];
+            invariant(entry.loc.isNormal());
+            dassert(!hasFieldNames(entry.key));
+
+            Status s = checkKeySize(entry.key);
+            if (!s.isOK())
+                return s;
+
+            s = _insert(c, entry.key, entry.loc, dupsAllowed);
+            if (!s.isOK())
+                return s;
+        }
+
+        return Status::OK();
+    }
+
     void WiredTigerIndex::unindex(OperationContext* txn,
                                   const BSONObj& key,
                                   const RecordId& loc,
@@ -377,7 +404,8 @@ namespace {
     bool WiredTigerIndex::isDup(WT_CURSOR *c, const BSONObj& key, const RecordId& loc ) {
         invariant( unique() );
         // First check whether the key exists.
-        KeyString data( key, _ordering );
+        KeyString data;
+        _keyEncoder.resetToKey(&data, key);
         WiredTigerItem item( data.getBuffer(), data.getSize() );
         c->set_key( c, item.Get() );
         int ret = WT_OP_CHECK(c->search(c));
@@ -468,7 +496,8 @@ namespace {
                     return s;
             }
 
-            KeyString data( key, _idx->_ordering, loc );
+            KeyString data;
+            _idx->_keyEncoder.resetToKey(&data, key, loc);
 
             // Can't use WiredTigerCursor since we aren't using the cache.
             WiredTigerItem item(data.getBuffer(), data.getSize());
@@ -539,7 +568,7 @@ namespace {
             }
 
             _key = newKey.getOwned();
-            _keyString.resetToKey(_key, _idx->ordering());
+            _idx->keyEncoder().resetToKey(&_keyString, _key);
             _records.push_back(std::make_pair(loc, _keyString.getTypeBits()));
 
             return Status::OK();
@@ -852,7 +881,7 @@ namespace {
             if (loc.isNull())
                 loc = _forward ? RecordId::min() : RecordId::max();
 
-            query->resetToKey(key, _idx.ordering(), loc);
+            _idx.keyEncoder().resetToKey(query, key, loc);
         }
 
         virtual bool _locate(const KeyString& query, RecordId loc) {
@@ -881,7 +910,8 @@ namespace {
             TRACE_CURSOR << " fillQuery " << key << " " << loc
                          << (_forward ? " forward" : " backward");
 
-            query->resetToKey(key, _idx.ordering()); // loc doesn't go in _query for unique indexes
+            // loc doesn't go in _query for unique indexes
+            _idx.keyEncoder().resetToKey(query, key);
         }
 
         virtual bool _locate(const KeyString& query, RecordId loc) {
@@ -949,7 +979,8 @@ namespace {
                                            const RecordId& loc,
                                            bool dupsAllowed ) {
 
-        const KeyString data( key, _ordering );
+        KeyString data;
+        _keyEncoder.resetToKey(&data, key);
         WiredTigerItem keyItem( data.getBuffer(), data.getSize() );
 
         KeyString value(loc);
@@ -1013,7 +1044,8 @@ namespace {
                                           const BSONObj& key,
                                           const RecordId& loc,
                                           bool dupsAllowed ) {
-        KeyString data( key, _ordering );
+        KeyString data;
+        _keyEncoder.resetToKey(&data, key);
         WiredTigerItem keyItem( data.getBuffer(), data.getSize() );
         c->set_key( c, keyItem.Get() );
 
@@ -1111,7 +1143,8 @@ namespace {
 
         TRACE_INDEX << " key: " << keyBson << " loc: " << loc;
 
-        KeyString key( keyBson, _ordering, loc );
+        KeyString key;
+        _keyEncoder.resetToKey(&key, keyBson, loc);
         WiredTigerItem keyItem( key.getBuffer(), key.getSize() );
 
         WiredTigerItem valueItem = 
@@ -1136,7 +1169,8 @@ namespace {
                                             const RecordId& loc,
                                             bool dupsAllowed ) {
         invariant( dupsAllowed );
-        KeyString data( key, _ordering, loc );
+        KeyString data;
+        _keyEncoder.resetToKey(&data, key, loc);
         WiredTigerItem item( data.getBuffer(), data.getSize() );
         c->set_key(c, item.Get() );
         int ret = WT_OP_CHECK(c->remove(c));
@@ -33,6 +33,7 @@
 
 #include "mongo/base/status_with.h"
 #include "mongo/db/storage/index_entry_comparison.h"
+#include "mongo/db/storage/key_string.h"
 #include "mongo/db/storage/sorted_data_interface.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 
@@ -87,6 +88,11 @@ namespace mongo {
                               const RecordId& loc,
                               bool dupsAllowed);
 
+        virtual Status insertKeys(OperationContext* txn,
+                                  const std::vector<IndexKeyEntry>& entries,
+                                  bool dupsAllowed,
+                                  size_t* numInserted);
+
         virtual void unindex(OperationContext* txn,
                              const BSONObj& key,
                              const RecordId& loc,
@@ -110,6 +116,7 @@ namespace mongo {
 
         uint64_t instanceId() const { return _instanceId; }
         Ordering ordering() const { return _ordering; }
+        const KeyString::Encoder& keyEncoder() const { return _keyEncoder; }
 
         virtual bool unique() const = 0;
 
@@ -132,6 +139,7 @@ namespace mongo {
         class UniqueBulkBuilder;
 
         const Ordering _ordering;
+        const KeyString::Encoder _keyEncoder;
         std::string _uri;
         uint64_t _instanceId;
         std::string _collectionNamespace;
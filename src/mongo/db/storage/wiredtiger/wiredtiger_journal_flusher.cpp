@@ -0,0 +1,260 @@
+// wiredtiger_journal_flusher.cpp
+
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_journal_flusher.h"
+
+#include <algorithm>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    namespace {
+
+        // How long the flusher thread waits for more committers to join a group commit once
+        // somebody asked for one. 0 means that only the waiters, which arrive while the previous
+        // log sync is in progress get grouped.
+        MONGO_EXPORT_SERVER_PARAMETER(wiredTigerJournalFlushDelayMillis, int, 0);
+
+        const int kMaxFlushDelayMillis = 1000;
+
+        int batchBucket(unsigned long long batchSize) {
+            int bucket = 0;
+            for (unsigned long long bound = 2;
+                 bucket < WiredTigerJournalFlusher::kNumBatchBuckets - 1 && batchSize >= bound;
+                 bound *= 2) {
+                bucket++;
+            }
+            return bucket;
+        }
+
+        int waitBucket(long long micros) {
+            int bucket = 0;
+            for (long long bound = 10;
+                 bucket < WiredTigerJournalFlusher::kNumWaitBuckets - 1 && micros >= bound;
+                 bound *= 10) {
+                bucket++;
+            }
+            return bucket;
+        }
+
+        /**
+         * Commits an update of a single row with sync=true, which forces the log to disk up to and
+         * including the update. A transaction without any updates doesn't write a log record, so
+         * it wouldn't sync anything.
+         */
+        void syncLog(WT_SESSION* session, WT_CURSOR* cursor, unsigned long long flushNumber) {
+            invariantWTOK(session->begin_transaction(session, "sync=true"));
+            cursor->set_key(cursor, "lastFlush");
+            cursor->set_value(cursor, static_cast<uint64_t>(flushNumber));
+            int ret = cursor->insert(cursor);
+            if (ret != 0) {
+                invariantWTOK(session->rollback_transaction(session, NULL));
+                invariantWTOK(ret);
+            }
+            invariantWTOK(cursor->reset(cursor));
+            invariantWTOK(session->commit_transaction(session, NULL));
+        }
+
+    }
+
+    const char* const WiredTigerJournalFlusher::kTableUri = "table:journalFlush";
+
+    WiredTigerJournalFlusher::Stats::Stats()
+        : flushes(0),
+          waiters(0),
+          totalFlushMicros(0),
+          totalWaitMicros(0) {
+        std::fill(batchSizes, batchSizes + kNumBatchBuckets, 0);
+        std::fill(waitMicros, waitMicros + kNumWaitBuckets, 0);
+    }
+
+    WiredTigerJournalFlusher::WiredTigerJournalFlusher(WT_CONNECTION* conn)
+        : _conn(conn),
+          _lastRequested(0),
+          _lastFlushed(0),
+          _started(false),
+          _shuttingDown(false) {
+    }
+
+    WiredTigerJournalFlusher::~WiredTigerJournalFlusher() {
+        shutdown();
+    }
+
+    void WiredTigerJournalFlusher::start() {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        invariant(!_started && !_shuttingDown);
+        _started = true;
+
+        boost::thread t(stdx::bind(&WiredTigerJournalFlusher::_flusherThread, this));
+        _flusherThreadHandle.swap(t);
+    }
+
+    void WiredTigerJournalFlusher::shutdown() {
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            if (_shuttingDown)
+                return;
+            _shuttingDown = true;
+            if (!_started)
+                return;
+            _flushRequested.notify_one();
+        }
+        _flusherThreadHandle.join();
+    }
+
+    void WiredTigerJournalFlusher::waitUntilDurable() {
+        Timer timer;
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        if (_shuttingDown || !_started)
+            return;
+
+        const unsigned long long request = ++_lastRequested;
+        _flushRequested.notify_one();
+        while (_lastFlushed < request) {
+            _flushDone.wait(lk);
+        }
+
+        const long long micros = timer.micros();
+        _stats.waiters++;
+        _stats.totalWaitMicros += micros;
+        _stats.waitMicros[waitBucket(micros)]++;
+    }
+
+    WiredTigerJournalFlusher::Stats WiredTigerJournalFlusher::getStats() const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        return _stats;
+    }
+
+    void WiredTigerJournalFlusher::appendStats(BSONObjBuilder* b) const {
+        const Stats stats = getStats();
+
+        b->append("flushes", stats.flushes);
+        b->append("waiters", stats.waiters);
+        b->append("totalFlushMicros", stats.totalFlushMicros);
+        b->append("totalWaitMicros", stats.totalWaitMicros);
+
+        BSONObjBuilder batchSizes(b->subobjStart("batchSize"));
+        for (int i = 0; i < kNumBatchBuckets; i++) {
+            batchSizes.append(batchBucketName(i), stats.batchSizes[i]);
+        }
+        batchSizes.done();
+
+        BSONObjBuilder waitMicros(b->subobjStart("waitMicros"));
+        for (int i = 0; i < kNumWaitBuckets; i++) {
+            waitMicros.append(waitBucketName(i), stats.waitMicros[i]);
+        }
+        waitMicros.done();
+    }
+
+    const char* WiredTigerJournalFlusher::batchBucketName(int bucket) {
+        static const char* const names[kNumBatchBuckets] = {
+            "lt2", "lt4", "lt8", "lt16", "lt32", "lt64", "ge64"
+        };
+        invariant(bucket >= 0 && bucket < kNumBatchBuckets);
+        return names[bucket];
+    }
+
+    const char* WiredTigerJournalFlusher::waitBucketName(int bucket) {
+        static const char* const names[kNumWaitBuckets] = {
+            "lt10us", "lt100us", "lt1ms", "lt10ms", "lt100ms", "lt1s", "ge1s"
+        };
+        invariant(bucket >= 0 && bucket < kNumWaitBuckets);
+        return names[bucket];
+    }
+
+    void WiredTigerJournalFlusher::_flusherThread() {
+        setThreadName("WTJournalFlusher");
+        LOG(1) << "WiredTiger journal flusher thread started";
+
+        WiredTigerSession sessionWrapper(_conn);
+        WT_SESSION* session = sessionWrapper.getSession();
+
+        WT_CURSOR* cursor;
+        int ret = session->open_cursor(session, kTableUri, NULL, "overwrite=true", &cursor);
+        if (ret == ENOENT) {
+            invariantWTOK(session->create(session, kTableUri, "key_format=S,value_format=Q"));
+            ret = session->open_cursor(session, kTableUri, NULL, "overwrite=true", &cursor);
+        }
+        invariantWTOK(ret);
+
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        while (true) {
+            while (_lastFlushed == _lastRequested && !_shuttingDown) {
+                _flushRequested.wait(lk);
+            }
+
+            // Waiters which got in before shutdown still get their flush.
+            if (_lastFlushed == _lastRequested)
+                break;
+
+            const int delayMillis = std::min(wiredTigerJournalFlushDelayMillis,
+                                             kMaxFlushDelayMillis);
+            if (delayMillis > 0 && !_shuttingDown) {
+                lk.unlock();
+                sleepmillis(delayMillis);
+                lk.lock();
+            }
+
+            // Everybody who asked so far has committed before asking, so they all get covered.
+            const unsigned long long flushTo = _lastRequested;
+            lk.unlock();
+
+            Timer timer;
+            syncLog(session, cursor, flushTo);
+            const long long micros = timer.micros();
+
+            lk.lock();
+            _stats.flushes++;
+            _stats.totalFlushMicros += micros;
+            _stats.batchSizes[batchBucket(flushTo - _lastFlushed)]++;
+            _lastFlushed = flushTo;
+            _flushDone.notify_all();
+        }
+        lk.unlock();
+
+        invariantWTOK(cursor->close(cursor));
+        LOG(1) << "WiredTiger journal flusher thread stopped";
+    }
+
+}
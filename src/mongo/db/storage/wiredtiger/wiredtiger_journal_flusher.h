@@ -0,0 +1,143 @@
+// wiredtiger_journal_flusher.h
+
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <wiredtiger.h>
+
+#include "mongo/base/disallow_copying.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Makes the WiredTiger journal durable on behalf of the operations which asked for it (j:true
+     * writes and fsync), so that concurrent committers share a single log sync instead of each
+     * forcing their own.
+     *
+     * Every caller of waitUntilDurable() takes the next request number and blocks until the
+     * flusher thread has synced the log past it. The flusher thread picks up all the requests
+     * which are outstanding when it wakes up (optionally sleeping for
+     * wiredTigerJournalFlushDelayMillis first, so that more of them can join) and satisfies them
+     * all with one synced commit. Since WiredTiger syncs the log in LSN order, that commit
+     * covers every transaction, which committed before its waiter asked.
+     *
+     * Thread-safe.
+     */
+    class WiredTigerJournalFlusher {
+        MONGO_DISALLOW_COPYING(WiredTigerJournalFlusher);
+    public:
+        /**
+         * The table, which the flusher writes into in order to get a log record to sync.
+         */
+        static const char* const kTableUri;
+
+        enum { kNumBatchBuckets = 7 };
+        enum { kNumWaitBuckets = 7 };
+
+        struct Stats {
+            Stats();
+
+            long long flushes;
+            long long waiters;
+            long long totalFlushMicros;
+            long long totalWaitMicros;
+
+            // Number of flushes by the number of waiters they satisfied, in powers of two.
+            long long batchSizes[kNumBatchBuckets];
+
+            // Number of waiters by how long they waited, in powers of ten.
+            long long waitMicros[kNumWaitBuckets];
+        };
+
+        /**
+         * The connection must have logging enabled and must outlive the flusher.
+         */
+        explicit WiredTigerJournalFlusher(WT_CONNECTION* conn);
+        ~WiredTigerJournalFlusher();
+
+        /**
+         * Starts the flusher thread.
+         */
+        void start();
+
+        /**
+         * Satisfies the outstanding waiters and stops the flusher thread. Waiters, which arrive
+         * later return immediately, since closing the connection syncs the log anyways.
+         */
+        void shutdown();
+
+        /**
+         * Blocks until everything, which was committed before the call, is durable.
+         */
+        void waitUntilDurable();
+
+        Stats getStats() const;
+
+        void appendStats(BSONObjBuilder* b) const;
+
+        static const char* batchBucketName(int bucket);
+        static const char* waitBucketName(int bucket);
+
+    private:
+        void _flusherThread();
+
+        WT_CONNECTION* const _conn;
+
+        boost::thread _flusherThreadHandle;
+
+        // Guards all the members below.
+        mutable boost::mutex _mutex;
+
+        // Signalled when there are new requests for the flusher thread, or on shutdown.
+        boost::condition_variable _flushRequested;
+
+        // Signalled by the flusher thread whenever _lastFlushed advances.
+        boost::condition_variable _flushDone;
+
+        // The last request number handed out to a waiter.
+        unsigned long long _lastRequested;
+
+        // All the requests up to and including this number have been satisfied.
+        unsigned long long _lastFlushed;
+
+        bool _started;
+        bool _shuttingDown;
+
+        Stats _stats;
+    };
+
+}
@@ -0,0 +1,178 @@
+// wiredtiger_journal_flusher_test.cpp
+
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include <boost/thread/thread.hpp>
+#include <sstream>
+#include <string>
+
+#include "mongo/base/string_data.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_journal_flusher.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    using std::string;
+
+    namespace {
+
+        class LoggedConnection {
+        public:
+            explicit LoggedConnection(StringData dbpath) : _conn(NULL) {
+                std::stringstream ss;
+                ss << "create,log=(enabled=true)";
+                string config = ss.str();
+                int ret = wiredtiger_open(dbpath.toString().c_str(), NULL, config.c_str(), &_conn);
+                ASSERT_OK(wtRCToStatus(ret));
+                ASSERT(_conn);
+            }
+
+            ~LoggedConnection() {
+                _conn->close(_conn, NULL);
+            }
+
+            WT_CONNECTION* get() const { return _conn; }
+
+        private:
+            WT_CONNECTION* _conn;
+        };
+
+        long long sum(const long long* counts, int n) {
+            long long total = 0;
+            for (int i = 0; i < n; i++) {
+                total += counts[i];
+            }
+            return total;
+        }
+
+        void waitManyTimes(WiredTigerJournalFlusher* flusher, int times) {
+            for (int i = 0; i < times; i++) {
+                flusher->waitUntilDurable();
+            }
+        }
+
+    }
+
+    TEST(WiredTigerJournalFlusherTest, NotRunningReturnsImmediately) {
+        unittest::TempDir dbpath("wt_journal_flusher_test");
+        LoggedConnection conn(dbpath.path());
+
+        WiredTigerJournalFlusher flusher(conn.get());
+        flusher.waitUntilDurable();
+
+        flusher.start();
+        flusher.shutdown();
+        flusher.waitUntilDurable();
+
+        WiredTigerJournalFlusher::Stats stats = flusher.getStats();
+        ASSERT_EQUALS(0, stats.flushes);
+        ASSERT_EQUALS(0, stats.waiters);
+    }
+
+    TEST(WiredTigerJournalFlusherTest, SingleWaiter) {
+        unittest::TempDir dbpath("wt_journal_flusher_test");
+        LoggedConnection conn(dbpath.path());
+
+        WiredTigerJournalFlusher flusher(conn.get());
+        flusher.start();
+        flusher.waitUntilDurable();
+        flusher.waitUntilDurable();
+
+        WiredTigerJournalFlusher::Stats stats = flusher.getStats();
+        ASSERT_EQUALS(2, stats.flushes);
+        ASSERT_EQUALS(2, stats.waiters);
+        ASSERT_EQUALS(2, stats.batchSizes[0]);
+        ASSERT_EQUALS(2, sum(stats.waitMicros, WiredTigerJournalFlusher::kNumWaitBuckets));
+    }
+
+    TEST(WiredTigerJournalFlusherTest, ConcurrentWaitersAreGrouped) {
+        unittest::TempDir dbpath("wt_journal_flusher_test");
+        LoggedConnection conn(dbpath.path());
+
+        WiredTigerJournalFlusher flusher(conn.get());
+        flusher.start();
+
+        const int kThreads = 16;
+        const int kWaitsPerThread = 50;
+        boost::thread_group threads;
+        for (int i = 0; i < kThreads; i++) {
+            threads.create_thread(stdx::bind(waitManyTimes, &flusher, kWaitsPerThread));
+        }
+        threads.join_all();
+        flusher.shutdown();
+
+        WiredTigerJournalFlusher::Stats stats = flusher.getStats();
+        ASSERT_EQUALS(kThreads * kWaitsPerThread, stats.waiters);
+        ASSERT_LESS_THAN_OR_EQUALS(stats.flushes, stats.waiters);
+        ASSERT_EQUALS(stats.flushes,
+                      sum(stats.batchSizes, WiredTigerJournalFlusher::kNumBatchBuckets));
+        ASSERT_EQUALS(stats.waiters,
+                      sum(stats.waitMicros, WiredTigerJournalFlusher::kNumWaitBuckets));
+    }
+
+    TEST(WiredTigerJournalFlusherTest, FlushesAreRecorded) {
+        unittest::TempDir dbpath("wt_journal_flusher_test");
+        LoggedConnection conn(dbpath.path());
+
+        {
+            WiredTigerJournalFlusher flusher(conn.get());
+            flusher.start();
+            waitManyTimes(&flusher, 3);
+        }
+
+        WT_SESSION* session;
+        ASSERT_OK(wtRCToStatus(conn.get()->open_session(conn.get(), NULL, NULL, &session)));
+        WT_CURSOR* cursor;
+        ASSERT_OK(wtRCToStatus(session->open_cursor(session,
+                                                     WiredTigerJournalFlusher::kTableUri,
+                                                     NULL, NULL, &cursor)));
+        cursor->set_key(cursor, "lastFlush");
+        ASSERT_OK(wtRCToStatus(cursor->search(cursor)));
+        uint64_t lastFlush;
+        ASSERT_OK(wtRCToStatus(cursor->get_value(cursor, &lastFlush)));
+        ASSERT_EQUALS(3U, lastFlush);
+        ASSERT_OK(wtRCToStatus(session->close(session, NULL)));
+    }
+
+    TEST(WiredTigerJournalFlusherTest, BucketNames) {
+        ASSERT_EQUALS(string("lt2"), WiredTigerJournalFlusher::batchBucketName(0));
+        ASSERT_EQUALS(string("ge64"), WiredTigerJournalFlusher::batchBucketName(
+                          WiredTigerJournalFlusher::kNumBatchBuckets - 1));
+        ASSERT_EQUALS(string("lt10us"), WiredTigerJournalFlusher::waitBucketName(0));
+        ASSERT_EQUALS(string("ge1s"), WiredTigerJournalFlusher::waitBucketName(
+                          WiredTigerJournalFlusher::kNumWaitBuckets - 1));
+    }
+
+}
@@ -40,6 +40,7 @@
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_global_options.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_index.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_journal_flusher.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
@@ -58,6 +59,11 @@ namespace mongo {
     using std::set;
     using std::string;
 
+    namespace {
+        // Only the record stores whose sizes changed get written, so this is cheap when idle.
+        const int kSizeStorerSyncPeriodMillis = 60 * 1000;
+    }
+
 
     WiredTigerKVEngine::WiredTigerKVEngine( const std::string& path,
                                             const std::string& extraOpenOptions,
@@ -65,8 +71,7 @@ namespace mongo {
                                             bool repair )
         : _eventHandler(WiredTigerUtil::defaultEventHandlers()),
           _path( path ),
-          _durable( durable ),
-          _sizeStorerSyncTracker( 100000, 60 * 1000 ) {
+          _durable( durable ) {
 
         size_t cacheSizeGB = wiredTigerGlobalOptions.cacheSizeGB;
         if (cacheSizeGB == 0) {
@@ -133,6 +138,12 @@ namespace mongo {
             }
             _sizeStorer.reset(new WiredTigerSizeStorer(_conn, _sizeStorerUri));
             _sizeStorer->fillCache();
+            _sizeStorer->startSyncThread(kSizeStorerSyncPeriodMillis);
+        }
+
+        if ( _durable ) {
+            _journalFlusher.reset( new WiredTigerJournalFlusher( _conn ) );
+            _journalFlusher->start();
         }
     }
 
@@ -149,6 +160,9 @@ namespace mongo {
         log() << "WiredTigerKVEngine shutting down";
         syncSizeInfo(true);
         if (_conn) {
+            // Closing the connection syncs the journal, so late waiters need not be flushed.
+            _journalFlusher.reset( NULL );
+
             // these must be the last things we do before _conn->close();
             _sizeStorer.reset( NULL );
             _sessionCache->shuttingDown();
@@ -349,10 +363,6 @@ namespace mongo {
     }
 
     bool WiredTigerKVEngine::haveDropsQueued() const {
-        if ( _sizeStorerSyncTracker.intervalHasElapsed() ) {
-            _sizeStorerSyncTracker.resetLastTime();
-            syncSizeInfo(false);
-        }
         boost::lock_guard<boost::mutex> lk( _identToDropMutex );
         return !_identToDrop.empty();
     }
@@ -439,7 +449,7 @@ namespace mongo {
                 continue;
 
             StringData ident = key.substr(idx+1);
-            if ( ident == "sizeStorer" )
+            if ( ident == "sizeStorer" || ident == "journalFlush" )
                 continue;
 
             all.push_back( ident.toString() );
@@ -448,6 +458,11 @@ namespace mongo {
         return all;
     }
 
+    void WiredTigerKVEngine::waitUntilDurable() {
+        if ( _journalFlusher )
+            _journalFlusher->waitUntilDurable();
+    }
+
     int WiredTigerKVEngine::reconfigure(const char* str) {
         return _conn->reconfigure(_conn, str);
     }
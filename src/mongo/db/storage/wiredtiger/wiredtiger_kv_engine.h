@@ -42,10 +42,10 @@
 #include "mongo/bson/ordering.h"
 #include "mongo/db/storage/kv/kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
-#include "mongo/util/elapsed_tracker.h"
 
 namespace mongo {
 
+    class WiredTigerJournalFlusher;
     class WiredTigerSessionCache;
     class WiredTigerSizeStorer;
 
@@ -120,6 +120,17 @@ namespace mongo {
 
         void syncSizeInfo(bool sync) const;
 
+        /**
+         * Blocks until everything committed so far is in the journal. Concurrent callers are
+         * grouped into a single journal sync. Returns immediately if not durable.
+         */
+        void waitUntilDurable();
+
+        /**
+         * NULL if not durable.
+         */
+        WiredTigerJournalFlusher* getJournalFlusher() { return _journalFlusher.get(); }
+
         /**
          * Initializes a background job to remove excess documents in the oplog collections.
          * This applies to the capped collections in the local.oplog.* namespaces (specifically
@@ -150,9 +161,10 @@ namespace mongo {
         std::set<std::string> _identToDrop;
         mutable boost::mutex _identToDropMutex;
 
+        boost::scoped_ptr<WiredTigerJournalFlusher> _journalFlusher;
+
         boost::scoped_ptr<WiredTigerSizeStorer> _sizeStorer;
         std::string _sizeStorerUri;
-        mutable ElapsedTracker _sizeStorerSyncTracker;
     };
 
 }
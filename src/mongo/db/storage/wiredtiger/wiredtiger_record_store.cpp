@@ -35,8 +35,10 @@
 
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
 
+#include <algorithm>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_array.hpp>
+#include <cmath>
 #include <wiredtiger.h>
 
 #include "mongo/base/checked_cast.h"
@@ -46,6 +48,7 @@
 #include "mongo/db/storage/oplog_hack.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_global_options.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_record_store_oplog_stones.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_size_storer.h"
@@ -187,8 +190,8 @@ namespace {
               _cappedDeleteCheckCount(0),
               _useOplogHack(shouldUseOplogHack(ctx, _uri)),
               _sizeStorer( sizeStorer ),
-              _sizeStorerCounter(0),
-              _shuttingDown(false)
+              _sizeInfo( NULL ),
+              _shuttingDown(0)
     {
         Status versionStatus = WiredTigerUtil::checkApplicationMetadataFormatVersion(
             ctx, uri, kMinimumRecordStoreVersion, kMaximumRecordStoreVersion);
@@ -214,7 +217,7 @@ namespace {
             // Need to start at 1 so we are always higher than RecordId::min()
             _nextIdNum.store( 1 );
             if ( sizeStorer )
-                _sizeStorer->onCreate( this, 0, 0 );
+                _sizeInfo = _sizeStorer->onCreate( this, 0, 0 );
         }
         else {
             RecordId maxLoc = iterator->curr();
@@ -228,7 +231,7 @@ namespace {
                 _sizeStorer->loadFromCache( uri, &numRecords, &dataSize );
                 _numRecords.store( numRecords );
                 _dataSize.store( dataSize );
-                _sizeStorer->onCreate( this, numRecords, dataSize );
+                _sizeInfo = _sizeStorer->onCreate( this, numRecords, dataSize );
             }
 
             if (_sizeStorer == NULL || _numRecords.load() < kCollectionScanOnCreationThreshold) {
@@ -251,13 +254,21 @@ namespace {
 
         }
 
+        if (_isOplog && _isCapped) {
+            _oplogStones.reset(new OplogStones(ctx, this));
+        }
+
         _hasBackgroundThread = WiredTigerKVEngine::initRsOplogBackgroundThread(ns);
     }
 
     WiredTigerRecordStore::~WiredTigerRecordStore() {
         {
             boost::lock_guard<boost::timed_mutex> lk(_cappedDeleterMutex);
-            _shuttingDown = true;
+            _shuttingDown.store(1);
+        }
+
+        if (_oplogStones) {
+            _oplogStones->kill();
         }
 
         LOG(1) << "~WiredTigerRecordStore for: " << ns();
@@ -266,13 +277,17 @@ namespace {
         }
     }
 
+    void WiredTigerRecordStore::setSizeStorer( WiredTigerSizeStorer* ss ) {
+        _sizeStorer = ss;
+        _sizeInfo = ss ? ss->onCreate( this, _numRecords.load(), _dataSize.load() ) : NULL;
+    }
+
     const char* WiredTigerRecordStore::name() const {
         return kWiredTigerEngineName.c_str();
     }
 
     bool WiredTigerRecordStore::inShutdown() const {
-        boost::lock_guard<boost::timed_mutex> lk(_cappedDeleterMutex);
-        return _shuttingDown;
+        return _shuttingDown.load();
     }
 
     long long WiredTigerRecordStore::dataSize( OperationContext *txn ) const {
@@ -394,12 +409,37 @@ namespace {
         // This variable isn't thread safe, but has loose semantics anyway.
         dassert( !_isOplog || _cappedMaxDocs == -1 );
 
-        if (!cappedAndNeedDelete())
-            return 0;
-
         // ensure only one thread at a time can do deletes, otherwise they'll conflict.
         boost::unique_lock<boost::timed_mutex> lock(_cappedDeleterMutex, boost::defer_lock);
 
+        if (_oplogStones) {
+            // The oplog is reclaimed a whole stone at a time, see ::reclaimOplog.
+            if (_hasBackgroundThread) {
+                // Only apply back pressure once the background thread is more than a stone
+                // behind, since it never truncates less than that.
+                if ((_dataSize.load() - _cappedMaxSize) <
+                        (_cappedMaxSizeSlack + _oplogStones->minBytesPerStone())) {
+                    return 0;
+                }
+
+                // Don't wait forever: we're in a transaction, we could block eviction.
+                (void)lock.timed_lock(boost::posix_time::millisec(200));
+                return 0;
+            }
+
+            // Without a background thread (e.g. during repair) reclaim inline.
+            if (!_oplogStones->hasExcessStones() || !lock.try_lock())
+                return 0;
+
+            int64_t recordsRemoved = 0;
+            int64_t bytesRemoved = 0;
+            reclaimOplog(txn, &recordsRemoved, &bytesRemoved);
+            return recordsRemoved;
+        }
+
+        if (!cappedAndNeedDelete())
+            return 0;
+
         if (_cappedMaxDocs != -1) {
             lock.lock(); // Max docs has to be exact, so have to check every time.
         }
@@ -480,7 +520,7 @@ namespace {
                 if ( newestOld >= justInserted ) // TODO: use oldest uncommitted instead
                     break;
 
-                if ( _shuttingDown )
+                if ( _shuttingDown.load() )
                     break;
 
                 WT_ITEM old_value;
@@ -545,6 +585,87 @@ namespace {
         return docsRemoved;
     }
 
+    void WiredTigerRecordStore::reclaimOplog(OperationContext* txn,
+                                             int64_t* recordsRemoved,
+                                             int64_t* bytesRemoved) {
+        invariant(_oplogStones);
+
+        OplogStones::Stone stone(0, 0, RecordId());
+        while (!_shuttingDown.load() && _oplogStones->peekOldestStoneIfNeeded(&stone)) {
+            invariant(stone.lastRecord.isNormal());
+            LOG(1) << "Truncating the oplog through " << stone.lastRecord << " to remove "
+                   << "approximately " << stone.records << " records totaling "
+                   << stone.bytes << " bytes";
+
+            // we do this is a side transaction in case it aborts
+            WiredTigerRecoveryUnit* realRecoveryUnit =
+                checked_cast<WiredTigerRecoveryUnit*>( txn->releaseRecoveryUnit() );
+            invariant( realRecoveryUnit );
+            WiredTigerSessionCache* sc = realRecoveryUnit->getSessionCache();
+            txn->setRecoveryUnit( new WiredTigerRecoveryUnit( sc ) );
+
+            WiredTigerRecoveryUnit::get(txn)->markNoTicketRequired();
+            WT_SESSION* session = WiredTigerRecoveryUnit::get(txn)->getSession(txn)->getSession();
+
+            bool truncated = false;
+            try {
+                WriteUnitOfWork wuow(txn);
+
+                WiredTigerCursor startWrap( _uri, _instanceId, true, txn);
+                WT_CURSOR* start = startWrap.get();
+                int ret = WT_OP_CHECK(start->next(start));
+
+                WiredTigerCursor endWrap( _uri, _instanceId, true, txn);
+                WT_CURSOR* end = endWrap.get();
+                if (ret == 0) {
+                    // Position on the newest record at or before the end of the stone.
+                    int cmp;
+                    end->set_key(end, _makeKey(stone.lastRecord));
+                    ret = WT_OP_CHECK(end->search_near(end, &cmp));
+                    if (ret == 0 && cmp > 0)
+                        ret = WT_OP_CHECK(end->prev(end));
+                }
+
+                if (ret == WT_NOTFOUND) {
+                    // The records of the stone are already gone, so there is nothing to truncate.
+                    truncated = true;
+                }
+                else {
+                    invariantWTOK(ret);
+                    ret = session->truncate(session, NULL, start, end, NULL);
+                    if (ret == ENOENT || ret == WT_NOTFOUND) {
+                        log() << "Soft failure truncating the oplog. Will try again later.";
+                    }
+                    else {
+                        invariantWTOK(ret);
+                        _changeNumRecords(txn, -stone.records);
+                        _increaseDataSize(txn, -stone.bytes);
+                        wuow.commit();
+                        truncated = true;
+                    }
+                }
+            }
+            catch ( const WriteConflictException& wce ) {
+                log() << "got conflict truncating the oplog, ignoring";
+            }
+            catch ( ... ) {
+                delete txn->releaseRecoveryUnit();
+                txn->setRecoveryUnit( realRecoveryUnit );
+                throw;
+            }
+
+            delete txn->releaseRecoveryUnit();
+            txn->setRecoveryUnit( realRecoveryUnit );
+
+            if (!truncated)
+                return;
+
+            _oplogStones->popOldestStone();
+            *recordsRemoved += stone.records;
+            *bytesRemoved += stone.bytes;
+        }
+    }
+
     StatusWith<RecordId> WiredTigerRecordStore::extractAndCheckLocForOplog(const char* data,
                                                                            int len) {
         return oploghack::extractKey(data, len);
@@ -597,11 +718,107 @@ namespace {
         _changeNumRecords( txn, 1 );
         _increaseDataSize( txn, len );
 
+        if (_oplogStones) {
+            _oplogStones->updateCurrentStoneAfterInsertOnCommit(txn, len, loc, 1);
+        }
+
         cappedDeleteAsNeeded(txn, loc);
 
         return StatusWith<RecordId>( loc );
     }
 
+    Status WiredTigerRecordStore::insertRecords( OperationContext* txn,
+                                                 const std::vector<RecordData>& records,
+                                                 std::vector<RecordId>* locsOut,
+                                                 bool enforceQuota ) {
+        if ( records.empty() )
+            return Status::OK();
+
+        // Capped collections delete as needed after each record.  The oplog is reclaimed a stone
+        // at a time, not per record, so it can still be inserted as a batch.
+        if ( _isCapped && !_oplogStones )
+            return RecordStore::insertRecords( txn, records, locsOut, enforceQuota );
+
+        int64_t totalLength = 0;
+        for ( size_t i = 0; i < records.size(); i++ ) {
+            if ( _isCapped && records[i].size() > _cappedMaxSize ) {
+                return Status( ErrorCodes::BadValue, "object to insert exceeds cappedMaxSize" );
+            }
+            totalLength += records[i].size();
+        }
+
+        // Assign every RecordId up front, so that they are allocated in one step.
+        const size_t firstLoc = locsOut->size();
+        if ( _useOplogHack ) {
+            RecordId highest;
+            for ( size_t i = 0; i < records.size(); i++ ) {
+                StatusWith<RecordId> status = extractAndCheckLocForOplog(records[i].data(),
+                                                                         records[i].size());
+                if (!status.isOK())
+                    return status.getStatus();
+                locsOut->push_back( status.getValue() );
+                if ( status.getValue() > highest )
+                    highest = status.getValue();
+            }
+            if ( highest > _oplog_highestSeen ) {
+                boost::lock_guard<boost::mutex> lk( _uncommittedDiskLocsMutex );
+                if ( highest > _oplog_highestSeen ) {
+                    _oplog_highestSeen = highest;
+                }
+            }
+        }
+        else if ( _isCapped ) {
+            boost::lock_guard<boost::mutex> lk( _uncommittedDiskLocsMutex );
+            for ( size_t i = 0; i < records.size(); i++ ) {
+                RecordId loc = _nextId();
+                _addUncommitedDiskLoc_inlock( txn, loc );
+                locsOut->push_back( loc );
+            }
+        }
+        else {
+            const int64_t first = _nextIdNum.fetchAndAdd( records.size() );
+            for ( size_t i = 0; i < records.size(); i++ ) {
+                RecordId loc( first + i );
+                invariant( loc.isNormal() );
+                locsOut->push_back( loc );
+            }
+        }
+
+        // Insert through a single cursor.
+        WiredTigerCursor curwrap( _uri, _instanceId, true, txn);
+        curwrap.assertInActiveTxn();
+        WT_CURSOR *c = curwrap.get();
+        invariant( c );
+
+        RecordId highestLoc;
+        for ( size_t i = 0; i < records.size(); i++ ) {
+            const RecordId& loc = (*locsOut)[firstLoc + i];
+            c->set_key(c, _makeKey(loc));
+            WiredTigerItem value(records[i].data(), records[i].size());
+            c->set_value(c, value.Get());
+            int ret = WT_OP_CHECK(c->insert(c));
+            if (ret) {
+                return wtRCToStatus(ret, "WiredTigerRecordStore::insertRecords");
+            }
+            if ( loc > highestLoc )
+                highestLoc = loc;
+        }
+
+        _changeNumRecords( txn, records.size() );
+        _increaseDataSize( txn, totalLength );
+
+        if (_oplogStones) {
+            _oplogStones->updateCurrentStoneAfterInsertOnCommit(txn,
+                                                                totalLength,
+                                                                highestLoc,
+                                                                records.size());
+        }
+
+        cappedDeleteAsNeeded(txn, highestLoc);
+
+        return Status::OK();
+    }
+
     void WiredTigerRecordStore::dealtWithCappedLoc( const RecordId& loc ) {
         boost::lock_guard<boost::mutex> lk( _uncommittedDiskLocsMutex );
         SortedDiskLocs::iterator it = std::find(_uncommittedDiskLocs.begin(),
@@ -722,6 +939,10 @@ namespace {
             deleteRecord( txn, loc );
         }
 
+        if (_oplogStones) {
+            _oplogStones->clearStonesOnCommit(txn);
+        }
+
         return Status::OK();
     }
 
@@ -973,7 +1194,7 @@ namespace {
 
     class WiredTigerRecordStore::DataSizeChange : public RecoveryUnit::Change {
     public:
-        DataSizeChange(WiredTigerRecordStore* rs, int amount) :_rs(rs), _amount(amount) {}
+        DataSizeChange(WiredTigerRecordStore* rs, int64_t amount) :_rs(rs), _amount(amount) {}
         virtual void commit() {}
         virtual void rollback() {
             _rs->_increaseDataSize( NULL, -_amount );
@@ -981,10 +1202,10 @@ namespace {
 
     private:
         WiredTigerRecordStore* _rs;
-        bool _amount;
+        int64_t _amount;
     };
 
-    void WiredTigerRecordStore::_increaseDataSize( OperationContext* txn, int amount ) {
+    void WiredTigerRecordStore::_increaseDataSize( OperationContext* txn, int64_t amount ) {
         if ( txn )
             txn->recoveryUnit()->registerChange(new DataSizeChange(this, amount));
 
@@ -997,8 +1218,8 @@ namespace {
             }
         }
 
-        if ( _sizeStorer && _sizeStorerCounter++ % 1000 == 0 ) {
-            _sizeStorer->storeToCache( _uri, _numRecords.load(), _dataSize.load() );
+        if ( _sizeInfo ) {
+            _sizeStorer->markDirty( _sizeInfo );
         }
     }
 
@@ -1250,17 +1471,336 @@ namespace {
         }
     }
 
+    size_t WiredTigerRecordStore::Iterator::getNextBatch( size_t maxRecords,
+                                                          std::vector<RecordIdAndData>* out ) {
+        size_t n = 0;
+        while ( n < maxRecords && !_eof ) {
+            RecordIdAndData record;
+            record.id = _loc;
+            record.data = _rs._getData(*_cursor);
+
+            // If this throws, the cursor is still on the record, so it isn't returned yet.
+            _getNext();
+            _lastLoc = record.id;
+
+            out->push_back( record );
+            n++;
+        }
+        return n;
+    }
+
     void WiredTigerRecordStore::temp_cappedTruncateAfter( OperationContext* txn,
                                                           RecordId end,
                                                           bool inclusive ) {
+        RecordId firstRemovedId;
+        int64_t recordsRemoved = 0;
+        int64_t bytesRemoved = 0;
+
         WriteUnitOfWork wuow(txn);
         boost::scoped_ptr<RecordIterator> iter( getIterator( txn, end ) );
         while( !iter->isEOF() ) {
             RecordId loc = iter->getNext();
             if ( end < loc || ( inclusive && end == loc ) ) {
+                if ( _oplogStones ) {
+                    if ( recordsRemoved == 0 )
+                        firstRemovedId = loc;
+                    recordsRemoved++;
+                    bytesRemoved += dataFor( txn, loc ).size();
+                }
                 deleteRecord( txn, loc );
             }
         }
         wuow.commit();
+
+        if ( _oplogStones && recordsRemoved > 0 ) {
+            _oplogStones->updateStonesAfterCappedTruncateAfter(recordsRemoved,
+                                                               bytesRemoved,
+                                                               firstRemovedId);
+        }
+    }
+
+    // -------- OplogStones
+
+    class WiredTigerRecordStore::OplogStones::InsertChange : public RecoveryUnit::Change {
+    public:
+        InsertChange(OplogStones* oplogStones,
+                     int64_t bytesInserted,
+                     const RecordId& highestInserted,
+                     int64_t countInserted)
+            : _oplogStones(oplogStones),
+              _bytesInserted(bytesInserted),
+              _highestInserted(highestInserted),
+              _countInserted(countInserted) {
+        }
+
+        virtual void commit() {
+            _oplogStones->_currentRecords.addAndFetch(_countInserted);
+            int64_t newCurrentBytes = _oplogStones->_currentBytes.addAndFetch(_bytesInserted);
+            if (newCurrentBytes >= _oplogStones->_minBytesPerStone) {
+                _oplogStones->_createNewStoneIfNeeded(_highestInserted);
+            }
+        }
+
+        virtual void rollback() {}
+
+    private:
+        OplogStones* _oplogStones;
+        int64_t _bytesInserted;
+        RecordId _highestInserted;
+        int64_t _countInserted;
+    };
+
+    class WiredTigerRecordStore::OplogStones::TruncateChange : public RecoveryUnit::Change {
+    public:
+        TruncateChange(OplogStones* oplogStones) : _oplogStones(oplogStones) {}
+
+        virtual void commit() {
+            boost::lock_guard<boost::mutex> lk(_oplogStones->_mutex);
+            _oplogStones->_currentRecords.store(0);
+            _oplogStones->_currentBytes.store(0);
+            _oplogStones->_stones.clear();
+        }
+
+        virtual void rollback() {}
+
+    private:
+        OplogStones* _oplogStones;
+    };
+
+    WiredTigerRecordStore::OplogStones::OplogStones(OperationContext* txn,
+                                                    WiredTigerRecordStore* rs)
+        : _rs(rs),
+          _isDead(false) {
+        invariant(rs->isCapped());
+        invariant(rs->cappedMaxSize() > 0);
+
+        // Keep enough stones that truncating one removes a small part of the oplog, but no more
+        // than one per maximum size document.
+        const int64_t kMinStonesToKeep = 10;
+        const int64_t kMaxStonesToKeep = 100;
+        int64_t numStonesToKeep = rs->cappedMaxSize() / BSONObjMaxInternalSize;
+        _numStonesToKeep = std::min(kMaxStonesToKeep, std::max(kMinStonesToKeep, numStonesToKeep));
+        _minBytesPerStone = rs->cappedMaxSize() / _numStonesToKeep;
+        invariant(_minBytesPerStone > 0);
+
+        _calculateStones(txn);
+        _pokeReclaimThreadIfNeeded(); // Reclaim stones if over the limit.
+    }
+
+    void WiredTigerRecordStore::OplogStones::kill() {
+        boost::lock_guard<boost::mutex> lk(_oplogReclaimMutex);
+        _isDead = true;
+        _oplogReclaimCv.notify_one();
+    }
+
+    bool WiredTigerRecordStore::OplogStones::isDead() const {
+        boost::lock_guard<boost::mutex> lk(_oplogReclaimMutex);
+        return _isDead;
+    }
+
+    bool WiredTigerRecordStore::OplogStones::hasExcessStones() const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        return _stones.size() > _numStonesToKeep;
+    }
+
+    void WiredTigerRecordStore::OplogStones::awaitHasExcessStonesOrDead() {
+        boost::unique_lock<boost::mutex> lock(_oplogReclaimMutex);
+        if (_isDead || hasExcessStones())
+            return;
+
+        _oplogReclaimCv.timed_wait(lock, boost::posix_time::seconds(1));
+    }
+
+    bool WiredTigerRecordStore::OplogStones::peekOldestStoneIfNeeded(Stone* stone) const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        if (_stones.size() <= _numStonesToKeep)
+            return false;
+
+        *stone = _stones.front();
+        return true;
+    }
+
+    void WiredTigerRecordStore::OplogStones::popOldestStone() {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        _stones.pop_front();
+    }
+
+    void WiredTigerRecordStore::OplogStones::updateCurrentStoneAfterInsertOnCommit(
+            OperationContext* txn,
+            int64_t bytesInserted,
+            const RecordId& highestInserted,
+            int64_t countInserted) {
+        txn->recoveryUnit()->registerChange(
+            new InsertChange(this, bytesInserted, highestInserted, countInserted));
+    }
+
+    void WiredTigerRecordStore::OplogStones::clearStonesOnCommit(OperationContext* txn) {
+        txn->recoveryUnit()->registerChange(new TruncateChange(this));
+    }
+
+    void WiredTigerRecordStore::OplogStones::updateStonesAfterCappedTruncateAfter(
+            int64_t recordsRemoved,
+            int64_t bytesRemoved,
+            const RecordId& firstRemovedId) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+
+        // Every stone ending at or after the first removed record lost some or all of its
+        // records, so fold what is left of them into the unfinished stone.
+        int64_t recordsInRemovedStones = 0;
+        int64_t bytesInRemovedStones = 0;
+        while (!_stones.empty() && _stones.back().lastRecord >= firstRemovedId) {
+            recordsInRemovedStones += _stones.back().records;
+            bytesInRemovedStones += _stones.back().bytes;
+            _stones.pop_back();
+        }
+
+        _currentRecords.addAndFetch(recordsInRemovedStones - recordsRemoved);
+        _currentBytes.addAndFetch(bytesInRemovedStones - bytesRemoved);
+    }
+
+    size_t WiredTigerRecordStore::OplogStones::numStones() const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        return _stones.size();
+    }
+
+    void WiredTigerRecordStore::OplogStones::setMinBytesPerStone(int64_t size) {
+        invariant(size > 0);
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+
+        // Only allow changing the minimum bytes per stone if no data has been inserted.
+        invariant(_stones.empty() && _currentRecords.load() == 0);
+        _minBytesPerStone = size;
+    }
+
+    void WiredTigerRecordStore::OplogStones::_calculateStones(OperationContext* txn) {
+        long long numRecords = _rs->numRecords(txn);
+        long long dataSize = _rs->dataSize(txn);
+
+        LOG(1) << "The oplog contains approximately " << numRecords << " records totaling "
+               << dataSize << " bytes";
+
+        // Only sample when the samples are at most 5% of the oplog, otherwise scanning it is
+        // about as cheap and gives exact stones.
+        const int64_t kMinSampleRatioForRandCursor = 20;
+        if (numRecords <= 0 || dataSize <= 0 ||
+            numRecords < kMinSampleRatioForRandCursor * kRandomSamplesPerStone *
+                             static_cast<int64_t>(_numStonesToKeep)) {
+            _calculateStonesByScanning(txn);
+            return;
+        }
+
+        // Use the average record size to estimate how many records make up a stone.
+        double avgRecordSize = static_cast<double>(dataSize) / numRecords;
+        double estRecordsPerStone = std::ceil(_minBytesPerStone / avgRecordSize);
+        double estBytesPerStone = estRecordsPerStone * avgRecordSize;
+
+        _calculateStonesBySampling(txn,
+                                   static_cast<int64_t>(estRecordsPerStone),
+                                   static_cast<int64_t>(estBytesPerStone));
+    }
+
+    void WiredTigerRecordStore::OplogStones::_calculateStonesByScanning(OperationContext* txn) {
+        log() << "Scanning the oplog to determine where to place markers for truncation";
+
+        _currentRecords.store(0);
+        _currentBytes.store(0);
+
+        WiredTigerCursor curwrap(_rs->getURI(), _rs->instanceId(), true, txn);
+        WT_CURSOR* c = curwrap.get();
+        int ret;
+        while ((ret = c->next(c)) == 0) {
+            int64_t key;
+            invariantWTOK(c->get_key(c, &key));
+            WT_ITEM value;
+            invariantWTOK(c->get_value(c, &value));
+
+            _currentRecords.addAndFetch(1);
+            int64_t newCurrentBytes = _currentBytes.addAndFetch(value.size);
+            if (newCurrentBytes >= _minBytesPerStone) {
+                _stones.push_back(Stone(_currentRecords.swap(0),
+                                        _currentBytes.swap(0),
+                                        _fromKey(key)));
+            }
+        }
+        invariant(ret == WT_NOTFOUND);
+    }
+
+    void WiredTigerRecordStore::OplogStones::_calculateStonesBySampling(
+            OperationContext* txn,
+            int64_t estRecordsPerStone,
+            int64_t estBytesPerStone) {
+        long long numRecords = _rs->numRecords(txn);
+        long long dataSize = _rs->dataSize(txn);
+
+        log() << "Sampling from the oplog to determine where to place markers for truncation";
+
+        int64_t wholeStones = numRecords / estRecordsPerStone;
+        int64_t numSamples = kRandomSamplesPerStone * numRecords / estRecordsPerStone;
+
+        std::vector<RecordId> oplogEstimates;
+        oplogEstimates.reserve(numSamples);
+        {
+            WT_SESSION* session = WiredTigerRecoveryUnit::get(txn)->getSession(txn)->getSession();
+            WT_CURSOR* c;
+            invariantWTOK(session->open_cursor(session, _rs->getURI().c_str(), NULL,
+                                               "next_random=true", &c));
+            for (int64_t i = 0; i < numSamples; ++i) {
+                int ret = c->next(c);
+                if (ret == WT_NOTFOUND) {
+                    // The random cursor can come back empty handed on a nonempty table.
+                    invariantWTOK(c->close(c));
+                    _calculateStonesByScanning(txn);
+                    return;
+                }
+                invariantWTOK(ret);
+
+                int64_t key;
+                invariantWTOK(c->get_key(c, &key));
+                oplogEstimates.push_back(_fromKey(key));
+            }
+            invariantWTOK(c->close(c));
+        }
+        std::sort(oplogEstimates.begin(), oplogEstimates.end());
+
+        // Every kRandomSamplesPerStone-th sample marks the end of a stone.
+        for (int64_t i = 1; i <= wholeStones; ++i) {
+            const RecordId& lastRecord = oplogEstimates[kRandomSamplesPerStone * i - 1];
+            _stones.push_back(Stone(estRecordsPerStone, estBytesPerStone, lastRecord));
+        }
+
+        // The rest of the oplog makes up the unfinished stone.
+        _currentRecords.store(numRecords - estRecordsPerStone * wholeStones);
+        _currentBytes.store(dataSize - estBytesPerStone * wholeStones);
+    }
+
+    void WiredTigerRecordStore::OplogStones::_createNewStoneIfNeeded(const RecordId& lastRecord) {
+        boost::unique_lock<boost::mutex> lk(_mutex, boost::try_to_lock);
+        if (!lk) {
+            // Another thread is already creating a stone.
+            return;
+        }
+
+        if (_currentBytes.load() < _minBytesPerStone) {
+            // Another thread created a stone in the meantime.
+            return;
+        }
+
+        if (!_stones.empty() && lastRecord <= _stones.back().lastRecord) {
+            // Inserts can commit out of order, so leave it to a later one to close the stone.
+            return;
+        }
+
+        _stones.push_back(Stone(_currentRecords.swap(0), _currentBytes.swap(0), lastRecord));
+        lk.unlock();
+
+        _pokeReclaimThreadIfNeeded();
+    }
+
+    void WiredTigerRecordStore::OplogStones::_pokeReclaimThreadIfNeeded() {
+        if (hasExcessStones()) {
+            boost::lock_guard<boost::mutex> lk(_oplogReclaimMutex);
+            _oplogReclaimCv.notify_one();
+        }
     }
 }
@@ -35,11 +35,13 @@
 #include <string>
 
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include "mongo/db/catalog/collection_options.h"
 #include "mongo/db/storage/record_store.h"
 #include "mongo/db/storage/capped_callback.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_size_storer.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/util/fail_point_service.h"
 
@@ -54,13 +56,14 @@ namespace mongo {
     class RecoveryUnit;
     class WiredTigerCursor;
     class WiredTigerRecoveryUnit;
-    class WiredTigerSizeStorer;
 
     extern const std::string kWiredTigerEngineName;
 
     class WiredTigerRecordStore : public RecordStore {
     public:
 
+        class OplogStones;
+
         /**
          * During record store creation, if size storer reports a record count under
          * 'kCollectionScanOnCreationThreshold', perform a collection scan to update size storer
@@ -131,6 +134,11 @@ namespace mongo {
                                                   const DocWriter* doc,
                                                   bool enforceQuota );
 
+        virtual Status insertRecords( OperationContext* txn,
+                                      const std::vector<RecordData>& records,
+                                      std::vector<RecordId>* locsOut,
+                                      bool enforceQuota );
+
         virtual StatusWith<RecordId> updateRecord( OperationContext* txn,
                                                   const RecordId& oldLocation,
                                                   const char* data,
@@ -200,7 +208,7 @@ namespace mongo {
         const std::string& getURI() const { return _uri; }
         uint64_t instanceId() const { return _instanceId; }
 
-        void setSizeStorer( WiredTigerSizeStorer* ss ) { _sizeStorer = ss; }
+        void setSizeStorer( WiredTigerSizeStorer* ss );
 
         void dealtWithCappedLoc( const RecordId& loc );
         bool isCappedHidden( const RecordId& loc ) const;
@@ -213,6 +221,17 @@ namespace mongo {
                                             const RecordId& justInserted);
 
         boost::timed_mutex& cappedDeleterMutex() { return _cappedDeleterMutex; }
+
+        /**
+         * Truncates the oplog a whole stone at a time until there are no excess stones, and adds
+         * the number of records and bytes removed to the out parameters. The caller must hold
+         * cappedDeleterMutex().
+         */
+        void reclaimOplog(OperationContext* txn, int64_t* recordsRemoved, int64_t* bytesRemoved);
+
+        /** Returns NULL unless this is a capped oplog. */
+        boost::shared_ptr<OplogStones> getOplogStones() const { return _oplogStones; }
+
     private:
 
         class Iterator : public RecordIterator {
@@ -232,6 +251,8 @@ namespace mongo {
             virtual void saveState();
             virtual bool restoreState(OperationContext *txn);
             virtual RecordData dataFor( const RecordId& loc ) const;
+            virtual size_t getNextBatch( size_t maxRecords, std::vector<RecordIdAndData>* out );
+            virtual bool hasNativeBatches() const { return true; }
 
         private:
             void _getNext();
@@ -266,7 +287,7 @@ namespace mongo {
         void _setId(RecordId loc);
         bool cappedAndNeedDelete() const;
         void _changeNumRecords(OperationContext* txn, int64_t diff);
-        void _increaseDataSize(OperationContext* txn, int amount);
+        void _increaseDataSize(OperationContext* txn, int64_t amount);
         RecordData _getData( const WiredTigerCursor& cursor) const;
         StatusWith<RecordId> extractAndCheckLocForOplog(const char* data, int len);
         void _oplogSetStartHack( WiredTigerRecoveryUnit* wru ) const;
@@ -297,10 +318,13 @@ namespace mongo {
         AtomicInt64 _numRecords;
 
         WiredTigerSizeStorer* _sizeStorer; // not owned, can be NULL
-        int _sizeStorerCounter;
+        WiredTigerSizeStorer::SizeInfo* _sizeInfo; // owned by _sizeStorer, NULL if it is
 
-        bool _shuttingDown;
+        AtomicUInt32 _shuttingDown; // Used as boolean - 0 = false, 1 = true
         bool _hasBackgroundThread;
+
+        // Non-NULL for a capped oplog. Shared with the background thread, which waits on it.
+        boost::shared_ptr<OplogStones> _oplogStones;
     };
 
     // WT failpoint to throw write conflict exceptions randomly
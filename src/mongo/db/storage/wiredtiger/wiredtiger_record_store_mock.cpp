@@ -32,6 +32,7 @@
 #include "mongo/platform/basic.h"
 
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 
 namespace mongo {
 
@@ -40,4 +41,9 @@ namespace mongo {
         return false;
     }
 
+    // static
+    TicketHolder::Priority WiredTigerRecoveryUnit::ticketPriority(OperationContext* opCtx) {
+        return TicketHolder::kInteractive;
+    }
+
 }  // namespace mongo
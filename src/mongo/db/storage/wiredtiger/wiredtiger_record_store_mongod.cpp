@@ -35,20 +35,25 @@
 #include <set>
 
 #include "mongo/base/checked_cast.h"
+#include "mongo/base/counter.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/client.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/concurrency/d_concurrency.h"
+#include "mongo/db/curop.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_record_store_oplog_stones.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/util/background.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/log.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -57,6 +62,21 @@ namespace mongo {
         std::set<NamespaceString> _backgroundThreadNamespaces;
         boost::mutex _backgroundThreadMutex;
 
+        // Passes of the background thread which truncated at least one oplog stone
+        Counter64 oplogTruncationPasses;
+        Counter64 oplogTruncationMicros;
+        Counter64 oplogTruncationRecords;
+        Counter64 oplogTruncationBytes;
+
+        ServerStatusMetricField<Counter64> displayOplogTruncationPasses(
+            "storage.oplogTruncation.passes", &oplogTruncationPasses);
+        ServerStatusMetricField<Counter64> displayOplogTruncationMicros(
+            "storage.oplogTruncation.totalTimeMicros", &oplogTruncationMicros);
+        ServerStatusMetricField<Counter64> displayOplogTruncationRecords(
+            "storage.oplogTruncation.recordsReclaimed", &oplogTruncationRecords);
+        ServerStatusMetricField<Counter64> displayOplogTruncationBytes(
+            "storage.oplogTruncation.bytesReclaimed", &oplogTruncationBytes);
+
         class WiredTigerRecordStoreThread : public BackgroundJob {
         public:
             WiredTigerRecordStoreThread(const NamespaceString& ns)
@@ -69,9 +89,13 @@ namespace mongo {
             }
 
             /**
+             * Truncates the oplog by whole stones. Sets 'oplogStones' to the stones of the oplog,
+             * if it has any, so that the caller can wait on them without holding locks.
+             *
              * @return Number of documents deleted.
              */
-            int64_t _deleteExcessDocuments() {
+            int64_t _deleteExcessDocuments(
+                    boost::shared_ptr<WiredTigerRecordStore::OplogStones>* oplogStones) {
                 if (!getGlobalServiceContext()->getGlobalStorageEngine()) {
                     LOG(1) << "no global storage engine yet";
                     return 0;
@@ -100,6 +124,23 @@ namespace mongo {
                     OldClientContext ctx(&txn, _ns, false);
                     WiredTigerRecordStore* rs =
                         checked_cast<WiredTigerRecordStore*>(collection->getRecordStore());
+
+                    *oplogStones = rs->getOplogStones();
+                    if (*oplogStones) {
+                        boost::lock_guard<boost::timed_mutex> lock(rs->cappedDeleterMutex());
+                        Timer timer;
+                        int64_t recordsRemoved = 0;
+                        int64_t bytesRemoved = 0;
+                        rs->reclaimOplog(&txn, &recordsRemoved, &bytesRemoved);
+                        if (recordsRemoved > 0) {
+                            oplogTruncationPasses.increment();
+                            oplogTruncationMicros.increment(timer.micros());
+                            oplogTruncationRecords.increment(recordsRemoved);
+                            oplogTruncationBytes.increment(bytesRemoved);
+                        }
+                        return recordsRemoved;
+                    }
+
                     WriteUnitOfWork wuow(&txn);
                     boost::lock_guard<boost::timed_mutex> lock(rs->cappedDeleterMutex());
                     int64_t removed = rs->cappedDeleteAsNeeded_inlock(&txn, RecordId::max());
@@ -119,9 +160,18 @@ namespace mongo {
                 Client::initThread(_name.c_str());
 
                 while (!inShutdown()) {
-                    int64_t removed = _deleteExcessDocuments();
+                    boost::shared_ptr<WiredTigerRecordStore::OplogStones> oplogStones;
+                    int64_t removed = _deleteExcessDocuments(&oplogStones);
                     LOG(2) << "WiredTigerRecordStoreThread deleted " << removed;
-                    if (removed == 0) {
+                    if (oplogStones) {
+                        if (removed == 0 && oplogStones->hasExcessStones()) {
+                            // Truncating failed, e.g. on a write conflict. Don't spin.
+                            sleepmillis(100);
+                        }
+                        // Sleep until the next stone is ready to be truncated.
+                        oplogStones->awaitHasExcessStonesOrDead();
+                    }
+                    else if (removed == 0) {
                         // If we removed 0 documents, sleep a bit in case we're on a laptop
                         // or something to be nice.
                         sleepmillis(1000);
@@ -171,4 +221,26 @@ namespace mongo {
         return true;
     }
 
+    // static
+    TicketHolder::Priority WiredTigerRecoveryUnit::ticketPriority(OperationContext* opCtx) {
+        // The storage engine is opened with an OperationContextNoop, which has no CurOp.
+        if (opCtx == NULL || !haveClient())
+            return TicketHolder::kInteractive;
+
+        // Oplog application.
+        if (opCtx->lockState()->isBatchWriter())
+            return TicketHolder::kReplication;
+
+        // An operation which continues a cursor or has yielded has been running for a while.
+        CurOp* curOp = cc().curop();
+        if (curOp->getOp() == dbGetMore || curOp->numYields() > 0) {
+            // Secondaries tail the oplog with getMores.
+            if (StringData(curOp->getNS()).startsWith("local.oplog."))
+                return TicketHolder::kReplication;
+            return TicketHolder::kScan;
+        }
+
+        return TicketHolder::kInteractive;
+    }
+
 }  // namespace mongo
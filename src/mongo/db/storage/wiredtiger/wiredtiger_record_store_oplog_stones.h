@@ -0,0 +1,159 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    class OperationContext;
+
+    /**
+     * Divides the oplog into "stones", contiguous ranges of records of roughly equal total size.
+     * Rather than deleting the oldest documents one at a time, the oplog is reclaimed by
+     * truncating the oldest stone as a whole once there are more stones than needed to hold
+     * cappedMaxSize bytes.
+     *
+     * The counts and sizes of the stones are estimates: they are only updated when inserts commit,
+     * and when the oplog is opened they may come from sampling rather than a scan.
+     */
+    class WiredTigerRecordStore::OplogStones {
+        MONGO_DISALLOW_COPYING(OplogStones);
+    public:
+        struct Stone {
+            Stone(int64_t records, int64_t bytes, const RecordId& lastRecord)
+                : records(records), bytes(bytes), lastRecord(lastRecord) {}
+
+            int64_t records;        // approximate number of records in the stone
+            int64_t bytes;          // approximate size of the records in the stone
+            RecordId lastRecord;    // RecordId of the newest record in the stone
+        };
+
+        /**
+         * Places the initial stones by scanning or sampling the oplog of 'rs', which must
+         * already know its number of records and data size.
+         */
+        OplogStones(OperationContext* txn, WiredTigerRecordStore* rs);
+
+        /**
+         * Wakes up and stops any thread waiting in awaitHasExcessStonesOrDead(). Called when the
+         * record store goes away.
+         */
+        void kill();
+        bool isDead() const;
+
+        bool hasExcessStones() const;
+
+        /**
+         * Waits until there is a stone to reclaim or kill() is called, but for no more than a
+         * second so that the caller can check for shutdown.
+         */
+        void awaitHasExcessStonesOrDead();
+
+        /**
+         * Returns false if there are no excess stones, otherwise copies the oldest stone into
+         * 'stone'. The stone stays in place until popOldestStone() is called.
+         */
+        bool peekOldestStoneIfNeeded(Stone* stone) const;
+        void popOldestStone();
+
+        /**
+         * Registers a change which adds the inserted records to the newest, unfinished stone when
+         * the unit of work commits, closing it off as a new stone once it is big enough.
+         */
+        void updateCurrentStoneAfterInsertOnCommit(OperationContext* txn,
+                                                   int64_t bytesInserted,
+                                                   const RecordId& highestInserted,
+                                                   int64_t countInserted);
+
+        /** Registers a change which removes all stones when the unit of work commits. */
+        void clearStonesOnCommit(OperationContext* txn);
+
+        /**
+         * Drops the stones which contained records removed by temp_cappedTruncateAfter(), and
+         * keeps the records which survived from them in the unfinished stone.
+         */
+        void updateStonesAfterCappedTruncateAfter(int64_t recordsRemoved,
+                                                  int64_t bytesRemoved,
+                                                  const RecordId& firstRemovedId);
+
+        size_t numStones() const;
+        size_t numStonesToKeep() const { return _numStonesToKeep; }
+        int64_t minBytesPerStone() const { return _minBytesPerStone; }
+        int64_t currentRecords() const { return _currentRecords.load(); }
+        int64_t currentBytes() const { return _currentBytes.load(); }
+
+        // For testing.
+        void setMinBytesPerStone(int64_t size);
+
+    private:
+        class InsertChange;
+        class TruncateChange;
+
+        void _calculateStones(OperationContext* txn);
+        void _calculateStonesByScanning(OperationContext* txn);
+        void _calculateStonesBySampling(OperationContext* txn,
+                                        int64_t estRecordsPerStone,
+                                        int64_t estBytesPerStone);
+
+        /** Closes off the unfinished stone at 'lastRecord' if it has reached the minimum size. */
+        void _createNewStoneIfNeeded(const RecordId& lastRecord);
+
+        void _pokeReclaimThreadIfNeeded();
+
+        // Number of random samples taken per stone when the initial stones are estimated.
+        static const int64_t kRandomSamplesPerStone = 10;
+
+        WiredTigerRecordStore* _rs;     // not owned
+
+        // Signalled when a stone is added or the oplog goes away. When both are held,
+        // _oplogReclaimMutex is acquired before _mutex.
+        mutable boost::mutex _oplogReclaimMutex;
+        boost::condition_variable _oplogReclaimCv;
+        bool _isDead;
+
+        size_t _numStonesToKeep;
+        int64_t _minBytesPerStone;
+
+        // Records inserted since the newest stone was created.
+        AtomicInt64 _currentRecords;
+        AtomicInt64 _currentBytes;
+
+        mutable boost::mutex _mutex;    // protects _stones
+        std::deque<Stone> _stones;      // oldest stone at the front
+    };
+
+}  // namespace mongo
@@ -43,11 +43,13 @@
 #include "mongo/db/storage/record_store_test_harness.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_record_store_oplog_stones.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_size_storer.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/unittest/temp_dir.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
@@ -371,6 +373,57 @@ namespace mongo {
         rs.reset( NULL ); // this has to be deleted before ss
     }
 
+    TEST(WiredTigerRecordStoreTest, SizeStorerTracksDirtyEntries) {
+        scoped_ptr<WiredTigerHarnessHelper> harnessHelper(new WiredTigerHarnessHelper());
+        scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
+        WiredTigerRecordStore* wtrs = checked_cast<WiredTigerRecordStore*>( rs.get() );
+        string uri = wtrs->getURI();
+
+        string storerUri = "table:sizeStorerDirty";
+        WiredTigerSizeStorer ss(harnessHelper->conn(), storerUri);
+        wtrs->setSizeStorer( &ss );
+        ASSERT_EQUALS( 1U, ss.numDirty() );
+        ss.syncCache(true);
+        ASSERT_EQUALS( 0U, ss.numDirty() );
+
+        int N = 20;
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            WriteUnitOfWork uow( opCtx.get() );
+            for ( int i = 0; i < N; i++ ) {
+                ASSERT_OK( rs->insertRecord( opCtx.get(), "a", 2, false ).getStatus() );
+            }
+            uow.commit();
+        }
+        // Many changes to one record store only put it on the dirty list once.
+        ASSERT_EQUALS( 1U, ss.numDirty() );
+
+        // storeToCache() marks every entry dirty, so syncing these takes several batches.
+        const int numOtherUris = 2500;
+        for ( int i = 0; i < numOtherUris; i++ ) {
+            const string otherUri = str::stream() << "table:other" << i;
+            ss.storeToCache( otherUri, i, 2 * i );
+        }
+        ASSERT_EQUALS( 1U + numOtherUris, ss.numDirty() );
+        ss.syncCache(true);
+        ASSERT_EQUALS( 0U, ss.numDirty() );
+
+        {
+            WiredTigerSizeStorer ss2(harnessHelper->conn(), storerUri);
+            ss2.fillCache();
+            long long numRecords;
+            long long dataSize;
+            ss2.loadFromCache( uri, &numRecords, &dataSize );
+            ASSERT_EQUALS( N, numRecords );
+            ASSERT_EQUALS( 2 * N, dataSize );
+            ss2.loadFromCache( "table:other2499", &numRecords, &dataSize );
+            ASSERT_EQUALS( 2499, numRecords );
+            ASSERT_EQUALS( 2 * 2499, dataSize );
+        }
+
+        rs.reset( NULL ); // this has to be deleted before ss
+    }
+
 namespace {
 
     class GoodValidateAdaptor : public ValidateAdaptor {
@@ -828,6 +881,131 @@ namespace {
         }
     }
 
+    // Inserts a record of 'size' bytes into the oplog, keyed on OpTime(1, 'inc').
+    RecordId _oplogStonesInsert(OperationContext* txn, RecordStore* rs, int inc, int size) {
+        BSONObjBuilder bob;
+        bob.appendTimestamp("ts", OpTime(1, inc).asDate());
+        bob.append("pad", std::string(size - bob.len() - 11, 'x'));
+        BSONObj obj = bob.obj();
+        ASSERT_EQUALS(size, obj.objsize());
+
+        WriteUnitOfWork uow(txn);
+        StatusWith<RecordId> res = rs->insertRecord(txn, obj.objdata(), obj.objsize(), false);
+        ASSERT_OK(res.getStatus());
+        uow.commit();
+        return res.getValue();
+    }
+
+    TEST(WiredTigerRecordStoreTest, OplogStonesCreateNewStone) {
+        scoped_ptr<WiredTigerHarnessHelper> harnessHelper(new WiredTigerHarnessHelper());
+        scoped_ptr<RecordStore> rs(harnessHelper->newCappedRecordStore("local.oplog.stones",
+                                                                       100000,
+                                                                       -1));
+        WiredTigerRecordStore* wrs = checked_cast<WiredTigerRecordStore*>(rs.get());
+        boost::shared_ptr<WiredTigerRecordStore::OplogStones> oplogStones = wrs->getOplogStones();
+        ASSERT(oplogStones);
+        oplogStones->setMinBytesPerStone(300);
+
+        scoped_ptr<OperationContext> opCtx(harnessHelper->newOperationContext());
+
+        _oplogStonesInsert(opCtx.get(), rs.get(), 1, 100);
+        _oplogStonesInsert(opCtx.get(), rs.get(), 2, 100);
+        ASSERT_EQUALS(0U, oplogStones->numStones());
+        ASSERT_EQUALS(2, oplogStones->currentRecords());
+        ASSERT_EQUALS(200, oplogStones->currentBytes());
+
+        // Reaching the minimum size closes off the stone.
+        _oplogStonesInsert(opCtx.get(), rs.get(), 3, 100);
+        ASSERT_EQUALS(1U, oplogStones->numStones());
+        ASSERT_EQUALS(0, oplogStones->currentRecords());
+        ASSERT_EQUALS(0, oplogStones->currentBytes());
+
+        // A single large record can make up a stone on its own.
+        _oplogStonesInsert(opCtx.get(), rs.get(), 4, 400);
+        ASSERT_EQUALS(2U, oplogStones->numStones());
+        ASSERT_EQUALS(0, oplogStones->currentRecords());
+
+        // Inserts which roll back don't count.
+        {
+            WriteUnitOfWork uow(opCtx.get());
+            BSONObj obj = BSON("ts" << OpTime(1, 5) << "pad" << std::string(500, 'x'));
+            ASSERT_OK(rs->insertRecord(opCtx.get(), obj.objdata(), obj.objsize(), false)
+                          .getStatus());
+        }
+        ASSERT_EQUALS(2U, oplogStones->numStones());
+        ASSERT_EQUALS(0, oplogStones->currentRecords());
+        ASSERT_EQUALS(0, oplogStones->currentBytes());
+    }
+
+    TEST(WiredTigerRecordStoreTest, OplogStonesReclaim) {
+        scoped_ptr<WiredTigerHarnessHelper> harnessHelper(new WiredTigerHarnessHelper());
+        scoped_ptr<RecordStore> rs(harnessHelper->newCappedRecordStore("local.oplog.stones",
+                                                                       100000,
+                                                                       -1));
+        WiredTigerRecordStore* wrs = checked_cast<WiredTigerRecordStore*>(rs.get());
+        boost::shared_ptr<WiredTigerRecordStore::OplogStones> oplogStones = wrs->getOplogStones();
+        oplogStones->setMinBytesPerStone(300);
+        const int numStonesToKeep = oplogStones->numStonesToKeep();
+
+        scoped_ptr<OperationContext> opCtx(harnessHelper->newOperationContext());
+
+        // Fill exactly one stone more than is kept.
+        std::vector<RecordId> locs;
+        for (int i = 1; i <= 3 * (numStonesToKeep + 1); i++) {
+            locs.push_back(_oplogStonesInsert(opCtx.get(), rs.get(), i, 100));
+        }
+        ASSERT_EQUALS(static_cast<size_t>(numStonesToKeep + 1), oplogStones->numStones());
+        ASSERT(oplogStones->hasExcessStones());
+
+        // Without a background thread the next insert truncates the oldest stone as a whole.
+        _oplogStonesInsert(opCtx.get(), rs.get(), 1000, 100);
+        ASSERT_EQUALS(static_cast<size_t>(numStonesToKeep), oplogStones->numStones());
+        ASSERT_FALSE(oplogStones->hasExcessStones());
+        ASSERT_EQUALS(3 * numStonesToKeep + 1, rs->numRecords(opCtx.get()));
+        ASSERT_EQUALS(100 * (3 * numStonesToKeep + 1), rs->dataSize(opCtx.get()));
+
+        RecordData data;
+        for (int i = 0; i < 3; i++) {
+            ASSERT_FALSE(rs->findRecord(opCtx.get(), locs[i], &data));
+        }
+        ASSERT_TRUE(rs->findRecord(opCtx.get(), locs[3], &data));
+    }
+
+    TEST(WiredTigerRecordStoreTest, OplogStonesTruncate) {
+        scoped_ptr<WiredTigerHarnessHelper> harnessHelper(new WiredTigerHarnessHelper());
+        scoped_ptr<RecordStore> rs(harnessHelper->newCappedRecordStore("local.oplog.stones",
+                                                                       100000,
+                                                                       -1));
+        WiredTigerRecordStore* wrs = checked_cast<WiredTigerRecordStore*>(rs.get());
+        boost::shared_ptr<WiredTigerRecordStore::OplogStones> oplogStones = wrs->getOplogStones();
+        oplogStones->setMinBytesPerStone(300);
+
+        scoped_ptr<OperationContext> opCtx(harnessHelper->newOperationContext());
+
+        std::vector<RecordId> locs;
+        for (int i = 1; i <= 7; i++) {
+            locs.push_back(_oplogStonesInsert(opCtx.get(), rs.get(), i, 100));
+        }
+        ASSERT_EQUALS(2U, oplogStones->numStones());
+        ASSERT_EQUALS(1, oplogStones->currentRecords());
+
+        // Removing records from the second stone drops it, leaving its first record in the
+        // unfinished stone.
+        rs->temp_cappedTruncateAfter(opCtx.get(), locs[3], false);
+        ASSERT_EQUALS(1U, oplogStones->numStones());
+        ASSERT_EQUALS(1, oplogStones->currentRecords());
+        ASSERT_EQUALS(100, oplogStones->currentBytes());
+
+        {
+            WriteUnitOfWork uow(opCtx.get());
+            ASSERT_OK(rs->truncate(opCtx.get()));
+            uow.commit();
+        }
+        ASSERT_EQUALS(0U, oplogStones->numStones());
+        ASSERT_EQUALS(0, oplogStones->currentRecords());
+        ASSERT_EQUALS(0, oplogStones->currentBytes());
+    }
+
     TEST(WiredTigerRecordStoreTest, StorageSizeStatisticsDisabled) {
         WiredTigerHarnessHelper harnessHelper("statistics=(none)");
         scoped_ptr<RecordStore> rs(harnessHelper.newNonCappedRecordStore("a.b"));
@@ -30,9 +30,6 @@
 
 #define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
 
-#include <boost/thread/condition.hpp>
-#include <boost/thread/mutex.hpp>
-
 #include "mongo/base/checked_cast.h"
 #include "mongo/base/init.h"
 #include "mongo/bson/bsonobjbuilder.h"
@@ -48,37 +45,6 @@
 
 namespace mongo {
 
-    namespace {
-        struct AwaitCommitData {
-            AwaitCommitData() :
-                numWaitingForSync(0),
-                lastSyncTime(0) {
-            }
-
-            void syncHappend() {
-                boost::lock_guard<boost::mutex> lk( mutex );
-                lastSyncTime++;
-                condvar.notify_all();
-            }
-
-            // return true if happened
-            bool awaitCommit() {
-                boost::unique_lock<boost::mutex> lk( mutex );
-                long long start = lastSyncTime;
-                numWaitingForSync.fetchAndAdd(1);
-                condvar.timed_wait(lk,boost::posix_time::milliseconds(50));
-                numWaitingForSync.fetchAndAdd(-1);
-                return lastSyncTime > start;
-            }
-
-            AtomicUInt32 numWaitingForSync;
-
-            boost::mutex mutex; // this just protects lastSyncTime
-            boost::condition condvar;
-            long long lastSyncTime;
-        } awaitCommitData;
-    }
-
     WiredTigerRecoveryUnit::WiredTigerRecoveryUnit(WiredTigerSessionCache* sc) :
         _sessionCache( sc ),
         _session( NULL ),
@@ -87,7 +53,6 @@ namespace mongo {
         _myTransactionCount( 1 ),
         _everStartedWrite( false ),
         _currentlySquirreled( false ),
-        _syncing( false ),
         _noTicketNeeded( false ) {
     }
 
@@ -170,21 +135,10 @@ namespace mongo {
         }
     }
 
-    void WiredTigerRecoveryUnit::goingToAwaitCommit() {
-        if ( _active ) {
-            // too late, can't change config
-            return;
-        }
-        // yay, we've configured ourselves for sync
-        _syncing = true;
-    }
-
     bool WiredTigerRecoveryUnit::awaitCommit() {
-        if ( _syncing && _everStartedWrite ) {
-            // we did a sync, so we're good
-            return true;
-        }
-        awaitCommitData.awaitCommit();
+        // Our own writes were committed when their unit of work ended, so the next journal flush
+        // covers them. It is shared with everybody else waiting at the same time.
+        _sessionCache->waitUntilDurable();
         return true;
     }
 
@@ -279,22 +233,42 @@ namespace mongo {
         TicketServerParameter openReadTransactionParam(&openReadTransaction,
                                                        "wiredTigerConcurrentReadTransactions");
 
+        void appendTicketStats(BSONObjBuilder* b, const TicketHolder& holder) {
+            b->append("out", holder.used());
+            b->append("available", holder.available());
+            b->append("totalTickets", holder.outof());
+
+            BSONObjBuilder queues(b->subobjStart("queues"));
+            for (int i = 0; i < TicketHolder::kNumPriorities; i++) {
+                const TicketHolder::Priority priority = static_cast<TicketHolder::Priority>(i);
+                const TicketHolder::QueueStats stats = holder.getQueueStats(priority);
+
+                BSONObjBuilder queue(queues.subobjStart(TicketHolder::priorityName(priority)));
+                queue.append("waiting", stats.waiting);
+                queue.append("queued", stats.queued);
+                queue.append("totalWaitMicros", stats.totalWaitMicros);
+                BSONObjBuilder histogram(queue.subobjStart("waitMicros"));
+                for (int j = 0; j < TicketHolder::kNumWaitBuckets; j++) {
+                    histogram.append(TicketHolder::waitBucketName(j), stats.waitMicros[j]);
+                }
+                histogram.done();
+                queue.done();
+            }
+            queues.done();
+        }
+
     }
 
     void WiredTigerRecoveryUnit::appendGlobalStats(BSONObjBuilder& b) {
         BSONObjBuilder bb(b.subobjStart("concurrentTransactions"));
         {
             BSONObjBuilder bbb(bb.subobjStart("write"));
-            bbb.append("out", openWriteTransaction.used());
-            bbb.append("available", openWriteTransaction.available());
-            bbb.append("totalTickets", openWriteTransaction.outof());
+            appendTicketStats(&bbb, openWriteTransaction);
             bbb.done();
         }
         {
             BSONObjBuilder bbb(bb.subobjStart("read"));
-            bbb.append("out", openReadTransaction.used());
-            bbb.append("available", openReadTransaction.available());
-            bbb.append("totalTickets", openReadTransaction.outof());
+            appendTicketStats(&bbb, openReadTransaction);
             bbb.done();
         }
         bb.done();
@@ -306,8 +280,6 @@ namespace mongo {
         if ( commit ) {
             invariantWTOK( s->commit_transaction(s, NULL) );
             LOG(2) << "WT commit_transaction";
-            if ( _syncing )
-                awaitCommitData.syncHappend();
         }
         else {
             invariantWTOK( s->rollback_transaction(s, NULL) );
@@ -351,7 +323,7 @@ namespace mongo {
 
         TicketHolder* holder = writeLocked ? &openWriteTransaction : &openReadTransaction;
 
-        holder->waitForTicket();
+        holder->waitForTicket(ticketPriority(opCtx));
         _ticket.reset(holder);
     }
 
@@ -360,8 +332,7 @@ namespace mongo {
         _getTicket(opCtx);
 
         WT_SESSION *s = _session->getSession();
-        _syncing = _syncing || awaitCommitData.numWaitingForSync.load() > 0;
-        invariantWTOK( s->begin_transaction(s, _syncing ? "sync=true" : NULL) );
+        invariantWTOK( s->begin_transaction(s, NULL) );
         LOG(2) << "WT begin_transaction";
         _timer.reset();
         _active = true;
@@ -64,7 +64,6 @@ namespace mongo {
         virtual void endUnitOfWork();
 
         virtual bool awaitCommit();
-        virtual void goingToAwaitCommit();
 
         virtual void registerChange(Change *);
 
@@ -98,6 +97,12 @@ namespace mongo {
         static WiredTigerRecoveryUnit* get(OperationContext *txn);
 
         static void appendGlobalStats(BSONObjBuilder& b);
+
+        /**
+         * Returns the queue in which 'opCtx' waits for a transaction ticket when all are out.
+         * Defined separately for mongod and for the unit tests, which have no Client or CurOp.
+         */
+        static TicketHolder::Priority ticketPriority(OperationContext* opCtx);
     private:
 
         void _abort();
@@ -115,7 +120,6 @@ namespace mongo {
         bool _everStartedWrite;
         Timer _timer;
         bool _currentlySquirreled;
-        bool _syncing;
         RecordId _oplogReadTill;
 
         typedef OwnedPointerVector<Change> Changes;
@@ -37,6 +37,7 @@
 
 #include "mongo/base/checked_cast.h"
 #include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_journal_flusher.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
@@ -80,6 +81,18 @@ namespace mongo {
 
         WiredTigerRecoveryUnit::appendGlobalStats(bob);
 
+        {
+            BSONObjBuilder sessionCacheBob(bob.subobjStart("sessionCache"));
+            WiredTigerSessionCache::appendGlobalStats(&sessionCacheBob);
+            sessionCacheBob.done();
+        }
+
+        if (WiredTigerJournalFlusher* flusher = _engine->getJournalFlusher()) {
+            BSONObjBuilder flusherBob(bob.subobjStart("journalFlusher"));
+            flusher->appendStats(&flusherBob);
+            flusherBob.done();
+        }
+
         return bob.obj();
     }
 
@@ -33,16 +33,64 @@
 
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 
+#include <algorithm>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/config.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
 
+    namespace {
+
+        // Maximum number of idle cursors each session keeps open for reuse.
+        MONGO_EXPORT_SERVER_PARAMETER(wiredTigerCursorCacheSize, int, 100);
+
+        AtomicUInt64 sessionsOpened;
+        AtomicUInt64 sessionCacheHits;
+        AtomicUInt64 sessionAffinityHits;
+
+        AtomicUInt64 cursorsOpened;
+        AtomicUInt64 cursorCacheHits;
+        AtomicUInt64 cursorsEvicted;
+
+        /**
+         * Which session cache partition the current thread uses and the session it released
+         * last. Zero initialized, so the partition is stored off by one.
+         */
+        struct SessionAffinity {
+            int cachePartitionPlusOne;
+            const WiredTigerSession* lastReleased;
+        };
+
+    }
+
+#if defined(MONGO_CONFIG_HAVE___THREAD)
+    __thread SessionAffinity _sessionAffinity;
+    static SessionAffinity* getSessionAffinity() {
+        return &_sessionAffinity;
+    }
+#elif defined(MONGO_CONFIG_HAVE___DECLSPEC_THREAD)
+    __declspec( thread ) SessionAffinity _sessionAffinity;
+    static SessionAffinity* getSessionAffinity() {
+        return &_sessionAffinity;
+    }
+#else
+    TSP_DEFINE(SessionAffinity, _sessionAffinity);
+    static SessionAffinity* getSessionAffinity() {
+        return _sessionAffinity.getMake();
+    }
+#endif
+
     WiredTigerSession::WiredTigerSession(WT_CONNECTION* conn, int cachePartition, int epoch)
         : _cachePartition(cachePartition),
           _epoch(epoch),
           _session(NULL),
+          _cursorsCached(0),
           _cursorsOut(0) {
 
         int ret = conn->open_session(conn, NULL, "isolation=snapshot", &_session);
@@ -59,15 +107,18 @@ namespace mongo {
     WT_CURSOR* WiredTigerSession::getCursor(const std::string& uri,
                                             uint64_t id,
                                             bool forRecordStore) {
-        {
-            Cursors& cursors = _curmap[id];
-            if ( !cursors.empty() ) {
-                WT_CURSOR* save = cursors.back();
-                cursors.pop_back();
+        // Recently released cursors are at the front, so that's where the hits usually are.
+        for (CursorCache::iterator i = _cursors.begin(); i != _cursors.end(); ++i) {
+            if (i->id == id) {
+                WT_CURSOR* save = i->cursor;
+                _cursors.erase(i);
+                _cursorsCached--;
                 _cursorsOut++;
+                cursorCacheHits.fetchAndAdd(1);
                 return save;
             }
         }
+
         WT_CURSOR* c = NULL;
         int ret = _session->open_cursor(_session,
                                         uri.c_str(),
@@ -76,7 +127,10 @@ namespace mongo {
                                         &c);
         if (ret != ENOENT)
             invariantWTOK(ret);
-        if ( c ) _cursorsOut++;
+        if ( c ) {
+            _cursorsOut++;
+            cursorsOpened.fetchAndAdd(1);
+        }
         return c;
     }
 
@@ -85,29 +139,34 @@ namespace mongo {
         invariant( cursor );
         _cursorsOut--;
 
-        Cursors& cursors = _curmap[id];
-        if ( cursors.size() > 10u ) {
+        invariantWTOK( cursor->reset( cursor ) );
+        _cursors.push_front( CachedCursor( id, cursor ) );
+        _cursorsCached++;
+
+        _evictCursors( wiredTigerCursorCacheSize );
+    }
+
+    void WiredTigerSession::_evictCursors(int maxCached) {
+        while ( _cursorsCached > 0 && _cursorsCached > maxCached ) {
+            WT_CURSOR* cursor = _cursors.back().cursor;
+            _cursors.pop_back();
+            _cursorsCached--;
             invariantWTOK( cursor->close(cursor) );
-        }
-        else {
-            invariantWTOK( cursor->reset( cursor ) );
-            cursors.push_back( cursor );
+            cursorsEvicted.fetchAndAdd(1);
         }
     }
 
     void WiredTigerSession::closeAllCursors() {
         invariant( _session );
-        for (CursorMap::iterator i = _curmap.begin(); i != _curmap.end(); ++i ) {
-            Cursors& cursors = i->second;
-            for ( size_t j = 0; j < cursors.size(); j++ ) {
-                WT_CURSOR *cursor = cursors[j];
-                if (cursor) {
-                    int ret = cursor->close(cursor);
-                    invariantWTOK(ret);
-                }
+        for (CursorCache::iterator i = _cursors.begin(); i != _cursors.end(); ++i ) {
+            WT_CURSOR* cursor = i->cursor;
+            if (cursor) {
+                int ret = cursor->close(cursor);
+                invariantWTOK(ret);
             }
         }
-        _curmap.clear();
+        _cursors.clear();
+        _cursorsCached = 0;
     }
 
     namespace {
@@ -175,8 +234,13 @@ namespace mongo {
         // operations should be allowed to start.
         invariant(!_shuttingDown.loadRelaxed());
 
-        // Spread sessions uniformly across the cache partitions
-        const int cachePartition = cachePartitionGen.addAndFetch(1) % NumSessionCachePartitions;
+        SessionAffinity* affinity = getSessionAffinity();
+        if (!affinity->cachePartitionPlusOne) {
+            // Spread threads uniformly across the cache partitions
+            affinity->cachePartitionPlusOne =
+                cachePartitionGen.addAndFetch(1) % NumSessionCachePartitions + 1;
+        }
+        const int cachePartition = affinity->cachePartitionPlusOne - 1;
 
         int epoch;
 
@@ -184,15 +248,27 @@ namespace mongo {
             boost::unique_lock<SpinLock> cachePartitionLock(_cache[cachePartition].lock);
             epoch = _cache[cachePartition].epoch;
 
-            if (!_cache[cachePartition].pool.empty()) {
-                WiredTigerSession* cachedSession = _cache[cachePartition].pool.back();
-                _cache[cachePartition].pool.pop_back();
+            SessionPool& pool = _cache[cachePartition].pool;
+            if (!pool.empty()) {
+                // Prefer the session this thread used last, it has the cursors we've been using.
+                // Otherwise take the most recently released one.
+                SessionPool::iterator it = std::find(pool.begin(), pool.end(),
+                                                     affinity->lastReleased);
+                if (it != pool.end()) {
+                    std::swap(*it, pool.back());
+                    sessionAffinityHits.fetchAndAdd(1);
+                }
+
+                WiredTigerSession* cachedSession = pool.back();
+                pool.pop_back();
+                sessionCacheHits.fetchAndAdd(1);
 
                 return cachedSession;
             }
         }
 
         // Outside of the cache partition lock, but on release will be put back on the cache
+        sessionsOpened.fetchAndAdd(1);
         return new WiredTigerSession(_conn, cachePartition, epoch);
     }
 
@@ -232,6 +308,9 @@ namespace mongo {
             }
         }
 
+        // Only compared against, never dereferenced, so it doesn't matter if it goes away.
+        getSessionAffinity()->lastReleased = returnedToCache ? session : NULL;
+
         // Do all cleanup outside of the cache partition spinlock.
         if (!returnedToCache) {
             delete session;
@@ -241,4 +320,29 @@ namespace mongo {
             _engine->dropAllQueued();
         }
     }
+
+    // static
+    void WiredTigerSessionCache::appendGlobalStats(BSONObjBuilder* b) {
+        {
+            BSONObjBuilder sessions(b->subobjStart("sessions"));
+            sessions.appendNumber("opened", static_cast<long long>(sessionsOpened.load()));
+            sessions.appendNumber("cacheHits", static_cast<long long>(sessionCacheHits.load()));
+            sessions.appendNumber("affinityHits",
+                                  static_cast<long long>(sessionAffinityHits.load()));
+            sessions.done();
+        }
+        {
+            BSONObjBuilder cursors(b->subobjStart("cursors"));
+            cursors.appendNumber("opened", static_cast<long long>(cursorsOpened.load()));
+            cursors.appendNumber("cacheHits", static_cast<long long>(cursorCacheHits.load()));
+            cursors.appendNumber("evicted", static_cast<long long>(cursorsEvicted.load()));
+            cursors.done();
+        }
+    }
+
+    void WiredTigerSessionCache::waitUntilDurable() {
+        if (_engine) {
+            _engine->waitUntilDurable();
+        }
+    }
 }
@@ -31,7 +31,7 @@
 
 #pragma once
 
-#include <map>
+#include <list>
 #include <string>
 #include <vector>
 
@@ -45,10 +45,12 @@
 
 namespace mongo {
 
+    class BSONObjBuilder;
     class WiredTigerKVEngine;
 
     /**
-     * This is a structure that caches 1 cursor for each uri.
+     * This is a structure that caches cursors by id, up to wiredTigerCursorCacheSize of them in
+     * total, evicting the least recently released cursor when it gets full.
      * The idea is that there is a pool of these somewhere.
      * NOT THREADSAFE
      */
@@ -80,6 +82,8 @@ namespace mongo {
 
         int cursorsOut() const { return _cursorsOut; }
 
+        int cursorsCached() const { return _cursorsCached; }
+
         static uint64_t genCursorId();
 
         /**
@@ -90,19 +94,28 @@ namespace mongo {
     private:
         friend class WiredTigerSessionCache;
 
-        typedef std::vector<WT_CURSOR*> Cursors;
-        typedef std::map<uint64_t, Cursors> CursorMap;
+        struct CachedCursor {
+            CachedCursor(uint64_t id, WT_CURSOR* cursor) : id(id), cursor(cursor) { }
+
+            uint64_t id;
+            WT_CURSOR* cursor;
+        };
+
+        // Most recently released first
+        typedef std::list<CachedCursor> CursorCache;
 
 
         // Used internally by WiredTigerSessionCache
         int _getEpoch() const { return _epoch; }
         int _getCachePartition() const { return _cachePartition; }
 
+        void _evictCursors(int maxCached);
 
         const int _cachePartition;
         const int _epoch;
         WT_SESSION* _session; // owned
-        CursorMap _curmap; // owned
+        CursorCache _cursors; // owned
+        int _cursorsCached; // std::list::size() is not constant time
         int _cursorsOut;
     };
 
@@ -120,8 +133,19 @@ namespace mongo {
 
         void shuttingDown();
 
+        /**
+         * Blocks until everything committed so far is durable. Does nothing for caches, which
+         * were not created for an engine.
+         */
+        void waitUntilDurable();
+
         WT_CONNECTION* conn() const { return _conn; }
 
+        /**
+         * Reports session and cursor cache hit counts across all session caches.
+         */
+        static void appendGlobalStats(BSONObjBuilder* b);
+
     private:
         typedef std::vector<WiredTigerSession*> SessionPool;
 
@@ -142,9 +166,10 @@ namespace mongo {
         WiredTigerKVEngine* _engine; // not owned, might be NULL
         WT_CONNECTION* _conn; // not owned
 
-        // Partitioned cache of WT sessions. The partition key is not important, but it is
-        // important that sessions be returned to the same partition they were taken from in order
-        // to have some form of balance between the partitions.
+        // Partitioned cache of WT sessions. Each thread has a home partition, which it takes
+        // sessions from and in which it prefers the session it released last, so that it gets
+        // back the cursors it has been using. Sessions must be returned to the same partition
+        // they were taken from in order to have some form of balance between the partitions.
         SessionCachePartition _cache[NumSessionCachePartitions];
 
         // Regular operations take it in shared mode. Shutdown sets the _shuttingDown flag and
@@ -0,0 +1,186 @@
+// wiredtiger_session_cache_test.cpp
+
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include <sstream>
+#include <string>
+
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    using std::string;
+
+    namespace {
+
+        class WiredTigerConnection {
+        public:
+            explicit WiredTigerConnection(StringData dbpath) : _conn(NULL) {
+                int ret = wiredtiger_open(dbpath.toString().c_str(), NULL, "create", &_conn);
+                ASSERT_OK(wtRCToStatus(ret));
+                ASSERT(_conn);
+            }
+
+            ~WiredTigerConnection() {
+                _conn->close(_conn, NULL);
+            }
+
+            WT_CONNECTION* get() const { return _conn; }
+
+        private:
+            WT_CONNECTION* _conn;
+        };
+
+        /**
+         * Sets wiredTigerCursorCacheSize for the lifetime of the object.
+         */
+        class CursorCacheSize {
+        public:
+            explicit CursorCacheSize(int size)
+                : _param(ServerParameterSet::getGlobal()->getMap().find(
+                             "wiredTigerCursorCacheSize")->second) {
+                BSONObjBuilder b;
+                _param->append(NULL, b, "value");
+                _old = b.obj();
+                ASSERT_OK(_param->set(BSON("value" << size).firstElement()));
+            }
+
+            ~CursorCacheSize() {
+                _param->set(_old.firstElement());
+            }
+
+        private:
+            ServerParameter* const _param;
+            BSONObj _old;
+        };
+
+        long long getStat(const char* section, const char* name) {
+            BSONObjBuilder b;
+            WiredTigerSessionCache::appendGlobalStats(&b);
+            return b.obj()[section].Obj()[name].numberLong();
+        }
+
+    }
+
+    TEST(WiredTigerSessionCacheTest, SameThreadGetsItsSessionBack) {
+        unittest::TempDir dbpath("wt_session_cache_test");
+        WiredTigerConnection conn(dbpath.path());
+        WiredTigerSessionCache cache(conn.get());
+
+        const long long openedBefore = getStat("sessions", "opened");
+        const long long affinityBefore = getStat("sessions", "affinityHits");
+
+        WiredTigerSession* first = cache.getSession();
+        WiredTigerSession* second = cache.getSession();
+        cache.releaseSession(second);
+        cache.releaseSession(first);
+
+        for (int i = 0; i < 10; i++) {
+            WiredTigerSession* session = cache.getSession();
+            ASSERT_EQUALS(first, session);
+            cache.releaseSession(session);
+        }
+
+        ASSERT_EQUALS(openedBefore + 2, getStat("sessions", "opened"));
+        ASSERT_EQUALS(affinityBefore + 10, getStat("sessions", "affinityHits"));
+    }
+
+    TEST(WiredTigerSessionCacheTest, CursorsAreReused) {
+        unittest::TempDir dbpath("wt_session_cache_test");
+        WiredTigerConnection conn(dbpath.path());
+        WiredTigerSession session(conn.get());
+        WT_SESSION* s = session.getSession();
+        ASSERT_OK(wtRCToStatus(s->create(s, "table:a", NULL)));
+
+        const long long openedBefore = getStat("cursors", "opened");
+        const long long hitsBefore = getStat("cursors", "cacheHits");
+
+        const uint64_t id = WiredTigerSession::genCursorId();
+        for (int i = 0; i < 5; i++) {
+            WT_CURSOR* cursor = session.getCursor("table:a", id, true);
+            ASSERT(cursor);
+            session.releaseCursor(id, cursor);
+        }
+
+        ASSERT_EQUALS(1, session.cursorsCached());
+        ASSERT_EQUALS(0, session.cursorsOut());
+        ASSERT_EQUALS(openedBefore + 1, getStat("cursors", "opened"));
+        ASSERT_EQUALS(hitsBefore + 4, getStat("cursors", "cacheHits"));
+    }
+
+    TEST(WiredTigerSessionCacheTest, CursorCacheEvictsLeastRecentlyReleased) {
+        unittest::TempDir dbpath("wt_session_cache_test");
+        WiredTigerConnection conn(dbpath.path());
+        WiredTigerSession session(conn.get());
+        WT_SESSION* s = session.getSession();
+
+        const char* uris[] = { "table:a", "table:b", "table:c" };
+        uint64_t ids[3];
+        WT_CURSOR* cursors[3];
+        for (int i = 0; i < 3; i++) {
+            ASSERT_OK(wtRCToStatus(s->create(s, uris[i], NULL)));
+            ids[i] = WiredTigerSession::genCursorId();
+            cursors[i] = session.getCursor(uris[i], ids[i], true);
+            ASSERT(cursors[i]);
+        }
+
+        CursorCacheSize cacheSize(2);
+        const long long evictedBefore = getStat("cursors", "evicted");
+
+        for (int i = 0; i < 3; i++) {
+            session.releaseCursor(ids[i], cursors[i]);
+        }
+        ASSERT_EQUALS(2, session.cursorsCached());
+        ASSERT_EQUALS(evictedBefore + 1, getStat("cursors", "evicted"));
+
+        // "table:a" was released first, so it is the one which had to be closed.
+        const long long openedBefore = getStat("cursors", "opened");
+        WT_CURSOR* c = session.getCursor(uris[2], ids[2], true);
+        session.releaseCursor(ids[2], c);
+        ASSERT_EQUALS(openedBefore, getStat("cursors", "opened"));
+
+        c = session.getCursor(uris[0], ids[0], true);
+        session.releaseCursor(ids[0], c);
+        ASSERT_EQUALS(openedBefore + 1, getStat("cursors", "opened"));
+        ASSERT_EQUALS(2, session.cursorsCached());
+
+        session.closeAllCursors();
+        ASSERT_EQUALS(0, session.cursorsCached());
+    }
+
+}
@@ -31,14 +31,18 @@
 
 #define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
 
+#include <algorithm>
 #include <wiredtiger.h>
 
 #include "mongo/bson/bsonobj.h"
 #include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_size_storer.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/log.h"
 #include "mongo/util/scopeguard.h"
 
@@ -48,10 +52,15 @@ namespace mongo {
 
     namespace {
         int MAGIC = 123123;
+
+        // How many entries get written per WT transaction, so that syncing many of them doesn't
+        // hold the entries lock or build up a large transaction.
+        const size_t kSyncBatchSize = 1000;
     }
 
     WiredTigerSizeStorer::WiredTigerSizeStorer(WT_CONNECTION* conn, const std::string& storageUri)
-            : _session(conn)
+            : _session(conn),
+              _syncThreadShutdown(false)
     {
         WT_SESSION* session = _session.getSession();
         int ret = session->open_cursor(session, storageUri.c_str(), NULL,
@@ -69,11 +78,23 @@ namespace mongo {
     }
 
     WiredTigerSizeStorer::~WiredTigerSizeStorer() {
+        {
+            boost::lock_guard<boost::mutex> lk( _syncThreadMutex );
+            _syncThreadShutdown = true;
+            _syncThreadCondition.notify_one();
+        }
+        if ( _syncThreadHandle.joinable() )
+            _syncThreadHandle.join();
+
         // This shouldn't be necessary, but protects us if we screw up.
         boost::lock_guard<boost::mutex> cursorLock( _cursorMutex );
 
         _magic = 11111;
         _cursor->close(_cursor);
+
+        for ( Map::iterator it = _entries.begin(); it != _entries.end(); ++it ) {
+            delete it->second;
+        }
     }
 
     void WiredTigerSizeStorer::_checkMagic() const {
@@ -83,25 +104,54 @@ namespace mongo {
         invariant( _magic == MAGIC );
     }
 
-    void WiredTigerSizeStorer::onCreate( WiredTigerRecordStore* rs,
-                                         long long numRecords, long long dataSize ) {
+    WiredTigerSizeStorer::SizeInfo* WiredTigerSizeStorer::_getOrCreate_inlock(
+            const std::string& uri ) {
+        SizeInfo*& sizeInfo = _entries[uri];
+        if ( !sizeInfo )
+            sizeInfo = new SizeInfo( uri );
+        return sizeInfo;
+    }
+
+    void WiredTigerSizeStorer::markDirty( SizeInfo* sizeInfo ) {
+        // Already on the dirty list, which is the common case.
+        if ( sizeInfo->dirty.load() )
+            return;
+        _markDirty( sizeInfo );
+    }
+
+    void WiredTigerSizeStorer::_markDirty( SizeInfo* sizeInfo ) {
+        if ( sizeInfo->dirty.compareAndSwap( 0, 1 ) != 0 )
+            return;
+        boost::lock_guard<boost::mutex> lk( _dirtyMutex );
+        _dirty.push_back( sizeInfo );
+    }
+
+    size_t WiredTigerSizeStorer::numDirty() const {
+        boost::lock_guard<boost::mutex> lk( _dirtyMutex );
+        return _dirty.size();
+    }
+
+    WiredTigerSizeStorer::SizeInfo* WiredTigerSizeStorer::onCreate( WiredTigerRecordStore* rs,
+                                                                    long long numRecords,
+                                                                    long long dataSize ) {
         _checkMagic();
         boost::lock_guard<boost::mutex> lk( _entriesMutex );
-        Entry& entry = _entries[rs->getURI()];
-        entry.rs = rs;
-        entry.numRecords = numRecords;
-        entry.dataSize = dataSize;
-        entry.dirty = true;
+        SizeInfo* sizeInfo = _getOrCreate_inlock( rs->getURI() );
+        sizeInfo->rs = rs;
+        sizeInfo->numRecords.store( numRecords );
+        sizeInfo->dataSize.store( dataSize );
+        _markDirty( sizeInfo );
+        return sizeInfo;
     }
 
     void WiredTigerSizeStorer::onDestroy( WiredTigerRecordStore* rs ) {
         _checkMagic();
         boost::lock_guard<boost::mutex> lk( _entriesMutex );
-        Entry& entry = _entries[rs->getURI()];
-        entry.numRecords = rs->numRecords( NULL );
-        entry.dataSize = rs->dataSize( NULL );
-        entry.dirty = true;
-        entry.rs = NULL;
+        SizeInfo* sizeInfo = _getOrCreate_inlock( rs->getURI() );
+        sizeInfo->numRecords.store( rs->numRecords( NULL ) );
+        sizeInfo->dataSize.store( rs->dataSize( NULL ) );
+        sizeInfo->rs = NULL;
+        _markDirty( sizeInfo );
     }
 
 
@@ -109,10 +159,10 @@ namespace mongo {
                                              long long numRecords, long long dataSize ) {
         _checkMagic();
         boost::lock_guard<boost::mutex> lk( _entriesMutex );
-        Entry& entry = _entries[uri.toString()];
-        entry.numRecords = numRecords;
-        entry.dataSize = dataSize;
-        entry.dirty = true;
+        SizeInfo* sizeInfo = _getOrCreate_inlock( uri.toString() );
+        sizeInfo->numRecords.store( numRecords );
+        sizeInfo->dataSize.store( dataSize );
+        _markDirty( sizeInfo );
     }
 
     void WiredTigerSizeStorer::loadFromCache( StringData uri,
@@ -125,92 +175,102 @@ namespace mongo {
             *dataSize = 0;
             return;
         }
-        *numRecords = it->second.numRecords;
-        *dataSize = it->second.dataSize;
+        *numRecords = it->second->numRecords.load();
+        *dataSize = it->second->dataSize.load();
     }
 
     void WiredTigerSizeStorer::fillCache() {
         boost::lock_guard<boost::mutex> cursorLock( _cursorMutex );
         _checkMagic();
 
-        Map m;
-        {
-            // Seek to beginning if needed.
-            invariantWTOK(_cursor->reset(_cursor));
-
-            // Intentionally ignoring return value.
-            ON_BLOCK_EXIT(_cursor->reset, _cursor);
-
-            int cursorNextRet;
-            while ((cursorNextRet = _cursor->next(_cursor)) != WT_NOTFOUND) {
-                invariantWTOK(cursorNextRet);
-
-                WT_ITEM key;
-                WT_ITEM value;
-                invariantWTOK( _cursor->get_key(_cursor, &key ) );
-                invariantWTOK( _cursor->get_value(_cursor, &value ) );
-                std::string uriKey( reinterpret_cast<const char*>( key.data ), key.size );
-                BSONObj data( reinterpret_cast<const char*>( value.data ) );
-
-                LOG(2) << "WiredTigerSizeStorer::loadFrom " << uriKey << " -> " << data;
-
-                Entry& e = m[uriKey];
-                e.numRecords = data["numRecords"].safeNumberLong();
-                e.dataSize = data["dataSize"].safeNumberLong();
-                e.dirty = false;
-                e.rs = NULL;
-            }
-        }
+        // Seek to beginning if needed.
+        invariantWTOK(_cursor->reset(_cursor));
 
+        // Intentionally ignoring return value.
+        ON_BLOCK_EXIT(_cursor->reset, _cursor);
+
+        // The entries are updated in place, since record stores may hold on to them.
         boost::lock_guard<boost::mutex> lk( _entriesMutex );
-        _entries.swap(m);
+
+        int cursorNextRet;
+        while ((cursorNextRet = _cursor->next(_cursor)) != WT_NOTFOUND) {
+            invariantWTOK(cursorNextRet);
+
+            WT_ITEM key;
+            WT_ITEM value;
+            invariantWTOK( _cursor->get_key(_cursor, &key ) );
+            invariantWTOK( _cursor->get_value(_cursor, &value ) );
+            std::string uriKey( reinterpret_cast<const char*>( key.data ), key.size );
+            BSONObj data( reinterpret_cast<const char*>( value.data ) );
+
+            LOG(2) << "WiredTigerSizeStorer::loadFrom " << uriKey << " -> " << data;
+
+            SizeInfo* sizeInfo = _getOrCreate_inlock( uriKey );
+            sizeInfo->numRecords.store( data["numRecords"].safeNumberLong() );
+            sizeInfo->dataSize.store( data["dataSize"].safeNumberLong() );
+        }
     }
 
     void WiredTigerSizeStorer::syncCache(bool syncToDisk) {
         boost::lock_guard<boost::mutex> cursorLock( _cursorMutex );
         _checkMagic();
 
-        Map myMap;
+        SizeInfos dirty;
+        {
+            boost::lock_guard<boost::mutex> lk( _dirtyMutex );
+            dirty.swap( _dirty );
+        }
+
+        if ( dirty.empty() )
+            return; // Nothing to do.
+
+        size_t written = 0;
+        try {
+            do {
+                const size_t end = std::min( dirty.size(), written + kSyncBatchSize );
+                SizeInfos batch( dirty.begin() + written, dirty.begin() + end );
+                _writeBatch( batch, syncToDisk && end == dirty.size() );
+                written = end;
+            } while ( written < dirty.size() );
+        }
+        catch (const WriteConflictException&) {
+            // Whatever didn't make it goes back on the dirty list for the next sync.
+            for ( size_t i = written; i < dirty.size(); i++ ) {
+                _markDirty( dirty[i] );
+            }
+            throw;
+        }
+    }
+
+    void WiredTigerSizeStorer::_writeBatch( const SizeInfos& batch, bool syncToDisk ) {
+        // Take the values while holding the entries lock, so that the record stores can't go
+        // away. The dirty flags are dropped first, so that later changes mark them dirty again.
+        std::vector<BSONObj> values;
+        values.reserve( batch.size() );
         {
             boost::lock_guard<boost::mutex> lk( _entriesMutex );
-            for ( Map::iterator it = _entries.begin(); it != _entries.end(); ++it ) {
-                std::string uriKey = it->first;
-                Entry& entry = it->second;
-                if ( entry.rs ) {
-                    if ( entry.dataSize != entry.rs->dataSize( NULL ) ) {
-                        entry.dataSize = entry.rs->dataSize( NULL );
-                        entry.dirty = true;
-                    }
-                    if ( entry.numRecords != entry.rs->numRecords( NULL ) ) {
-                        entry.numRecords = entry.rs->numRecords( NULL );
-                        entry.dirty = true;
-                    }
+            for ( size_t i = 0; i < batch.size(); i++ ) {
+                SizeInfo* sizeInfo = batch[i];
+                sizeInfo->dirty.store( 0 );
+                if ( sizeInfo->rs ) {
+                    sizeInfo->numRecords.store( sizeInfo->rs->numRecords( NULL ) );
+                    sizeInfo->dataSize.store( sizeInfo->rs->dataSize( NULL ) );
                 }
 
-                if ( !entry.dirty )
-                    continue;
-                myMap[uriKey] = entry;
+                BSONObjBuilder b;
+                b.append( "numRecords", sizeInfo->numRecords.load() );
+                b.append( "dataSize", sizeInfo->dataSize.load() );
+                values.push_back( b.obj() );
             }
         }
 
-        if (myMap.empty())
-            return; // Nothing to do.
-
         WT_SESSION* session = _session.getSession();
         invariantWTOK(session->begin_transaction(session, syncToDisk ? "sync=true" : ""));
         ScopeGuard rollbacker = MakeGuard(session->rollback_transaction, session, "");
 
-        for ( Map::iterator it = myMap.begin(); it != myMap.end(); ++it ) {
-            string uriKey = it->first;
-            Entry& entry = it->second;
-
-            BSONObj data;
-            {
-                BSONObjBuilder b;
-                b.append( "numRecords", entry.numRecords );
-                b.append( "dataSize", entry.dataSize );
-                data = b.obj();
-            }
+        for ( size_t i = 0; i < batch.size(); i++ ) {
+            const string& uriKey = batch[i]->uri;
+            const BSONObj& data = values[i];
 
             LOG(2) << "WiredTigerSizeStorer::storeInto " << uriKey << " -> " << data;
 
@@ -218,21 +278,47 @@ namespace mongo {
             WiredTigerItem value( data.objdata(), data.objsize() );
             _cursor->set_key( _cursor, key.Get() );
             _cursor->set_value( _cursor, value.Get() );
-            invariantWTOK( _cursor->insert(_cursor) );
+            int ret = _cursor->insert(_cursor);
+            if ( ret == WT_ROLLBACK )
+                throw WriteConflictException();
+            invariantWTOK( ret );
         }
 
         invariantWTOK(_cursor->reset(_cursor));
 
         rollbacker.Dismiss();
         invariantWTOK(session->commit_transaction(session, NULL));
+    }
 
-        {
-            boost::lock_guard<boost::mutex> lk( _entriesMutex );
-            for (Map::iterator it = _entries.begin(); it != _entries.end(); ++it) {
-                it->second.dirty = false;
+    void WiredTigerSizeStorer::startSyncThread(int syncPeriodMillis) {
+        invariant( !_syncThreadHandle.joinable() );
+        boost::thread t( stdx::bind( &WiredTigerSizeStorer::_syncThread, this,
+                                     syncPeriodMillis ) );
+        _syncThreadHandle.swap( t );
+    }
+
+    void WiredTigerSizeStorer::_syncThread(int syncPeriodMillis) {
+        setThreadName( "WTSizeStorer" );
+        LOG(1) << "WiredTigerSizeStorer sync thread started";
+
+        boost::unique_lock<boost::mutex> lk( _syncThreadMutex );
+        while ( !_syncThreadShutdown ) {
+            _syncThreadCondition.timed_wait( lk,
+                                             boost::posix_time::milliseconds(syncPeriodMillis) );
+            if ( _syncThreadShutdown )
+                break;
+
+            lk.unlock();
+            try {
+                syncCache(false);
             }
+            catch (const WriteConflictException&) {
+                // ignore, we'll try again later.
+            }
+            lk.lock();
         }
-    }
 
+        LOG(1) << "WiredTigerSizeStorer sync thread stopped";
+    }
 
 }
@@ -31,27 +31,50 @@
 
 #pragma once
 
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <map>
 #include <string>
+#include <vector>
 #include <wiredtiger.h>
 
 #include "mongo/base/string_data.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
+#include "mongo/platform/atomic_word.h"
 
 namespace mongo {
 
     class WiredTigerRecordStore;
     class WiredTigerSession;
 
+    /**
+     * Caches numRecords and dataSize of every record store and persists them in a WT table.
+     *
+     * Only the entries that changed since they were last written are tracked on a dirty list,
+     * and syncCache() writes them out in batches, so its cost does not depend on the number of
+     * record stores. Record stores mark their entry dirty through the handle they get from
+     * onCreate(), which takes no lock unless the entry was clean.
+     */
     class WiredTigerSizeStorer {
     public:
+        class SizeInfo;
+
         WiredTigerSizeStorer(WT_CONNECTION* conn, const std::string& storageUri);
         ~WiredTigerSizeStorer();
 
-        void onCreate( WiredTigerRecordStore* rs, long long nr, long long ds );
+        /**
+         * Registers the record store as the source of the sizes for its uri. The returned handle
+         * stays valid for the lifetime of the size storer.
+         */
+        SizeInfo* onCreate( WiredTigerRecordStore* rs, long long nr, long long ds );
         void onDestroy( WiredTigerRecordStore* rs );
 
+        /**
+         * Called whenever the sizes of the record store that owns the handle change.
+         */
+        void markDirty( SizeInfo* sizeInfo );
+
         void storeToCache( StringData uri, long long numRecords, long long dataSize );
 
         void loadFromCache( StringData uri, long long* numRecords, long long* dataSize ) const;
@@ -66,16 +89,29 @@ namespace mongo {
          */
         void syncCache(bool syncToDisk);
 
+        /**
+         * Starts a thread, which calls syncCache(false) every syncPeriodMillis. It is stopped by
+         * the destructor.
+         */
+        void startSyncThread(int syncPeriodMillis);
+
+        /**
+         * Number of entries waiting to be written.
+         */
+        size_t numDirty() const;
+
     private:
+        typedef std::vector<SizeInfo*> SizeInfos;
+
         void _checkMagic() const;
 
-        struct Entry {
-            Entry() : numRecords(0), dataSize(0), dirty(false), rs(NULL){}
-            long long numRecords;
-            long long dataSize;
-            bool dirty;
-            WiredTigerRecordStore* rs; // not owned
-        };
+        SizeInfo* _getOrCreate_inlock( const std::string& uri );
+
+        void _markDirty( SizeInfo* sizeInfo );
+
+        void _writeBatch( const SizeInfos& batch, bool syncToDisk );
+
+        void _syncThread(int syncPeriodMillis);
 
         int _magic;
 
@@ -84,10 +120,35 @@ namespace mongo {
         const WiredTigerSession _session;
         WT_CURSOR* _cursor; // pointer is const after constructor
 
-        typedef std::map<std::string,Entry> Map;
+        // Owns the SizeInfos, which are never removed.
+        typedef std::map<std::string, SizeInfo*> Map;
         Map _entries;
+
+        // Guards _entries and SizeInfo::rs. Acquire *before* _dirtyMutex.
         mutable boost::mutex _entriesMutex;
 
+        // Entries whose dirty flag got raised since the last sync.
+        SizeInfos _dirty;
+        mutable boost::mutex _dirtyMutex;
+
+        boost::thread _syncThreadHandle;
+        boost::mutex _syncThreadMutex;
+        boost::condition_variable _syncThreadCondition;
+        bool _syncThreadShutdown;
+    };
+
+    class WiredTigerSizeStorer::SizeInfo {
+    public:
+        explicit SizeInfo(const std::string& uri) : uri(uri), rs(NULL) { }
+
+        const std::string uri;
+        AtomicInt64 numRecords;
+        AtomicInt64 dataSize;
+
+        // 1 while the entry is on the dirty list
+        AtomicUInt32 dirty;
+
+        WiredTigerRecordStore* rs; // not owned
     };
 
 }
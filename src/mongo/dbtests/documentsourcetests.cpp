@@ -904,6 +904,80 @@ namespace DocumentSourceTests {
             string expectedResultSetString() { return "[{_id:[1,2,3],a:[[4,5,6]]}]"; }
         };
 
+        /** Sets whether $group may use a GroupTable, for the lifetime of this object. */
+        class UseGroupTable {
+        public:
+            explicit UseGroupTable( bool useGroupTable )
+                : _old( internalDocumentSourceGroupUseGroupTable ) {
+                internalDocumentSourceGroupUseGroupTable = useGroupTable;
+            }
+            ~UseGroupTable() {
+                internalDocumentSourceGroupUseGroupTable = _old;
+            }
+        private:
+            const bool _old;
+        };
+
+        /** A GroupTable produces the same results as the Accumulators it stands in for. */
+        class GroupTableMatchesAccumulators : public Base {
+        public:
+            void run() {
+                for ( int i = 0; i < 100; ++i ) {
+                    BSONObjBuilder b;
+                    b << "k" << i % 7 << "a" << i;
+                    if ( i % 3 == 0 ) {
+                        b.appendNull( "b" );
+                    }
+                    else {
+                        b << "b" << i * 1.5;
+                    }
+                    if ( i % 5 == 0 ) {
+                        b << "c" << BSONObjBuilder::numStr( i );
+                    }
+                    else {
+                        b << "c" << static_cast<long long>( i );
+                    }
+                    client.insert( ns, b.obj() );
+                }
+                // A group whose fields are all missing.
+                client.insert( ns, BSON( "k" << 7 ) );
+
+                ASSERT_EQUALS( results( false, false ), results( true, false ) );
+                ASSERT_EQUALS( results( false, true ), results( true, true ) );
+            }
+        private:
+            BSONArray results( bool useGroupTable, bool sharded ) {
+                UseGroupTable knob( useGroupTable );
+                createSource();
+                createGroup( fromjson( "{_id:'$k',sum:{$sum:'$c'},sumA:{$sum:'$a'},"
+                                       "avg:{$avg:'$b'},min:{$min:'$c'},max:{$max:'$b'},"
+                                       "first:{$first:'$b'},last:{$last:'$c'}}" ) );
+
+                intrusive_ptr<DocumentSource> sink = group();
+                if ( sharded ) {
+                    SplittableDocumentSource* splittable =
+                            dynamic_cast<SplittableDocumentSource*>( group() );
+                    ASSERT( splittable );
+                    sink = splittable->getMergeSource();
+                    createGroup( toBson( group() )[ "$group" ].Obj(), true );
+                    sink->setSource( group() );
+                }
+
+                IdMap resultSet;
+                while (boost::optional<Document> current = sink->getNext()) {
+                    resultSet[ current->getField( "_id" ) ] = *current;
+                }
+                assertExhausted( sink );
+                ASSERT_EQUALS( 8U, resultSet.size() );
+
+                BSONArrayBuilder bsonResultSet;
+                for( IdMap::const_iterator i = resultSet.begin(); i != resultSet.end(); ++i ) {
+                    bsonResultSet << i->second;
+                }
+                return bsonResultSet.arr();
+            }
+        };
+
     } // namespace DocumentSourceGroup
 
     namespace DocumentSourceProject {
@@ -1909,6 +1983,7 @@ namespace DocumentSourceTests {
             add<DocumentSourceGroup::Dependencies>();
             add<DocumentSourceGroup::StringConstantIdAndAccumulatorExpressions>();
             add<DocumentSourceGroup::ArrayConstantAccumulatorExpression>();
+            add<DocumentSourceGroup::GroupTableMatchesAccumulators>();
 
             add<DocumentSourceProject::Inclusion>();
             add<DocumentSourceProject::Optimize>();
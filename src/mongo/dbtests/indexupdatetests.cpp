@@ -36,6 +36,7 @@
 #include "mongo/db/db_raii.h"
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/dbhelpers.h"
+#include "mongo/db/index/index_access_method.h"
 #include "mongo/db/service_context_d.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/index/index_descriptor.h"
@@ -43,6 +44,13 @@
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/platform/cstdint.h"
 
+namespace mongo {
+
+    // How we access the external setParameter testing bool.
+    extern bool failIndexKeyTooLong;
+
+}  // namespace mongo
+
 namespace IndexUpdateTests {
 
     using boost::scoped_ptr;
@@ -895,6 +903,142 @@ namespace IndexUpdateTests {
         }
     };
 
+    /**
+     * Fixture for IndexAccessMethod::insertMany() tests, which hand it documents with made up
+     * locations rather than insert them in the collection.
+     */
+    class InsertManyBase : public IndexBuildBase {
+    protected:
+        IndexDescriptor* descriptor(const std::string& name) {
+            return collection()->getIndexCatalog()->findIndexByName(&_txn, name, true);
+        }
+
+        IndexAccessMethod* accessMethod(const std::string& name) {
+            return collection()->getIndexCatalog()->getIndex(descriptor(name));
+        }
+
+        static std::vector<RecordId> locs(size_t n) {
+            std::vector<RecordId> result;
+            for (size_t i = 0; i < n; ++i) {
+                result.push_back(RecordId(1, 16 * (i + 1)));
+            }
+            return result;
+        }
+    };
+
+    /** insertMany() marks the index multikey if any one document has several keys. */
+    class InsertManySetsMultikey : public InsertManyBase {
+    public:
+        void run() {
+            ASSERT_OK(createIndex("unittest",
+                                  BSON("name" << "a_1" << "ns" << _ns << "key" << BSON("a" << 1))));
+
+            std::vector<BSONObj> objs;
+            objs.push_back(BSON("a" << 1));
+            objs.push_back(BSON("a" << 2));
+            WriteUnitOfWork wunit(&_txn);
+            int64_t numInserted;
+            ASSERT_OK(accessMethod("a_1")->insertMany(&_txn, objs, locs(objs.size()),
+                                                      InsertDeleteOptions(), &numInserted));
+            ASSERT_EQUALS(2, numInserted);
+            ASSERT_FALSE(descriptor("a_1")->isMultikey(&_txn));
+
+            objs.clear();
+            objs.push_back(BSON("a" << 3));
+            objs.push_back(BSON("a" << BSON_ARRAY(4 << 5 << 6)));
+            ASSERT_OK(accessMethod("a_1")->insertMany(&_txn, objs, locs(objs.size()),
+                                                      InsertDeleteOptions(), &numInserted));
+            ASSERT_EQUALS(4, numInserted);
+            ASSERT_TRUE(descriptor("a_1")->isMultikey(&_txn));
+            wunit.commit();
+        }
+    };
+
+    /**
+     * insertMany() skips keys which are too long when failIndexKeyTooLong is off, and fails on
+     * them otherwise.
+     */
+    class InsertManyIgnoresKeyTooLong : public InsertManyBase {
+    public:
+        InsertManyIgnoresKeyTooLong() : _failIndexKeyTooLong(failIndexKeyTooLong) {}
+        ~InsertManyIgnoresKeyTooLong() { failIndexKeyTooLong = _failIndexKeyTooLong; }
+
+        void run() {
+            ASSERT_OK(createIndex("unittest",
+                                  BSON("name" << "a_1" << "ns" << _ns << "key" << BSON("a" << 1))));
+
+            std::vector<BSONObj> objs;
+            objs.push_back(BSON("a" << 1));
+            objs.push_back(BSON("a" << std::string(2000, 'x')));
+            objs.push_back(BSON("a" << 2));
+
+            {
+                failIndexKeyTooLong = false;
+                WriteUnitOfWork wunit(&_txn);
+                int64_t numInserted;
+                ASSERT_OK(accessMethod("a_1")->insertMany(&_txn, objs, locs(objs.size()),
+                                                          InsertDeleteOptions(), &numInserted));
+                ASSERT_EQUALS(2, numInserted);
+                ASSERT_FALSE(descriptor("a_1")->isMultikey(&_txn));
+            }
+
+            {
+                failIndexKeyTooLong = true;
+                WriteUnitOfWork wunit(&_txn);
+                int64_t numInserted;
+                ASSERT_EQUALS(ErrorCodes::KeyTooLong,
+                              accessMethod("a_1")->insertMany(&_txn, objs, locs(objs.size()),
+                                                              InsertDeleteOptions(),
+                                                              &numInserted));
+            }
+        }
+
+    private:
+        const bool _failIndexKeyTooLong;
+    };
+
+    /**
+     * insertMany() skips duplicate keys of a unique index which is still being built, as a
+     * document may be indexed twice during a background build, and fails on them once the index
+     * is ready.
+     */
+    class InsertManyIgnoresDupsWhileBuilding : public InsertManyBase {
+    public:
+        void run() {
+            const BSONObj spec = BSON("name" << "a_1" << "ns" << _ns << "key" << BSON("a" << 1)
+                                      << "unique" << true);
+
+            std::vector<BSONObj> objs;
+            objs.push_back(BSON("a" << 1));
+            objs.push_back(BSON("a" << 2));
+            objs.push_back(BSON("a" << 1));
+
+            {
+                MultiIndexBlock indexer(&_txn, collection());
+                BSONObjBuilder backgroundSpec;
+                backgroundSpec.appendElements(spec);
+                backgroundSpec.append("background", true);
+                ASSERT_OK(indexer.init(backgroundSpec.obj()));
+                ASSERT_FALSE(collection()->getIndexCatalog()->getEntry(descriptor("a_1"))
+                                 ->isReady(&_txn));
+
+                WriteUnitOfWork wunit(&_txn);
+                int64_t numInserted;
+                ASSERT_OK(accessMethod("a_1")->insertMany(&_txn, objs, locs(objs.size()),
+                                                          InsertDeleteOptions(), &numInserted));
+                ASSERT_EQUALS(2, numInserted);
+                // The indexer goes away without committing, which drops the unfinished index.
+            }
+
+            ASSERT_OK(createIndex("unittest", spec));
+            WriteUnitOfWork wunit(&_txn);
+            int64_t numInserted;
+            ASSERT_EQUALS(ErrorCodes::DuplicateKeyValue,
+                          accessMethod("a_1")->insertMany(&_txn, objs, locs(objs.size()),
+                                                          InsertDeleteOptions(), &numInserted));
+        }
+    };
+
     class IndexCatatalogFixIndexKey {
     public:
         void run() {
@@ -943,6 +1087,9 @@ namespace IndexUpdateTests {
             add<SameSpecDifferentSparse>();
             add<SameSpecDifferentTTL>();
             add<StorageEngineOptions>();
+            add<InsertManySetsMultikey>();
+            add<InsertManyIgnoresKeyTooLong>();
+            add<InsertManyIgnoresDupsWhileBuilding>();
 
             add<IndexCatatalogFixIndexKey>();
         }
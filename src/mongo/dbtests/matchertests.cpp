@@ -29,10 +29,12 @@
  *    then also delete it in the license file.
  */
 
+#include <boost/scoped_ptr.hpp>
 #include <iostream>
 
 #include "mongo/db/db_raii.h"
 #include "mongo/db/json.h"
+#include "mongo/db/matcher/compiled_expression.h"
 #include "mongo/db/matcher/matcher.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/dbtests/dbtests.h"
@@ -253,6 +255,49 @@ namespace MatcherTests {
         }
     };
 
+    /**
+     * Compares matching through the MatchExpression tree with the compiled program, on a
+     * document with many fields where the queried ones are towards the end.
+     */
+    class CompiledTiming {
+    public:
+        void run() {
+            BSONObjBuilder docBuilder;
+            for ( int i = 0; i < 20; i++ ) {
+                const string name = str::stream() << "f" << i;
+                docBuilder.append( name, i );
+            }
+            docBuilder.append( "a", 5 );
+            docBuilder.append( "b", BSON_ARRAY( "x" << "y" << "z" ) );
+            docBuilder.append( "c", 2.5 );
+            const BSONObj doc = docBuilder.obj();
+
+            const BSONObj query = fromjson( "{a: {$gte: 1, $lt: 10}, b: 'z', "
+                                            "$or: [{c: {$gt: 2}}, {d: {$exists: true}}]}" );
+            StatusWithMatchExpression result = MatchExpressionParser::parse( query );
+            ASSERT_OK( result.getStatus() );
+            boost::scoped_ptr<MatchExpression> expr( result.getValue() );
+            boost::scoped_ptr<CompiledMatchExpression> compiled(
+                CompiledMatchExpression::compile( expr.get() ) );
+            ASSERT( compiled );
+
+            const int iterations = 900000;
+            Timer t;
+            for ( int i = 0; i < iterations; i++ ) {
+                ASSERT( expr->matchesBSON( doc ) );
+            }
+            const long long treeMicros = t.micros();
+
+            t.reset();
+            for ( int i = 0; i < iterations; i++ ) {
+                ASSERT( compiled->matchesBSON( doc ) );
+            }
+            const long long compiledMicros = t.micros();
+
+            cout << "CompiledTiming tree: " << treeMicros * 1000 / iterations << "ns"
+                 << " compiled: " << compiledMicros * 1000 / iterations << "ns" << endl;
+        }
+    };
 
     class All : public Suite {
     public:
@@ -276,6 +321,7 @@ namespace MatcherTests {
             ADD_BOTH(WithinBox);
             ADD_BOTH(WithinCenter);
             ADD_BOTH(WithinPolygon);
+            add< CompiledTiming >();
         }
     };
 
@@ -131,6 +131,31 @@ namespace NamespaceTests {
                 ASSERT_EQUALS( nullFieldFromKey, missingField.firstElement());
             }
         };
+
+        /**
+         * The hash of null for a missing field also depends on the hashVersion.
+         */
+        class HashedIndexMissingFieldMurmur3 {
+        public:
+            void run() {
+                OperationContextImpl txn;
+                BSONObj spec( BSON("key" << BSON( "a" << "hashed" ) <<  "hashVersion" << 1 ));
+                BSONObj nullObj = BSON( "a" << BSONNULL );
+
+                BSONObjSet nullFieldKeySet;
+                ExpressionKeysPrivate::getHashKeys(nullObj, "a", 0, 1, false, &nullFieldKeySet);
+                BSONElement nullFieldFromKey = nullFieldKeySet.begin()->firstElement();
+
+                ASSERT_EQUALS( ExpressionKeysPrivate::makeSingleHashKey( nullObj.firstElement(), 0, 1 ),
+                               nullFieldFromKey.Long() );
+                ASSERT_NOT_EQUALS( ExpressionKeysPrivate::makeSingleHashKey( nullObj.firstElement(), 0, 0 ),
+                                   nullFieldFromKey.Long() );
+
+                BSONObj missingField = IndexLegacy::getMissingField(&txn, NULL,spec);
+                ASSERT_EQUALS( NumberLong, missingField.firstElement().type());
+                ASSERT_EQUALS( nullFieldFromKey, missingField.firstElement());
+            }
+        };
         
     } // namespace MissingFieldTests
 
@@ -623,6 +648,7 @@ namespace NamespaceTests {
             add< MissingFieldTests::TwoDIndexMissingField >();
             add< MissingFieldTests::HashedIndexMissingField >();
             add< MissingFieldTests::HashedIndexMissingFieldAlternateSeed >();
+            add< MissingFieldTests::HashedIndexMissingFieldMurmur3 >();
 
             // add< NamespaceDetailsTests::Create >();
             //add< NamespaceDetailsTests::SingleAlloc >();
@@ -39,6 +39,7 @@
 #include "mongo/platform/basic.h"
 
 #include <boost/filesystem/operations.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/version.hpp>
@@ -47,12 +48,18 @@
 #include <fstream>
 #include <mutex>
 
+#include "mongo/bson/bson_field_extractor.h"
 #include "mongo/config.h"
 #include "mongo/db/db.h"
 #include "mongo/db/dbdirectclient.h"
+#include "mongo/db/hasher.h"
+#include "mongo/db/index/btree_key_generator.h"
+#include "mongo/db/index/expression_keys_private.h"
 #include "mongo/db/json.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/storage/mmap_v1/durable_mapped_file.h"
 #include "mongo/db/storage/mmap_v1/dur_stats.h"
 #include "mongo/db/storage/mmap_v1/btree/key.h"
@@ -62,9 +69,11 @@
 #include "mongo/util/allocator.h"
 #include "mongo/util/checksum.h"
 #include "mongo/util/compress.h"
+#include "mongo/util/crc32c.h"
 #include "mongo/util/fail_point.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mmap.h"
+#include "mongo/util/processinfo.h"
 #include "mongo/util/timer.h"
 #include "mongo/util/version.h"
 #include "mongo/util/version_reporting.h"
@@ -1067,6 +1076,259 @@ namespace PerfTests {
         }
     };
 
+    // test speed of the crc32c used for journal section checksums, compare with ChecksumTest
+    template<bool Software>
+    class Crc32cTest : public B {
+    public:
+        const unsigned sz;
+        Crc32cTest() : sz(1024*1024*100+3) { }
+        string name() { return Software ? "crc32c-software" : "crc32c"; }
+        virtual int howLongMillis() { return 2000; }
+        virtual bool showDurStats() { return false; }
+        virtual unsigned batchSize() { return 1; }
+
+        void *p;
+        uint32_t last;
+
+        void prep() {
+            p = malloc(sz);
+            for (unsigned i = 0; i<sz; i++)
+                ((char*)p)[i] = rand();
+            last = crc32cSoftware(0, p, sz);
+            static unsigned once;
+            if( once++ == 0 )
+                cout << "crc32c hardware accelerated: " << crc32cIsHardwareAccelerated() << endl;
+        }
+
+        void timed() {
+            uint32_t c = Software ? crc32cSoftware(0, p, sz) : crc32c(0, p, sz);
+            ASSERT_EQUALS( c, last );
+        }
+        void post() {
+            ((char *&)p)[0]++; // check same data, different order, doesn't give same checksum
+            ((char *&)p)[1]--;
+            ASSERT( crc32c(0, p, sz) != last );
+            free(p);
+        }
+    };
+
+    /** hashed index key generation for each hashVersion, one document per op */
+    template<int HashVersion>
+    class HashedKeyGen : public B {
+    public:
+        string name() {
+            return str::stream() << "hashed-index-keys-v" << HashVersion;
+        }
+        virtual int howLongMillis() { return 2000; }
+        virtual bool showDurStats() { return false; }
+
+        vector<BSONObj> docs;
+        unsigned i;
+
+        void prep() {
+            // a mix of the shard key values people actually use
+            for (int n = 0; n < 1000; n++) {
+                const string user = "user" + BSONObjBuilder::numStr(n * 7919);
+                switch (n % 4) {
+                case 0: docs.push_back(BSON("a" << n)); break;
+                case 1: docs.push_back(BSON("a" << OID::gen())); break;
+                case 2: docs.push_back(BSON("a" << user)); break;
+                case 3: docs.push_back(BSON("a" << BSON("x" << n << "y" << user))); break;
+                }
+            }
+            i = 0;
+        }
+
+        void timed() {
+            BSONObjSet keys;
+            ExpressionKeysPrivate::getHashKeys(docs[i++ % docs.size()],
+                                               "a",
+                                               BSONElementHasher::DEFAULT_HASH_SEED,
+                                               HashVersion,
+                                               false,
+                                               &keys);
+            ASSERT_EQUALS(keys.size(), 1U);
+        }
+    };
+
+    /**
+     * Looking up a handful of fields, some dotted, in documents with 120 top-level fields, one
+     * path at a time or all at once with a BSONFieldExtractor.
+     */
+    template<bool UseExtractor>
+    class WideDocFields : public B {
+    public:
+        WideDocFields() : extractor(paths()) {}
+        string name() {
+            return UseExtractor ? "wide-doc-fields-extractor" : "wide-doc-fields-getField";
+        }
+        virtual int howLongMillis() { return 2000; }
+        virtual bool showDurStats() { return false; }
+
+        void prep() {
+            BSONObjBuilder b;
+            for (int n = 0; n < 120; n++) {
+                const string field = "field" + BSONObjBuilder::numStr(n);
+                if (n % 10 == 0) {
+                    b.append(field, BSON("x" << n << "y" << "value"));
+                }
+                else {
+                    b.append(field, n);
+                }
+            }
+            doc = b.obj();
+        }
+
+        void timed() {
+            const vector<const char*>& p = paths();
+            BSONElement elements[5];
+            const char* remaining[5];
+            if (UseExtractor) {
+                extractor.extract(doc, elements, remaining);
+            }
+            else {
+                for (size_t i = 0; i < p.size(); i++) {
+                    remaining[i] = p[i];
+                    elements[i] = doc.getFieldDottedOrArray(remaining[i]);
+                }
+            }
+            verify(elements[4].numberInt() == 110);
+        }
+
+    private:
+        static const vector<const char*>& paths() {
+            static const char* const names[] =
+                {"field3", "field50.x", "field77", "field90.y", "field110.x"};
+            static const vector<const char*> v(names, names + 5);
+            return v;
+        }
+
+        BSONObj doc;
+        const BSONFieldExtractor extractor;
+    };
+
+    /** compound index keys for documents with 120 top-level fields */
+    class WideDocBtreeKeys : public B {
+    public:
+        WideDocBtreeKeys() {
+            fieldNames.push_back("field7");
+            fieldNames.push_back("field60.x");
+            fieldNames.push_back("field99");
+            fieldNames.push_back("field118");
+            keyGen.reset(new BtreeKeyGeneratorV1(fieldNames,
+                                                 vector<BSONElement>(fieldNames.size()),
+                                                 false));
+        }
+        string name() { return "wide-doc-btree-keys"; }
+        virtual int howLongMillis() { return 2000; }
+        virtual bool showDurStats() { return false; }
+
+        void prep() {
+            BSONObjBuilder b;
+            for (int n = 0; n < 120; n++) {
+                const string field = "field" + BSONObjBuilder::numStr(n);
+                if (n % 10 == 0) {
+                    b.append(field, BSON("x" << n));
+                }
+                else {
+                    b.append(field, n);
+                }
+            }
+            doc = b.obj();
+
+            BSONObjSet keys;
+            keyGen->getKeys(doc, &keys);
+            verify(keys.size() == 1);
+            verify(keys.begin()->woCompare(BSON("" << 7 << "" << 60 << "" << 99 << "" << 118))
+                   == 0);
+        }
+
+        void timed() {
+            BSONObjSet keys;
+            keyGen->getKeys(doc, &keys);
+            verify(keys.size() == 1);
+        }
+
+    private:
+        vector<const char*> fieldNames;
+        boost::scoped_ptr<BtreeKeyGenerator> keyGen;
+        BSONObj doc;
+    };
+
+    /**
+     * $group of 2M documents into 1M groups, with a GroupTable or with Accumulators. Also reports
+     * how much the resident size grew while the groups were built.
+     */
+    template <bool UseGroupTable>
+    class GroupLargeInput : public B {
+    public:
+        GroupLargeInput() : groups(0), residentMB(0) {}
+        string name() {
+            return UseGroupTable ? "group-1M-groups-table" : "group-1M-groups-accumulators";
+        }
+        virtual int howLongMillis() { return 0; }
+        virtual bool showDurStats() { return false; }
+
+        void prep() {
+            ctx = new ExpressionContext(txn(), NamespaceString(ns()));
+            ctx->extSortAllowed = true;
+            ctx->tempDir = storageGlobalParams.dbpath + "/_tmp";
+        }
+
+        void timed() {
+            const bool oldUseGroupTable = internalDocumentSourceGroupUseGroupTable;
+            internalDocumentSourceGroupUseGroupTable = UseGroupTable;
+
+            BSONObj spec = BSON("$group" << BSON("_id" << "$k" << "total" << BSON("$sum" << "$x")));
+            boost::intrusive_ptr<DocumentSource> source(new Source(ctx));
+            boost::intrusive_ptr<DocumentSource> group =
+                DocumentSourceGroup::createFromBson(spec.firstElement(), ctx);
+            group->setSource(source.get());
+            internalDocumentSourceGroupUseGroupTable = oldUseGroupTable;
+
+            ProcessInfo processInfo;
+            const int residentBefore = processInfo.getResidentSize();
+            // The first getNext() consumes the whole input.
+            verify(group->getNext());
+            residentMB = processInfo.getResidentSize() - residentBefore;
+
+            groups = 1;
+            while (group->getNext()) {
+                groups++;
+            }
+        }
+
+        void post() {
+            verify(groups == kGroups);
+            cout << "stats " << setw(42) << left << name() << " resident +" << residentMB << "MB"
+                 << endl;
+        }
+
+    private:
+        static const long long kGroups = 1000 * 1000;
+        static const long long kDocs = 2 * kGroups;
+
+        /** Produces {k: i % kGroups, x: i} for i in [0, kDocs). */
+        class Source : public DocumentSource {
+        public:
+            explicit Source(const boost::intrusive_ptr<ExpressionContext>& ctx)
+                : DocumentSource(ctx), i(0) {}
+            virtual boost::optional<Document> getNext() {
+                if (i == kDocs)
+                    return boost::none;
+                const long long n = i++;
+                return DOC("k" << n % kGroups << "x" << n);
+            }
+        private:
+            virtual Value serialize(bool explain) const { return Value(); }
+            long long i;
+        };
+
+        boost::intrusive_ptr<ExpressionContext> ctx;
+        long long groups;
+        int residentMB;
+    };
+
     class InsertDup : public B {
         const BSONObj o;
     public:
@@ -1424,6 +1686,15 @@ namespace PerfTests {
             else {
                 add< Dummy >();
                 add< ChecksumTest >();
+                add< Crc32cTest<false> >();
+                add< Crc32cTest<true> >();
+                add< HashedKeyGen<0> >();
+                add< HashedKeyGen<1> >();
+                add< WideDocFields<false> >();
+                add< WideDocFields<true> >();
+                add< WideDocBtreeKeys >();
+                add< GroupLargeInput<true> >();
+                add< GroupLargeInput<false> >();
                 add< Compress >();
                 add< TLS >();
 #if defined(_WIN32)
@@ -46,6 +46,7 @@
 #include "mongo/db/storage/record_store.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/util/fail_point_service.h"
+#include "mongo/util/timer.h"
 
 namespace QueryStageCollectionScan {
 
@@ -78,6 +79,14 @@ namespace QueryStageCollectionScan {
             _client.remove(ns(), obj);
         }
 
+        void update(const BSONObj& query, const BSONObj& updateObj) {
+            _client.update(ns(), query, updateObj);
+        }
+
+        void insert(const BSONObj& obj) {
+            _client.insert(ns(), obj);
+        }
+
         int countResults(CollectionScanParams::Direction direction, const BSONObj& filterObj) {
             AutoGetCollectionForRead ctx(&_txn, ns());
 
@@ -379,6 +388,150 @@ namespace QueryStageCollectionScan {
         }
     };
 
+    //
+    // Scan through some of the objects, change the one we're about to fetch, then expect to get
+    // its new version.  Iterators which read ahead in batches must not return the old version.
+    //
+
+    class QueryStageCollscanInvalidateUpcomingObjectMutation : public QueryStageCollectionScanBase {
+    public:
+        void run() {
+            OldClientWriteContext ctx(&_txn, ns());
+            Collection* coll = ctx.getCollection();
+
+            vector<RecordId> locs;
+            getLocs(coll, CollectionScanParams::FORWARD, &locs);
+
+            CollectionScanParams params;
+            params.collection = coll;
+            params.direction = CollectionScanParams::FORWARD;
+            params.tailable = false;
+
+            WorkingSet ws;
+            scoped_ptr<CollectionScan> scan(new CollectionScan(&_txn, params, &ws, NULL));
+
+            int count = 0;
+            while (count < 10) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                PlanStage::StageState state = scan->work(&id);
+                if (PlanStage::ADVANCED == state) {
+                    ++count;
+                }
+            }
+
+            // Change locs[count] in place.
+            scan->saveState();
+            scan->invalidate(&_txn, locs[count], INVALIDATION_MUTATION);
+            update(BSON("foo" << count), BSON("$set" << BSON("foo" << -count)));
+            scan->restoreState(&_txn);
+
+            while (!scan->isEOF()) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                PlanStage::StageState state = scan->work(&id);
+                if (PlanStage::ADVANCED == state) {
+                    WorkingSetMember* member = ws.get(id);
+                    ASSERT_EQUALS(locs[count], member->loc);
+                    ASSERT_EQUALS(count == 10 ? -10 : count,
+                                  member->obj.value()["foo"].numberInt());
+                    ++count;
+                }
+            }
+
+            ASSERT_EQUALS(numObj(), count);
+        }
+    };
+
+    //
+    // Compare reading a collection one record at a time with reading it in batches, and time
+    // CollectionScan over it with and without a filter.  Only the timings are reported.
+    //
+
+    class QueryStageCollscanBenchmark : public QueryStageCollectionScanBase {
+    public:
+        void run() {
+            for (int i = numObj(); i < kDocs; ++i) {
+                insert(BSON("foo" << i));
+            }
+
+            AutoGetCollectionForRead ctx(&_txn, ns());
+            Collection* coll = ctx.getCollection();
+
+            unittest::log() << "scan of " << kDocs << " documents:";
+
+            {
+                Timer timer;
+                scoped_ptr<RecordIterator> it(coll->getIterator(&_txn));
+                int count = 0;
+                while (!it->isEOF()) {
+                    RecordId loc = it->curr();
+                    RecordData data = it->dataFor(loc);
+                    invariant(it->getNext() == loc);
+                    count += data.size() > 0;
+                }
+                ASSERT_EQUALS(kDocs, count);
+                report("RecordIterator::getNext", timer.micros());
+            }
+
+            {
+                Timer timer;
+                scoped_ptr<RecordIterator> it(coll->getIterator(&_txn));
+                vector<RecordIdAndData> batch;
+                int count = 0;
+                while (!it->isEOF()) {
+                    batch.clear();
+                    it->getNextBatch(64, &batch);
+                    for (size_t i = 0; i < batch.size(); ++i) {
+                        count += batch[i].data.size() > 0;
+                    }
+                }
+                ASSERT_EQUALS(kDocs, count);
+                report("RecordIterator::getNextBatch", timer.micros());
+            }
+
+            {
+                Timer timer;
+                ASSERT_EQUALS(kDocs, scanAll(coll, BSONObj()));
+                report("CollectionScan", timer.micros());
+            }
+
+            {
+                Timer timer;
+                ASSERT_EQUALS(0, scanAll(coll, BSON("foo" << -1)));
+                report("CollectionScan with filter", timer.micros());
+            }
+        }
+
+    private:
+        static const int kDocs = 20 * 1000;
+
+        int scanAll(Collection* coll, const BSONObj& filterObj) {
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(filterObj);
+            verify(swme.isOK());
+            auto_ptr<MatchExpression> filterExpr(swme.getValue());
+
+            CollectionScanParams params;
+            params.collection = coll;
+            params.direction = CollectionScanParams::FORWARD;
+            params.tailable = false;
+
+            WorkingSet ws;
+            CollectionScan scan(&_txn, params, &ws, filterExpr.get());
+            int count = 0;
+            while (!scan.isEOF()) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                if (PlanStage::ADVANCED == scan.work(&id)) {
+                    ws.free(id);
+                    ++count;
+                }
+            }
+            return count;
+        }
+
+        void report(const char* name, long long micros) {
+            unittest::log() << "    " << name << ": " << micros << " micros";
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "QueryStageCollectionScan" ) {}
@@ -393,6 +546,8 @@ namespace QueryStageCollectionScan {
             add<QueryStageCollscanObjectsInOrderBackward>();
             add<QueryStageCollscanInvalidateUpcomingObject>();
             add<QueryStageCollscanInvalidateUpcomingObjectBackward>();
+            add<QueryStageCollscanInvalidateUpcomingObjectMutation>();
+            add<QueryStageCollscanBenchmark>();
         }
     };
 
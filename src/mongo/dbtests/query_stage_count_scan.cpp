@@ -130,7 +130,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
 
             int numCounted = runCount(&count);
             ASSERT_EQUALS(2, numCounted);
@@ -162,7 +162,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
 
             int numCounted = runCount(&count);
             ASSERT_EQUALS(5, numCounted);
@@ -194,7 +194,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = false;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
 
             int numCounted = runCount(&count);
             ASSERT_EQUALS(3, numCounted);
@@ -222,7 +222,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = false;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
 
             int numCounted = runCount(&count);
             ASSERT_EQUALS(0, numCounted);
@@ -251,7 +251,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = false;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
 
             int numCounted = runCount(&count);
             ASSERT_EQUALS(0, numCounted);
@@ -281,7 +281,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
 
             int numCounted = runCount(&count);
             ASSERT_EQUALS(0, numCounted);
@@ -312,7 +312,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
             WorkingSetID wsid;
 
             int numCounted = 0;
@@ -363,7 +363,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
             WorkingSetID wsid;
 
             int numCounted = 0;
@@ -417,7 +417,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
             WorkingSetID wsid;
 
             int numCounted = 0;
@@ -474,7 +474,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
             WorkingSetID wsid;
 
             int numCounted = 0;
@@ -532,7 +532,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
 
             int numCounted = runCount(&count);
             ASSERT_EQUALS(7, numCounted);
@@ -565,7 +565,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true; // yes?
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
 
             int numCounted = runCount(&count);
             ASSERT_EQUALS(9, numCounted);
@@ -595,7 +595,7 @@ namespace QueryStageCountScan {
             params.endKeyInclusive = true;
 
             WorkingSet ws;
-            CountScan count(&_txn, params, &ws);
+            CountScan count(&_txn, params, &ws, NULL);
             WorkingSetID wsid;
 
             int numCounted = 0;
@@ -625,6 +625,70 @@ namespace QueryStageCountScan {
         }
     };
 
+    //
+    // Counts the keys of several intervals, optionally filtered, without an end key
+    //
+    class QueryStageCountScanBounds : public CountBase {
+    public:
+        void run() {
+            OldClientWriteContext ctx(&_txn, ns());
+
+            for (int a = 0; a < 10; ++a) {
+                for (int b = 0; b < 10; ++b) {
+                    insert(BSON("a" << a << "b" << b));
+                }
+            }
+            addIndex(BSON("a" << 1 << "b" << 1));
+
+            // a in {2} or [5, 7] and b in [3, 8).
+            CountScanParams params;
+            params.descriptor = getIndex(ctx.db(), BSON("a" << 1 << "b" << 1));
+            verify(params.descriptor);
+            OrderedIntervalList oilA("a");
+            oilA.intervals.push_back(Interval(BSON("" << 2 << "" << 2), true, true));
+            oilA.intervals.push_back(Interval(BSON("" << 5 << "" << 7), true, true));
+            params.bounds.fields.push_back(oilA);
+            OrderedIntervalList oilB("b");
+            oilB.intervals.push_back(Interval(BSON("" << 3 << "" << 8), true, false));
+            params.bounds.fields.push_back(oilB);
+
+            {
+                WorkingSet ws;
+                CountScan count(&_txn, params, &ws, NULL);
+                ASSERT_EQUALS(20, runCount(&count));
+            }
+
+            // Only the even values of b in those bounds.
+            StatusWithMatchExpression swme =
+                MatchExpressionParser::parse(fromjson("{b: {$mod: [2, 0]}}"));
+            ASSERT_OK(swme.getStatus());
+            boost::scoped_ptr<MatchExpression> filter(swme.getValue());
+
+            WorkingSet ws;
+            CountScan count(&_txn, params, &ws, filter.get());
+            WorkingSetID wsid;
+
+            int numCounted = 0;
+            PlanStage::StageState countState;
+            while (numCounted < 3) {
+                countState = count.work(&wsid);
+                if (PlanStage::ADVANCED == countState) numCounted++;
+            }
+
+            // Documents removed during a yield are not counted.
+            count.saveState();
+            remove(BSON("a" << 7 << "b" << 4));
+            remove(BSON("a" << 7 << "b" << 5));
+            count.restoreState(&_txn);
+
+            while (PlanStage::IS_EOF != countState) {
+                countState = count.work(&wsid);
+                if (PlanStage::ADVANCED == countState) numCounted++;
+            }
+            ASSERT_EQUALS(7, numCounted);
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite("query_stage_count_scan") { }
@@ -641,6 +705,7 @@ namespace QueryStageCountScan {
             add<QueryStageCountScanInsertNewDocsDuringYield>();
             add<QueryStageCountScanBecomesMultiKeyDuringYield>();
             add<QueryStageCountScanUnusedKeys>();
+            add<QueryStageCountScanBounds>();
         }
     };
 
@@ -34,6 +34,7 @@
 #include "mongo/db/exec/distinct_scan.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/json.h"
+#include "mongo/db/matcher/expression_parser.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/query/index_bounds_builder.h"
 #include "mongo/db/query/plan_executor.h"
@@ -135,7 +136,7 @@ namespace QueryStageDistinct {
             params.bounds.fields.push_back(oil);
 
             WorkingSet ws;
-            DistinctScan distinct(&_txn, params, &ws);
+            DistinctScan distinct(&_txn, params, &ws, NULL);
 
             WorkingSetID wsid;
             // Get our first result.
@@ -201,7 +202,7 @@ namespace QueryStageDistinct {
             params.bounds.fields.push_back(oil);
 
             WorkingSet ws;
-            DistinctScan distinct(&_txn, params, &ws);
+            DistinctScan distinct(&_txn, params, &ws, NULL);
 
             // We should see each number in the range [1, 6] exactly once.
             std::set<int> seen;
@@ -225,6 +226,62 @@ namespace QueryStageDistinct {
         }
     };
 
+    // Tests distinct with a filter over the index keys.
+    class QueryStageDistinctFilter : public DistinctBase {
+    public:
+        virtual ~QueryStageDistinctFilter() { }
+
+        void run() {
+            // Only the values 1 and 2 of 'a' have keys with b > 8, and those keys come last among
+            // the keys with the same value of 'a'.
+            for (int i = 0; i < 100; ++i) {
+                insert(BSON("a" << 1 << "b" << i % 10));
+                insert(BSON("a" << 2 << "b" << i % 10));
+                insert(BSON("a" << 3 << "b" << i % 5));
+            }
+
+            addIndex(BSON("a" << 1 << "b" << 1));
+
+            AutoGetCollectionForRead ctx(&_txn, ns());
+            Collection* coll = ctx.getCollection();
+
+            DistinctParams params;
+            params.descriptor = coll->getIndexCatalog()->findIndexByKeyPattern(
+                &_txn, BSON("a" << 1 << "b" << 1));
+            verify(params.descriptor);
+            params.direction = 1;
+            params.fieldNo = 0;
+            params.bounds.isSimpleRange = false;
+            OrderedIntervalList oilA("a");
+            oilA.intervals.push_back(IndexBoundsBuilder::allValues());
+            params.bounds.fields.push_back(oilA);
+            OrderedIntervalList oilB("b");
+            oilB.intervals.push_back(IndexBoundsBuilder::allValues());
+            params.bounds.fields.push_back(oilB);
+
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(fromjson("{b: {$gt: 8}}"));
+            ASSERT_OK(swme.getStatus());
+            boost::scoped_ptr<MatchExpression> filter(swme.getValue());
+
+            WorkingSet ws;
+            DistinctScan distinct(&_txn, params, &ws, filter.get());
+
+            std::vector<int> seen;
+            WorkingSetID wsid;
+            PlanStage::StageState state;
+            while (PlanStage::IS_EOF != (state = distinct.work(&wsid))) {
+                if (PlanStage::ADVANCED == state) {
+                    ASSERT_EQUALS(9, getIntFieldDotted(ws, wsid, "b"));
+                    seen.push_back(getIntFieldDotted(ws, wsid, "a"));
+                }
+            }
+
+            ASSERT_EQUALS(2U, seen.size());
+            ASSERT_EQUALS(1, seen[0]);
+            ASSERT_EQUALS(2, seen[1]);
+        }
+    };
+
     // XXX: add a test case with bounds where skipping to the next key gets us a result that's not
     // valid w.r.t. our query.
 
@@ -235,6 +292,7 @@ namespace QueryStageDistinct {
         void setupTests() {
             add<QueryStageDistinctBasic>();
             add<QueryStageDistinctMultiKey>();
+            add<QueryStageDistinctFilter>();
         }
     };
 
@@ -38,7 +38,9 @@
 #include "mongo/db/json.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/query/plan_executor.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/dbtests/dbtests.h"
+#include "mongo/util/scopeguard.h"
 
 /**
  * This file tests db/exec/sort.cpp
@@ -153,6 +155,7 @@ namespace QueryStageSortTests {
             params.collection = coll;
             params.pattern = BSON("foo" << direction);
             params.limit = limit();
+            params.allowDiskUse = allowDiskUse();
 
             // Must fetch so we can look at the doc as a BSONObj.
             PlanExecutor* rawExec;
@@ -206,6 +209,9 @@ namespace QueryStageSortTests {
         // Leave as 0 to disable limit.
         virtual int limit() const { return 0; };
 
+        // Whether the sort stage may spill to disk.
+        virtual bool allowDiskUse() const { return false; }
+
 
         static const char* ns() { return "unittests.QueryStageSort"; }
 
@@ -284,6 +290,72 @@ namespace QueryStageSortTests {
         }
     };
 
+    // Sort more data than fits in the sort stage's memory limit, spilling to disk.
+    template <int LIMIT>
+    class QueryStageSortSpill : public QueryStageSortTestBase {
+    public:
+        virtual int numObj() { return 10000; }
+        virtual int limit() const { return LIMIT; }
+        virtual bool allowDiskUse() const { return true; }
+
+        void run() {
+            OldClientWriteContext ctx(&_txn, ns());
+            Database* db = ctx.db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                WriteUnitOfWork wuow(&_txn);
+                coll = db->createCollection(&_txn, ns());
+                wuow.commit();
+            }
+
+            fillData();
+
+            // Small enough that every sort below has to write several sorted runs.
+            const int oldMaxBytes = internalQueryExecMaxBlockingSortBytes;
+            internalQueryExecMaxBlockingSortBytes = 16 * 1024;
+            ON_BLOCK_EXIT(setMaxBlockingSortBytes, oldMaxBytes);
+
+            sortAndCheck(1, coll);
+            sortAndCheck(-1, coll);
+        }
+
+    private:
+        static void setMaxBlockingSortBytes(int bytes) {
+            internalQueryExecMaxBlockingSortBytes = bytes;
+        }
+    };
+
+    // Without allowDiskUse, exceeding the memory limit fails the sort.
+    class QueryStageSortMemLimitExceeded : public QueryStageSortTestBase {
+    public:
+        virtual int numObj() { return 10000; }
+
+        void run() {
+            OldClientWriteContext ctx(&_txn, ns());
+            Database* db = ctx.db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                WriteUnitOfWork wuow(&_txn);
+                coll = db->createCollection(&_txn, ns());
+                wuow.commit();
+            }
+
+            fillData();
+
+            const int oldMaxBytes = internalQueryExecMaxBlockingSortBytes;
+            internalQueryExecMaxBlockingSortBytes = 16 * 1024;
+            ON_BLOCK_EXIT(setMaxBlockingSortBytes, oldMaxBytes);
+
+            boost::scoped_ptr<PlanExecutor> exec(makePlanExecutorWithSortStage(coll));
+            ASSERT_EQUALS(PlanExecutor::FAILURE, exec->getNext(NULL, NULL));
+        }
+
+    private:
+        static void setMaxBlockingSortBytes(int bytes) {
+            internalQueryExecMaxBlockingSortBytes = bytes;
+        }
+    };
+
     // Mutation invalidation of docs fed to sort.
     class QueryStageSortMutationInvalidation : public QueryStageSortTestBase {
     public:
@@ -553,6 +625,9 @@ namespace QueryStageSortTests {
             // and a special case for limit == 1
             add<QueryStageSortDecWithLimit<1> >();
             add<QueryStageSortExt>();
+            add<QueryStageSortSpill<0> >();
+            add<QueryStageSortSpill<500> >();
+            add<QueryStageSortMemLimitExceeded>();
             add<QueryStageSortMutationInvalidation>();
             add<QueryStageSortDeletionInvalidation>();
             add<QueryStageSortDeletionInvalidationWithLimit<10> >();
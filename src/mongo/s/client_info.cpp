@@ -103,6 +103,15 @@ namespace mongo {
         return info;
     }
 
+    ClientInfo* ClientInfo::releaseCurrent() {
+        return _tlInfo.release();
+    }
+
+    void ClientInfo::setCurrent(ClientInfo* info) {
+        massert(28625, "A ClientInfo already exists for this thread", !_tlInfo.get());
+        _tlInfo.reset(info);
+    }
+
     bool ClientInfo::exists() {
         return _tlInfo.get();
     }
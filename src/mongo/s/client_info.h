@@ -101,6 +101,10 @@ namespace mongo {
         static ClientInfo * get(AbstractMessagingPort* messagingPort = NULL);
         // Creates a ClientInfo and stores it in _tlInfo
         static ClientInfo* create(AbstractMessagingPort* messagingPort);
+        // Removes this thread's ClientInfo from _tlInfo without destroying it, so that it can be
+        // stored in _tlInfo of another thread with setCurrent
+        static ClientInfo* releaseCurrent();
+        static void setCurrent(ClientInfo* info);
 
     private:
         struct RequestInfo {
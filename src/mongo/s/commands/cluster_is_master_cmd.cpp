@@ -28,9 +28,12 @@
 
 #include "mongo/platform/basic.h"
 
+#include "mongo/db/client.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/operation_context.h"
 #include "mongo/db/wire_version.h"
 #include "mongo/s/write_ops/batched_command_request.h"
+#include "mongo/util/net/message_compression.h"
 
 namespace mongo {
 namespace {
@@ -78,6 +81,11 @@ namespace {
             result.append("maxWireVersion", maxWireVersion);
             result.append("minWireVersion", minWireVersion);
 
+            std::vector<MessageCompressor> acceptedCompressors;
+            appendNegotiatedMessageCompressors(cmdObj, &result, &acceptedCompressors);
+            if (txn->getClient()->port())
+                txn->getClient()->port()->acceptCompressors(acceptedCompressors);
+
             return true;
         }
 
@@ -78,6 +78,8 @@ namespace {
         virtual void help(std::stringstream& help) const {
             help << "Shard a collection. Requires key. Optional unique."
                  << " Sharding must already be enabled for the database.\n"
+                 << " A hashed shard key needs a hashed index with the default seed and"
+                 << " hashVersion.\n"
                  << "   { enablesharding : \"<dbname>\" }\n";
         }
 
@@ -203,7 +205,8 @@ namespace {
             //         ii. is not sparse
             //         iii. contains no null values
             //         iv. is not multikey (maybe lift this restriction later)
-            //         v. if a hashed index, has default seed (lift this restriction later)
+            //         v. if a hashed index, has default seed and hashVersion (lift this
+            //            restriction later)
             //
             // 3. If the proposed shard key is specified as unique, there must exist a useful,
             //    unique index exactly equal to the proposedKey (not just a prefix).
@@ -261,6 +264,20 @@ namespace {
                         return false;
                     }
 
+                    // mongos computes the hashes of shard key values itself and only knows the
+                    // default hashVersion, so the index must use it too.
+                    if (isHashedShardKey &&
+                        idx["hashVersion"].numberInt() != BSONElementHasher::DEFAULT_HASH_VERSION) {
+
+                        errmsg = str::stream() << "can't shard collection " << ns
+                                               << " with hashed shard key " << proposedKey
+                                               << " because the hashed index uses a non-default"
+                                               << " hashVersion of "
+                                               << idx["hashVersion"].numberInt();
+                        conn.done();
+                        return false;
+                    }
+
                     hasUsefulIndexForKey = true;
                 }
             }
@@ -38,6 +38,7 @@
 #include <boost/thread/thread.hpp>
 #include <iostream>
 
+#include "mongo/base/checked_cast.h"
 #include "mongo/base/init.h"
 #include "mongo/base/initializer.h"
 #include "mongo/base/status.h"
@@ -189,6 +190,14 @@ namespace mongo {
         virtual void disconnected( AbstractMessagingPort* p ) {
             // all things are thread local
         }
+
+        virtual ClientBasic* detachFromThread( AbstractMessagingPort* p ) {
+            return ClientInfo::releaseCurrent();
+        }
+
+        virtual void attachToThread( AbstractMessagingPort* p , ClientBasic* client ) {
+            ClientInfo::setCurrent( checked_cast<ClientInfo*>( client ) );
+        }
     };
 
     void start( const MessageServer::Options& opts ) {
@@ -310,6 +319,10 @@ static ExitCode runMongosServer( bool doUpgrade ) {
     MessageServer::Options opts;
     opts.port = serverGlobalParams.port;
     opts.ipList = serverGlobalParams.bind_ip;
+    if (serverGlobalParams.reactorNetworking) {
+        opts.connectionModel = MessageServer::Options::kReactor;
+        opts.workerThreads = serverGlobalParams.reactorWorkerThreads;
+    }
     start(opts);
 
     // listen() will return when exit code closes its socket.
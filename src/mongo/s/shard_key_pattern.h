@@ -114,7 +114,8 @@ namespace mongo {
          *
          * Paths to shard key fields must not contain arrays at any level, and shard keys may not
          * be array fields, undefined, or non-storable sub-documents.  If the shard key pattern is
-         * a hashed key pattern, this method performs the hashing.
+         * a hashed key pattern, this method performs the hashing, always with the default seed and
+         * hashVersion; shardCollection refuses hashed indexes which use others.
          *
          * If a shard key cannot be extracted, returns an empty BSONObj().
          *
@@ -39,6 +39,7 @@
 #include "mongo/db/server_options.h"
 #include "mongo/shell/shell_utils.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/sock.h"
 #include "mongo/util/net/ssl_options.h"
 #include "mongo/util/options_parser/startup_options.h"
@@ -107,6 +108,11 @@ namespace mongo {
         options->addOptionChaining("ipv6", "ipv6", moe::Switch,
                 "enable IPv6 support (disabled by default)");
 
+        options->addOptionChaining("networkMessageCompressors", "networkMessageCompressors",
+                moe::String,
+                "comma separated list of compressors to offer servers, most preferred first "
+                "(snappy,zlib/disabled)");
+
         Status ret = Status::OK();
 #ifdef MONGO_CONFIG_SSL
         ret = addSSLClientOptions(options);
@@ -194,6 +200,15 @@ namespace mongo {
         if (params.count("ipv6")) {
             mongo::enableIPv6();
         }
+        if (params.count("networkMessageCompressors")) {
+            std::vector<MessageCompressor> compressors;
+            Status status = parseMessageCompressors(
+                params["networkMessageCompressors"].as<string>(), &compressors);
+            if (!status.isOK()) {
+                return status;
+            }
+            setMessageCompressors(compressors);
+        }
         if (params.count("verbose")) {
             logger::globalLogDomain()->setMinimumLoggedSeverity(logger::LogSeverity::Debug(1));
         }
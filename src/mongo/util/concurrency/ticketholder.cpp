@@ -30,167 +30,190 @@
 #include "mongo/platform/basic.h"
 
 #include "mongo/util/concurrency/ticketholder.h"
-#include "mongo/util/log.h"
+
+#include "mongo/util/assert_util.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
-#if defined(__linux__)
-    namespace {
-        void _check(int ret) {
-            if (ret == 0)
-                return;
-            int err = errno;
-            severe() << "error in Ticketholder: " << errnoWithDescription(err);
-            fassertFailed(28604);
+    TicketHolder::QueueStats::QueueStats()
+        : waiting(0), queued(0), totalWaitMicros(0) {
+        for (int i = 0; i < kNumWaitBuckets; i++) {
+            waitMicros[i] = 0;
         }
     }
 
     TicketHolder::TicketHolder(int num)
-        : _outof(num) {
-        _check(sem_init(&_sem, 0, num));
+        : _available(num),
+          _outof(num),
+          _numWaiting(0),
+          _nextSequence(0),
+          _numGranted(0) {
     }
 
-    TicketHolder::~TicketHolder(){
-        _check(sem_destroy(&_sem));
-    }
+    TicketHolder::~TicketHolder() = default;
 
     bool TicketHolder::tryAcquire() {
-        while (0 != sem_trywait(&_sem)) {
-            switch(errno) {
-            case EAGAIN: return false;
-            case EINTR: break;
-            default: _check(-1);
-            }
-        }
-        return true;
+        return _tryAcquireFree();
     }
 
-    void TicketHolder::waitForTicket() {
-        while (0 != sem_wait(&_sem)) {
-            switch(errno) {
-            case EINTR: break;
-            default: _check(-1);
-            }
+    bool TicketHolder::_tryAcquireFree() {
+        // Queued callers go first.
+        if (_numWaiting.load() > 0)
+            return false;
+
+        int available = _available.load();
+        while (available > 0) {
+            const int old = _available.compareAndSwap(available, available - 1);
+            if (old == available)
+                return true;
+            available = old;
         }
+        return false;
     }
 
-    void TicketHolder::release() {
-        _check(sem_post(&_sem));
-    }
+    void TicketHolder::waitForTicket(Priority priority) {
+        invariant(priority >= 0 && priority < kNumPriorities);
 
-    Status TicketHolder::resize(int newSize) {
-        boost::lock_guard<boost::mutex> lk(_resizeMutex);
+        if (_tryAcquireFree())
+            return;
 
-        if (newSize < 5)
-            return Status(ErrorCodes::BadValue,
-                          str::stream() << "Minimum value for semaphore is 5; given "
-                          << newSize);
+        Timer timer;
+        Waiter waiter;
+        boost::unique_lock<boost::mutex> lk(_mutex);
 
-        if (newSize > SEM_VALUE_MAX)
-            return Status(ErrorCodes::BadValue,
-                          str::stream() << "Maximum value for semaphore is "
-                          << SEM_VALUE_MAX << "; given " << newSize );
+        waiter.sequence = _nextSequence++;
+        _queues[priority].push_back(&waiter);
+        _numWaiting.fetchAndAdd(1);
 
-        while (_outof.load() < newSize) {
-            release();
-            _outof.fetchAndAdd(1);
-        }
+        // A ticket may have been released before _numWaiting went up, in which case its
+        // release() didn't look at the queues.
+        _grantTickets();
 
-        while (_outof.load() > newSize) {
-            waitForTicket();
-            _outof.subtractAndFetch(1);
+        while (!waiter.granted) {
+            waiter.wakeUp.wait(lk);
         }
 
-        invariant(_outof.load() == newSize);
-        return Status::OK();
-    }
+        const long long micros = timer.micros();
+        QueueStats& stats = _stats[priority];
+        stats.queued++;
+        stats.totalWaitMicros += micros;
 
-    int TicketHolder::available() const {
-        int val = 0;
-        _check(sem_getvalue(&_sem, &val));
-        return val;
+        int bucket = 0;
+        for (long long bound = 10; bucket < kNumWaitBuckets - 1 && micros >= bound; bound *= 10) {
+            bucket++;
+        }
+        stats.waitMicros[bucket]++;
     }
 
-    int TicketHolder::used() const {
-        return outof() - available();
-    }
+    void TicketHolder::release() {
+        _available.fetchAndAdd(1);
 
-    int TicketHolder::outof() const {
-        return _outof.load();
+        // Pairs with waitForTicket() raising _numWaiting before it looks for a free ticket.
+        if (_numWaiting.load() > 0) {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            _grantTickets();
+        }
     }
 
-#else
-
-    TicketHolder::TicketHolder( int num ) : _outof(num), _num(num) {}
-
-    TicketHolder::~TicketHolder() = default;
+    void TicketHolder::_grantTickets() {
+        while (_numWaiting.load() > 0) {
+            const int available = _available.load();
+            if (available <= 0)
+                return;
+            if (_available.compareAndSwap(available, available - 1) != available)
+                continue;
 
-    bool TicketHolder::tryAcquire() {
-        boost::lock_guard<boost::mutex> lk( _mutex );
-        return _tryAcquire();
+            Waiter* waiter = _nextWaiter();
+            _numWaiting.subtractAndFetch(1);
+            waiter->granted = true;
+            waiter->wakeUp.notify_one();
+        }
     }
 
-    void TicketHolder::waitForTicket() {
-        boost::unique_lock<boost::mutex> lk( _mutex );
+    TicketHolder::Waiter* TicketHolder::_nextWaiter() {
+        int chosen = -1;
 
-        while( ! _tryAcquire() ) {
-            _newTicket.wait( lk );
+        if (++_numGranted % kFairnessInterval == 0) {
+            // The longest waiting caller is at the head of one of the queues.
+            for (int i = 0; i < kNumPriorities; i++) {
+                if (_queues[i].empty())
+                    continue;
+                if (chosen < 0 || _queues[i].front()->sequence < _queues[chosen].front()->sequence)
+                    chosen = i;
+            }
         }
-    }
-
-    void TicketHolder::release() {
-        {
-            boost::lock_guard<boost::mutex> lk( _mutex );
-            _num++;
+        else {
+            for (int i = 0; i < kNumPriorities; i++) {
+                if (!_queues[i].empty()) {
+                    chosen = i;
+                    break;
+                }
+            }
         }
-        _newTicket.notify_one();
-    }
 
-    Status TicketHolder::resize( int newSize ) {
-        boost::lock_guard<boost::mutex> lk( _mutex );
+        invariant(chosen >= 0);
+        Waiter* waiter = _queues[chosen].front();
+        _queues[chosen].pop_front();
+        return waiter;
+    }
 
-        int used = _outof.load() - _num;
-        if ( used > newSize ) {
-            std::stringstream ss;
-            ss << "can't resize since we're using (" << used << ") "
-               << "more than newSize(" << newSize << ")";
+    Status TicketHolder::resize(int newSize) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
 
-            std::string errmsg = ss.str();
-            log() << errmsg;
-            return Status(ErrorCodes::BadValue, errmsg);
-        }
+        if (newSize < 5)
+            return Status(ErrorCodes::BadValue,
+                          str::stream() << "Minimum value for semaphore is 5; given "
+                          << newSize);
 
+        const int delta = newSize - _outof.load();
         _outof.store(newSize);
-        _num = _outof.load() - used;
+        _available.fetchAndAdd(delta);
 
-        // Potentially wasteful, but easier to see is correct
-        _newTicket.notify_all();
+        _grantTickets();
         return Status::OK();
     }
 
     int TicketHolder::available() const {
-        return _num;
+        const int available = _available.load();
+        return available > 0 ? available : 0;
     }
 
     int TicketHolder::used() const {
-        return outof() - _num;
+        return outof() - _available.load();
     }
 
     int TicketHolder::outof() const {
         return _outof.load();
     }
 
-    bool TicketHolder::_tryAcquire(){
-        if ( _num <= 0 ) {
-            if ( _num < 0 ) {
-                std::cerr << "DISASTER! in TicketHolder" << std::endl;
-            }
-            return false;
+    TicketHolder::QueueStats TicketHolder::getQueueStats(Priority priority) const {
+        invariant(priority >= 0 && priority < kNumPriorities);
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        QueueStats stats = _stats[priority];
+        stats.waiting = _queues[priority].size();
+        return stats;
+    }
+
+    const char* TicketHolder::priorityName(Priority priority) {
+        switch (priority) {
+        case kReplication: return "replication";
+        case kInteractive: return "interactive";
+        case kScan: return "scan";
+        case kNumPriorities: break;
         }
-        _num--;
-        return true;
+        invariant(false);
+        return NULL;
+    }
+
+    const char* TicketHolder::waitBucketName(int bucket) {
+        static const char* const names[kNumWaitBuckets] = {
+            "lt10us", "lt100us", "lt1ms", "lt10ms", "lt100ms", "lt1s", "ge1s"
+        };
+        invariant(bucket >= 0 && bucket < kNumWaitBuckets);
+        return names[bucket];
     }
-#endif
 
 }
@@ -26,29 +26,66 @@
  */
 #pragma once
 
-#if defined(__linux__)
-#include <semaphore.h>
-#endif
-
 #include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
 
 #include "mongo/base/disallow_copying.h"
-#include "mongo/util/concurrency/mutex.h"
+#include "mongo/base/status.h"
+#include "mongo/platform/atomic_word.h"
 
 namespace mongo {
 
+    /**
+     * Hands out a fixed number of tickets, for limiting how many operations do something at
+     * once.
+     *
+     * When a ticket is free and nobody is queued, acquiring it is a single compare and swap.
+     * Otherwise waitForTicket() queues the caller. There is one FIFO queue for each Priority, and
+     * a released ticket goes to the head of the highest priority queue which has waiters. So
+     * that lower priority queues still drain under sustained load, every kFairnessInterval-th
+     * ticket handed out from the queues goes to the longest waiting caller instead.
+     */
     class TicketHolder {
         MONGO_DISALLOW_COPYING(TicketHolder);
     public:
+        enum Priority {
+            kReplication,   // applying and serving the oplog
+            kInteractive,   // short operations with a client waiting on them
+            kScan,          // long running reads
+            kNumPriorities
+        };
+
+        static const int kFairnessInterval = 4;
+
+        // Bucket i of a wait time histogram counts waits shorter than 10^(i+1) microseconds.
+        // The last bucket counts all longer waits.
+        static const int kNumWaitBuckets = 7;
+
+        struct QueueStats {
+            QueueStats();
+
+            int waiting;                // callers in the queue now
+            long long queued;           // tickets handed out from the queue
+            long long totalWaitMicros;  // time those callers spent in the queue
+            long long waitMicros[kNumWaitBuckets];
+        };
+
         explicit TicketHolder(int num);
         ~TicketHolder();
 
+        /**
+         * Takes a ticket if one is free and nobody is queued for one.
+         */
         bool tryAcquire();
 
-        void waitForTicket();
+        void waitForTicket(Priority priority = kInteractive);
 
         void release();
 
+        /**
+         * When shrinking, tickets in use stay out until they are released.
+         */
         Status resize(int newSize);
 
         int available() const;
@@ -57,21 +94,42 @@ namespace mongo {
 
         int outof() const;
 
+        QueueStats getQueueStats(Priority priority) const;
+
+        static const char* priorityName(Priority priority);
+
+        /** Name of bucket 'bucket' of QueueStats::waitMicros, such as "lt100us". */
+        static const char* waitBucketName(int bucket);
+
     private:
-#if defined(__linux__)
-        mutable sem_t _sem;
+        struct Waiter {
+            Waiter() : granted(false), sequence(0) {}
 
-        // You can read _outof without a lock, but have to hold _resizeMutex to change.
-        AtomicInt32 _outof;
-        boost::mutex _resizeMutex;
-#else
-        bool _tryAcquire();
+            boost::condition_variable wakeUp;
+            bool granted;
+            unsigned long long sequence;
+        };
+
+        bool _tryAcquireFree();
+
+        /** Hands out free tickets to queued callers. Must hold _mutex. */
+        void _grantTickets();
 
+        /** Removes and returns the caller which gets the next ticket. Must hold _mutex. */
+        Waiter* _nextWaiter();
+
+        // Free tickets. Negative when the holder was shrunk while more tickets were in use.
+        AtomicInt32 _available;
         AtomicInt32 _outof;
-        int _num;
-        mongo::mutex _mutex;
-        boost::condition_variable_any _newTicket;
-#endif
+
+        // Callers in the queues. Only changed while holding _mutex.
+        AtomicInt32 _numWaiting;
+
+        mutable boost::mutex _mutex;
+        std::deque<Waiter*> _queues[kNumPriorities];
+        unsigned long long _nextSequence;
+        unsigned long long _numGranted;
+        QueueStats _stats[kNumPriorities];
     };
 
     class ScopedTicket {
@@ -0,0 +1,269 @@
+/*    Copyright 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/stdx/functional.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/time_support.h"
+
+namespace {
+
+    using boost::scoped_ptr;
+    using mongo::AtomicInt32;
+    using mongo::TicketHolder;
+
+    /**
+     * Waits for a ticket on a thread of its own.
+     */
+    class Waiter {
+    public:
+        Waiter(TicketHolder* holder, TicketHolder::Priority priority)
+            : _holder(holder), _priority(priority), _done(0) {}
+
+        ~Waiter() {
+            if (_thread) {
+                _thread->join();
+            }
+        }
+
+        /** Starts waiting, and returns once the waiter is queued. */
+        void start() {
+            const int queued = _holder->getQueueStats(_priority).waiting;
+            _thread.reset(new boost::thread(mongo::stdx::bind(&Waiter::run, this)));
+            while (_holder->getQueueStats(_priority).waiting == queued) {
+                mongo::sleepmillis(1);
+            }
+        }
+
+        bool done() const { return _done.load() != 0; }
+
+    private:
+        void run() {
+            _holder->waitForTicket(_priority);
+            _done.store(1);
+        }
+
+        TicketHolder* _holder;
+        const TicketHolder::Priority _priority;
+        AtomicInt32 _done;
+        scoped_ptr<boost::thread> _thread;
+    };
+
+    /** Releases one ticket and returns once one of the waiters has it. */
+    void releaseToOneOf(TicketHolder* holder, Waiter** waiters, int numWaiters) {
+        int before = 0;
+        for (int i = 0; i < numWaiters; i++) {
+            before += waiters[i]->done();
+        }
+
+        holder->release();
+
+        for (;;) {
+            int after = 0;
+            for (int i = 0; i < numWaiters; i++) {
+                after += waiters[i]->done();
+            }
+            if (after > before) {
+                ASSERT_EQUALS(before + 1, after);
+                return;
+            }
+            mongo::sleepmillis(1);
+        }
+    }
+
+    void acquireAll(TicketHolder* holder) {
+        while (holder->tryAcquire()) {
+        }
+        ASSERT_EQUALS(0, holder->available());
+    }
+
+    TEST(TicketHolderTest, BasicTimeout) {
+        TicketHolder holder(5);
+        ASSERT_EQUALS(0, holder.used());
+        ASSERT_EQUALS(5, holder.available());
+        ASSERT_EQUALS(5, holder.outof());
+
+        for (int i = 0; i < 5; i++) {
+            ASSERT_TRUE(holder.tryAcquire());
+        }
+        ASSERT_FALSE(holder.tryAcquire());
+        ASSERT_EQUALS(5, holder.used());
+        ASSERT_EQUALS(0, holder.available());
+
+        holder.release();
+        ASSERT_EQUALS(4, holder.used());
+        holder.waitForTicket();
+        ASSERT_EQUALS(5, holder.used());
+    }
+
+    TEST(TicketHolderTest, Resize) {
+        TicketHolder holder(10);
+        for (int i = 0; i < 8; i++) {
+            ASSERT_TRUE(holder.tryAcquire());
+        }
+
+        ASSERT_NOT_OK(holder.resize(4));
+
+        // Tickets in use stay out until they are released.
+        ASSERT_OK(holder.resize(6));
+        ASSERT_EQUALS(6, holder.outof());
+        ASSERT_EQUALS(8, holder.used());
+        ASSERT_EQUALS(0, holder.available());
+        for (int i = 0; i < 3; i++) {
+            holder.release();
+        }
+        ASSERT_EQUALS(5, holder.used());
+        ASSERT_EQUALS(1, holder.available());
+
+        ASSERT_OK(holder.resize(8));
+        ASSERT_EQUALS(3, holder.available());
+    }
+
+    TEST(TicketHolderTest, ResizeWakesWaiters) {
+        TicketHolder holder(5);
+        acquireAll(&holder);
+
+        Waiter waiter(&holder, TicketHolder::kInteractive);
+        waiter.start();
+        ASSERT_OK(holder.resize(6));
+        while (!waiter.done()) {
+            mongo::sleepmillis(1);
+        }
+        ASSERT_EQUALS(6, holder.used());
+    }
+
+    TEST(TicketHolderTest, FifoWithinPriority) {
+        TicketHolder holder(5);
+        acquireAll(&holder);
+
+        Waiter first(&holder, TicketHolder::kInteractive);
+        Waiter second(&holder, TicketHolder::kInteractive);
+        first.start();
+        second.start();
+
+        // A free ticket goes to the queue, not to a caller which didn't wait.
+        Waiter* waiters[] = { &first, &second };
+        releaseToOneOf(&holder, waiters, 2);
+        ASSERT_TRUE(first.done());
+        ASSERT_FALSE(holder.tryAcquire());
+
+        releaseToOneOf(&holder, waiters, 2);
+        ASSERT_TRUE(second.done());
+    }
+
+    TEST(TicketHolderTest, HigherPriorityFirst) {
+        TicketHolder holder(5);
+        acquireAll(&holder);
+
+        Waiter scan(&holder, TicketHolder::kScan);
+        Waiter interactive(&holder, TicketHolder::kInteractive);
+        Waiter replication(&holder, TicketHolder::kReplication);
+        scan.start();
+        interactive.start();
+        replication.start();
+
+        Waiter* waiters[] = { &scan, &interactive, &replication };
+        releaseToOneOf(&holder, waiters, 3);
+        ASSERT_TRUE(replication.done());
+        ASSERT_FALSE(interactive.done());
+
+        releaseToOneOf(&holder, waiters, 3);
+        ASSERT_TRUE(interactive.done());
+        ASSERT_FALSE(scan.done());
+
+        releaseToOneOf(&holder, waiters, 3);
+        ASSERT_TRUE(scan.done());
+    }
+
+    TEST(TicketHolderTest, LowerPriorityIsNotStarved) {
+        TicketHolder holder(5);
+        acquireAll(&holder);
+
+        Waiter scan(&holder, TicketHolder::kScan);
+        scan.start();
+
+        const int numReplication = TicketHolder::kFairnessInterval;
+        Waiter* waiters[numReplication + 1];
+        waiters[0] = &scan;
+        for (int i = 1; i <= numReplication; i++) {
+            waiters[i] = new Waiter(&holder, TicketHolder::kReplication);
+            waiters[i]->start();
+        }
+
+        // The longest waiting caller gets every kFairnessInterval-th ticket.
+        for (int i = 1; i < TicketHolder::kFairnessInterval; i++) {
+            releaseToOneOf(&holder, waiters, numReplication + 1);
+            ASSERT_TRUE(waiters[i]->done());
+        }
+        ASSERT_FALSE(scan.done());
+        releaseToOneOf(&holder, waiters, numReplication + 1);
+        ASSERT_TRUE(scan.done());
+
+        releaseToOneOf(&holder, waiters, numReplication + 1);
+        for (int i = 1; i <= numReplication; i++) {
+            delete waiters[i];
+        }
+    }
+
+    TEST(TicketHolderTest, QueueStats) {
+        TicketHolder holder(5);
+        acquireAll(&holder);
+
+        Waiter first(&holder, TicketHolder::kScan);
+        Waiter second(&holder, TicketHolder::kScan);
+        first.start();
+        second.start();
+        ASSERT_EQUALS(2, holder.getQueueStats(TicketHolder::kScan).waiting);
+
+        Waiter* waiters[] = { &first, &second };
+        releaseToOneOf(&holder, waiters, 2);
+        releaseToOneOf(&holder, waiters, 2);
+
+        TicketHolder::QueueStats stats = holder.getQueueStats(TicketHolder::kScan);
+        ASSERT_EQUALS(0, stats.waiting);
+        ASSERT_EQUALS(2, stats.queued);
+        ASSERT_GREATER_THAN(stats.totalWaitMicros, 0);
+
+        long long total = 0;
+        for (int i = 0; i < TicketHolder::kNumWaitBuckets; i++) {
+            total += stats.waitMicros[i];
+        }
+        ASSERT_EQUALS(2, total);
+
+        // Acquiring a free ticket doesn't queue.
+        holder.release();
+        holder.waitForTicket(TicketHolder::kScan);
+        ASSERT_EQUALS(2, holder.getQueueStats(TicketHolder::kScan).queued);
+        ASSERT_EQUALS(0, holder.getQueueStats(TicketHolder::kInteractive).queued);
+    }
+
+}  // namespace
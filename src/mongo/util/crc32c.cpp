@@ -0,0 +1,301 @@
+// crc32c.cpp
+
+/*    Copyright 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/crc32c.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <cpuid.h>
+#define MONGO_CRC32C_SSE42_GCC
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <nmmintrin.h>
+#define MONGO_CRC32C_SSE42_MSVC
+#endif
+
+namespace mongo {
+
+namespace {
+
+    // Reflected CRC32C polynomial 0x82f63b78, one entry per byte value.
+    const uint32_t crc32cTable[256] = {
+        0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c,
+        0x26a1e7e8, 0xd4ca64eb, 0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b,
+        0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24, 0x105ec76f, 0xe235446c,
+        0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+        0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc,
+        0xbc267848, 0x4e4dfb4b, 0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a,
+        0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35, 0xaa64d611, 0x580f5512,
+        0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+        0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad,
+        0x1642ae59, 0xe4292d5a, 0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a,
+        0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595, 0x417b1dbc, 0xb3109ebf,
+        0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+        0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f,
+        0xed03a29b, 0x1f682198, 0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927,
+        0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38, 0xdbfc821c, 0x2997011f,
+        0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+        0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e,
+        0x4767748a, 0xb50cf789, 0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859,
+        0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46, 0x7198540d, 0x83f3d70e,
+        0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+        0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de,
+        0xdde0eb2a, 0x2f8b6829, 0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c,
+        0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93, 0x082f63b7, 0xfa44e0b4,
+        0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+        0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b,
+        0xb4091bff, 0x466298fc, 0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c,
+        0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033, 0xa24bb5a6, 0x502036a5,
+        0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+        0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975,
+        0x0e330a81, 0xfc588982, 0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d,
+        0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622, 0x38cc2a06, 0xcaa7a905,
+        0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+        0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8,
+        0xe52cc12c, 0x1747422f, 0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff,
+        0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0, 0xd3d3e1ab, 0x21b862a8,
+        0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+        0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78,
+        0x7fab5e8c, 0x8dc0dd8f, 0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee,
+        0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1, 0x69e9f0d5, 0x9b8273d6,
+        0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+        0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69,
+        0xd5cf889d, 0x27a40b9e, 0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e,
+        0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351,
+    };
+
+#if defined(MONGO_CRC32C_SSE42_GCC)
+    bool haveSSE42() {
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return false;
+        return ecx & bit_SSE4_2;
+    }
+
+    // Inline assembly rather than the intrinsics, which need -msse4.2 for the whole file with
+    // older compilers. The caller checks for the instruction at runtime.
+    inline uint64_t crc32cWord(uint64_t crc, uint64_t word) {
+        __asm__("crc32q %1, %0" : "+r" (crc) : "rm" (word));
+        return crc;
+    }
+
+    inline uint32_t crc32cByte(uint32_t crc, unsigned char byte) {
+        __asm__("crc32b %1, %0" : "+r" (crc) : "rm" (byte));
+        return crc;
+    }
+#elif defined(MONGO_CRC32C_SSE42_MSVC)
+    bool haveSSE42() {
+        int info[4];
+        __cpuid(info, 1);
+        return info[2] & (1 << 20);
+    }
+
+    inline uint64_t crc32cWord(uint64_t crc, uint64_t word) {
+        return _mm_crc32_u64(crc, word);
+    }
+
+    inline uint32_t crc32cByte(uint32_t crc, unsigned char byte) {
+        return _mm_crc32_u8(crc, byte);
+    }
+#endif
+
+#if defined(MONGO_CRC32C_SSE42_GCC) || defined(MONGO_CRC32C_SSE42_MSVC)
+    /**
+     * The crc32 instruction has a latency of three cycles but can start one every cycle, so the
+     * hardware path checksums three adjacent blocks at once and then combines their CRCs. To
+     * combine, the CRC of the earlier block is shifted over the length of the later one, which
+     * is the same as running it over that many zero bytes. These tables do that shift for a
+     * fixed block length, one table per byte of the CRC.
+     */
+    const size_t kLongBlock = 8192;
+    const size_t kShortBlock = 256;
+    uint32_t crc32cLongShift[4][256];
+    uint32_t crc32cShortShift[4][256];
+
+    // Multiplies a vector by a 32x32 matrix over GF(2).
+    uint32_t gf2MatrixTimes(const uint32_t* mat, uint32_t vec) {
+        uint32_t sum = 0;
+        while (vec) {
+            if (vec & 1)
+                sum ^= *mat;
+            vec >>= 1;
+            mat++;
+        }
+        return sum;
+    }
+
+    void gf2MatrixSquare(uint32_t* square, const uint32_t* mat) {
+        for (int n = 0; n < 32; n++)
+            square[n] = gf2MatrixTimes(mat, mat[n]);
+    }
+
+    // Builds the operator which runs a CRC over 'len' zero bytes. 'len' must be a power of two.
+    void crc32cZerosOperator(uint32_t* even, size_t len) {
+        uint32_t odd[32];
+
+        // operator for one zero bit
+        odd[0] = 0x82f63b78;
+        uint32_t row = 1;
+        for (int n = 1; n < 32; n++) {
+            odd[n] = row;
+            row <<= 1;
+        }
+
+        gf2MatrixSquare(even, odd);  // two zero bits
+        gf2MatrixSquare(odd, even);  // four zero bits
+
+        // Each square doubles the number of zero bits, starting from one zero byte in 'even'.
+        do {
+            gf2MatrixSquare(even, odd);
+            len >>= 1;
+            if (len == 0)
+                return;
+            gf2MatrixSquare(odd, even);
+            len >>= 1;
+        } while (len);
+
+        for (int n = 0; n < 32; n++)
+            even[n] = odd[n];
+    }
+
+    void crc32cInitShift(uint32_t shift[4][256], size_t len) {
+        uint32_t op[32];
+        crc32cZerosOperator(op, len);
+        for (uint32_t n = 0; n < 256; n++) {
+            shift[0][n] = gf2MatrixTimes(op, n);
+            shift[1][n] = gf2MatrixTimes(op, n << 8);
+            shift[2][n] = gf2MatrixTimes(op, n << 16);
+            shift[3][n] = gf2MatrixTimes(op, n << 24);
+        }
+    }
+
+    inline uint32_t crc32cShift(uint32_t shift[4][256], uint32_t crc) {
+        return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff]
+             ^ shift[2][(crc >> 16) & 0xff] ^ shift[3][crc >> 24];
+    }
+
+    // Checksums 'len' bytes at 'p', 8 byte aligned, as three interleaved blocks of 'block' bytes
+    // at a time. Advances 'p' and 'len' past the data it consumed.
+    inline uint64_t crc32cInterleaved(uint64_t crc0,
+                                      const unsigned char*& p,
+                                      size_t& len,
+                                      size_t block,
+                                      uint32_t shift[4][256]) {
+        while (len >= block * 3) {
+            uint64_t crc1 = 0;
+            uint64_t crc2 = 0;
+            const unsigned char* const end = p + block;
+            do {
+                uint64_t word0, word1, word2;
+                memcpy(&word0, p, sizeof(word0));
+                memcpy(&word1, p + block, sizeof(word1));
+                memcpy(&word2, p + block * 2, sizeof(word2));
+                crc0 = crc32cWord(crc0, word0);
+                crc1 = crc32cWord(crc1, word1);
+                crc2 = crc32cWord(crc2, word2);
+                p += 8;
+            } while (p < end);
+
+            crc0 = crc32cShift(shift, static_cast<uint32_t>(crc0)) ^ crc1;
+            crc0 = crc32cShift(shift, static_cast<uint32_t>(crc0)) ^ crc2;
+            p += block * 2;
+            len -= block * 3;
+        }
+        return crc0;
+    }
+
+    uint32_t crc32cHardware(uint32_t crc, const void* buf, size_t len) {
+        const unsigned char* p = static_cast<const unsigned char*>(buf);
+        uint32_t c = ~crc;
+
+        // Byte at a time up to an 8 byte boundary, then a word at a time.
+        while (len && (reinterpret_cast<uintptr_t>(p) & 7)) {
+            c = crc32cByte(c, *p++);
+            len--;
+        }
+
+        uint64_t c64 = c;
+        c64 = crc32cInterleaved(c64, p, len, kLongBlock, crc32cLongShift);
+        c64 = crc32cInterleaved(c64, p, len, kShortBlock, crc32cShortShift);
+        while (len >= 8) {
+            uint64_t word;
+            memcpy(&word, p, sizeof(word));
+            c64 = crc32cWord(c64, word);
+            p += 8;
+            len -= 8;
+        }
+        c = static_cast<uint32_t>(c64);
+
+        while (len) {
+            c = crc32cByte(c, *p++);
+            len--;
+        }
+
+        return ~c;
+    }
+#endif
+
+    typedef uint32_t (*Crc32cFunction)(uint32_t crc, const void* buf, size_t len);
+
+    Crc32cFunction chooseCrc32c() {
+#if defined(MONGO_CRC32C_SSE42_GCC) || defined(MONGO_CRC32C_SSE42_MSVC)
+        if (haveSSE42()) {
+            crc32cInitShift(crc32cLongShift, kLongBlock);
+            crc32cInitShift(crc32cShortShift, kShortBlock);
+            return &crc32cHardware;
+        }
+#endif
+        return &crc32cSoftware;
+    }
+
+    const Crc32cFunction crc32cImpl = chooseCrc32c();
+
+} // namespace
+
+    uint32_t crc32cSoftware(uint32_t crc, const void* buf, size_t len) {
+        const unsigned char* p = static_cast<const unsigned char*>(buf);
+        uint32_t c = ~crc;
+        while (len--) {
+            c = crc32cTable[(c ^ *p++) & 0xff] ^ (c >> 8);
+        }
+        return ~c;
+    }
+
+    uint32_t crc32c(uint32_t crc, const void* buf, size_t len) {
+        return crc32cImpl(crc, buf, len);
+    }
+
+    bool crc32cIsHardwareAccelerated() {
+        return crc32cImpl != &crc32cSoftware;
+    }
+
+} // namespace mongo
@@ -0,0 +1,53 @@
+// crc32c.h
+
+/*    Copyright 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    /**
+     * Computes the CRC32C (Castagnoli polynomial) of 'len' bytes at 'buf'. Pass 0 as 'crc' to
+     * start a checksum, or a previous result to continue it over more data.
+     *
+     * Uses the SSE4.2 crc32 instruction when the processor supports it, and a table otherwise.
+     * Both produce the same result.
+     */
+    uint32_t crc32c(uint32_t crc, const void* buf, size_t len);
+
+    /** The table driven implementation of crc32c(), for tests and benchmarks. */
+    uint32_t crc32cSoftware(uint32_t crc, const void* buf, size_t len);
+
+    /** True if crc32c() uses the SSE4.2 instruction on this machine. */
+    bool crc32cIsHardwareAccelerated();
+
+}
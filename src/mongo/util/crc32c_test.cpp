@@ -0,0 +1,103 @@
+// crc32c_test.cpp
+
+/*    Copyright 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/crc32c.h"
+
+namespace mongo {
+namespace {
+
+    // Check values from RFC 3720 (iSCSI), appendix B.4.
+    TEST(Crc32c, KnownValues) {
+        ASSERT_EQUALS(0xe3069283U, crc32c(0, "123456789", 9));
+
+        std::vector<unsigned char> buf(32, 0);
+        ASSERT_EQUALS(0x8a9136aaU, crc32c(0, &buf[0], buf.size()));
+
+        std::fill(buf.begin(), buf.end(), 0xff);
+        ASSERT_EQUALS(0x62a8ab43U, crc32c(0, &buf[0], buf.size()));
+
+        for (size_t i = 0; i < buf.size(); i++)
+            buf[i] = i;
+        ASSERT_EQUALS(0x46dd794eU, crc32c(0, &buf[0], buf.size()));
+    }
+
+    TEST(Crc32c, EmptyBuffer) {
+        ASSERT_EQUALS(0U, crc32c(0, "", 0));
+        ASSERT_EQUALS(0x12345678U, crc32c(0x12345678, "", 0));
+    }
+
+    // The hardware path handles unaligned heads and short tails separately, so compare it with
+    // the table at every offset and length around a few words.
+    TEST(Crc32c, MatchesSoftwareAtAllAlignments) {
+        std::vector<unsigned char> buf(64);
+        for (size_t i = 0; i < buf.size(); i++)
+            buf[i] = static_cast<unsigned char>(i * 37 + 11);
+
+        for (size_t offset = 0; offset < 16; offset++) {
+            for (size_t len = 0; offset + len <= buf.size(); len++) {
+                ASSERT_EQUALS(crc32cSoftware(0, &buf[offset], len),
+                              crc32c(0, &buf[offset], len));
+            }
+        }
+    }
+
+    // Long buffers go through the interleaved blocks of the hardware path.
+    TEST(Crc32c, MatchesSoftwareOnLongBuffers) {
+        std::vector<unsigned char> buf(3 * 8192 * 2 + 3 * 256 + 123);
+        for (size_t i = 0; i < buf.size(); i++)
+            buf[i] = static_cast<unsigned char>(i * 131 + (i >> 8));
+
+        for (size_t offset = 0; offset < 9; offset++) {
+            const size_t lens[] = { 3 * 256, 3 * 256 + 5, 3 * 8192, 3 * 8192 + 777,
+                                    buf.size() - offset };
+            for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+                ASSERT_EQUALS(crc32cSoftware(0, &buf[offset], lens[i]),
+                              crc32c(0, &buf[offset], lens[i]));
+            }
+        }
+    }
+
+    TEST(Crc32c, Incremental) {
+        const std::string data = "The quick brown fox jumps over the lazy dog";
+        const uint32_t whole = crc32c(0, data.c_str(), data.size());
+        for (size_t split = 0; split <= data.size(); split++) {
+            uint32_t crc = crc32c(0, data.c_str(), split);
+            crc = crc32c(crc, data.c_str() + split, data.size() - split);
+            ASSERT_EQUALS(whole, crc);
+        }
+    }
+
+} // namespace
+} // namespace mongo
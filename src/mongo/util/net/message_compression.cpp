@@ -0,0 +1,344 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_compression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <snappy.h>
+#include <zlib.h>
+
+#include "mongo/base/data_view.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/scopeguard.h"
+#include "mongo/util/stringutils.h"
+
+namespace mongo {
+
+    using std::string;
+    using std::vector;
+
+namespace {
+
+    // opCode, uncompressed size and compressor id.
+    const int kCompressedHeaderSize = 4 + 4 + 1;
+
+    const int kNumCompressors = 3;
+
+    vector<MessageCompressor> makeDefaultCompressors() {
+        vector<MessageCompressor> compressors;
+        compressors.push_back(kSnappyCompressor);
+        compressors.push_back(kZlibCompressor);
+        return compressors;
+    }
+
+    vector<MessageCompressor> enabledCompressors = makeDefaultCompressors();
+
+    bool isEnabled(MessageCompressor compressor) {
+        return std::find(enabledCompressors.begin(), enabledCompressors.end(), compressor)
+            != enabledCompressors.end();
+    }
+
+    bool parseName(StringData name, MessageCompressor* compressor) {
+        if (name == "snappy") {
+            *compressor = kSnappyCompressor;
+            return true;
+        }
+        if (name == "zlib") {
+            *compressor = kZlibCompressor;
+            return true;
+        }
+        return false;
+    }
+
+    struct ByteCounter {
+        void hit(long long in, long long out) {
+            bytesIn.fetchAndAdd(in);
+            bytesOut.fetchAndAdd(out);
+        }
+
+        void append(BSONObjBuilder* b, StringData name) const {
+            BSONObjBuilder sub(b->subobjStart(name));
+            sub.appendNumber("bytesIn", static_cast<long long>(bytesIn.loadRelaxed()));
+            sub.appendNumber("bytesOut", static_cast<long long>(bytesOut.loadRelaxed()));
+        }
+
+        AtomicUInt64 bytesIn;
+        AtomicUInt64 bytesOut;
+    };
+
+    ByteCounter compressorCounters[kNumCompressors];
+    ByteCounter decompressorCounters[kNumCompressors];
+
+    // The vendored zlib doesn't include compress2() and uncompress(), so use the stream API.
+
+    size_t zlibMaxCompressedLength(size_t inputSize) {
+        return deflateBound(NULL, inputSize);
+    }
+
+    size_t zlibCompress(const char* input, size_t inputSize, char* output, size_t outputSize) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        int ret = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+        massert(28631, str::stream() << "zlib failed to initialize: " << ret, ret == Z_OK);
+        ON_BLOCK_EXIT(deflateEnd, &stream);
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+        stream.avail_in = inputSize;
+        stream.next_out = reinterpret_cast<Bytef*>(output);
+        stream.avail_out = outputSize;
+        ret = deflate(&stream, Z_FINISH);
+        massert(28632, str::stream() << "zlib failed to compress message: " << ret,
+                ret == Z_STREAM_END);
+        return stream.total_out;
+    }
+
+    bool zlibUncompress(const char* input, size_t inputSize, char* output, size_t outputSize) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit(&stream) != Z_OK)
+            return false;
+        ON_BLOCK_EXIT(inflateEnd, &stream);
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+        stream.avail_in = inputSize;
+        stream.next_out = reinterpret_cast<Bytef*>(output);
+        stream.avail_out = outputSize;
+        return inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == outputSize;
+    }
+
+    Status badMessage(const string& reason) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "invalid compressed message: " << reason);
+    }
+
+} // namespace
+
+    const char* messageCompressorName(MessageCompressor compressor) {
+        switch (compressor) {
+        case kNoCompressor: return "noop";
+        case kSnappyCompressor: return "snappy";
+        case kZlibCompressor: return "zlib";
+        }
+        return "unknown";
+    }
+
+    Status parseMessageCompressors(const string& names, vector<MessageCompressor>* compressors) {
+        compressors->clear();
+        if (names == "disabled")
+            return Status::OK();
+
+        vector<string> parts;
+        splitStringDelim(names, &parts, ',');
+        for (vector<string>::const_iterator it = parts.begin(); it != parts.end(); ++it) {
+            MessageCompressor compressor;
+            if (!parseName(*it, &compressor)) {
+                return Status(ErrorCodes::BadValue,
+                              str::stream() << "unknown network message compressor '" << *it
+                                            << "', expected snappy, zlib or disabled");
+            }
+            if (std::find(compressors->begin(), compressors->end(), compressor)
+                    == compressors->end()) {
+                compressors->push_back(compressor);
+            }
+        }
+        return Status::OK();
+    }
+
+    void setMessageCompressors(const vector<MessageCompressor>& compressors) {
+        enabledCompressors = compressors;
+    }
+
+    const vector<MessageCompressor>& getMessageCompressors() {
+        return enabledCompressors;
+    }
+
+    void appendMessageCompressorsToIsMaster(BSONObjBuilder* cmd) {
+        if (enabledCompressors.empty())
+            return;
+
+        BSONArrayBuilder offered(cmd->subarrayStart("compression"));
+        for (size_t i = 0; i < enabledCompressors.size(); i++) {
+            offered.append(messageCompressorName(enabledCompressors[i]));
+        }
+    }
+
+    void appendNegotiatedMessageCompressors(const BSONObj& cmdObj,
+                                            BSONObjBuilder* result,
+                                            vector<MessageCompressor>* accepted) {
+        BSONElement offered = cmdObj["compression"];
+        if (offered.type() != Array)
+            return;
+
+        BSONArrayBuilder acceptedNames(result->subarrayStart("compression"));
+        BSONObjIterator it(offered.Obj());
+        while (it.more()) {
+            BSONElement e = it.next();
+            MessageCompressor compressor;
+            if (e.type() == String && parseName(e.valueStringData(), &compressor)
+                    && isEnabled(compressor)) {
+                acceptedNames.append(messageCompressorName(compressor));
+                accepted->push_back(compressor);
+            }
+        }
+    }
+
+    bool isMessageCompressorEnabled(MessageCompressor compressor) {
+        return isEnabled(compressor);
+    }
+
+    MessageCompressor chooseMessageCompressor(const BSONObj& isMasterReply) {
+        BSONElement accepted = isMasterReply["compression"];
+        if (accepted.type() != Array)
+            return kNoCompressor;
+
+        BSONObjIterator it(accepted.Obj());
+        while (it.more()) {
+            BSONElement e = it.next();
+            MessageCompressor compressor;
+            if (e.type() == String && parseName(e.valueStringData(), &compressor)
+                    && isEnabled(compressor)) {
+                return compressor;
+            }
+        }
+        return kNoCompressor;
+    }
+
+    void compressMessage(MessageCompressor compressor, Message& source, Message* compressed) {
+        verify(compressor == kSnappyCompressor || compressor == kZlibCompressor);
+
+        source.concat();
+        MsgData::ConstView in = source.singleData();
+        const char* input = in.data();
+        const size_t inputSize = in.dataLen();
+
+        const size_t bound = compressor == kSnappyCompressor
+            ? snappy::MaxCompressedLength(inputSize)
+            : zlibMaxCompressedLength(inputSize);
+        MsgData::View out = reinterpret_cast<char*>(
+            mongoMalloc(MsgData::MsgDataHeaderSize + kCompressedHeaderSize + bound));
+        ScopeGuard guard = MakeGuard(free, out.view2ptr());
+
+        char* dest = out.data() + kCompressedHeaderSize;
+        size_t compressedSize = bound;
+        if (compressor == kSnappyCompressor) {
+            snappy::RawCompress(input, inputSize, dest, &compressedSize);
+        }
+        else {
+            compressedSize = zlibCompress(input, inputSize, dest, bound);
+        }
+
+        DataView body(out.data());
+        body.writeLE<int32_t>(in.getOperation(), 0);
+        body.writeLE<int32_t>(inputSize, 4);
+        body.writeNative<uint8_t>(compressor, 8);
+
+        out.setLen(MsgData::MsgDataHeaderSize + kCompressedHeaderSize + compressedSize);
+        out.setId(in.getId());
+        out.setResponseTo(in.getResponseTo());
+        out.setOperation(dbCompressed);
+
+        compressorCounters[compressor].hit(in.getLen(), out.getLen());
+
+        guard.Dismiss();
+        compressed->reset();
+        compressed->setData(out.view2ptr(), true);
+    }
+
+    Status decompressMessage(const Message& compressed,
+                             Message* source,
+                             MessageCompressor* compressor) {
+        MsgData::ConstView in = compressed.singleData();
+        if (in.dataLen() < kCompressedHeaderSize)
+            return badMessage("too short");
+
+        ConstDataView body(in.data());
+        const int32_t opCode = body.readLE<int32_t>(0);
+        const int32_t size = body.readLE<int32_t>(4);
+        const uint8_t compressorId = body.readNative<uint8_t>(8);
+        const char* input = in.data() + kCompressedHeaderSize;
+        const size_t inputSize = in.dataLen() - kCompressedHeaderSize;
+
+        if (opCode == dbCompressed)
+            return badMessage("wraps another compressed message");
+        if (size < 0
+                || static_cast<size_t>(size) + MsgData::MsgDataHeaderSize > MaxMessageSizeBytes)
+            return badMessage(str::stream() << "uncompressed size " << size << " is invalid");
+
+        MsgData::View out = reinterpret_cast<char*>(
+            mongoMalloc(MsgData::MsgDataHeaderSize + size));
+        ScopeGuard guard = MakeGuard(free, out.view2ptr());
+
+        if (compressorId == kSnappyCompressor) {
+            size_t uncompressedSize;
+            if (!snappy::GetUncompressedLength(input, inputSize, &uncompressedSize)
+                    || uncompressedSize != static_cast<size_t>(size)
+                    || !snappy::RawUncompress(input, inputSize, out.data())) {
+                return badMessage("snappy failed to decompress it");
+            }
+        }
+        else if (compressorId == kZlibCompressor) {
+            if (!zlibUncompress(input, inputSize, out.data(), size))
+                return badMessage("zlib failed to decompress it");
+        }
+        else {
+            return badMessage(str::stream() << "unknown compressor "
+                                            << static_cast<int>(compressorId));
+        }
+
+        out.setLen(MsgData::MsgDataHeaderSize + size);
+        out.setId(in.getId());
+        out.setResponseTo(in.getResponseTo());
+        out.setOperation(opCode);
+
+        decompressorCounters[compressorId].hit(in.getLen(), out.getLen());
+
+        guard.Dismiss();
+        source->reset();
+        source->setData(out.view2ptr(), true);
+        *compressor = static_cast<MessageCompressor>(compressorId);
+        return Status::OK();
+    }
+
+    void appendMessageCompressionStats(BSONObjBuilder* b) {
+        for (int i = kSnappyCompressor; i < kNumCompressors; i++) {
+            BSONObjBuilder sub(b->subobjStart(
+                messageCompressorName(static_cast<MessageCompressor>(i))));
+            compressorCounters[i].append(&sub, "compressor");
+            decompressorCounters[i].append(&sub, "decompressor");
+        }
+    }
+
+} // namespace mongo
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/status.h"
+
+namespace mongo {
+
+    class BSONObj;
+    class BSONObjBuilder;
+    class Message;
+
+    /**
+     * Compression of whole wire protocol messages.
+     *
+     * A compressed message is a dbCompressed message with the requestID and responseTo of the
+     * message it wraps, whose body is
+     *
+     *     int32 opCode of the wrapped message
+     *     int32 size of the wrapped message's body, without its header
+     *     uint8 MessageCompressor used
+     *     the compressed body of the wrapped message
+     *
+     * Compression is negotiated per connection. The client lists the compressors it is willing to
+     * use in the "compression" field of isMaster, and the server answers with those it also
+     * supports, in the client's order. The client then compresses its requests with the first of
+     * them, and the server replies to a compressed request with the compressor it was sent with.
+     */
+    enum MessageCompressor {
+        kNoCompressor = 0,
+        kSnappyCompressor = 1,
+        kZlibCompressor = 2,
+    };
+
+    const char* messageCompressorName(MessageCompressor compressor);
+
+    /**
+     * Parses a comma separated list of compressor names, most preferred first, or "disabled".
+     */
+    Status parseMessageCompressors(const std::string& names,
+                                   std::vector<MessageCompressor>* compressors);
+
+    /**
+     * Sets the compressors this process offers to the servers it connects to and accepts from its
+     * clients, most preferred first. Defaults to snappy, then zlib. Only call during startup.
+     */
+    void setMessageCompressors(const std::vector<MessageCompressor>& compressors);
+    const std::vector<MessageCompressor>& getMessageCompressors();
+
+    /**
+     * Adds the "compression" field offering this process's compressors to an isMaster command.
+     * Does nothing if compression is disabled.
+     */
+    void appendMessageCompressorsToIsMaster(BSONObjBuilder* cmd);
+
+    /**
+     * Answers the "compression" field of the isMaster command 'cmdObj', if it has one, with the
+     * offered compressors this process supports, and appends those to 'accepted'.
+     */
+    void appendNegotiatedMessageCompressors(const BSONObj& cmdObj,
+                                            BSONObjBuilder* result,
+                                            std::vector<MessageCompressor>* accepted);
+
+    /**
+     * Returns true if this process has 'compressor' enabled.
+     */
+    bool isMessageCompressorEnabled(MessageCompressor compressor);
+
+    /**
+     * Returns the compressor a client should use given the server's reply to isMaster.
+     */
+    MessageCompressor chooseMessageCompressor(const BSONObj& isMasterReply);
+
+    /**
+     * Sets 'compressed' to a dbCompressed message wrapping 'source'. Concatenates the buffers of
+     * 'source' if it has more than one.
+     */
+    void compressMessage(MessageCompressor compressor, Message& source, Message* compressed);
+
+    /**
+     * Sets 'source' to the message wrapped by the dbCompressed message 'compressed', and
+     * 'compressor' to the compressor it was compressed with.
+     */
+    Status decompressMessage(const Message& compressed,
+                             Message* source,
+                             MessageCompressor* compressor);
+
+    /**
+     * Appends the bytes which went into and came out of each compressor and decompressor.
+     */
+    void appendMessageCompressionStats(BSONObjBuilder* b);
+
+} // namespace mongo
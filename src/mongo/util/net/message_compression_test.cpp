@@ -0,0 +1,216 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compression.h"
+
+namespace mongo {
+namespace {
+
+    using std::string;
+    using std::vector;
+
+    void makeMessage(const string& body, Message* m) {
+        m->setData(dbQuery, body.c_str(), body.size());
+        m->header().setId(1234);
+        m->header().setResponseTo(5678);
+    }
+
+    void checkRoundTrip(MessageCompressor compressor, const string& body) {
+        Message source;
+        makeMessage(body, &source);
+
+        Message compressed;
+        compressMessage(compressor, source, &compressed);
+        ASSERT_EQUALS(dbCompressed, compressed.operation());
+        ASSERT_EQUALS(1234, static_cast<int>(compressed.header().getId()));
+        ASSERT_EQUALS(5678, static_cast<int>(compressed.header().getResponseTo()));
+
+        Message result;
+        MessageCompressor used;
+        ASSERT_OK(decompressMessage(compressed, &result, &used));
+        ASSERT_EQUALS(compressor, used);
+        ASSERT_EQUALS(dbQuery, result.operation());
+        ASSERT_EQUALS(1234, static_cast<int>(result.header().getId()));
+        ASSERT_EQUALS(5678, static_cast<int>(result.header().getResponseTo()));
+        ASSERT_EQUALS(source.size(), result.size());
+        ASSERT_EQUALS(body, string(result.singleData().data(), result.singleData().dataLen()));
+    }
+
+    string repetitiveBody() {
+        string body;
+        for (int i = 0; i < 1000; i++) {
+            body += "{ _id: 1, name: 'compressible' } ";
+        }
+        return body;
+    }
+
+    TEST(MessageCompression, SnappyRoundTrip) {
+        checkRoundTrip(kSnappyCompressor, repetitiveBody());
+        checkRoundTrip(kSnappyCompressor, "");
+    }
+
+    TEST(MessageCompression, ZlibRoundTrip) {
+        checkRoundTrip(kZlibCompressor, repetitiveBody());
+        checkRoundTrip(kZlibCompressor, "");
+    }
+
+    TEST(MessageCompression, CompressesRepetitiveMessages) {
+        Message source;
+        makeMessage(repetitiveBody(), &source);
+        const int sourceSize = source.size();
+
+        Message compressed;
+        compressMessage(kSnappyCompressor, source, &compressed);
+        ASSERT_LESS_THAN(compressed.size(), sourceSize / 4);
+    }
+
+    TEST(MessageCompression, RejectsCorruptMessages) {
+        Message source;
+        makeMessage(repetitiveBody(), &source);
+
+        Message compressed;
+        compressMessage(kZlibCompressor, source, &compressed);
+        char* body = compressed.singleData().data();
+
+        // Unknown compressor.
+        body[8] = 100;
+        Message result;
+        MessageCompressor used;
+        ASSERT_NOT_OK(decompressMessage(compressed, &result, &used));
+        ASSERT_TRUE(result.empty());
+
+        // An uncompressed size which with its header is over the message size limit.
+        body[8] = kZlibCompressor;
+        DataView(body).writeLE<int32_t>(MaxMessageSizeBytes - MsgData::MsgDataHeaderSize + 1, 4);
+        ASSERT_NOT_OK(decompressMessage(compressed, &result, &used));
+
+        // Wrong uncompressed size.
+        body[8] = kZlibCompressor;
+        DataView(body).writeLE<int32_t>(10, 4);
+        ASSERT_NOT_OK(decompressMessage(compressed, &result, &used));
+
+        // A compressed message may not wrap another one.
+        DataView(body).writeLE<int32_t>(dbCompressed, 0);
+        ASSERT_NOT_OK(decompressMessage(compressed, &result, &used));
+
+        // Garbage instead of compressed data.
+        Message garbage;
+        makeMessage(string(100, 'x'), &garbage);
+        garbage.header().setOperation(dbCompressed);
+        ASSERT_NOT_OK(decompressMessage(garbage, &result, &used));
+    }
+
+    TEST(MessageCompression, ParseCompressors) {
+        vector<MessageCompressor> compressors;
+        ASSERT_OK(parseMessageCompressors("zlib,snappy,zlib", &compressors));
+        ASSERT_EQUALS(2U, compressors.size());
+        ASSERT_EQUALS(kZlibCompressor, compressors[0]);
+        ASSERT_EQUALS(kSnappyCompressor, compressors[1]);
+
+        ASSERT_OK(parseMessageCompressors("disabled", &compressors));
+        ASSERT_TRUE(compressors.empty());
+
+        ASSERT_NOT_OK(parseMessageCompressors("snappy,lz4", &compressors));
+    }
+
+    TEST(MessageCompression, Negotiation) {
+        const vector<MessageCompressor> original = getMessageCompressors();
+
+        vector<MessageCompressor> compressors;
+        compressors.push_back(kZlibCompressor);
+        setMessageCompressors(compressors);
+
+        BSONObjBuilder cmd;
+        cmd.append("isMaster", 1);
+        appendMessageCompressorsToIsMaster(&cmd);
+        ASSERT_EQUALS(BSON("isMaster" << 1 << "compression" << BSON_ARRAY("zlib")), cmd.obj());
+
+        // The server only accepts what it has enabled, in the client's order.
+        BSONObjBuilder reply;
+        vector<MessageCompressor> accepted;
+        appendNegotiatedMessageCompressors(
+            BSON("isMaster" << 1 << "compression" << BSON_ARRAY("snappy" << "lz4" << "zlib")),
+            &reply,
+            &accepted);
+        BSONObj replyObj = reply.obj();
+        ASSERT_EQUALS(BSON("compression" << BSON_ARRAY("zlib")), replyObj);
+        ASSERT_EQUALS(kZlibCompressor, chooseMessageCompressor(replyObj));
+        ASSERT_EQUALS(1U, accepted.size());
+        ASSERT_EQUALS(kZlibCompressor, accepted[0]);
+        ASSERT_TRUE(isMessageCompressorEnabled(kZlibCompressor));
+        ASSERT_FALSE(isMessageCompressorEnabled(kSnappyCompressor));
+
+        // Clients which don't ask aren't answered.
+        BSONObjBuilder oldClientReply;
+        accepted.clear();
+        appendNegotiatedMessageCompressors(BSON("isMaster" << 1), &oldClientReply, &accepted);
+        ASSERT_TRUE(oldClientReply.obj().isEmpty());
+        ASSERT_TRUE(accepted.empty());
+
+        // Nothing in common.
+        ASSERT_EQUALS(kNoCompressor,
+                      chooseMessageCompressor(BSON("compression" << BSON_ARRAY("snappy"))));
+        ASSERT_EQUALS(kNoCompressor, chooseMessageCompressor(BSON("ismaster" << true)));
+
+        setMessageCompressors(vector<MessageCompressor>());
+        BSONObjBuilder disabled;
+        appendMessageCompressorsToIsMaster(&disabled);
+        ASSERT_TRUE(disabled.obj().isEmpty());
+
+        setMessageCompressors(original);
+    }
+
+    TEST(MessageCompression, Stats) {
+        BSONObjBuilder before;
+        appendMessageCompressionStats(&before);
+        const long long compressedBefore =
+            before.obj()["snappy"]["compressor"]["bytesIn"].numberLong();
+
+        checkRoundTrip(kSnappyCompressor, repetitiveBody());
+
+        BSONObjBuilder after;
+        appendMessageCompressionStats(&after);
+        BSONObj stats = after.obj();
+        ASSERT_GREATER_THAN(stats["snappy"]["compressor"]["bytesIn"].numberLong(),
+                            compressedBefore);
+        ASSERT_GREATER_THAN(stats["snappy"]["compressor"]["bytesIn"].numberLong(),
+                            stats["snappy"]["compressor"]["bytesOut"].numberLong());
+        ASSERT_TRUE(stats["zlib"]["decompressor"].isABSONObj());
+    }
+
+} // namespace
+} // namespace mongo
@@ -33,6 +33,7 @@
 
 #include "mongo/util/net/message_port.h"
 
+#include <algorithm>
 #include <boost/shared_ptr.hpp>
 #include <fcntl.h>
 #include <time.h>
@@ -144,18 +145,18 @@ namespace mongo {
     }
 
     MessagingPort::MessagingPort(int fd, const SockAddr& remote) 
-        : psock( new Socket( fd , remote ) ) , piggyBackData(0) {
+        : psock( new Socket( fd , remote ) ) , piggyBackData(0), _compressor(kNoCompressor) {
         ports.insert(this);
     }
 
     MessagingPort::MessagingPort( double timeout, logger::LogSeverity ll ) 
-        : psock( new Socket( timeout, ll ) ) {
+        : psock( new Socket( timeout, ll ) ), _compressor(kNoCompressor) {
         ports.insert(this);
         piggyBackData = 0;
     }
 
     MessagingPort::MessagingPort( boost::shared_ptr<Socket> sock )
-        : psock( sock ), piggyBackData( 0 ) {
+        : psock( sock ), piggyBackData( 0 ), _compressor(kNoCompressor) {
         ports.insert(this);
     }
 
@@ -244,7 +245,7 @@ again:
 
             guard.Dismiss();
             m.setData(md.view2ptr(), true);
-            return true;
+            return decompress(m);
 
         }
         catch ( const SocketException & e ) {
@@ -257,6 +258,50 @@ again:
         }
     }
 
+    bool MessagingPort::decompress(Message& m) {
+        if (m.operation() != dbCompressed)
+            return true;
+
+        Message source;
+        MessageCompressor compressor;
+        Status status = decompressMessage(m, &source, &compressor);
+        m.reset();
+        if (!status.isOK()) {
+            LOG(0) << "recv(): " << status.reason() << ", remote: " << psock->remoteString();
+            return false;
+        }
+
+        if (!isMessageCompressorEnabled(compressor)
+                || std::find(_acceptedCompressors.begin(), _acceptedCompressors.end(), compressor)
+                    == _acceptedCompressors.end()) {
+            LOG(0) << "recv(): message compressed with " << messageCompressorName(compressor)
+                   << ", which was not negotiated, remote: " << psock->remoteString();
+            return false;
+        }
+
+        m = source;
+        _compressor = compressor;
+        return true;
+    }
+
+    void MessagingPort::setCompressor(MessageCompressor compressor) {
+        _compressor = compressor;
+        _acceptedCompressors.clear();
+        if (compressor != kNoCompressor)
+            _acceptedCompressors.push_back(compressor);
+    }
+
+    void MessagingPort::acceptCompressors(const std::vector<MessageCompressor>& compressors) {
+        // Keep what earlier isMaster commands accepted, since the other end may already be using
+        // it; a client's monitoring isMaster needn't repeat the offer.
+        for (size_t i = 0; i < compressors.size(); i++) {
+            if (std::find(_acceptedCompressors.begin(), _acceptedCompressors.end(), compressors[i])
+                    == _acceptedCompressors.end()) {
+                _acceptedCompressors.push_back(compressors[i]);
+            }
+        }
+    }
+
     void MessagingPort::reply(Message& received, Message& response) {
         say(/*received.from, */response, received.header().getId());
     }
@@ -303,6 +348,17 @@ again:
         toSend.header().setId(nextMessageId());
         toSend.header().setResponseTo(responseTo);
 
+        if (_compressor != kNoCompressor) {
+            Message compressed;
+            compressMessage(_compressor, toSend, &compressed);
+            _say(compressed);
+        }
+        else {
+            _say(toSend);
+        }
+    }
+
+    void MessagingPort::_say(Message& toSend) {
         if ( piggyBackData && piggyBackData->len() ) {
             mmm( log() << "*     have piggy back" << endl; )
             if ( ( piggyBackData->len() + toSend.header().getLen() ) > 1300 ) {
@@ -331,10 +387,22 @@ again:
         toSend.header().setId(nextMessageId());
         toSend.header().setResponseTo(responseTo);
 
+        Message compressed;
+        Message* out = &toSend;
+        if (_compressor != kNoCompressor) {
+            compressMessage(_compressor, toSend, &compressed);
+            if (compressed.header().getLen() > 1300) {
+                // incompressible, so it no longer fits
+                _say(compressed);
+                return;
+            }
+            out = &compressed;
+        }
+
         if ( ! piggyBackData )
             piggyBackData = new PiggyBackData( this );
 
-        piggyBackData->append( toSend );
+        piggyBackData->append( *out );
     }
 
     HostAndPort MessagingPort::remote() const {
@@ -35,6 +35,7 @@
 
 #include "mongo/config.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/sock.h"
 
 namespace mongo {
@@ -65,6 +66,12 @@ namespace mongo {
         long long connectionId() const { return _connectionId; }
         void setConnectionId( long long connectionId );
 
+        /**
+         * Lets the other end send messages compressed with any of 'compressors', which this
+         * process accepted for it through isMaster.
+         */
+        virtual void acceptCompressors(const std::vector<MessageCompressor>& compressors) = 0;
+
     public:
         // TODO make this private with some helpers
 
@@ -117,6 +124,27 @@ namespace mongo {
 
         void piggyBack( Message& toSend , int responseTo = 0 );
 
+        /**
+         * Compresses every message sent from now on with 'compressor', which the other end must
+         * have accepted through isMaster. The other end may answer with the same compressor.
+         */
+        void setCompressor(MessageCompressor compressor);
+
+        virtual void acceptCompressors(const std::vector<MessageCompressor>& compressors);
+
+        MessageCompressor getCompressor() const {
+            return _compressor;
+        }
+
+        /**
+         * If 'm' is a dbCompressed message, replaces it with the message it wraps and compresses
+         * the messages sent from now on the same way, so a server answers in kind. Returns false,
+         * after which the caller must close the connection, if 'm' can't be decompressed or uses
+         * a compressor which wasn't negotiated on this connection. recv() does this itself; it is
+         * public for callers which read messages from the socket by other means.
+         */
+        bool decompress(Message& m);
+
         unsigned remotePort() const { return psock->remotePort(); }
         virtual HostAndPort remote() const;
         virtual SockAddr remoteAddr() const;
@@ -155,9 +183,16 @@ namespace mongo {
         }
 
     private:
-        
+        // Sends 'toSend', whose id and responseTo are already set, as is.
+        void _say(Message& toSend);
+
         PiggyBackData * piggyBackData;
 
+        MessageCompressor _compressor;
+
+        // The compressors the other end may send messages with.
+        std::vector<MessageCompressor> _acceptedCompressors;
+
         // this is the parsed version of remote
         // mutable because its initialized only on call to remote()
         mutable HostAndPort _remoteParsed; 
@@ -38,6 +38,7 @@
 
 namespace mongo {
 
+    class ClientBasic;
     struct LastError;
 
     class MessageHandler {
@@ -59,15 +60,41 @@ namespace mongo {
          * called once when a socket is disconnected
          */
         virtual void disconnected( AbstractMessagingPort* p ) = 0;
+
+        /**
+         * called by servers which multiplex connections over a pool of worker threads after
+         * connected() or process() returns. Unbinds and returns the per-connection client state
+         * the handler keeps in thread local storage, so that the next call for this connection
+         * can be made from a different thread. The default keeps no such state.
+         */
+        virtual ClientBasic* detachFromThread( AbstractMessagingPort* p ) { return NULL; }
+
+        /**
+         * called before process() or disconnected() to bind state returned by an earlier
+         * detachFromThread() to the calling thread
+         */
+        virtual void attachToThread( AbstractMessagingPort* p , ClientBasic* client ) {}
     };
 
     class MessageServer {
     public:
         struct Options {
+            enum ConnectionModel {
+                // each connection is serviced by its own thread for its whole lifetime
+                kThreadPerConnection,
+
+                // connections are watched by an event loop and handed to a fixed pool of worker
+                // threads only once a complete request has been read
+                kReactor
+            };
+
             int port;                   // port to bind to
             std::string ipList;             // addresses to bind to
+            ConnectionModel connectionModel;
+            int workerThreads;          // size of the kReactor worker pool, 0 picks a default
 
-            Options() : port(0), ipList("") {}
+            Options() : port(0), ipList(""), connectionModel(kThreadPerConnection),
+                        workerThreads(0) {}
         };
 
         virtual ~MessageServer() {}
@@ -76,6 +103,16 @@ namespace mongo {
         virtual void setupSockets() = 0;
     };
 
-    // TODO use a factory here to decide between port and asio variations
+    /**
+     * Creates the server variation selected by opts.connectionModel. Falls back to a thread per
+     * connection if the reactor is not available on this platform or configuration.
+     */
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler );
+
+    /**
+     * @return a server multiplexing connections over a worker pool, or NULL if that is not
+     *     supported on this platform or with the current SSL settings
+     */
+    MessageServer * createReactorServer( const MessageServer::Options& opts ,
+                                         MessageHandler * handler );
 }
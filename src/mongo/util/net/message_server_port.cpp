@@ -268,6 +268,13 @@ namespace {
 
 
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler ) {
+        if ( opts.connectionModel == MessageServer::Options::kReactor ) {
+            MessageServer* server = createReactorServer( opts , handler );
+            if ( server )
+                return server;
+            warning() << "reactor connection model is not available on this platform or with "
+                      << "SSL enabled, using a thread per connection" << endl;
+        }
         return new PortMessageServer( opts , handler );
     }
 
@@ -0,0 +1,541 @@
+// message_server_reactor.cpp
+
+/*    Copyright 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kNetwork
+
+#include "mongo/platform/basic.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <errno.h>
+
+#ifdef __linux__
+# include <sys/epoll.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/config.h"
+#include "mongo/db/client_basic.h"
+#include "mongo/db/lasterror.h"
+#include "mongo/db/server_options.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/util/allocator.h"
+#include "mongo/util/concurrency/synchronization.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/message_server.h"
+#include "mongo/util/net/ssl_options.h"
+#include "mongo/util/processinfo.h"
+#include "mongo/util/time_support.h"
+
+#ifdef __linux__
+
+namespace mongo {
+
+    using boost::scoped_ptr;
+    using std::endl;
+
+namespace {
+
+    const size_t kHeaderLen = sizeof(MSGHEADER::Value);
+
+    // How long the event loop sleeps before checking for shutdown
+    const int kEpollTimeoutMillis = 100;
+    const int kMaxEventsPerWait = 256;
+
+    /**
+     * Everything the reactor keeps for one client connection. While a connection waits for
+     * input it is owned by the epoll set; once a full message is read, or the peer goes away, it
+     * is owned by whichever worker runs the task scheduled for it. EPOLLONESHOT guarantees that
+     * exactly one thread touches it at a time.
+     */
+    struct Connection {
+        MONGO_DISALLOW_COPYING(Connection);
+    public:
+        Connection(const boost::shared_ptr<Socket>& socket, long long connectionId)
+            : port(new MessagingPort(socket)),
+              lastError(new LastError()),
+              client(NULL),
+              headerRead(0),
+              data(NULL),
+              messageLen(0),
+              messageRead(0),
+              bytesIn(0),
+              closeAfterReply(false) {
+            port->setConnectionId(connectionId);
+            port->psock->setLogLevel(logger::LogSeverity::Debug(1));
+        }
+
+        ~Connection() {
+            free(data);
+            delete lastError;
+        }
+
+        scoped_ptr<MessagingPort> port;
+
+        // Bound to the LastErrorHolder of the worker thread while a request is processed
+        LastError* lastError;
+
+        // Opaque per-connection state of the MessageHandler, see MessageHandler::attachToThread
+        ClientBasic* client;
+
+        // Partially read message
+        MSGHEADER::Value header;
+        size_t headerRead;
+        char* data;
+        int messageLen;
+        int messageRead;
+
+        // The last fully read message, handed to a worker
+        Message message;
+
+        // Bytes read since the last request was processed, for networkCounter
+        long long bytesIn;
+
+        // A reply to a handshake which the event loop left for a worker to send, and whether the
+        // connection is closed once it has been sent
+        std::string reply;
+        bool closeAfterReply;
+    };
+
+    enum ReadResult {
+        kNeedMore,
+        kMessageReady,
+        kReplyReady,
+        kClosed
+    };
+
+    class ReactorMessageServer : public MessageServer, public Listener {
+    public:
+        ReactorMessageServer(const MessageServer::Options& opts, MessageHandler* handler)
+            : Listener("", opts.ipList, opts.port),
+              _handler(handler),
+              _epollFD(-1),
+              _workers(NULL) {
+
+            _numWorkers = opts.workerThreads;
+            if (_numWorkers <= 0) {
+                ProcessInfo p;
+                _numWorkers = std::max(4u, p.getNumCores() * 2);
+            }
+        }
+
+        virtual ~ReactorMessageServer() {
+            if (_epollFD >= 0)
+                close(_epollFD);
+        }
+
+        virtual void accepted(boost::shared_ptr<Socket> psocket, long long connectionId) {
+            if (!Listener::globalTicketHolder.tryAcquire()) {
+                log() << "connection refused because too many open connections: "
+                      << Listener::globalTicketHolder.used() << endl;
+                sleepmillis(2);
+                return;
+            }
+
+            // The handler may block (e.g. on authorization setup), so connected() runs on a
+            // worker rather than on the listener thread
+            _workers->schedule(&ReactorMessageServer::_connect,
+                               this,
+                               new Connection(psocket, connectionId));
+        }
+
+        virtual void setAsTimeTracker() {
+            Listener::setAsTimeTracker();
+        }
+
+        virtual void setupSockets() {
+            Listener::setupSockets();
+        }
+
+        void run() {
+            _epollFD = epoll_create1(EPOLL_CLOEXEC);
+            if (_epollFD < 0) {
+                const int err = errno;
+                severe() << "epoll_create1 failed: " << errnoWithDescription(err) << endl;
+                fassertFailed(28626);
+            }
+
+            log() << "servicing connections with " << _numWorkers << " reactor worker threads"
+                  << endl;
+
+            _workers = new ThreadPool(_numWorkers, "reactorWorker");
+            boost::thread eventLoop(stdx::bind(&ReactorMessageServer::_eventLoop, this));
+
+            initAndListen();
+        }
+
+        virtual bool useUnixSockets() const { return true; }
+
+    private:
+        /**
+         * Waits for readable connections, reads whatever input is available without blocking and
+         * hands connections with a complete message (or an EOF) to the worker pool.
+         */
+        void _eventLoop() {
+            setThreadName("reactor");
+
+            struct epoll_event events[kMaxEventsPerWait];
+            while (!inShutdown()) {
+                const int n = epoll_wait(_epollFD, events, kMaxEventsPerWait,
+                                         kEpollTimeoutMillis);
+                if (n < 0) {
+                    const int err = errno;
+                    if (err == EINTR)
+                        continue;
+                    severe() << "epoll_wait failed: " << errnoWithDescription(err) << endl;
+                    fassertFailed(28627);
+                }
+
+                for (int i = 0; i < n; i++) {
+                    Connection* conn = static_cast<Connection*>(events[i].data.ptr);
+
+                    ReadResult result;
+                    try {
+                        result = _readMessage(conn);
+                    }
+                    catch (const DBException& e) {
+                        log() << "DBException reading request, closing client connection: "
+                              << e << endl;
+                        result = kClosed;
+                    }
+
+                    switch (result) {
+                    case kNeedMore:
+                        if (!_arm(conn, EPOLL_CTL_MOD))
+                            _workers->schedule(&ReactorMessageServer::_disconnect, this, conn);
+                        break;
+                    case kMessageReady:
+                        _workers->schedule(&ReactorMessageServer::_process, this, conn);
+                        break;
+                    case kReplyReady:
+                        _workers->schedule(&ReactorMessageServer::_sendReply, this, conn);
+                        break;
+                    case kClosed:
+                        _workers->schedule(&ReactorMessageServer::_disconnect, this, conn);
+                        break;
+                    }
+                }
+            }
+        }
+
+        /**
+         * Reads from the connection's socket until either a complete message has been assembled
+         * or the read would block. Never reads past the end of the current message, so pipelined
+         * requests are left in the kernel buffer and re-reported by epoll.
+         *
+         * Mirrors the handshake handling of MessagingPort::recv, except that replies to the
+         * handshake are left in the connection for a worker to send, as sending may block.
+         */
+        ReadResult _readMessage(Connection* conn) {
+            Socket& sock = *conn->port->psock;
+
+            while (true) {
+                char* dest;
+                size_t wanted;
+                if (conn->headerRead < kHeaderLen) {
+                    dest = reinterpret_cast<char*>(&conn->header) + conn->headerRead;
+                    wanted = kHeaderLen - conn->headerRead;
+                }
+                else {
+                    dest = conn->data + conn->messageRead;
+                    wanted = conn->messageLen - conn->messageRead;
+                }
+
+                const ssize_t got = ::recv(sock.rawFD(), dest, wanted, MSG_DONTWAIT);
+                if (got == 0) {
+                    return kClosed;
+                }
+                if (got < 0) {
+                    const int err = errno;
+                    if (err == EINTR)
+                        continue;
+                    if (err == EAGAIN || err == EWOULDBLOCK)
+                        return kNeedMore;
+                    LOG(sock.getLogLevel()) << "recv() error on " << sock.remoteString()
+                                            << ": " << errnoWithDescription(err) << endl;
+                    return kClosed;
+                }
+                conn->bytesIn += got;
+
+                if (conn->headerRead < kHeaderLen) {
+                    conn->headerRead += got;
+                    if (conn->headerRead < kHeaderLen)
+                        continue;
+
+                    const int len = conn->header.constView().getMessageLength();
+                    if (len == 542393671) {
+                        // an http GET
+                        std::string msg = "It looks like you are trying to access MongoDB over "
+                                          "HTTP on the native driver port.\n";
+                        LOG(sock.getLogLevel()) << msg;
+                        std::stringstream ss;
+                        ss << "HTTP/1.0 200 OK\r\nConnection: close\r\n"
+                           << "Content-Type: text/plain\r\nContent-Length: " << msg.size()
+                           << "\r\n\r\n" << msg;
+                        conn->reply = ss.str();
+                        conn->closeAfterReply = true;
+                        return kReplyReady;
+                    }
+                    else if (len == -1) {
+                        // Endian check from the client, after connecting, to see what mode
+                        // server is running in. Reading resumes once the reply is sent.
+                        unsigned foo = 0x10203040;
+                        conn->reply.assign(reinterpret_cast<char*>(&foo), 4);
+                        conn->closeAfterReply = false;
+                        sock.setHandshakeReceived();
+                        conn->headerRead = 0;
+                        return kReplyReady;
+                    }
+                    else if (sock.isAwaitingHandshake()) {
+                        const int responseTo = conn->header.constView().getResponseTo();
+                        if (responseTo != 0 && responseTo != -1) {
+                            log() << "SSL handshake requested by " << sock.remoteString()
+                                  << ", which is not supported by the reactor connection model"
+                                  << endl;
+                            return kClosed;
+                        }
+                    }
+
+                    if (static_cast<size_t>(len) < kHeaderLen ||
+                        static_cast<size_t>(len) > MaxMessageSizeBytes) {
+                        LOG(0) << "recv(): message len " << len << " is invalid. "
+                               << "Min " << kHeaderLen << " Max: " << MaxMessageSizeBytes;
+                        return kClosed;
+                    }
+
+                    sock.setHandshakeReceived();
+
+                    const int z = (len + 1023) & 0xfffffc00;
+                    verify(z >= len);
+                    conn->data = reinterpret_cast<char*>(mongoMalloc(z));
+                    memcpy(conn->data, &conn->header, kHeaderLen);
+                    conn->messageLen = len;
+                    conn->messageRead = kHeaderLen;
+                }
+                else {
+                    conn->messageRead += got;
+                }
+
+                if (conn->messageRead == conn->messageLen) {
+                    conn->message.setData(conn->data, true);
+                    conn->data = NULL;
+                    conn->headerRead = 0;
+                    conn->messageLen = 0;
+                    conn->messageRead = 0;
+                    if (!conn->port->decompress(conn->message))
+                        return kClosed;
+                    return kMessageReady;
+                }
+            }
+        }
+
+        /**
+         * (Re-)registers interest in the next message on the connection.
+         */
+        bool _arm(Connection* conn, int op) {
+            struct epoll_event event;
+            event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+            event.data.ptr = conn;
+            if (epoll_ctl(_epollFD, op, conn->port->psock->rawFD(), &event) != 0) {
+                const int err = errno;
+                log() << "epoll_ctl failed for " << conn->port->psock->remoteString() << ": "
+                      << errnoWithDescription(err) << endl;
+                return false;
+            }
+            return true;
+        }
+
+        void _attach(Connection* conn) {
+            lastError.reset(conn->lastError);
+            if (conn->client) {
+                _handler->attachToThread(conn->port.get(), conn->client);
+                conn->client = NULL;
+            }
+            else {
+                setThreadName(std::string(str::stream() << "conn"
+                                                        << conn->port->connectionId()));
+            }
+        }
+
+        void _detach(Connection* conn) {
+            conn->client = _handler->detachFromThread(conn->port.get());
+            lastError.release();
+        }
+
+        // Worker tasks. Each one is the sole owner of 'conn' until it re-arms or destroys it.
+
+        void _connect(Connection* conn) {
+            bool ok = true;
+            _attach(conn);
+            try {
+                _handler->connected(conn->port.get());
+            }
+            catch (const DBException& e) {
+                log() << "DBException setting up client connection: " << e << endl;
+                ok = false;
+            }
+            _detach(conn);
+
+            if (ok && !inShutdown() && _arm(conn, EPOLL_CTL_ADD))
+                return;
+            _disconnect(conn);
+        }
+
+        void _process(Connection* conn) {
+            bool ok = true;
+            _attach(conn);
+            try {
+                conn->port->psock->clearCounters();
+                _handler->process(conn->message, conn->port.get(), conn->lastError);
+                networkCounter.hit(conn->bytesIn, conn->port->psock->getBytesOut());
+            }
+            catch (const AssertionException& e) {
+                log() << "AssertionException handling request, closing client connection: "
+                      << e << endl;
+                ok = false;
+            }
+            catch (const SocketException& e) {
+                log() << "SocketException handling request, closing client connection: "
+                      << e << endl;
+                ok = false;
+            }
+            catch (const DBException& e) {
+                // must be right above std::exception to avoid catching subclasses
+                log() << "DBException handling request, closing client connection: " << e
+                      << endl;
+                ok = false;
+            }
+            catch (const std::exception& e) {
+                error() << "Uncaught std::exception: " << e.what() << ", terminating" << endl;
+                dbexit(EXIT_UNCAUGHT);
+            }
+            _detach(conn);
+
+            conn->message.reset();
+            conn->bytesIn = 0;
+            markThreadIdle();
+
+            // Once re-armed the connection may immediately be picked up by another thread, so
+            // it must not be touched afterwards
+            if (ok && !inShutdown() && _arm(conn, EPOLL_CTL_MOD))
+                return;
+            _disconnect(conn);
+        }
+
+        void _sendReply(Connection* conn) {
+            bool ok = !conn->closeAfterReply;
+            try {
+                conn->port->send(conn->reply.c_str(), conn->reply.size(),
+                                 ok ? "endian" : "http");
+            }
+            catch (const SocketException& e) {
+                LOG(conn->port->psock->getLogLevel())
+                    << "SocketException sending handshake reply: " << e << endl;
+                ok = false;
+            }
+            conn->reply.clear();
+
+            if (ok && !inShutdown() && _arm(conn, EPOLL_CTL_MOD))
+                return;
+            _disconnect(conn);
+        }
+
+        void _disconnect(Connection* conn) {
+            MessagingPort* const port = conn->port.get();
+
+            // Not registered if connected() failed, so errors are expected and ignored
+            epoll_ctl(_epollFD, EPOLL_CTL_DEL, port->psock->rawFD(), NULL);
+
+            if (!serverGlobalParams.quiet) {
+                const int conns = Listener::globalTicketHolder.used() - 1;
+                const char* word = (conns == 1 ? " connection" : " connections");
+                log() << "end connection " << port->psock->remoteString()
+                      << " (" << conns << word << " now open)" << endl;
+            }
+            port->shutdown();
+
+            _attach(conn);
+            try {
+                _handler->disconnected(port);
+            }
+            catch (const DBException& e) {
+                log() << "DBException cleaning up client connection: " << e << endl;
+            }
+            _detach(conn);
+
+            delete conn->client;
+            delete conn;
+            Listener::globalTicketHolder.release();
+        }
+
+        MessageHandler* const _handler;
+        int _numWorkers;
+        int _epollFD;
+
+        // Created by run(). Never destroyed, as the worker threads may be running until the
+        // process exits.
+        ThreadPool* _workers;
+    };
+
+}  // namespace
+
+    MessageServer* createReactorServer(const MessageServer::Options& opts,
+                                       MessageHandler* handler) {
+#ifdef MONGO_CONFIG_SSL
+        // The event loop reads raw bytes off the socket, which does not work for SSL connections
+        if (sslGlobalParams.sslMode.load() != SSLParams::SSLMode_disabled)
+            return NULL;
+#endif
+        return new ReactorMessageServer(opts, handler);
+    }
+
+}  // namespace mongo
+
+#else  // __linux__
+
+namespace mongo {
+
+    MessageServer* createReactorServer(const MessageServer::Options& opts,
+                                       MessageHandler* handler) {
+        return NULL;
+    }
+
+}  // namespace mongo
+
+#endif  // __linux__